@@ -35,6 +35,17 @@
 # The optional argument -fopenmp can be supplied to enable multi-threading.
 # By default multi-threading will be disabled to allow compilation on Mac
 # with Clang.
+#
+# SQLite catalogue output can be enabled by setting the environment variable
+# SQLITE=1, e.g. 'SQLITE=1 ./compile.sh -fopenmp'. This requires the SQLite 3
+# library and header files to be installed.
+
+SQLITE_FLAGS=""
+SQLITE_LIBS=""
+if [ -n "$SQLITE" ]; then
+	SQLITE_FLAGS="-DHAVE_SQLITE3"
+	SQLITE_LIBS="-lsqlite3"
+fi
 
 echo "_______________________________________________________________________"
 echo
@@ -65,6 +76,16 @@ echo "  Compiling src/Map.c"
 gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/Map.o -c src/Map.c
 echo "  Compiling src/Matrix.c"
 gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/Matrix.o -c src/Matrix.c
+echo "  Compiling src/PointGrid.c"
+gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/PointGrid.o -c src/PointGrid.c
+echo "  Compiling src/VoxelIndex.c"
+gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/VoxelIndex.o -c src/VoxelIndex.c $1
+echo "  Compiling src/FlagIndex.c"
+gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/FlagIndex.o -c src/FlagIndex.c
+echo "  Compiling src/BitMask.c"
+gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/BitMask.o -c src/BitMask.c $1
+echo "  Compiling src/SparseMask.c"
+gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/SparseMask.o -c src/SparseMask.c $1
 echo "  Compiling src/LinkerPar.c"
 gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/LinkerPar.o -c src/LinkerPar.c $1
 echo "  Compiling src/Parameter.c"
@@ -72,17 +93,17 @@ gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused
 echo "  Compiling src/Source.c"
 gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/Source.o -c src/Source.c
 echo "  Compiling src/Catalog.c"
-gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/Catalog.o -c src/Catalog.c
+gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/Catalog.o -c src/Catalog.c $1 $SQLITE_FLAGS
 echo "  Compiling src/Flagger.c"
 gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/Flagger.o -c src/Flagger.c
 echo "  Compiling src/WCS.c"
-gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/WCS.o -c src/WCS.c
+gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/WCS.o -c src/WCS.c $1
 echo "  Compiling src/Header.c"
 gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/Header.o -c src/Header.c
 echo "  Compiling src/DataCube.c"
 gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o src/DataCube.o -c src/DataCube.c $1
 echo "  Compiling sofia.c"
-gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o sofia src/common.o src/statistics_flt.o src/statistics_dbl.o src/Table.o src/String.o src/Stack.o src/Path.o src/Array_dbl.o src/Array_siz.o src/Map.o src/Matrix.o src/LinkerPar.o src/Parameter.o src/Flagger.o src/WCS.o src/Header.o src/DataCube.o src/Source.o src/Catalog.o sofia.c -lm -lwcs $1
+gcc --std=c99 --pedantic -Wall -Wextra -Wshadow -Wno-unknown-pragmas -Wno-unused-function -Wfatal-errors -O3 -o sofia src/common.o src/statistics_flt.o src/statistics_dbl.o src/Table.o src/String.o src/Stack.o src/Path.o src/Array_dbl.o src/Array_siz.o src/Map.o src/Matrix.o src/PointGrid.o src/VoxelIndex.o src/FlagIndex.o src/BitMask.o src/SparseMask.o src/LinkerPar.o src/Parameter.o src/Flagger.o src/WCS.o src/Header.o src/DataCube.o src/Source.o src/Catalog.o sofia.c -lm -lwcs $1 $SQLITE_FLAGS $SQLITE_LIBS
 
 # Remove object files
 #rm -rf src/*.o
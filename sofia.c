@@ -177,6 +177,7 @@ int main(int argc, char **argv)
 	const bool autoflag_log      = Parameter_get_bool(par, "flag.log");
 	const bool use_cont_sub      = Parameter_get_bool(par, "contsub.enable");
 	const bool use_noise_scaling = Parameter_get_bool(par, "scaleNoise.enable");
+	const bool use_sn_local      = (strcmp(Parameter_get_str(par, "scaleNoise.mode"), "local") == 0);
 	const bool use_sc_scaling    = Parameter_get_bool(par, "scaleNoise.scfind");
 	const bool use_spat_filter   = Parameter_get_bool(par, "spatFilter.enable");
 	const bool use_scfind        = Parameter_get_bool(par, "scfind.enable");
@@ -186,6 +187,8 @@ int main(int argc, char **argv)
 	const bool use_reliability   = Parameter_get_bool(par, "reliability.enable");
 	const bool use_rel_plot      = Parameter_get_bool(par, "reliability.plot");
 	const bool use_rel_cat       = strlen(Parameter_get_str(par, "reliability.catalog")) ? true : false;
+	const bool use_rel_sweep     = Parameter_get_bool(par, "reliability.sweep");
+	const bool use_rel_dens      = Parameter_get_bool(par, "reliability.sweepDensity");
 	const bool use_mask_dilation = Parameter_get_bool(par, "dilation.enable");
 	const bool use_parameteriser = Parameter_get_bool(par, "parameter.enable");
 	const bool use_wcs           = Parameter_get_bool(par, "parameter.wcs");
@@ -195,6 +198,10 @@ int main(int argc, char **argv)
 	const bool write_ascii       = Parameter_get_bool(par, "output.writeCatASCII");
 	const bool write_xml         = Parameter_get_bool(par, "output.writeCatXML");
 	const bool write_sql         = Parameter_get_bool(par, "output.writeCatSQL");
+	const bool write_fits        = Parameter_get_bool(par, "output.writeCatFITS");
+	const bool write_sqlite      = Parameter_get_bool(par, "output.writeCatSQLite");
+	const bool sqlite_data       = Parameter_get_bool(par, "output.sqliteSourceData");
+	const bool binary_xml        = Parameter_get_bool(par, "output.binaryCatXML");
 	const bool write_noise       = Parameter_get_bool(par, "output.writeNoise");
 	const bool write_filtered    = Parameter_get_bool(par, "output.writeFiltered");
 	const bool write_mask        = Parameter_get_bool(par, "output.writeMask");
@@ -251,6 +258,11 @@ int main(int argc, char **argv)
 	// Linker sanity check
 	ensure(use_linker || write_noise || write_filtered || write_rawmask, ERR_USER_INPUT, "When disabling the linker, you will want to write either the\n       noise cube, the filtered cube or the raw mask, as otherwise\n       no output would be produced at all.");
 	
+	// SQLite sanity check
+	#ifndef HAVE_SQLITE3
+		ensure(!write_sqlite, ERR_USER_INPUT, "SQLite catalogue output requested, but SoFiA was compiled without\n       SQLite support. Please recompile with SQLite enabled or set\n       output.writeCatSQLite = false.");
+	#endif
+	
 	
 	
 	// ---------------------------- //
@@ -290,7 +302,10 @@ int main(int argc, char **argv)
 	Path *path_cat_ascii = Path_new();
 	Path *path_cat_xml   = Path_new();
 	Path *path_cat_sql   = Path_new();
+	Path *path_cat_fits  = Path_new();
+	Path *path_cat_db    = Path_new();
 	Path *path_noise_out = Path_new();
+	Path *path_noise_spec = Path_new();
 	Path *path_filtered  = Path_new();
 	Path *path_mask_out  = Path_new();
 	Path *path_mask_2d   = Path_new();
@@ -301,6 +316,8 @@ int main(int argc, char **argv)
 	Path *path_chan      = Path_new();
 	Path *path_rel_plot  = Path_new();
 	Path *path_skel_plot = Path_new();
+	Path *path_rel_sweep = Path_new();
+	Path *path_rel_dens  = Path_new();
 	Path *path_flag      = Path_new();
 	Path *path_cubelets  = Path_new();
 	
@@ -308,7 +325,10 @@ int main(int argc, char **argv)
 	Path_set_dir(path_cat_ascii, String_get(output_dir_name));
 	Path_set_dir(path_cat_xml,   String_get(output_dir_name));
 	Path_set_dir(path_cat_sql,   String_get(output_dir_name));
+	Path_set_dir(path_cat_fits,  String_get(output_dir_name));
+	Path_set_dir(path_cat_db,    String_get(output_dir_name));
 	Path_set_dir(path_noise_out, String_get(output_dir_name));
+	Path_set_dir(path_noise_spec, String_get(output_dir_name));
 	Path_set_dir(path_filtered,  String_get(output_dir_name));
 	Path_set_dir(path_mask_out,  String_get(output_dir_name));
 	Path_set_dir(path_mask_2d,   String_get(output_dir_name));
@@ -319,6 +339,8 @@ int main(int argc, char **argv)
 	Path_set_dir(path_chan,      String_get(output_dir_name));
 	Path_set_dir(path_rel_plot,  String_get(output_dir_name));
 	Path_set_dir(path_skel_plot, String_get(output_dir_name));
+	Path_set_dir(path_rel_sweep, String_get(output_dir_name));
+	Path_set_dir(path_rel_dens,  String_get(output_dir_name));
 	Path_set_dir(path_flag,      String_get(output_dir_name));
 	Path_set_dir(path_cubelets,  String_get(output_dir_name));
 	
@@ -326,7 +348,10 @@ int main(int argc, char **argv)
 	Path_set_file_from_template(path_cat_ascii,  String_get(output_file_name), "_cat",      ".txt");
 	Path_set_file_from_template(path_cat_xml,    String_get(output_file_name), "_cat",      ".xml");
 	Path_set_file_from_template(path_cat_sql,    String_get(output_file_name), "_cat",      ".sql");
+	Path_set_file_from_template(path_cat_fits,   String_get(output_file_name), "_cat",      ".fits");
+	Path_set_file_from_template(path_cat_db,     String_get(output_file_name), "_cat",      ".sqlite");
 	Path_set_file_from_template(path_noise_out,  String_get(output_file_name), "_noise",    ".fits");
+	Path_set_file_from_template(path_noise_spec, String_get(output_file_name), "_noise_spec", ".txt");
 	Path_set_file_from_template(path_filtered,   String_get(output_file_name), "_filtered", ".fits");
 	Path_set_file_from_template(path_mask_out,   String_get(output_file_name), "_mask",     ".fits");
 	Path_set_file_from_template(path_mask_2d,    String_get(output_file_name), "_mask-2d",  ".fits");
@@ -337,6 +362,8 @@ int main(int argc, char **argv)
 	Path_set_file_from_template(path_chan,       String_get(output_file_name), "_chan",     ".fits");
 	Path_set_file_from_template(path_rel_plot,   String_get(output_file_name), "_rel",      ".eps");
 	Path_set_file_from_template(path_skel_plot,  String_get(output_file_name), "_skellam",  ".eps");
+	Path_set_file_from_template(path_rel_sweep,  String_get(output_file_name), "_rel_sweep", ".txt");
+	Path_set_file_from_template(path_rel_dens,   String_get(output_file_name), "_rel_dens", ".txt");
 	Path_set_file_from_template(path_flag,       String_get(output_file_name), "_flags",    ".log");
 	
 	// Set up cubelet directory and file base name
@@ -384,11 +411,26 @@ int main(int argc, char **argv)
 				"SQL catalogue file already exists. Please delete the file\n"
 				"       or set \'output.overwrite = true\'.");
 		}
+		if(write_fits) {
+			ensure(!Path_file_is_readable(path_cat_fits), ERR_FILE_ACCESS,
+				"FITS catalogue file already exists. Please delete the file\n"
+				"       or set \'output.overwrite = true\'.");
+		}
+		if(write_sqlite) {
+			ensure(!Path_file_is_readable(path_cat_db), ERR_FILE_ACCESS,
+				"SQLite catalogue file already exists. Please delete the file\n"
+				"       or set \'output.overwrite = true\'.");
+		}
 		if(write_noise) {
 			ensure(!Path_file_is_readable(path_noise_out), ERR_FILE_ACCESS,
 				"Noise cube already exists. Please delete the file\n"
 				"       or set \'output.overwrite = true\'.");
 		}
+		if(write_noise && use_noise_scaling && !use_sn_local) {
+			ensure(!Path_file_is_readable(path_noise_spec), ERR_FILE_ACCESS,
+				"Noise spectrum already exists. Please delete the file\n"
+				"       or set \'output.overwrite = true\'.");
+		}
 		if(write_filtered) {
 			ensure(!Path_file_is_readable(path_filtered), ERR_FILE_ACCESS,
 				"Filtered cube already exists. Please delete the file\n"
@@ -425,6 +467,14 @@ int main(int argc, char **argv)
 				"Skellam plot already exists. Please delete the file\n"
 				"       or set \'output.overwrite = true\'.");*/
 		}
+		if(use_reliability && use_rel_sweep) {
+			ensure(!Path_file_is_readable(path_rel_sweep), ERR_FILE_ACCESS,
+				"Reliability sweep table already exists. Please delete the file\n"
+				"       or set \'output.overwrite = true\'.");
+			ensure(!use_rel_dens || !Path_file_is_readable(path_rel_dens), ERR_FILE_ACCESS,
+				"Reliability density file already exists. Please delete the file\n"
+				"       or set \'output.overwrite = true\'.");
+		}
 		if(autoflag_log) {
 			ensure(!Path_file_is_readable(path_flag), ERR_FILE_ACCESS,
 				"Flagging log file already exists. Please delete the file\n"
@@ -453,8 +503,13 @@ int main(int argc, char **argv)
 	// (Yes, some data cubes do contain those!)
 	if(DataCube_flag_infinity(dataCube, flag_regions)) use_flagging = true;
 	
-	// Apply flags if required
-	if(use_flagging) DataCube_flag_regions(dataCube, flag_regions);
+	// Normalise flagging regions for reuse on all cubes and apply flags if required
+	FlagIndex *flag_index = NULL;
+	if(use_flagging)
+	{
+		flag_index = FlagIndex_new(DataCube_get_axis_size(dataCube, 0), DataCube_get_axis_size(dataCube, 1), DataCube_get_axis_size(dataCube, 2), flag_regions);
+		DataCube_apply_flags(dataCube, flag_index);
+	}
 	
 	// Invert cube if requested
 	if(use_invert)
@@ -558,7 +613,7 @@ int main(int argc, char **argv)
 	{
 		status("Scaling data by noise");
 		
-		if(strcmp(Parameter_get_str(par, "scaleNoise.mode"), "local") == 0)
+		if(use_sn_local)
 		{
 			// Local noise scaling
 			message("Correcting for local noise variations.");
@@ -579,7 +634,7 @@ int main(int argc, char **argv)
 			if(write_noise)
 			{
 				// Apply flags to noise cube
-				if(use_flagging) DataCube_flag_regions(noiseCube, flag_regions);
+				if(use_flagging) DataCube_apply_flags(noiseCube, flag_index);
 				DataCube_save(noiseCube, Path_get(path_noise_out), overwrite, DESTROY);
 			}
 			DataCube_delete(noiseCube);
@@ -590,7 +645,42 @@ int main(int argc, char **argv)
 			message("Correcting for noise variations along spectral axis.");
 			message("- Noise statistic:  %s", noise_stat_name[sn_statistic]);
 			message("- Flux range:       %s\n", flux_range_name[sn_range + 1]);
-			DataCube_scale_noise_spec(dataCube, sn_statistic, sn_range);
+			Array_dbl *noise_spec = DataCube_scale_noise_spec(dataCube, sn_statistic, sn_range);
+			
+			// Write noise spectrum to text file if requested
+			if(write_noise)
+			{
+				// Try to open output file
+				FILE *fp;
+				if(overwrite) fp = fopen(Path_get(path_noise_spec), "wb");
+				else fp = fopen(Path_get(path_noise_spec), "wxb");
+				
+				// If successful...
+				if(fp != NULL)
+				{
+					// ...write out noise level of each channel...
+					message("Writing noise spectrum: %s", Path_get_file(path_noise_spec));
+					fprintf(fp, "# Noise spectrum\n");
+					fprintf(fp, "# Creator: %s\n#\n", SOFIA_VERSION_FULL);
+					fprintf(fp, "# Noise statistic: %s\n", noise_stat_name[sn_statistic]);
+					fprintf(fp, "# Flux range:      %s\n", flux_range_name[sn_range + 1]);
+					fprintf(fp, "# Note that channel numbers will be relative to subregion\n");
+					fprintf(fp, "# unless parameter.offset was set to true.\n#\n");
+					fprintf(fp, "#%*s%*s\n", 9, "Channel", 18, "Noise");
+					fprintf(fp, "#\n");
+					
+					for(size_t i = 0; i < Array_dbl_get_size(noise_spec); ++i)
+					{
+						fprintf(fp, "%*zu%*.7e\n", 10, i + ((use_region && use_pos_offset) ? Array_siz_get(region, 4) : 0), 18, Array_dbl_get(noise_spec, i));
+					}
+					
+					// ...and close output file again
+					fclose(fp);
+				}
+				else warning("Failed to write noise spectrum: %s", Path_get_file(path_noise_spec));
+			}
+			
+			Array_dbl_delete(noise_spec);
 		}
 		
 		// Print time
@@ -616,9 +706,14 @@ int main(int argc, char **argv)
 		// Apply flags if necessary
 		if(size)
 		{
-			DataCube_flag_regions(dataCube, autoflag_regions);  // Apply auto-flagging regions
 			Array_siz_cat(flag_regions, autoflag_regions);      // Append auto-flagging regions to general flagging regions
 			use_flagging = true;                                // Update flagging switch
+			
+			// Update flagging index and apply it
+			// NOTE: Re-blanking the already flagged user regions is harmless.
+			FlagIndex_delete(flag_index);
+			flag_index = FlagIndex_new(DataCube_get_axis_size(dataCube, 0), DataCube_get_axis_size(dataCube, 1), DataCube_get_axis_size(dataCube, 2), flag_regions);
+			DataCube_apply_flags(dataCube, flag_index);
 		}
 		else message("No flagging required.");
 		
@@ -758,10 +853,8 @@ int main(int argc, char **argv)
 	// Terminate if no source finder is to be run, but no input mask is provided either
 	ensure(use_scfind || use_threshold || use_mask, ERR_USER_INPUT, "No mask provided and no source finder selected. Cannot proceed.");
 	
-	// Create temporary 8-bit mask to hold source finding output
-	DataCube *maskCubeTmp = DataCube_blank(DataCube_get_axis_size(dataCube, 0), DataCube_get_axis_size(dataCube, 1), DataCube_get_axis_size(dataCube, 2), 8, verbosity);
-	DataCube_copy_wcs(dataCube, maskCubeTmp);
-	DataCube_puthd_str(maskCubeTmp, "BUNIT", " ");
+	// Create temporary bit mask to hold source finding output
+	BitMask *maskBits = BitMask_new(DataCube_get_axis_size(dataCube, 0), DataCube_get_axis_size(dataCube, 1), DataCube_get_axis_size(dataCube, 2));
 	
 	// S+C finder
 	if(use_scfind)
@@ -801,7 +894,7 @@ int main(int argc, char **argv)
 		// Run S+C finder to obtain mask
 		DataCube_run_scfind(
 			dataCube,
-			maskCubeTmp,
+			maskBits,
 			kernels_spat,
 			kernels_spec,
 			Parameter_get_flt(par, "scfind.threshold"),
@@ -825,7 +918,7 @@ int main(int argc, char **argv)
 		Array_siz_delete(kernels_spec);
 		
 		// Apply flags to mask cube
-		if(use_flagging) DataCube_flag_regions(maskCubeTmp, flag_regions);
+		if(use_flagging) BitMask_apply_flags(maskBits, flag_index);
 	}
 	
 	// Threshold finder
@@ -847,7 +940,7 @@ int main(int argc, char **argv)
 		// Run threshold finder
 		DataCube_run_threshold(
 			dataCube,
-			maskCubeTmp,
+			maskBits,
 			absolute,
 			Parameter_get_flt(par, "threshold.threshold"),
 			tf_statistic,
@@ -855,7 +948,7 @@ int main(int argc, char **argv)
 		);
 		
 		// Apply flags to mask cube
-		if(use_flagging) DataCube_flag_regions(maskCubeTmp, flag_regions);
+		if(use_flagging) BitMask_apply_flags(maskBits, flag_index);
 		
 		// Print time
 		timestamp(start_time, start_clock);
@@ -870,7 +963,12 @@ int main(int argc, char **argv)
 	if(write_rawmask)
 	{
 		status("Writing raw binary mask");
-		DataCube_save(maskCubeTmp, Path_get(path_mask_raw), overwrite, DESTROY);
+		DataCube *maskCubeRaw = DataCube_blank(DataCube_get_axis_size(dataCube, 0), DataCube_get_axis_size(dataCube, 1), DataCube_get_axis_size(dataCube, 2), 8, verbosity);
+		DataCube_copy_wcs(dataCube, maskCubeRaw);
+		DataCube_puthd_str(maskCubeRaw, "BUNIT", " ");
+		DataCube_copy_bitmask(maskCubeRaw, maskBits, 1);
+		DataCube_save(maskCubeRaw, Path_get(path_mask_raw), overwrite, DESTROY);
+		DataCube_delete(maskCubeRaw);
 		
 		// Print time
 		timestamp(start_time, start_clock);
@@ -939,7 +1037,7 @@ int main(int argc, char **argv)
 		}
 		
 		// Apply flags to mask cube
-		if(use_flagging) DataCube_flag_regions(maskCube, flag_regions);
+		if(use_flagging) DataCube_apply_flags(maskCube, flag_index);
 	}
 	else
 	{
@@ -961,11 +1059,11 @@ int main(int argc, char **argv)
 	// ---------------------------- //
 	
 	// Copy SF mask prior to linking
-	const size_t n_pix_det = DataCube_copy_mask_32(maskCube, maskCubeTmp, -1);
+	const size_t n_pix_det = DataCube_copy_bitmask(maskCube, maskBits, -1);
 	message("%zu pixels detected by source finder (%.3f%%).", n_pix_det, 100.0 * (double)(n_pix_det) / (double)(DataCube_get_size(maskCube)));
 	
 	// Delete temporary SF mask again
-	DataCube_delete(maskCubeTmp);
+	BitMask_delete(maskBits);
 	
 	// Print time
 	timestamp(start_time, start_clock);
@@ -982,6 +1080,9 @@ int main(int argc, char **argv)
 	
 	const bool remove_neg_src = !use_reliability && !keep_negative;  // ALERT: Add conditions here as needed.
 	
+	// Index of source voxels, created by the linker and kept up to date until the end
+	VoxelIndex *voxel_index = NULL;
+	
 	LinkerPar *lpar = DataCube_run_linker(
 		dataCube,
 		maskCube,
@@ -995,7 +1096,8 @@ int main(int argc, char **argv)
 		Parameter_get_int(par, "linker.maxSizeXY"),
 		Parameter_get_int(par, "linker.maxSizeZ"),
 		remove_neg_src,
-		global_rms
+		global_rms,
+		&voxel_index
 	);
 	
 	// Print time
@@ -1006,6 +1108,17 @@ int main(int argc, char **argv)
 	
 	
 	
+	// ---------------------------- //
+	// Convert mask to sparse form  //
+	// ---------------------------- //
+	
+	// NOTE: All remaining steps apart from mask dilation only need to
+	//       visit the labelled voxels, so the dense mask is released
+	//       here and only restored temporarily for mask dilation.
+	SparseMask *sparseMask = DataCube_to_sparse_mask(maskCube);
+	
+	
+	
 	// ---------------------------- //
 	// Run reliability filter       //
 	// ---------------------------- //
@@ -1040,15 +1153,28 @@ int main(int argc, char **argv)
 				
 				if(wcs != NULL)
 				{
-					// Loop over all rows and convert WCS to pixels
-					for(size_t row = 0; row < Table_rows(rel_cat); ++row)
+					// Convert all rows from WCS to pixels in one go
+					const size_t n_rows = Table_rows(rel_cat);
+					double *world = (double *)memory(MALLOC, 4 * n_rows, sizeof(double));
+					double *pixel = world + 2 * n_rows;
+					
+					for(size_t row = 0; row < n_rows; ++row)
+					{
+						world[row]          = Table_get(rel_cat, row, 0);
+						world[row + n_rows] = Table_get(rel_cat, row, 1);
+						pixel[row]          = -1e+30;
+						pixel[row + n_rows] = -1e+30;
+					}
+					
+					WCS_convertToPixelArray(wcs, n_rows, world, world + n_rows, NULL, pixel, pixel + n_rows, NULL);
+					
+					for(size_t row = 0; row < n_rows; ++row)
 					{
-						double lon = -1e+30;
-						double lat = -1e+30;
-						WCS_convertToPixel(wcs, Table_get(rel_cat, row, 0), Table_get(rel_cat, row, 1), 0.0, &lon, &lat, NULL);
-						Table_set(rel_cat, row, 0, lon);
-						Table_set(rel_cat, row, 1, lat);
+						Table_set(rel_cat, row, 0, pixel[row]);
+						Table_set(rel_cat, row, 1, pixel[row + n_rows]);
 					}
+					
+					free(world);
 				}
 				else
 				{
@@ -1063,11 +1189,27 @@ int main(int argc, char **argv)
 		}
 		
 		// Calculate reliability values
-		Matrix *covar = LinkerPar_reliability(lpar, Parameter_get_flt(par, "reliability.scaleKernel"), rel_fmin, rel_cat);
+		Matrix *covar = LinkerPar_reliability(lpar, Parameter_get_flt(par, "reliability.scaleKernel"), rel_fmin, Parameter_get_flt(par, "reliability.kernelCutoff"), rel_cat);
 		
 		// Create plots if requested
 		if(use_rel_plot) LinkerPar_rel_plots(lpar, rel_threshold, rel_fmin, covar, Path_get(path_rel_plot), overwrite);
 		
+		// Sweep reliability parameters if requested
+		if(use_rel_sweep)
+		{
+			message("\nRunning reliability parameter sweep.");
+			Array_dbl *sweep_kernel    = Array_dbl_new_str(Parameter_get_str(par, "reliability.sweepKernel"));
+			Array_dbl *sweep_threshold = Array_dbl_new_str(Parameter_get_str(par, "reliability.sweepThreshold"));
+			Array_dbl *sweep_fmin      = Array_dbl_new_str(Parameter_get_str(par, "reliability.sweepFmin"));
+			
+			LinkerPar_rel_sweep(lpar, sweep_kernel, sweep_threshold, sweep_fmin, Parameter_get_flt(par, "reliability.kernelCutoff"), rel_cat, Path_get(path_rel_sweep), use_rel_dens ? Path_get(path_rel_dens) : NULL, overwrite);
+			message("Reliability sweep table written to: %s", Path_get_file(path_rel_sweep));
+			
+			Array_dbl_delete(sweep_kernel);
+			Array_dbl_delete(sweep_threshold);
+			Array_dbl_delete(sweep_fmin);
+		}
+		
 		// Delete covariance matrix and catalogue table again
 		Matrix_delete(covar);
 		Table_delete(rel_cat);
@@ -1087,9 +1229,10 @@ int main(int argc, char **argv)
 		ensure(Map_get_size(rel_filter), ERR_NO_SRC_FOUND, "No reliable sources found. Terminating pipeline.");
 		message("%zu reliable sources found.", Map_get_size(rel_filter));
 		
-		// Apply filter to mask cube, so unreliable sources are removed
-		// and reliable ones relabelled in consecutive order
-		DataCube_filter_mask_32(maskCube, rel_filter);
+		// Apply filter to sparse mask and voxel index, so unreliable sources
+		// are removed and reliable ones relabelled in consecutive order
+		SparseMask_relabel(sparseMask, rel_filter);
+		VoxelIndex_relabel(voxel_index, rel_filter);
 		
 		// Print time
 		timestamp(start_time, start_clock);
@@ -1132,11 +1275,18 @@ int main(int argc, char **argv)
 	{
 		status("Mask dilation");
 		
+		// Restore dense mask, as dilation needs to look up neighbouring voxels
+		DataCube_from_sparse_mask(maskCube, sparseMask);
+		SparseMask_delete(sparseMask);
+		
 		message("Spectral dilation");
-		DataCube_dilate_mask_z(dataCube, maskCube, catalog, Parameter_get_int(par, "dilation.iterationsZ"), Parameter_get_flt(par, "dilation.threshold"));
+		DataCube_dilate_mask_z(dataCube, maskCube, catalog, Parameter_get_int(par, "dilation.iterationsZ"), Parameter_get_flt(par, "dilation.threshold"), voxel_index);
 		
 		message("Spatial dilation");
-		DataCube_dilate_mask_xy(dataCube, maskCube, catalog, Parameter_get_int(par, "dilation.iterationsXY"), Parameter_get_flt(par, "dilation.threshold"));
+		DataCube_dilate_mask_xy(dataCube, maskCube, catalog, Parameter_get_int(par, "dilation.iterationsXY"), Parameter_get_flt(par, "dilation.threshold"), voxel_index);
+		
+		// Release dense mask again
+		sparseMask = DataCube_to_sparse_mask(maskCube);
 		
 		// Print time
 		timestamp(start_time, start_clock);
@@ -1153,7 +1303,7 @@ int main(int argc, char **argv)
 		DataCube_load(dataCube, Path_get(path_data_in), region);
 		
 		// Apply flags if required
-		if(use_flagging) DataCube_flag_regions(dataCube, flag_regions);
+		if(use_flagging) DataCube_apply_flags(dataCube, flag_index);
 		
 		// Apply flagging catalogue if required		
 		if(use_flagging_cat) DataCube_continuum_flagging(dataCube, Parameter_get_str(par, "flag.catalog"), 1, Parameter_get_int(par, "flag.radius"));
@@ -1192,7 +1342,7 @@ int main(int argc, char **argv)
 	if(use_parameteriser)
 	{
 		status("Measuring source parameters");
-		DataCube_parameterise(dataCube, maskCube, catalog, use_wcs, use_physical, Parameter_get_str(par, "parameter.prefix"));
+		DataCube_parameterise(dataCube, maskCube, catalog, use_wcs, use_physical, Parameter_get_str(par, "parameter.prefix"), voxel_index, sparseMask);
 		
 		// Print time
 		timestamp(start_time, start_clock);
@@ -1207,7 +1357,7 @@ int main(int argc, char **argv)
 	if(write_cubelets)
 	{
 		status("Creating cubelets");
-		DataCube_create_cubelets(dataCube, maskCube, catalog, Path_get(path_cubelets), overwrite, use_wcs, use_physical, Parameter_get_int(par, "output.marginCubelets"));
+		DataCube_create_cubelets(dataCube, maskCube, catalog, Path_get(path_cubelets), overwrite, use_wcs, use_physical, Parameter_get_int(par, "output.marginCubelets"), voxel_index);
 		
 		// Print time
 		timestamp(start_time, start_clock);
@@ -1228,7 +1378,7 @@ int main(int argc, char **argv)
 		DataCube *mom1 = NULL;
 		DataCube *mom2 = NULL;
 		DataCube *chan = NULL;
-		DataCube_create_moments(dataCube, maskCube, &mom0, &mom1, &mom2, &chan, NULL, use_wcs, true);
+		DataCube_create_moments_sparse(dataCube, sparseMask, &mom0, &mom1, &mom2, &chan, NULL, use_wcs, true);
 		
 		// Save moment maps to disk
 		if(mom0 != NULL) DataCube_save(mom0, Path_get(path_mom0), overwrite, DESTROY);
@@ -1259,13 +1409,13 @@ int main(int argc, char **argv)
 		// Create and save projected 2-D mask image
 		if(write_mask2d)
 		{
-			DataCube *maskImage = DataCube_2d_mask(maskCube);
+			DataCube *maskImage = DataCube_2d_sparse_mask(maskCube, sparseMask);
 			DataCube_save(maskImage, Path_get(path_mask_2d), overwrite, DESTROY);
 			DataCube_delete(maskImage);
 		}
 		
 		// Write 3-D mask cube
-		if(write_mask) DataCube_save(maskCube, Path_get(path_mask_out), overwrite, DESTROY);
+		if(write_mask) DataCube_save_sparse_mask(maskCube, sparseMask, Path_get(path_mask_out), overwrite);
 		
 		// Print time
 		timestamp(start_time, start_clock);
@@ -1277,20 +1427,19 @@ int main(int argc, char **argv)
 	// Save catalogue(s)            //
 	// ---------------------------- //
 	
-	if(write_ascii || write_xml || write_sql)
+	if(write_ascii || write_xml || write_sql || write_fits || write_sqlite)
 	{
 		status("Writing source catalogue");
 		
+		// Extract source spectra and voxels for database if requested
+		// NOTE: This must be done before any position offset is applied.
+		Array_dbl **spectra = NULL;
+		Array_siz **voxels = NULL;
+		if(write_sqlite && sqlite_data) DataCube_get_source_data(dataCube, maskCube, catalog, use_physical, voxel_index, &spectra, &voxels);
+		
 		// Correct x, y and z for subregion offset if requested
 		// WARNING: This will alter the original x, y and z positions!
-		if(use_region && use_pos_offset)
-		{
-			for(size_t i = Catalog_get_size(catalog); i--;)
-			{
-				Source *src = Catalog_get_source(catalog, i);
-				Source_offset_xyz(src, Array_siz_get(region, 0), Array_siz_get(region, 2), Array_siz_get(region, 4));
-			}
-		}
+		if(use_region && use_pos_offset) Catalog_offset_xyz(catalog, Array_siz_get(region, 0), Array_siz_get(region, 2), Array_siz_get(region, 4));
 		
 		if(write_ascii)
 		{
@@ -1301,7 +1450,7 @@ int main(int argc, char **argv)
 		if(write_xml)
 		{
 			message("Writing VOTable file: %s", Path_get_file(path_cat_xml));
-			Catalog_save(catalog, Path_get(path_cat_xml), CATALOG_FORMAT_XML, overwrite);
+			Catalog_save(catalog, Path_get(path_cat_xml), binary_xml ? CATALOG_FORMAT_XML_BINARY : CATALOG_FORMAT_XML, overwrite);
 		}
 		
 		if(write_sql)
@@ -1310,6 +1459,30 @@ int main(int argc, char **argv)
 			Catalog_save(catalog, Path_get(path_cat_sql), CATALOG_FORMAT_SQL, overwrite);
 		}
 		
+		if(write_fits)
+		{
+			message("Writing FITS file:    %s", Path_get_file(path_cat_fits));
+			Catalog_save(catalog, Path_get(path_cat_fits), CATALOG_FORMAT_FITS, overwrite);
+		}
+		
+		if(write_sqlite)
+		{
+			message("Writing SQLite file:  %s", Path_get_file(path_cat_db));
+			Catalog_save_sqlite(catalog, Path_get(path_cat_db), overwrite, spectra, voxels);
+		}
+		
+		// Delete source spectra and voxels
+		if(spectra != NULL)
+		{
+			for(size_t i = 0; i < Catalog_get_size(catalog); ++i)
+			{
+				Array_dbl_delete(spectra[i]);
+				Array_siz_delete(voxels[i]);
+			}
+			free(spectra);
+			free(voxels);
+		}
+		
 		// Print time
 		timestamp(start_time, start_clock);
 	}
@@ -1320,8 +1493,10 @@ int main(int argc, char **argv)
 	// Clean up and exit            //
 	// ---------------------------- //
 	
-	// Delete data cube and mask cube
+	// Delete data cube, mask cube, sparse mask and voxel index
 	DataCube_delete(maskCube);
+	SparseMask_delete(sparseMask);
+	VoxelIndex_delete(voxel_index);
 	DataCube_delete(dataCube);
 	
 	// Delete sub-cube region
@@ -1329,6 +1504,7 @@ int main(int argc, char **argv)
 	
 	// Delete flagging regions
 	Array_siz_delete(flag_regions);
+	FlagIndex_delete(flag_index);
 	
 	// Delete input parameters
 	Parameter_delete(par);
@@ -1342,10 +1518,13 @@ int main(int argc, char **argv)
 	Path_delete(path_cat_ascii);
 	Path_delete(path_cat_xml);
 	Path_delete(path_cat_sql);
+	Path_delete(path_cat_fits);
+	Path_delete(path_cat_db);
 	Path_delete(path_mask_out);
 	Path_delete(path_mask_2d);
 	Path_delete(path_mask_raw);
 	Path_delete(path_noise_out);
+	Path_delete(path_noise_spec);
 	Path_delete(path_filtered);
 	Path_delete(path_mom0);
 	Path_delete(path_mom1);
@@ -1353,6 +1532,8 @@ int main(int argc, char **argv)
 	Path_delete(path_chan);
 	Path_delete(path_rel_plot);
 	Path_delete(path_skel_plot);
+	Path_delete(path_rel_sweep);
+	Path_delete(path_rel_dens);
 	Path_delete(path_flag);
 	Path_delete(path_cubelets);
 	
@@ -0,0 +1,404 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (BitMask.c) - Source Finding Application                 ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "BitMask.h"
+
+
+
+// ----------------------------------------------------------------- //
+// Declaration of properties of class BitMask                        //
+// ----------------------------------------------------------------- //
+
+CLASS BitMask
+{
+	size_t    size[3];
+	size_t    n_voxels;
+	size_t    n_words;
+	uint64_t *data;
+};
+
+
+
+// ----------------------------------------------------------------- //
+// Standard constructor                                              //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) size_x   - Size of the cube in x.                           //
+//   (2) size_y   - Size of the cube in y.                           //
+//   (3) size_z   - Size of the cube in z.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Pointer to newly created BitMask object.                        //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Standard constructor. Will create a new BitMask object for a    //
+//   cube of the specified size with all bits initially set to 0.    //
+//   Note that the destructor will need to be called explicitly once //
+//   the object is no longer required to release any memory alloca-  //
+//   ted during the lifetime of the object.                          //
+// ----------------------------------------------------------------- //
+
+PUBLIC BitMask *BitMask_new(const size_t size_x, const size_t size_y, const size_t size_z)
+{
+	// Sanity checks
+	ensure(size_x && size_y && size_z, ERR_USER_INPUT, "Cannot create bit mask for empty cube.");
+	
+	BitMask *self = (BitMask *)memory(MALLOC, 1, sizeof(BitMask));
+	
+	self->size[0]  = size_x;
+	self->size[1]  = size_y;
+	self->size[2]  = size_z;
+	self->n_voxels = size_x * size_y * size_z;
+	self->n_words  = (self->n_voxels + BITMASK_WORD_BITS - 1) / BITMASK_WORD_BITS;
+	self->data     = (uint64_t *)memory(CALLOC, self->n_words, sizeof(uint64_t));
+	
+	return self;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Destructor                                                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Destructor. Note that the destructor must be called explicitly  //
+//   if the object is no longer required. This will release the me-  //
+//   mory occupied by the object.                                    //
+// ----------------------------------------------------------------- //
+
+PUBLIC void BitMask_delete(BitMask *self)
+{
+	if(self != NULL) free(self->data);
+	free(self);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return size of cube along specified axis                          //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) axis     - Axis (0, 1 or 2) for which to return the size.   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Size of the cube along the specified axis.                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the size of the cube for which the  //
+//   bit mask was created along the specified axis.                  //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t BitMask_get_axis_size(const BitMask *self, const size_t axis)
+{
+	check_null(self);
+	ensure(axis < 3, ERR_INDEX_RANGE, "Axis must be 0, 1 or 2.");
+	return self->size[axis];
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return total number of voxels                                     //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Total number of voxels covered by the mask.                     //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the total number of voxels (i.e.    //
+//   bits) covered by the mask.                                      //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t BitMask_get_size(const BitMask *self)
+{
+	check_null(self);
+	return self->n_voxels;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return number of 64-bit words                                     //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of 64-bit words used to store the mask.                  //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the number of 64-bit words in which //
+//   the mask bits are stored. Bit j of word i corresponds to voxel  //
+//   i * BITMASK_WORD_BITS + j of the cube. Any bits of the last     //
+//   word that lie beyond the end of the cube are always 0.          //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t BitMask_get_words(const BitMask *self)
+{
+	check_null(self);
+	return self->n_words;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return pointer to mask words                                      //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Pointer to the first 64-bit word of the mask.                   //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning a pointer to the array of 64-bit    //
+//   words in which the mask is stored. This is intended for methods //
+//   that need to process the mask one word at a time, e.g. for set- //
+//   ting mask bits from a data cube. Such methods must ensure that  //
+//   bits beyond the end of the cube are never set.                  //
+// ----------------------------------------------------------------- //
+
+PUBLIC uint64_t *BitMask_get_ptr(const BitMask *self)
+{
+	check_null(self);
+	return self->data;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return value of a single voxel                                    //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) index    - Index of the voxel.                              //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   True if the voxel is set, false otherwise.                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for checking whether the voxel with the specified //
+//   linear index is set in the mask.                                //
+// ----------------------------------------------------------------- //
+
+PUBLIC bool BitMask_get(const BitMask *self, const size_t index)
+{
+	check_null(self);
+	ensure(index < self->n_voxels, ERR_INDEX_RANGE, "Voxel index out of range.");
+	return (self->data[index / BITMASK_WORD_BITS] >> (index % BITMASK_WORD_BITS)) & 1;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Count number of voxels set                                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of voxels set in the mask.                               //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for counting the number of voxels that are set in //
+//   the mask by adding up the population count of all words.        //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t BitMask_count(const BitMask *self)
+{
+	check_null(self);
+	size_t counter = 0;
+	
+	#pragma omp parallel for schedule(static) reduction(+: counter)
+	for(size_t i = 0; i < self->n_words; ++i) counter += BitMask_popcount(self->data[i]);
+	
+	return counter;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Clear range of voxels                                             //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) first    - Linear index of the first voxel to be cleared.   //
+//   (3) size     - Number of consecutive voxels to be cleared.      //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for setting the specified range of consecutive    //
+//   voxels to 0. Whole words within the range are cleared at once,  //
+//   while partially covered words at either end are masked.         //
+// ----------------------------------------------------------------- //
+
+PUBLIC void BitMask_clear_range(BitMask *self, const size_t first, const size_t size)
+{
+	check_null(self);
+	if(size == 0) return;
+	ensure(first < self->n_voxels && size <= self->n_voxels - first, ERR_INDEX_RANGE, "Voxel range out of range.");
+	
+	const size_t last = first + size - 1;
+	const size_t w_first = first / BITMASK_WORD_BITS;
+	const size_t w_last  = last  / BITMASK_WORD_BITS;
+	const uint64_t keep_low  = ((uint64_t)1 << (first % BITMASK_WORD_BITS)) - 1;                // Bits below first
+	const uint64_t keep_high = ~(uint64_t)1 << (last % BITMASK_WORD_BITS);                      // Bits above last
+	
+	if(w_first == w_last)
+	{
+		self->data[w_first] &= keep_low | keep_high;
+		return;
+	}
+	
+	self->data[w_first] &= keep_low;
+	for(size_t i = w_first + 1; i < w_last; ++i) self->data[i] = 0;
+	self->data[w_last] &= keep_high;
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Apply flags                                                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) flags    - Flagging index to be applied.                    //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for clearing all voxels of the mask that are fla- //
+//   gged in the specified flagging index, which must have been cre- //
+//   ated for a cube of the same size as the mask.                   //
+// ----------------------------------------------------------------- //
+
+PUBLIC void BitMask_apply_flags(BitMask *self, const FlagIndex *flags)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(flags);
+	ensure(FlagIndex_get_axis_size(flags, 0) == self->size[0] && FlagIndex_get_axis_size(flags, 1) == self->size[1] && FlagIndex_get_axis_size(flags, 2) == self->size[2], ERR_USER_INPUT, "Flagging index and bit mask have different sizes.");
+	
+	// NOTE: This is done serially, as adjacent channels can share a word.
+	for(size_t z = 0; z < self->size[2]; ++z)
+	{
+		const size_t *interval;
+		const size_t n_int = FlagIndex_get_plane(flags, z, &interval);
+		
+		for(size_t i = 0; i < n_int; ++i)
+		{
+			const size_t y     = interval[3 * i];
+			const size_t x_min = interval[3 * i + 1];
+			const size_t x_max = interval[3 * i + 2];
+			BitMask_clear_range(self, x_min + self->size[0] * (y + self->size[1] * z), x_max - x_min + 1);
+		}
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Population count of a 64-bit word                                 //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) word     - 64-bit word.                                     //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of bits set in the word.                                 //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for counting the number of bits set in a 64-bit  //
+//   word using the standard parallel bit-counting algorithm, which  //
+//   most compilers will translate into a single instruction where   //
+//   the hardware supports it.                                       //
+// ----------------------------------------------------------------- //
+
+PRIVATE size_t BitMask_popcount(uint64_t word)
+{
+	word = word - ((word >> 1) & 0x5555555555555555ULL);
+	word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (size_t)((word * 0x0101010101010101ULL) >> 56);
+}
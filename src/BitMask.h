@@ -0,0 +1,75 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (BitMask.h) - Source Finding Application                 ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <stdint.h>
+
+#include "common.h"
+#include "FlagIndex.h"
+
+#define BITMASK_WORD_BITS 64
+
+
+// ----------------------------------------------------------------- //
+// Class 'BitMask'                                                   //
+// ----------------------------------------------------------------- //
+// The purpose of this class is to provide a compact binary mask for //
+// a three-dimensional data cube, using a single bit per voxel. The  //
+// bits are stored in 64-bit words in the same order as the voxels   //
+// of the data cube, such that the mask can be processed 64 voxels   //
+// at a time. This is used for recording the pixels detected by the  //
+// source finders, which only need to be flagged as detected or not, //
+// and reduces memory usage by a factor of 8 compared to an 8-bit    //
+// mask cube.                                                        //
+// ----------------------------------------------------------------- //
+
+typedef CLASS BitMask BitMask;
+
+// Constructor and destructor
+PUBLIC BitMask   *BitMask_new           (const size_t size_x, const size_t size_y, const size_t size_z);
+PUBLIC void       BitMask_delete        (BitMask *self);
+
+// Public methods
+PUBLIC size_t     BitMask_get_axis_size (const BitMask *self, const size_t axis);
+PUBLIC size_t     BitMask_get_size      (const BitMask *self);
+PUBLIC size_t     BitMask_get_words     (const BitMask *self);
+PUBLIC uint64_t  *BitMask_get_ptr       (const BitMask *self);
+PUBLIC bool       BitMask_get           (const BitMask *self, const size_t index);
+PUBLIC size_t     BitMask_count         (const BitMask *self);
+PUBLIC void       BitMask_clear_range   (BitMask *self, const size_t first, const size_t size);
+PUBLIC void       BitMask_apply_flags   (BitMask *self, const FlagIndex *flags);
+
+// Private methods
+PRIVATE size_t    BitMask_popcount      (uint64_t word);
+
+#endif
@@ -31,11 +31,18 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <math.h>
 #include <time.h>
 
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
 #include "Catalog.h"
+#include "Header.h"
+#include "String.h"
 
 
 
@@ -43,10 +50,33 @@
 // Declaration of properties of class Catalog                        //
 // ----------------------------------------------------------------- //
 
-CLASS Catalog
+typedef union CatalogValue CatalogValue;
+
+union CatalogValue
+{
+	double   value_flt;
+	long int value_int;
+};
+
+struct CatalogBuffer
 {
+	char  *data;
 	size_t size;
-	Source **sources;
+	size_t capacity;
+};
+
+CLASS Catalog
+{
+	size_t          size;
+	size_t          capacity;
+	Source        **sources;
+	String        **identifiers;
+	size_t          n_col;
+	CatalogValue  **values;
+	unsigned char  *types;
+	String        **names;
+	String        **units;
+	String        **ucds;
 };
 
 
@@ -78,8 +108,16 @@ PUBLIC Catalog *Catalog_new(void)
 	Catalog *self = (Catalog *)memory(MALLOC, 1, sizeof(Catalog));
 	
 	// Initialise properties
-	self->size = 0;
-	self->sources = NULL;
+	self->size        = 0;
+	self->capacity    = 0;
+	self->sources     = NULL;
+	self->identifiers = NULL;
+	self->n_col       = 0;
+	self->values      = NULL;
+	self->types       = NULL;
+	self->names       = NULL;
+	self->units       = NULL;
+	self->ucds        = NULL;
 	
 	return self;
 }
@@ -112,16 +150,30 @@ PUBLIC void Catalog_delete(Catalog *self)
 {
 	if(self != NULL)
 	{
-		if(self->sources != NULL)
+		// Call the destructor on individual sources and identifiers first
+		for(size_t i = self->size; i--;)
 		{
-			// Call the destructor on individual sources first
-			Source **ptr = self->sources + self->size;
-			while(ptr --> self->sources) Source_delete(*ptr);
-			
-			// Then de-allocate memory for pointers to those sources
-			free(self->sources);
+			Source_delete(self->sources[i]);
+			String_delete(self->identifiers[i]);
+		}
+		
+		// Then de-allocate memory for columns
+		for(size_t j = self->n_col; j--;)
+		{
+			free(self->values[j]);
+			String_delete(self->names[j]);
+			String_delete(self->units[j]);
+			String_delete(self->ucds[j]);
 		}
 		
+		free(self->sources);
+		free(self->identifiers);
+		free(self->values);
+		free(self->types);
+		free(self->names);
+		free(self->units);
+		free(self->ucds);
+		
 		// Lastly, de-allocate memory for catalog object
 		free(self);
 	}
@@ -149,6 +201,12 @@ PUBLIC void Catalog_delete(Catalog *self)
 //   logue. Note that the function does not check if a source with   //
 //   the same name already exists; a new source will always be added //
 //   to the existing source list.                                    //
+//   The parameters of the source will be copied into a new row of   //
+//   the catalogue, and any parameters not yet defined in the cata-  //
+//   logue will be added as new columns. The source object will then //
+//   be turned into a view of that row and be owned by the catalogue //
+//   from then on. A source that is already part of a catalogue can- //
+//   not be added again.                                             //
 // ----------------------------------------------------------------- //
 
 PUBLIC void Catalog_add_source(Catalog *self, Source *src)
@@ -156,16 +214,71 @@ PUBLIC void Catalog_add_source(Catalog *self, Source *src)
 	// Sanity checks
 	check_null(self);
 	check_null(src);
-	ensure(!Catalog_source_exists(self, src, NULL), ERR_USER_INPUT, "Source \'%s\' is already in catalogue.", Source_get_identifier(src));
+	ensure(!Source_is_attached(src), ERR_USER_INPUT, "Source \'%s\' is already in catalogue.", Source_get_identifier(src));
+	
+	const size_t row = Catalog_append_memory(self);
+	String_set(self->identifiers[row], Source_get_identifier(src));
 	
-	Catalog_append_memory(self);
-	*(self->sources + self->size - 1) = src;
+	// Copy parameters, adding new columns as needed
+	for(size_t j = 0; j < Source_get_num_par(src); ++j)
+	{
+		const unsigned char type = Source_get_type(src, j);
+		const size_t col = Catalog_add_column(self, Source_get_name(src, j), type, Source_get_unit(src, j), Source_get_ucd(src, j));
+		
+		if(type == SOURCE_TYPE_INT) self->values[col][row].value_int = Source_get_par_int(src, j);
+		else self->values[col][row].value_flt = Source_get_par_flt(src, j);
+	}
+	
+	// Turn source into view of new row
+	Source_attach(src, self, row);
+	self->sources[row] = src;
 	
 	return;
 }
 
 
 
+// ----------------------------------------------------------------- //
+// Add a new, empty row to a catalogue                               //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self       - Object self-reference.                         //
+//   (2) identifier - Identifier (e.g. name) of the new source.      //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Index of the newly added row.                                   //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for appending a new row to the catalogue. All pa- //
+//   rameters of the new row will be initialised to 0 and can then   //
+//   be set with Catalog_set_flt() or Catalog_set_int(). The index   //
+//   of the new row will be returned. This is the preferred way of   //
+//   filling a catalogue, as it avoids having to create individual   //
+//   Source objects with their own parameter lists.                  //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t Catalog_add_row(Catalog *self, const char *identifier)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(identifier);
+	
+	const size_t row = Catalog_append_memory(self);
+	String_set(self->identifiers[row], identifier);
+	
+	// Create view of new row
+	Source *src = Source_new(false);
+	Source_attach(src, self, row);
+	self->sources[row] = src;
+	
+	return row;
+}
+
+
+
 // ----------------------------------------------------------------- //
 // Get source index                                                  //
 // ----------------------------------------------------------------- //
@@ -305,6 +418,364 @@ PUBLIC size_t Catalog_get_size(const Catalog *self)
 
 
 
+// ----------------------------------------------------------------- //
+// Add a new column or update an existing one                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) name     - Name of the column.                              //
+//   (3) type     - Data type of the column; can be SOURCE_TYPE_INT  //
+//                  or SOURCE_TYPE_FLT.                              //
+//   (4) unit     - Unit of the column.                              //
+//   (5) ucd      - Unified Content Descriptor of the column.        //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Index of the column.                                            //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for adding a new column to the catalogue schema.  //
+//   The values of all existing rows will be initialised to 0. If a  //
+//   column of the same name already exists, its unit and UCD will   //
+//   be replaced, unless NULL is specified, and the index of the     //
+//   existing column will be returned. The data type of an existing  //
+//   column cannot be changed. The returned index can be used as a   //
+//   handle for fast access to the column's values with the methods  //
+//   Catalog_get_*() and Catalog_set_*(). Note that names are case-  //
+//   sensitive.                                                      //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t Catalog_add_column(Catalog *self, const char *name, const unsigned char type, const char *unit, const char *ucd)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(name);
+	ensure(type == SOURCE_TYPE_INT || type == SOURCE_TYPE_FLT, ERR_USER_INPUT, "Invalid data type for column \'%s\'.", name);
+	
+	size_t col = 0;
+	
+	if(Catalog_column_exists(self, name, &col))
+	{
+		// Update existing column
+		ensure(self->types[col] == type, ERR_USER_INPUT, "Data type of existing column \'%s\' cannot be changed.", name);
+		if(unit != NULL) String_set(self->units[col], unit);
+		if(ucd  != NULL) String_set(self->ucds [col], ucd);
+		return col;
+	}
+	
+	check_null(unit);
+	check_null(ucd);
+	
+	// Append new column
+	col = self->n_col++;
+	self->values = (CatalogValue **) memory_realloc(self->values, self->n_col, sizeof(CatalogValue *));
+	self->types  = (unsigned char *) memory_realloc(self->types,  self->n_col, sizeof(unsigned char));
+	self->names  = (String **)       memory_realloc(self->names,  self->n_col, sizeof(String *));
+	self->units  = (String **)       memory_realloc(self->units,  self->n_col, sizeof(String *));
+	self->ucds   = (String **)       memory_realloc(self->ucds,   self->n_col, sizeof(String *));
+	
+	self->values[col] = self->capacity ? (CatalogValue *)memory(CALLOC, self->capacity, sizeof(CatalogValue)) : NULL;
+	self->types[col]  = type;
+	self->names[col]  = String_new(name);
+	self->units[col]  = String_new(unit);
+	self->ucds [col]  = String_new(ucd);
+	
+	return col;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Check if column exists                                            //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) name     - Name of the column to be checked.                //
+//   (3) col      - Pointer to a variable that will hold the index   //
+//                  of the column if found.                          //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Returns true if the column exists, false otherwise.             //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for checking if a column of the specified name    //
+//   exists in the catalogue. The variable 'col' will be set to the  //
+//   index of the column if found. Otherwise it will be left untou-  //
+//   ched. If no index is required, a NULL pointer can instead be    //
+//   provided. Note that names are case-sensitive.                   //
+// ----------------------------------------------------------------- //
+
+PUBLIC bool Catalog_column_exists(const Catalog *self, const char *name, size_t *col)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(name);
+	
+	for(size_t j = 0; j < self->n_col; ++j)
+	{
+		if(String_compare(self->names[j], name))
+		{
+			if(col != NULL) *col = j;
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Get index of column by name                                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) name     - Name of the column.                              //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Index of the column.                                            //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the index of the column of the spe- //
+//   cified name. The index can be used as a handle for fast access  //
+//   to the values of that column. If the column does not exist, the //
+//   process will be terminated with an error message.               //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t Catalog_get_column(const Catalog *self, const char *name)
+{
+	size_t col = 0;
+	ensure(Catalog_column_exists(self, name, &col), ERR_USER_INPUT, "Parameter \'%s\' missing from catalogue.", name);
+	return col;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return number of columns                                          //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of columns currently defined.                            //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the number of columns (parameters)  //
+//   currently defined in the catalogue. Note that the source iden-  //
+//   tifier is not counted as a column.                              //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t Catalog_get_num_col(const Catalog *self)
+{
+	check_null(self);
+	return self->n_col;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Extract name, unit, UCD and type of column                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) col      - Index of the column.                             //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Pointer to the name, unit or UCD string or data type of the     //
+//   specified column.                                               //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public methods for returning the name, unit, UCD or data type   //
+//   of the specified column. The data type will be 0 for integer    //
+//   and 1 for floating-point values.                                //
+// ----------------------------------------------------------------- //
+
+PUBLIC const char *Catalog_get_name(const Catalog *self, const size_t col)
+{
+	check_null(self);
+	ensure(col < self->n_col, ERR_INDEX_RANGE, "Catalogue column index out of range.");
+	return String_get(self->names[col]);
+}
+
+PUBLIC const char *Catalog_get_unit(const Catalog *self, const size_t col)
+{
+	check_null(self);
+	ensure(col < self->n_col, ERR_INDEX_RANGE, "Catalogue column index out of range.");
+	return String_get(self->units[col]);
+}
+
+PUBLIC const char *Catalog_get_ucd(const Catalog *self, const size_t col)
+{
+	check_null(self);
+	ensure(col < self->n_col, ERR_INDEX_RANGE, "Catalogue column index out of range.");
+	return String_get(self->ucds[col]);
+}
+
+PUBLIC unsigned char Catalog_get_type(const Catalog *self, const size_t col)
+{
+	check_null(self);
+	ensure(col < self->n_col, ERR_INDEX_RANGE, "Catalogue column index out of range.");
+	return self->types[col];
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Set and get source identifier                                     //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) row      - Index of the row.                                //
+//   (3) name     - Name to be used as identifier.                   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Identifier of the specified row (get) or no return value (set). //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public methods for setting and returning the identifier (e.g.   //
+//   name) of the source in the specified row of the catalogue.      //
+// ----------------------------------------------------------------- //
+
+PUBLIC void Catalog_set_identifier(Catalog *self, const size_t row, const char *name)
+{
+	check_null(self);
+	ensure(row < self->size, ERR_INDEX_RANGE, "Catalogue index out of range.");
+	String_set(self->identifiers[row], name);
+	return;
+}
+
+PUBLIC const char *Catalog_get_identifier(const Catalog *self, const size_t row)
+{
+	check_null(self);
+	ensure(row < self->size, ERR_INDEX_RANGE, "Catalogue index out of range.");
+	return String_get(self->identifiers[row]);
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Set and get parameter values                                      //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) row      - Index of the row.                                //
+//   (3) col      - Index of the column.                             //
+//   (4) value    - Value to be set.                                 //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Value of the specified parameter (get) or no return value       //
+//   (set).                                                          //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public methods for setting and returning the value of a single  //
+//   parameter in the catalogue, as identified by its row and column //
+//   index. Column indices can be obtained once with the methods     //
+//   Catalog_add_column() or Catalog_get_column() and then be reused //
+//   for all rows. The data type must match that of the column.      //
+// ----------------------------------------------------------------- //
+
+PUBLIC void Catalog_set_flt(Catalog *self, const size_t row, const size_t col, const double value)
+{
+	check_null(self);
+	ensure(row < self->size && col < self->n_col, ERR_INDEX_RANGE, "Catalogue index out of range.");
+	ensure(self->types[col] == SOURCE_TYPE_FLT, ERR_USER_INPUT, "Parameter \'%s\' is not of floating-point type.", String_get(self->names[col]));
+	self->values[col][row].value_flt = value;
+	return;
+}
+
+PUBLIC void Catalog_set_int(Catalog *self, const size_t row, const size_t col, const long int value)
+{
+	check_null(self);
+	ensure(row < self->size && col < self->n_col, ERR_INDEX_RANGE, "Catalogue index out of range.");
+	ensure(self->types[col] == SOURCE_TYPE_INT, ERR_USER_INPUT, "Parameter \'%s\' is not of integer type.", String_get(self->names[col]));
+	self->values[col][row].value_int = value;
+	return;
+}
+
+PUBLIC double Catalog_get_flt(const Catalog *self, const size_t row, const size_t col)
+{
+	check_null(self);
+	ensure(row < self->size && col < self->n_col, ERR_INDEX_RANGE, "Catalogue index out of range.");
+	return self->values[col][row].value_flt;
+}
+
+PUBLIC long int Catalog_get_int(const Catalog *self, const size_t row, const size_t col)
+{
+	check_null(self);
+	ensure(row < self->size && col < self->n_col, ERR_INDEX_RANGE, "Catalogue index out of range.");
+	return self->values[col][row].value_int;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Add a position offset to x, y, z parameters of all sources        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) dx       - Position offset in x.                            //
+//   (3) dy       - Position offset in y.                            //
+//   (4) dz       - Position offset in z.                            //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for adding a position offset to the columns named //
+//   x, y, z, x_min, x_max, y_min, y_max, z_min, and z_max of all    //
+//   sources in the catalogue. Only existing columns will be shifted //
+//   and non-existing ones ignored. Offsets can only be positive, as //
+//   negative pixel coordinates are not possible.                    //
+// ----------------------------------------------------------------- //
+
+PUBLIC void Catalog_offset_xyz(Catalog *self, const size_t dx, const size_t dy, const size_t dz)
+{
+	check_null(self);
+	
+	const char *names_flt[3] = {"x", "y", "z"};
+	const char *names_int[6] = {"x_min", "x_max", "y_min", "y_max", "z_min", "z_max"};
+	const size_t offset[3] = {dx, dy, dz};
+	size_t col = 0;
+	
+	for(size_t j = 0; j < 3; ++j)
+	{
+		if(Catalog_column_exists(self, names_flt[j], &col)) for(size_t i = 0; i < self->size; ++i) self->values[col][i].value_flt += (double)(offset[j]);
+	}
+	
+	for(size_t j = 0; j < 6; ++j)
+	{
+		if(Catalog_column_exists(self, names_int[j], &col)) for(size_t i = 0; i < self->size; ++i) self->values[col][i].value_int += offset[j / 2];
+	}
+	
+	return;
+}
+
+
+
 // ----------------------------------------------------------------- //
 // Save catalogue to file                                            //
 // ----------------------------------------------------------------- //
@@ -314,8 +785,10 @@ PUBLIC size_t Catalog_get_size(const Catalog *self)
 //   (2) filename  - Full path to the output file.                   //
 //   (3) format    - Output format; can be CATALOG_FORMAT_ASCII for  //
 //                   plain text ASCII files, CATALOG_FORMAT_XML for  //
-//                   VOTable format or CATALOG_FORMAT_SQL for SQL    //
-//                   table format.                                   //
+//                   VOTable format, CATALOG_FORMAT_XML_BINARY for   //
+//                   VOTable format with BINARY2 serialisation,      //
+//                   CATALOG_FORMAT_SQL for SQL table format or      //
+//                   CATALOG_FORMAT_FITS for a FITS binary table.    //
 //   (4) overwrite - Overwrite existing file (true) or not (false)?  //
 //                                                                   //
 // Return value:                                                     //
@@ -328,7 +801,11 @@ PUBLIC size_t Catalog_get_size(const Catalog *self)
 //   fied name in the specified file format. The file name will be   //
 //   relative to the process execution directory unless the full     //
 //   path to the output directory is specified. Available formats    //
-//   are plain text ASCII, VOTable XML format and SQL format.        //
+//   are plain text ASCII, VOTable XML format (with either TABLEDATA //
+//   or BINARY2 serialisation), SQL format and FITS binary table.    //
+//   The two binary formats are written in large blocks directly     //
+//   from the column arrays and are much faster to write and read    //
+//   for large catalogues.                                           //
 // ----------------------------------------------------------------- //
 
 PUBLIC void Catalog_save(const Catalog *self, const char *filename, const file_format format, const bool overwrite)
@@ -352,19 +829,20 @@ PUBLIC void Catalog_save(const Catalog *self, const char *filename, const file_f
 	
 	// Some initial definitions
 	const char char_comment = '#';
-	const char char_nocomment = ' ';
 	
 	// Get current date and time
 	char current_time_string[64];
 	time_t current_time = time(NULL);
 	strftime(current_time_string, 64, "%a, %d %b %Y, %H:%M:%S", localtime(&current_time));
 	
-	// Get first source to extract parameter names and units
-	Source *src0 = self->sources[0];
-	
-	if(format == CATALOG_FORMAT_XML)
+	if(format == CATALOG_FORMAT_FITS)
 	{
-		const char *data_type_names[2] = {"long", "double"};
+		// Write FITS binary table
+		Catalog_write_fits(self, fp);
+	}
+	else if(format == CATALOG_FORMAT_XML || format == CATALOG_FORMAT_XML_BINARY)
+	{
+		const char *data_type_names[2] = {"long", "double"};
 		const char *indentation[7] = {"", "\t", "\t\t", "\t\t\t", "\t\t\t\t", "\t\t\t\t\t", "\t\t\t\t\t\t"}; // Better readability
 		//const char *indentation[7] = {"", "", "", "", "", "", ""}; // Smaller file size
 		
@@ -380,45 +858,35 @@ PUBLIC void Catalog_save(const Catalog *self, const char *filename, const file_f
 		fprintf(fp, "%s<TABLE ID=\"SoFiA_source_catalogue\" name=\"SoFiA source catalogue\">\n", indentation[2]);
 		
 		// Column descriptors
-		fprintf(fp, "%s<FIELD arraysize=\"32\" datatype=\"char\" name=\"name\" unit=\"\" ucd=\"meta.id\"/>\n", indentation[3]);
-		for(size_t j = 0; j < Source_get_num_par(src0); ++j)
+		fprintf(fp, "%s<FIELD arraysize=\"%s\" datatype=\"char\" name=\"name\" unit=\"\" ucd=\"meta.id\"/>\n", indentation[3], format == CATALOG_FORMAT_XML_BINARY ? "*" : "32");
+		for(size_t j = 0; j < self->n_col; ++j)
 		{
-			fprintf(fp, "%s<FIELD datatype=\"%s\" name=\"%s\" unit=\"%s\" ucd=\"%s\"/>\n", indentation[3], data_type_names[Source_get_type(src0, j)], Source_get_name(src0, j), Source_get_unit(src0, j), Source_get_ucd(src0, j));
+			fprintf(fp, "%s<FIELD datatype=\"%s\" name=\"%s\" unit=\"%s\" ucd=\"%s\"/>\n", indentation[3], data_type_names[self->types[j]], String_get(self->names[j]), String_get(self->units[j]), String_get(self->ucds[j]));
 		}
 		
 		// Start of data table
 		fprintf(fp, "%s<DATA>\n", indentation[3]);
-		fprintf(fp, "%s<TABLEDATA>\n", indentation[4]);
 		
-		// Data rows
-		for(size_t i = 0; i < self->size; ++i)
+		if(format == CATALOG_FORMAT_XML_BINARY)
+		{
+			// Data rows as base64-encoded BINARY2 stream
+			fprintf(fp, "%s<BINARY2>\n", indentation[4]);
+			fprintf(fp, "%s<STREAM encoding=\"base64\">\n", indentation[5]);
+			Catalog_write_binary2(self, fp);
+			fprintf(fp, "%s</STREAM>\n", indentation[5]);
+			fprintf(fp, "%s</BINARY2>\n", indentation[4]);
+		}
+		else
 		{
-			Source *src = self->sources[i];
-			fprintf(fp, "%s<TR>\n", indentation[5]);
+			fprintf(fp, "%s<TABLEDATA>\n", indentation[4]);
 			
-			fprintf(fp, "%s<TD>%s</TD>\n", indentation[6], Source_get_identifier(src));
+			// Data rows
+			Catalog_write_rows(self, fp, format, indentation);
 			
-			for(size_t j = 0; j < Source_get_num_par(src); ++j)
-			{
-				if(Source_get_type(src, j) == SOURCE_TYPE_INT)
-				{
-					// Integer value
-					const long int value = Source_get_par_int(src, j);
-					fprintf(fp, "%s<TD>%ld</TD>\n", indentation[6], value);
-				}
-				else
-				{
-					// Floating-point value
-					const double value = Source_get_par_flt(src, j);
-					fprintf(fp, "%s<TD>%.15e</TD>\n", indentation[6], value);
-				}
-			}
-			
-			fprintf(fp, "%s</TR>\n", indentation[5]);
+			// End of data table
+			fprintf(fp, "%s</TABLEDATA>\n", indentation[4]);
 		}
 		
-		// End of data table
-		fprintf(fp, "%s</TABLEDATA>\n", indentation[4]);
 		fprintf(fp, "%s</DATA>\n", indentation[3]);
 		
 		// Finalise XML file
@@ -436,41 +904,24 @@ PUBLIC void Catalog_save(const Catalog *self, const char *filename, const file_f
 		fprintf(fp, "CREATE TABLE IF NOT EXISTS `%s` (\n", catalog_name);
 		fprintf(fp, "\t`name` VARCHAR(255) NOT NULL,\n");
 		
-		for(size_t j = 0; j < Source_get_num_par(src0); ++j)
+		for(size_t j = 0; j < self->n_col; ++j)
 		{
-			if(Source_get_type(src0, j) == SOURCE_TYPE_INT) fprintf(fp, "\t`%s` INTEGER NOT NULL,\n", Source_get_name(src0, j));
-			else fprintf(fp, "\t`%s` DOUBLE PRECISION NOT NULL,\n", Source_get_name(src0, j));
+			if(self->types[j] == SOURCE_TYPE_INT) fprintf(fp, "\t`%s` INTEGER NOT NULL,\n", String_get(self->names[j]));
+			else fprintf(fp, "\t`%s` DOUBLE PRECISION NOT NULL,\n", String_get(self->names[j]));
 		}
 		
 		fprintf(fp, "\tPRIMARY KEY (`id`),\n\tKEY (`id`)\n) COMMENT=\'SoFiA source catalogue; created with SoFiA version %s\';\n\n", SOFIA_VERSION);
 		fprintf(fp, "INSERT INTO `SoFiA-Catalogue` (`name`, ");
 		
-		for(size_t j = 0; j < Source_get_num_par(src0); ++j)
+		for(size_t j = 0; j < self->n_col; ++j)
 		{
-			fprintf(fp, "`%s`", Source_get_name(src0, j));
-			if(j + 1 < Source_get_num_par(src0)) fprintf(fp, ", ");
+			fprintf(fp, "`%s`", String_get(self->names[j]));
+			if(j + 1 < self->n_col) fprintf(fp, ", ");
 			else fprintf(fp, ") VALUES\n");
 		}
 		
 		// Loop over all sources to write parameters
-		for(size_t i = 0; i < self->size; ++i)
-		{
-			fprintf(fp, "(");
-			
-			Source *src = self->sources[i];
-			
-			fprintf(fp, "\'%s\', ", Source_get_identifier(src));
-			
-			for(size_t j = 0; j < Source_get_num_par(src); ++j)
-			{
-				if(Source_get_type(src, j) == SOURCE_TYPE_INT) fprintf(fp, "%ld", Source_get_par_int(src, j));
-				else fprintf(fp, "%.15e", Source_get_par_flt(src, j));
-				if(j + 1 < Source_get_num_par(src)) fprintf(fp, ", ");
-			}
-			
-			if(i + 1 < self->size) fprintf(fp, "),\n");
-			else fprintf(fp, ");\n");
-		}
+		Catalog_write_rows(self, fp, format, NULL);
 	}
 	else
 	{
@@ -479,47 +930,421 @@ PUBLIC void Catalog_save(const Catalog *self, const char *filename, const file_f
 		fprintf(fp, "# Header rows:\n#   1 = column number\n#   2 = parameter name\n#   3 = parameter unit\n%c\n%c", char_comment, char_comment);
 		
 		fprintf(fp, "%*d", 2 * CATALOG_COLUMN_WIDTH, 1);
-		for(size_t j = 0; j < Source_get_num_par(src0); ++j) fprintf(fp, "%*zu", CATALOG_COLUMN_WIDTH, j + 2);
+		for(size_t j = 0; j < self->n_col; ++j) fprintf(fp, "%*zu", CATALOG_COLUMN_WIDTH, j + 2);
 		fprintf(fp, "\n%c", char_comment);
 		
 		fprintf(fp, "%*s", 2 * CATALOG_COLUMN_WIDTH, "name");
-		for(size_t j = 0; j < Source_get_num_par(src0); ++j) fprintf(fp, "%*s", CATALOG_COLUMN_WIDTH, Source_get_name(src0, j));
+		for(size_t j = 0; j < self->n_col; ++j) fprintf(fp, "%*s", CATALOG_COLUMN_WIDTH, String_get(self->names[j]));
 		fprintf(fp, "\n%c", char_comment);
 		
 		fprintf(fp, "%*s", 2 * CATALOG_COLUMN_WIDTH, " ");
-		for(size_t j = 0; j < Source_get_num_par(src0); ++j) fprintf(fp, "%*s", CATALOG_COLUMN_WIDTH, Source_get_unit(src0, j));
+		for(size_t j = 0; j < self->n_col; ++j) fprintf(fp, "%*s", CATALOG_COLUMN_WIDTH, String_get(self->units[j]));
 		fprintf(fp, "\n\n");
 		
 		// Loop over all sources to write parameters
+		Catalog_write_rows(self, fp, format, NULL);
+	}
+	
+	fclose(fp);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Save catalogue as SQLite database                                 //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) filename  - Full path to the output file.                   //
+//   (3) overwrite - Overwrite existing file (true) or not (false)?  //
+//   (4) spectra   - Array of one spectrum per source to be stored   //
+//                   alongside the catalogue. Can be NULL.           //
+//   (5) voxels    - Array of one list of voxel indices per source   //
+//                   to be stored alongside the catalogue. Can be    //
+//                   NULL.                                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for saving the current catalogue as an SQLite     //
+//   database. The table 'SoFiA-Catalogue' is created from the cata- //
+//   logue schema, with the source ID as the primary key, and all    //
+//   rows are inserted through a single prepared statement inside    //
+//   transactions of CATALOG_SQLITE_BATCH rows each. The units and   //
+//   UCDs of all columns are stored in the table 'SoFiA-Columns'.    //
+//   If spectra or voxels are provided, they will be stored as BLOBs //
+//   of little-endian 64-bit floating-point values and integers, re- //
+//   spectively, in the table 'SoFiA-SourceData', using the source   //
+//   ID as the key. This method is only available if SoFiA was com-  //
+//   piled with SQLite support (HAVE_SQLITE3 defined); otherwise, an //
+//   error will be raised.                                           //
+// ----------------------------------------------------------------- //
+
+PUBLIC void Catalog_save_sqlite(const Catalog *self, const char *filename, const bool overwrite, Array_dbl * const *spectra, Array_siz * const *voxels)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(filename);
+	ensure(strlen(filename), ERR_USER_INPUT, "File name is empty.");
+	
+	#ifdef HAVE_SQLITE3
+		if(!self->size)
+		{
+			warning("Failed to save catalogue; no sources found.");
+			return;
+		}
+		
+		size_t col_id = 0;
+		ensure(Catalog_column_exists(self, "id", &col_id), ERR_USER_INPUT, "Source ID missing from catalogue; cannot create SQLite database.");
+		
+		// Remove existing file if requested
+		FILE *fp = fopen(filename, "rb");
+		if(fp != NULL)
+		{
+			fclose(fp);
+			ensure(overwrite, ERR_FILE_ACCESS, "SQLite database already exists: %s", filename);
+			ensure(remove(filename) == 0, ERR_FILE_ACCESS, "Failed to replace existing file: %s", filename);
+		}
+		
+		// Create new database
+		sqlite3 *db = NULL;
+		ensure(sqlite3_open_v2(filename, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) == SQLITE_OK, ERR_FILE_ACCESS, "Failed to create SQLite database: %s", filename);
+		
+		// The database is written only once, so journalling can be disabled
+		Catalog_sqlite_exec(db, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;");
+		
+		// Create tables
+		String *sql = String_new("CREATE TABLE \"SoFiA-Catalogue\" (\"name\" TEXT NOT NULL");
+		for(size_t j = 0; j < self->n_col; ++j)
+		{
+			String_append(String_append(String_append(sql, ", \""), String_get(self->names[j])), "\"");
+			String_append(sql, self->types[j] == SOURCE_TYPE_INT ? " INTEGER NOT NULL" : " REAL");
+			if(j == col_id) String_append(sql, " PRIMARY KEY");
+		}
+		String_append(sql, ");");
+		Catalog_sqlite_exec(db, String_get(sql));
+		
+		Catalog_sqlite_exec(db, "CREATE TABLE \"SoFiA-Columns\" (\"name\" TEXT PRIMARY KEY, \"type\" TEXT NOT NULL, \"unit\" TEXT, \"ucd\" TEXT);");
+		if(spectra != NULL || voxels != NULL) Catalog_sqlite_exec(db, "CREATE TABLE \"SoFiA-SourceData\" (\"id\" INTEGER PRIMARY KEY, \"spectrum\" BLOB, \"voxels\" BLOB);");
+		
+		Catalog_sqlite_exec(db, "BEGIN;");
+		
+		// Column descriptions
+		sqlite3_stmt *stmt = NULL;
+		ensure(sqlite3_prepare_v2(db, "INSERT INTO \"SoFiA-Columns\" VALUES (?, ?, ?, ?);", -1, &stmt, NULL) == SQLITE_OK, ERR_FAILURE, "SQLite error: %s", sqlite3_errmsg(db));
+		
+		for(size_t j = 0; j < self->n_col; ++j)
+		{
+			sqlite3_bind_text(stmt, 1, String_get(self->names[j]), -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 2, self->types[j] == SOURCE_TYPE_INT ? "long" : "double", -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 3, String_get(self->units[j]), -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 4, String_get(self->ucds[j]), -1, SQLITE_STATIC);
+			ensure(sqlite3_step(stmt) == SQLITE_DONE, ERR_FAILURE, "SQLite error: %s", sqlite3_errmsg(db));
+			sqlite3_reset(stmt);
+		}
+		
+		sqlite3_finalize(stmt);
+		
+		// Prepare insert statements for catalogue rows and source data
+		String_set(sql, "INSERT INTO \"SoFiA-Catalogue\" VALUES (?");
+		for(size_t j = 0; j < self->n_col; ++j) String_append(sql, ", ?");
+		String_append(sql, ");");
+		ensure(sqlite3_prepare_v2(db, String_get(sql), -1, &stmt, NULL) == SQLITE_OK, ERR_FAILURE, "SQLite error: %s", sqlite3_errmsg(db));
+		
+		sqlite3_stmt *stmt_data = NULL;
+		if(spectra != NULL || voxels != NULL) ensure(sqlite3_prepare_v2(db, "INSERT INTO \"SoFiA-SourceData\" VALUES (?, ?, ?);", -1, &stmt_data, NULL) == SQLITE_OK, ERR_FAILURE, "SQLite error: %s", sqlite3_errmsg(db));
+		
+		// Scratch buffers for BLOBs
+		const bool swap = !is_little_endian();
+		unsigned char *blob_spec = NULL;
+		unsigned char *blob_vox  = NULL;
+		
+		// Insert rows
 		for(size_t i = 0; i < self->size; ++i)
 		{
-			Source *src = self->sources[i];
+			sqlite3_bind_text(stmt, 1, String_get(self->identifiers[i]), -1, SQLITE_STATIC);
+			
+			for(size_t j = 0; j < self->n_col; ++j)
+			{
+				if(self->types[j] == SOURCE_TYPE_INT) sqlite3_bind_int64(stmt, j + 2, self->values[j][i].value_int);
+				else sqlite3_bind_double(stmt, j + 2, self->values[j][i].value_flt);
+			}
 			
-			fprintf(fp, "%c", char_nocomment);
-			fprintf(fp, "%*s", 2 * CATALOG_COLUMN_WIDTH, Source_get_identifier(src));
+			ensure(sqlite3_step(stmt) == SQLITE_DONE, ERR_FAILURE, "SQLite error: %s", sqlite3_errmsg(db));
+			sqlite3_reset(stmt);
 			
-			for(size_t j = 0; j < Source_get_num_par(src); ++j)
+			if(stmt_data != NULL)
 			{
-				if(Source_get_type(src, j) == SOURCE_TYPE_INT)
+				sqlite3_bind_int64(stmt_data, 1, self->values[col_id][i].value_int);
+				
+				if(spectra != NULL && spectra[i] != NULL && Array_dbl_get_size(spectra[i]))
 				{
-					// Integer value
-					const long int value = Source_get_par_int(src, j);
-					fprintf(fp, "%*ld", CATALOG_COLUMN_WIDTH, value);
+					const size_t size = Array_dbl_get_size(spectra[i]);
+					blob_spec = (unsigned char *)memory_realloc(blob_spec, size, sizeof(double));
+					memcpy(blob_spec, Array_dbl_get_ptr(spectra[i]), size * sizeof(double));
+					if(swap) for(size_t k = 0; k < size; ++k) swap_byte_order((char *)(blob_spec + k * sizeof(double)), sizeof(double));
+					sqlite3_bind_blob(stmt_data, 2, blob_spec, size * sizeof(double), SQLITE_STATIC);
 				}
-				else
+				else sqlite3_bind_null(stmt_data, 2);
+				
+				if(voxels != NULL && voxels[i] != NULL && Array_siz_get_size(voxels[i]))
 				{
-					// Floating-point value
-					const double value = Source_get_par_flt(src, j);
-					if(value != 0.0 && (fabs(value) >= 1.0e+4 || fabs(value) < 1.0e-3)) fprintf(fp, "%*.5e", CATALOG_COLUMN_WIDTH, value);
-					else fprintf(fp, "%*.6f", CATALOG_COLUMN_WIDTH, value);
+					const size_t size = Array_siz_get_size(voxels[i]);
+					const size_t *ptr = Array_siz_get_ptr(voxels[i]);
+					blob_vox = (unsigned char *)memory_realloc(blob_vox, size, sizeof(int64_t));
+					for(size_t k = 0; k < size; ++k)
+					{
+						const int64_t value = ptr[k];
+						memcpy(blob_vox + k * sizeof(int64_t), &value, sizeof(int64_t));
+						if(swap) swap_byte_order((char *)(blob_vox + k * sizeof(int64_t)), sizeof(int64_t));
+					}
+					sqlite3_bind_blob(stmt_data, 3, blob_vox, size * sizeof(int64_t), SQLITE_STATIC);
 				}
+				else sqlite3_bind_null(stmt_data, 3);
+				
+				ensure(sqlite3_step(stmt_data) == SQLITE_DONE, ERR_FAILURE, "SQLite error: %s", sqlite3_errmsg(db));
+				sqlite3_reset(stmt_data);
 			}
 			
-			fprintf(fp, "\n");
+			// Commit current batch and start a new transaction
+			if((i + 1) % CATALOG_SQLITE_BATCH == 0 && i + 1 < self->size) Catalog_sqlite_exec(db, "COMMIT; BEGIN;");
+		}
+		
+		Catalog_sqlite_exec(db, "COMMIT;");
+		
+		// Clean up
+		sqlite3_finalize(stmt);
+		sqlite3_finalize(stmt_data);
+		ensure(sqlite3_close(db) == SQLITE_OK, ERR_FILE_ACCESS, "Failed to close SQLite database: %s", filename);
+		String_delete(sql);
+		free(blob_spec);
+		free(blob_vox);
+	#else
+		(void)overwrite;
+		(void)spectra;
+		(void)voxels;
+		ensure(false, ERR_USER_INPUT, "SQLite output not available. Please recompile SoFiA with SQLite\n       support to enable this feature.");
+	#endif
+	
+	return;
+}
+
+
+
+#ifdef HAVE_SQLITE3
+// ----------------------------------------------------------------- //
+// Execute SQL statement(s) on SQLite database                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) db       - SQLite database connection.                      //
+//   (2) sql      - SQL statement(s) to be executed.                 //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private function for executing one or more SQL statements that  //
+//   do not return any data on the specified database. Programme     //
+//   execution will be terminated with an error message if any of    //
+//   the statements fails.                                           //
+// ----------------------------------------------------------------- //
+
+PRIVATE void Catalog_sqlite_exec(sqlite3 *db, const char *sql)
+{
+	char *error = NULL;
+	ensure(sqlite3_exec(db, sql, NULL, NULL, &error) == SQLITE_OK, ERR_FAILURE, "SQLite error: %s", error != NULL ? error : "unknown error");
+	
+	return;
+}
+#endif
+
+
+
+// ----------------------------------------------------------------- //
+// Reallocate memory for one additional row                          //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Index of the new row.                                           //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for appending one more row to the specified cat- //
+//   alogue. All parameters of the new row will be set to 0, and an  //
+//   empty identifier will be created. Memory is allocated in blocks //
+//   of increasing size, so that the columns do not need to be real- //
+//   located every time a new row is added. The function should be   //
+//   called from public member functions that will add sources to a  //
+//   catalogue prior to inserting the new source.                    //
+// ----------------------------------------------------------------- //
+
+PRIVATE size_t Catalog_append_memory(Catalog *self)
+{
+	if(self->size == self->capacity)
+	{
+		self->capacity = self->capacity ? 2 * self->capacity : 64;
+		self->sources     = (Source **)memory_realloc(self->sources,     self->capacity, sizeof(Source *));
+		self->identifiers = (String **)memory_realloc(self->identifiers, self->capacity, sizeof(String *));
+		for(size_t j = 0; j < self->n_col; ++j) self->values[j] = (CatalogValue *)memory_realloc(self->values[j], self->capacity, sizeof(CatalogValue));
+	}
+	
+	const size_t row = self->size++;
+	self->sources[row] = NULL;
+	self->identifiers[row] = String_new("");
+	for(size_t j = 0; j < self->n_col; ++j) memset(self->values[j] + row, 0, sizeof(CatalogValue));
+	
+	return row;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Write catalogue as FITS binary table                              //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) fp       - Output file opened for binary writing.           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for writing the catalogue to the specified file  //
+//   as an empty primary HDU followed by a FITS BINTABLE extension.  //
+//   The source name is stored as a character column just wide en-   //
+//   ough to hold the longest name, while integer and floating-point //
+//   parameters are stored as 64-bit integers (K) and double-preci-  //
+//   sion values (D), respectively. Rows are assembled in big-endian //
+//   byte order from the column arrays in blocks of about 1 MB, each //
+//   of which is written with a single call to fwrite().             //
+// ----------------------------------------------------------------- //
+
+PRIVATE void Catalog_write_fits(const Catalog *self, FILE *fp)
+{
+	ensure(self->n_col < 999, ERR_USER_INPUT, "Too many catalogue columns for FITS binary table.");
+	
+	const bool swap = is_little_endian();
+	char key[FITS_HEADER_KEYWORD_SIZE + 1];
+	char value[FITS_HEADER_VALUE_SIZE];
+	
+	// Determine width of name column and size of each row
+	size_t name_width = 1;
+	for(size_t i = 0; i < self->size; ++i) if(String_size(self->identifiers[i]) > name_width) name_width = String_size(self->identifiers[i]);
+	const size_t row_size = name_width + self->n_col * sizeof(int64_t);
+	
+	// Get current date and time (UTC)
+	char current_time_string[32];
+	time_t current_time = time(NULL);
+	strftime(current_time_string, 32, "%Y-%m-%dT%H:%M:%S", gmtime(&current_time));
+	
+	// Write empty primary HDU
+	Header *header = Header_blank(false);
+	Header_set_bool(header, "SIMPLE", true);
+	Header_set_int (header, "BITPIX", 8);
+	Header_set_int (header, "NAXIS",  0);
+	Header_set_bool(header, "EXTEND", true);
+	Header_set_str (header, "ORIGIN", SOFIA_VERSION_FULL);
+	Header_set_str (header, "DATE",   current_time_string);
+	ensure(fwrite(Header_get(header), 1, Header_get_size(header), fp) == Header_get_size(header), ERR_FILE_ACCESS, "Failed to write header to FITS file.");
+	Header_delete(header);
+	
+	// Write binary table header
+	header = Header_blank(false);
+	Header_set_str (header, "XTENSION", "BINTABLE");
+	Header_set_int (header, "BITPIX",   8);
+	Header_set_int (header, "NAXIS",    2);
+	Header_set_int (header, "NAXIS1",   row_size);
+	Header_set_int (header, "NAXIS2",   self->size);
+	Header_set_int (header, "PCOUNT",   0);
+	Header_set_int (header, "GCOUNT",   1);
+	Header_set_int (header, "TFIELDS",  self->n_col + 1);
+	Header_set_str (header, "EXTNAME",  "CATALOGUE");
+	
+	snprintf(value, FITS_HEADER_VALUE_SIZE, "%zuA", name_width);
+	Header_set_str(header, "TTYPE1", "name");
+	Header_set_str(header, "TFORM1", value);
+	
+	for(size_t j = 0; j < self->n_col; ++j)
+	{
+		snprintf(key, sizeof(key), "TTYPE%zu", j + 2);
+		Header_set_str(header, key, String_get(self->names[j]));
+		snprintf(key, sizeof(key), "TFORM%zu", j + 2);
+		Header_set_str(header, key, self->types[j] == SOURCE_TYPE_INT ? "K" : "D");
+		
+		if(String_size(self->units[j]))
+		{
+			snprintf(key, sizeof(key), "TUNIT%zu", j + 2);
+			Header_set_str(header, key, String_get(self->units[j]));
 		}
 	}
 	
-	fclose(fp);
+	ensure(fwrite(Header_get(header), 1, Header_get_size(header), fp) == Header_get_size(header), ERR_FILE_ACCESS, "Failed to write header to FITS file.");
+	Header_delete(header);
+	
+	// Write data in blocks of rows
+	const size_t block_rows = row_size < CATALOG_BLOCK_SIZE ? CATALOG_BLOCK_SIZE / row_size : 1;
+	unsigned char *buffer = (unsigned char *)memory(MALLOC, block_rows, row_size);
+	
+	for(size_t first = 0; first < self->size; first += block_rows)
+	{
+		const size_t n_rows = first + block_rows < self->size ? block_rows : self->size - first;
+		
+		// Source names, padded with NUL characters
+		for(size_t r = 0; r < n_rows; ++r)
+		{
+			unsigned char *ptr = buffer + r * row_size;
+			memset(ptr, 0, name_width);
+			memcpy(ptr, String_get(self->identifiers[first + r]), String_size(self->identifiers[first + r]));
+		}
+		
+		// Parameter columns
+		for(size_t j = 0; j < self->n_col; ++j)
+		{
+			const CatalogValue *column = self->values[j] + first;
+			unsigned char *ptr = buffer + name_width + j * sizeof(int64_t);
+			
+			for(size_t r = 0; r < n_rows; ++r, ptr += row_size)
+			{
+				if(self->types[j] == SOURCE_TYPE_INT)
+				{
+					const int64_t value_int = column[r].value_int;
+					memcpy(ptr, &value_int, sizeof(int64_t));
+				}
+				else memcpy(ptr, &column[r].value_flt, sizeof(double));
+				
+				if(swap) swap_byte_order((char *)ptr, sizeof(int64_t));
+			}
+		}
+		
+		ensure(fwrite(buffer, row_size, n_rows, fp) == n_rows, ERR_FILE_ACCESS, "Failed to write data to FITS file.");
+	}
+	
+	free(buffer);
+	
+	// Fill file with 0x00 if necessary
+	const size_t size_footer = (self->size * row_size) % FITS_HEADER_BLOCK_SIZE;
+	if(size_footer)
+	{
+		char footer[FITS_HEADER_BLOCK_SIZE];
+		memset(footer, 0, FITS_HEADER_BLOCK_SIZE - size_footer);
+		ensure(fwrite(footer, 1, FITS_HEADER_BLOCK_SIZE - size_footer, fp) == FITS_HEADER_BLOCK_SIZE - size_footer, ERR_FILE_ACCESS, "Failed to write data to FITS file.");
+	}
 	
 	return;
 }
@@ -527,11 +1352,325 @@ PUBLIC void Catalog_save(const Catalog *self, const char *filename, const file_f
 
 
 // ----------------------------------------------------------------- //
-// Reallocate memory for one additional source                       //
+// Write catalogue rows as VOTable BINARY2 stream                    //
 // ----------------------------------------------------------------- //
 // Arguments:                                                        //
 //                                                                   //
 //   (1) self     - Object self-reference.                           //
+//   (2) fp       - Output file.                                     //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for writing the content of the catalogue as the  //
+//   base64-encoded stream of a VOTable BINARY2 element. Each row    //
+//   starts with the null-flag bytes (all cleared), followed by the  //
+//   source name as a variable-length character array with a 32-bit  //
+//   length prefix and then all parameters as 64-bit big-endian in-  //
+//   tegers or doubles. Rows are serialised in blocks of about       //
+//   CATALOG_BLOCK_SIZE bytes and encoded in lines of 76 characters; //
+//   any bytes left over at the end of a block are carried over to   //
+//   the next one, so the stream is continuous. The enclosing STREAM //
+//   and BINARY2 elements must be written by the caller.             //
+// ----------------------------------------------------------------- //
+
+PRIVATE void Catalog_write_binary2(const Catalog *self, FILE *fp)
+{
+	const bool swap = is_little_endian();
+	const size_t n_flags = (self->n_col + 8) / 8;
+	const size_t line_bytes = 57;
+	
+	// Determine maximum size of each row
+	size_t name_width = 0;
+	for(size_t i = 0; i < self->size; ++i) if(String_size(self->identifiers[i]) > name_width) name_width = String_size(self->identifiers[i]);
+	const size_t row_size = n_flags + sizeof(uint32_t) + name_width + self->n_col * sizeof(int64_t);
+	const size_t block_rows = row_size < CATALOG_BLOCK_SIZE ? CATALOG_BLOCK_SIZE / row_size : 1;
+	
+	// Raw and encoded buffers; the raw buffer has room for carry-over
+	const size_t buffer_size = block_rows * row_size + line_bytes;
+	unsigned char *buffer = (unsigned char *)memory(MALLOC, buffer_size, sizeof(unsigned char));
+	char *text = (char *)memory(MALLOC, (buffer_size / line_bytes + 1) * 77, sizeof(char));
+	size_t fill = 0;
+	
+	for(size_t first = 0; first < self->size; first += block_rows)
+	{
+		const size_t last = first + block_rows < self->size ? first + block_rows : self->size;
+		
+		// Serialise rows
+		for(size_t i = first; i < last; ++i)
+		{
+			unsigned char *ptr = buffer + fill;
+			
+			memset(ptr, 0, n_flags);
+			ptr += n_flags;
+			
+			uint32_t length = String_size(self->identifiers[i]);
+			memcpy(ptr + sizeof(uint32_t), String_get(self->identifiers[i]), length);
+			if(swap) swap_byte_order((char *)&length, sizeof(uint32_t));
+			memcpy(ptr, &length, sizeof(uint32_t));
+			ptr += sizeof(uint32_t) + String_size(self->identifiers[i]);
+			
+			for(size_t j = 0; j < self->n_col; ++j, ptr += sizeof(int64_t))
+			{
+				if(self->types[j] == SOURCE_TYPE_INT)
+				{
+					const int64_t value_int = self->values[j][i].value_int;
+					memcpy(ptr, &value_int, sizeof(int64_t));
+				}
+				else memcpy(ptr, &self->values[j][i].value_flt, sizeof(double));
+				
+				if(swap) swap_byte_order((char *)ptr, sizeof(int64_t));
+			}
+			
+			fill = ptr - buffer;
+		}
+		
+		// Encode all complete lines and carry over the remainder
+		const size_t n_encode = fill - fill % line_bytes;
+		size_t n_text = 0;
+		
+		for(size_t k = 0; k < n_encode; k += line_bytes)
+		{
+			n_text += Catalog_encode_base64(buffer + k, line_bytes, text + n_text);
+			text[n_text++] = '\n';
+		}
+		
+		ensure(fwrite(text, 1, n_text, fp) == n_text, ERR_FILE_ACCESS, "Failed to write VOTable stream.");
+		memmove(buffer, buffer + n_encode, fill - n_encode);
+		fill -= n_encode;
+	}
+	
+	// Encode final, incomplete line
+	if(fill)
+	{
+		size_t n_text = Catalog_encode_base64(buffer, fill, text);
+		text[n_text++] = '\n';
+		ensure(fwrite(text, 1, n_text, fp) == n_text, ERR_FILE_ACCESS, "Failed to write VOTable stream.");
+	}
+	
+	free(buffer);
+	free(text);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Base64 encoding of binary data                                    //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) data     - Binary data to be encoded.                       //
+//   (2) size     - Number of bytes to be encoded.                   //
+//   (3) output   - Output buffer; must be able to hold at least     //
+//                  4 * ceil(size / 3) characters.                   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of characters written to output.                         //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private function for encoding the specified number of bytes in  //
+//   base64 as defined in RFC 4648. If size is not a multiple of 3,  //
+//   the output will be padded with '=' characters. No terminating   //
+//   null character will be written.                                 //
+// ----------------------------------------------------------------- //
+
+PRIVATE size_t Catalog_encode_base64(const unsigned char *data, const size_t size, char *output)
+{
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	char *ptr = output;
+	size_t i = 0;
+	
+	for(; i + 2 < size; i += 3)
+	{
+		const uint32_t triple = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | (uint32_t)data[i + 2];
+		*ptr++ = alphabet[(triple >> 18) & 0x3F];
+		*ptr++ = alphabet[(triple >> 12) & 0x3F];
+		*ptr++ = alphabet[(triple >>  6) & 0x3F];
+		*ptr++ = alphabet[ triple        & 0x3F];
+	}
+	
+	if(i < size)
+	{
+		const uint32_t triple = ((uint32_t)data[i] << 16) | (i + 1 < size ? (uint32_t)data[i + 1] << 8 : 0);
+		*ptr++ = alphabet[(triple >> 18) & 0x3F];
+		*ptr++ = alphabet[(triple >> 12) & 0x3F];
+		*ptr++ = i + 1 < size ? alphabet[(triple >> 6) & 0x3F] : '=';
+		*ptr++ = '=';
+	}
+	
+	return ptr - output;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Format catalogue rows in parallel and write them to file          //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self        - Object self-reference.                        //
+//   (2) fp          - Output file.                                  //
+//   (3) format      - Output format; must be CATALOG_FORMAT_ASCII,  //
+//                     CATALOG_FORMAT_XML or CATALOG_FORMAT_SQL.     //
+//   (4) indentation - Array of indentation strings for XML output;  //
+//                     ignored (and can be NULL) for other formats.  //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for writing all rows of the catalogue to the     //
+//   specified file in one of the text formats. Rows are split into  //
+//   chunks of CATALOG_CHUNK_ROWS rows which are formatted into sep- //
+//   arate memory buffers by multiple threads. Once a batch of       //
+//   chunks has been formatted, the buffers are written to the file  //
+//   in the original order with a single call to fwrite() each, so   //
+//   the output is identical to formatting all rows sequentially.    //
+//   The buffers are reused across batches to limit memory usage.    //
+// ----------------------------------------------------------------- //
+
+PRIVATE void Catalog_write_rows(const Catalog *self, FILE *fp, const file_format format, const char **indentation)
+{
+	// Determine number of chunks and chunks per batch
+	const size_t n_chunks = (self->size + CATALOG_CHUNK_ROWS - 1) / CATALOG_CHUNK_ROWS;
+	size_t n_batch = 4;
+	#ifdef _OPENMP
+		n_batch *= omp_get_max_threads();
+	#endif
+	if(n_batch > n_chunks) n_batch = n_chunks;
+	
+	CatalogBuffer *buffers = (CatalogBuffer *)memory(CALLOC, n_batch, sizeof(CatalogBuffer));
+	
+	for(size_t first = 0; first < n_chunks; first += n_batch)
+	{
+		const size_t last = first + n_batch < n_chunks ? first + n_batch : n_chunks;
+		
+		// Format chunks in parallel
+		#pragma omp parallel for schedule(dynamic, 1)
+		for(size_t chunk = first; chunk < last; ++chunk)
+		{
+			CatalogBuffer *buffer = buffers + (chunk - first);
+			const size_t row_last = (chunk + 1) * CATALOG_CHUNK_ROWS < self->size ? (chunk + 1) * CATALOG_CHUNK_ROWS : self->size;
+			buffer->size = 0;
+			
+			for(size_t i = chunk * CATALOG_CHUNK_ROWS; i < row_last; ++i) Catalog_format_row(self, i, format, indentation, buffer);
+		}
+		
+		// Write chunks in order
+		for(size_t chunk = first; chunk < last; ++chunk)
+		{
+			const CatalogBuffer *buffer = buffers + (chunk - first);
+			ensure(fwrite(buffer->data, 1, buffer->size, fp) == buffer->size, ERR_FILE_ACCESS, "Failed to write catalogue to file.");
+		}
+	}
+	
+	for(size_t i = 0; i < n_batch; ++i) free(buffers[i].data);
+	free(buffers);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Format a single catalogue row                                     //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self        - Object self-reference.                        //
+//   (2) row         - Index of the row to be formatted.             //
+//   (3) format      - Output format.                                //
+//   (4) indentation - Array of indentation strings for XML output.  //
+//   (5) buffer      - Buffer to which the formatted row will be ap- //
+//                     pended.                                       //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for appending the text representation of the     //
+//   specified row to the specified buffer, using the same number    //
+//   formats as in previous versions of SoFiA. This method does not  //
+//   modify the catalogue and can be called from multiple threads    //
+//   concurrently, provided that each thread uses its own buffer.    //
+// ----------------------------------------------------------------- //
+
+PRIVATE void Catalog_format_row(const Catalog *self, const size_t row, const file_format format, const char **indentation, CatalogBuffer *buffer)
+{
+	if(format == CATALOG_FORMAT_XML)
+	{
+		Catalog_buffer_printf(buffer, "%s<TR>\n", indentation[5]);
+		Catalog_buffer_printf(buffer, "%s<TD>%s</TD>\n", indentation[6], String_get(self->identifiers[row]));
+		
+		for(size_t j = 0; j < self->n_col; ++j)
+		{
+			if(self->types[j] == SOURCE_TYPE_INT) Catalog_buffer_printf(buffer, "%s<TD>%ld</TD>\n", indentation[6], self->values[j][row].value_int);
+			else Catalog_buffer_printf(buffer, "%s<TD>%.15e</TD>\n", indentation[6], self->values[j][row].value_flt);
+		}
+		
+		Catalog_buffer_printf(buffer, "%s</TR>\n", indentation[5]);
+	}
+	else if(format == CATALOG_FORMAT_SQL)
+	{
+		Catalog_buffer_printf(buffer, "(\'%s\', ", String_get(self->identifiers[row]));
+		
+		for(size_t j = 0; j < self->n_col; ++j)
+		{
+			if(self->types[j] == SOURCE_TYPE_INT) Catalog_buffer_printf(buffer, "%ld", self->values[j][row].value_int);
+			else Catalog_buffer_printf(buffer, "%.15e", self->values[j][row].value_flt);
+			if(j + 1 < self->n_col) Catalog_buffer_printf(buffer, ", ");
+		}
+		
+		if(row + 1 < self->size) Catalog_buffer_printf(buffer, "),\n");
+		else Catalog_buffer_printf(buffer, ");\n");
+	}
+	else
+	{
+		Catalog_buffer_printf(buffer, " %*s", 2 * CATALOG_COLUMN_WIDTH, String_get(self->identifiers[row]));
+		
+		for(size_t j = 0; j < self->n_col; ++j)
+		{
+			if(self->types[j] == SOURCE_TYPE_INT)
+			{
+				// Integer value
+				Catalog_buffer_printf(buffer, "%*ld", CATALOG_COLUMN_WIDTH, self->values[j][row].value_int);
+			}
+			else
+			{
+				// Floating-point value
+				const double value = self->values[j][row].value_flt;
+				if(value != 0.0 && (fabs(value) >= 1.0e+4 || fabs(value) < 1.0e-3)) Catalog_buffer_printf(buffer, "%*.5e", CATALOG_COLUMN_WIDTH, value);
+				else Catalog_buffer_printf(buffer, "%*.6f", CATALOG_COLUMN_WIDTH, value);
+			}
+		}
+		
+		Catalog_buffer_printf(buffer, "\n");
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Append formatted text to buffer                                   //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) buffer   - Buffer to append to.                             //
+//   (2) format   - printf() format string.                          //
+//   (3) ...      - Arguments to be formatted.                       //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
@@ -539,16 +1678,37 @@ PUBLIC void Catalog_save(const Catalog *self, const char *filename, const file_f
 //                                                                   //
 // Description:                                                      //
 //                                                                   //
-//   Private method for allocating additional memory for one more    //
-//   source in the specified catalogue. Note that this will not cre- //
-//   ate a new source yet, but just allocate the memory needed to    //
-//   append a source at the end of the catalogue. The function       //
-//   should be called from public member functions that will add     //
-//   sources to a catalogue prior to inserting the new source.       //
+//   Private function for appending the formatted text to the speci- //
+//   fied buffer, using the same conversions as printf(). The buffer //
+//   will be enlarged as needed, doubling its capacity each time to  //
+//   keep the number of reallocations small. The text in the buffer  //
+//   will not be null-terminated.                                    //
 // ----------------------------------------------------------------- //
 
-PRIVATE void Catalog_append_memory(Catalog *self)
+PRIVATE void Catalog_buffer_printf(CatalogBuffer *buffer, const char *format, ...)
 {
-	self->sources = (Source **)memory_realloc(self->sources, ++(self->size), sizeof(Source *));
+	va_list args;
+	va_list args_copy;
+	va_start(args, format);
+	va_copy(args_copy, args);
+	
+	// Try writing into remaining space
+	const size_t space = buffer->capacity - buffer->size;
+	int length = vsnprintf(space ? buffer->data + buffer->size : NULL, space, format, args);
+	ensure(length >= 0, ERR_FAILURE, "Encoding error in catalogue output.");
+	
+	// Enlarge buffer and try again if text did not fit
+	if((size_t)(length) >= space)
+	{
+		while(buffer->capacity - buffer->size <= (size_t)(length)) buffer->capacity = buffer->capacity ? 2 * buffer->capacity : 65536;
+		buffer->data = (char *)memory_realloc(buffer->data, buffer->capacity, sizeof(char));
+		vsnprintf(buffer->data + buffer->size, buffer->capacity - buffer->size, format, args_copy);
+	}
+	
+	buffer->size += length;
+	
+	va_end(args_copy);
+	va_end(args);
+	
 	return;
 }
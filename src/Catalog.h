@@ -33,39 +33,84 @@
 #define CATALOG_H
 
 #include <stdint.h>
+
+#ifdef HAVE_SQLITE3
+	#include <sqlite3.h>
+#endif
+
 #include "common.h"
 #include "Source.h"
+#include "Array_dbl.h"
+#include "Array_siz.h"
 
 #define CATALOG_COLUMN_WIDTH 14
+#define CATALOG_BLOCK_SIZE   1048576
+#define CATALOG_CHUNK_ROWS   1024
+#define CATALOG_SQLITE_BATCH 100000
 
-typedef enum {CATALOG_FORMAT_ASCII, CATALOG_FORMAT_XML, CATALOG_FORMAT_SQL} file_format;
+typedef enum {CATALOG_FORMAT_ASCII, CATALOG_FORMAT_XML, CATALOG_FORMAT_XML_BINARY, CATALOG_FORMAT_SQL, CATALOG_FORMAT_FITS} file_format;
 
 
 // ----------------------------------------------------------------- //
 // Class 'Catalog'                                                   //
 // ----------------------------------------------------------------- //
 // The purpose of this class is to provide a structure for storing   //
-// and handling source catalogues as a simple list of objects of     //
-// class 'Source'.                                                   //
+// and handling source catalogues. Catalogues are stored in columnar //
+// form with a single schema of column names, units, UCDs and data   //
+// types shared by all sources, while the values of each column are  //
+// held in a contiguous array. Columns can be accessed by index for  //
+// fast access, and individual rows are also accessible as objects   //
+// of class 'Source' for compatibility.                              //
 // ----------------------------------------------------------------- //
 
 typedef CLASS Catalog Catalog;
+typedef struct CatalogBuffer CatalogBuffer;
 
 // Constructor and destructor
-PUBLIC  Catalog *Catalog_new           (void);
-PUBLIC  void     Catalog_delete        (Catalog *self);
+PUBLIC  Catalog    *Catalog_new           (void);
+PUBLIC  void        Catalog_delete        (Catalog *self);
 
 // Public methods
-PUBLIC  void     Catalog_add_source    (Catalog *self, Source *src);
-PUBLIC  Source  *Catalog_get_source    (const Catalog *self, const size_t index);
-PUBLIC  size_t   Catalog_get_index     (const Catalog *self, const Source *src);
-PUBLIC  bool     Catalog_source_exists (const Catalog *self, const Source *src, size_t *index);
+PUBLIC  void        Catalog_add_source    (Catalog *self, Source *src);
+PUBLIC  size_t      Catalog_add_row       (Catalog *self, const char *identifier);
+PUBLIC  Source     *Catalog_get_source    (const Catalog *self, const size_t index);
+PUBLIC  size_t      Catalog_get_index     (const Catalog *self, const Source *src);
+PUBLIC  bool        Catalog_source_exists (const Catalog *self, const Source *src, size_t *index);
 
-PUBLIC  size_t   Catalog_get_size      (const Catalog *self);
+PUBLIC  size_t      Catalog_get_size      (const Catalog *self);
 
-PUBLIC  void     Catalog_save          (const Catalog *self, const char *filename, const file_format format, const bool overwrite);
+// Column schema
+PUBLIC  size_t      Catalog_add_column    (Catalog *self, const char *name, const unsigned char type, const char *unit, const char *ucd);
+PUBLIC  bool        Catalog_column_exists (const Catalog *self, const char *name, size_t *col);
+PUBLIC  size_t      Catalog_get_column    (const Catalog *self, const char *name);
+PUBLIC  size_t      Catalog_get_num_col   (const Catalog *self);
+PUBLIC  const char *Catalog_get_name      (const Catalog *self, const size_t col);
+PUBLIC  const char *Catalog_get_unit      (const Catalog *self, const size_t col);
+PUBLIC  const char *Catalog_get_ucd       (const Catalog *self, const size_t col);
+PUBLIC  unsigned char Catalog_get_type    (const Catalog *self, const size_t col);
+
+// Access to values
+PUBLIC  void        Catalog_set_identifier(Catalog *self, const size_t row, const char *name);
+PUBLIC  const char *Catalog_get_identifier(const Catalog *self, const size_t row);
+PUBLIC  void        Catalog_set_flt       (Catalog *self, const size_t row, const size_t col, const double value);
+PUBLIC  void        Catalog_set_int       (Catalog *self, const size_t row, const size_t col, const long int value);
+PUBLIC  double      Catalog_get_flt       (const Catalog *self, const size_t row, const size_t col);
+PUBLIC  long int    Catalog_get_int       (const Catalog *self, const size_t row, const size_t col);
+PUBLIC  void        Catalog_offset_xyz    (Catalog *self, const size_t dx, const size_t dy, const size_t dz);
+
+PUBLIC  void        Catalog_save          (const Catalog *self, const char *filename, const file_format format, const bool overwrite);
+PUBLIC  void        Catalog_save_sqlite   (const Catalog *self, const char *filename, const bool overwrite, Array_dbl * const *spectra, Array_siz * const *voxels);
 
 // Private methods
-PRIVATE void     Catalog_append_memory (Catalog *self);
+PRIVATE size_t      Catalog_append_memory (Catalog *self);
+PRIVATE void        Catalog_write_fits    (const Catalog *self, FILE *fp);
+PRIVATE void        Catalog_write_binary2 (const Catalog *self, FILE *fp);
+PRIVATE size_t      Catalog_encode_base64 (const unsigned char *data, const size_t size, char *output);
+PRIVATE void        Catalog_write_rows    (const Catalog *self, FILE *fp, const file_format format, const char **indentation);
+PRIVATE void        Catalog_format_row    (const Catalog *self, const size_t row, const file_format format, const char **indentation, CatalogBuffer *buffer);
+PRIVATE void        Catalog_buffer_printf (CatalogBuffer *buffer, const char *format, ...);
+#ifdef HAVE_SQLITE3
+PRIVATE void        Catalog_sqlite_exec   (sqlite3 *db, const char *sql);
+#endif
 
 #endif
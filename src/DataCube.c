@@ -44,6 +44,7 @@
 #include "DataCube.h"
 #include "Table.h"
 #include "Source.h"
+#include "PointGrid.h"
 #include "statistics_flt.h"
 #include "statistics_dbl.h"
 
@@ -98,6 +99,77 @@ CLASS DataCube
 };
 
 
+// ----------------------------------------------------------------- //
+// Declaration of source parameters measured during parameterisation //
+// ----------------------------------------------------------------- //
+
+struct SourcePar
+{
+	size_t src_id;
+	size_t n_pix;
+	size_t x_min;
+	size_t x_max;
+	size_t y_min;
+	size_t y_max;
+	size_t z_min;
+	size_t z_max;
+	bool   is_negative;
+	bool   rms_valid;
+	size_t kpa_counter;
+	double rms;
+	double pos_x;
+	double pos_y;
+	double pos_z;
+	double f_sum;
+	double f_min;
+	double f_max;
+	double w50;
+	double w20;
+	double err_x;
+	double err_y;
+	double err_z;
+	double ell_maj;
+	double ell_min;
+	double ell_pa;
+	double ell3s_maj;
+	double ell3s_min;
+	double ell3s_pa;
+	double kin_pa;
+};
+
+
+
+// ----------------------------------------------------------------- //
+// Declaration of data products held during cubelet creation         //
+// ----------------------------------------------------------------- //
+
+struct CubeletSet
+{
+	size_t    row;
+	size_t    src_id;
+	size_t    x_min;
+	size_t    x_max;
+	size_t    y_min;
+	size_t    y_max;
+	size_t    z_min;
+	size_t    z_max;
+	DataCube *cubelet;
+	DataCube *masklet;
+	DataCube *mom0;
+	DataCube *mom1;
+	DataCube *mom2;
+	DataCube *chan;
+	double   *spectrum;
+	size_t   *pixcount;
+	size_t    capacity;
+	size_t    memory;
+	bool      busy;
+	#ifdef _OPENMP
+		omp_lock_t lock;
+	#endif
+};
+
+
 
 // ----------------------------------------------------------------- //
 // Standard constructor                                              //
@@ -1525,7 +1597,7 @@ PUBLIC double DataCube_stat_gauss(const DataCube *self, const size_t cadence, co
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
-//   No return value.                                                //
+//   Array containing the noise level measured in each channel.      //
 //                                                                   //
 // Description:                                                      //
 //                                                                   //
@@ -1535,10 +1607,14 @@ PUBLIC double DataCube_stat_gauss(const DataCube *self, const size_t cadence, co
 //   noise measurement can be selected to ensure a robust noise mea- //
 //   surement. This method should be applied prior to source finding //
 //   on data cubes where the noise level varies with frequency, but  //
-//   is constant along the two spatial axes in each channel.         //
+//   is constant along the two spatial axes in each channel. Each    //
+//   plane is measured and divided by its noise level in one go. The //
+//   method returns an array with the noise level of each channel    //
+//   which can be used for quality control; the array will need to   //
+//   be deleted by the user once it is no longer required.           //
 // ----------------------------------------------------------------- //
 
-PUBLIC void DataCube_scale_noise_spec(const DataCube *self, const noise_stat statistic, const int range)
+PUBLIC Array_dbl *DataCube_scale_noise_spec(const DataCube *self, const noise_stat statistic, const int range)
 {
 	// Sanity checks
 	check_null(self);
@@ -1548,17 +1624,18 @@ PUBLIC void DataCube_scale_noise_spec(const DataCube *self, const noise_stat sta
 	// A few settings
 	const size_t size_xy = self->axis_size[0] * self->axis_size[1];
 	const size_t size_z  = self->axis_size[2];
-	double rms;
+	Array_dbl *noise_spec = Array_dbl_new(size_z);
 	
 	message("Dividing by noise in each image plane.");
 	size_t progress = 0;
-	const size_t progress_max = size_z - 1;
 	
-	#pragma omp parallel for schedule(static) private(rms)
+	// Measure noise in each plane and divide by it straight away while
+	// the plane is still in cache; only the master thread updates the
+	// progress bar, so no critical section is required.
+	#pragma omp parallel for schedule(dynamic, 1)
 	for(size_t i = 0; i < size_z; ++i)
 	{
-		#pragma omp critical
-		progress_bar("Progress: ", progress++, progress_max);
+		double rms;
 		
 		if(self->data_type == -32)
 		{
@@ -1580,9 +1657,23 @@ PUBLIC void DataCube_scale_noise_spec(const DataCube *self, const noise_stat sta
 			
 			for(double *ptr = ptr_start + size_xy; ptr --> ptr_start;) *ptr /= rms;
 		}
+		
+		Array_dbl_set(noise_spec, i, rms);
+		
+		size_t done;
+		#pragma omp atomic capture
+		done = ++progress;
+		
+		bool is_master = true;
+		#ifdef _OPENMP
+			is_master = (omp_get_thread_num() == 0);
+		#endif
+		if(is_master && done < size_z) progress_bar("Progress: ", done, size_z);
 	}
 	
-	return;
+	progress_bar("Progress: ", size_z, size_z);
+	
+	return noise_spec;
 }
 
 
@@ -2080,7 +2171,7 @@ PUBLIC void DataCube_gaussian_filter(DataCube *self, const double sigma)
 // Arguments:                                                        //
 //                                                                   //
 //   (1) self      - Object self-reference.                          //
-//   (2) order     - Order of polynomial fit (0 or 1).               //
+//   (2) order     - Order of polynomial fit (0 to 5).               //
 //   (3) shift     - Amount by which to shift and subtract spectrum. //
 //   (4) padding   - Padding around flagged channels with emission.  //
 //   (5) threshold - Threshold for flagging of emission.             //
@@ -2092,9 +2183,9 @@ PUBLIC void DataCube_gaussian_filter(DataCube *self, const double sigma)
 // Description:                                                      //
 //                                                                   //
 //   Public method for fitting and subtracting a polynomial from the //
-//   spectrum at each spatial position of the data cube. Currently,  //
-//   order = 0 (constant offset) and 1 (offset + linear slope) are   //
-//   implemented and supported.                                      //
+//   spectrum at each spatial position of the data cube. Orders of   //
+//   0 (constant offset), 1 (offset + linear slope) and up to        //
+//   CONTSUB_MAX_ORDER for higher-order polynomials are supported.   //
 //   The algorithm works by subtracting the spectrum shifted by      //
 //   -shift from the same spectrum shifted by +shift. It then uses a //
 //   robust algorithm for measuring the noise in the shifted and     //
@@ -2102,15 +2193,22 @@ PUBLIC void DataCube_gaussian_filter(DataCube *self, const double sigma)
 //   spectrum where the flux density exceeds threshold times the     //
 //   noise level. A certain amount of padding can be applied by set- //
 //   ting the padding parameter to > 0. In a last step, a polynomial //
-//   of order 0 or 1 is fitted and subtracted from all channels in   //
-//   the original data cube.                                         //
+//   of the requested order is fitted and subtracted from all chan-  //
+//   nels in the original data cube.                                 //
 //   For this algorithm to work correctly, the data must be a 3D     //
 //   cube with a sufficiently large number of channels. In addition, //
-//   the continuum residual must be a simple offset + slope, and     //
-//   higher-order variation cannot be handled at the moment. It is   //
-//   also crucial that any emission lines in the data cube do not    //
+//   the continuum residual must be well described by a low-order    //
+//   polynomial, and low orders should be preferred, as higher       //
+//   orders can partly absorb broad emission lines. It is also       //
+//   crucial that any emission lines in the data cube do not         //
 //   cover more than about 20% of the spectral band, as otherwise    //
 //   their presence may start to influence the fit.                  //
+//   The spectra are processed in tiles of CONTSUB_TILE_SIZE         //
+//   consecutive spatial pixels. Each tile is transposed into a      //
+//   spectrum-contiguous scratch buffer one channel at a time,       //
+//   processed by DataCube_contsub_spectrum() and then written back  //
+//   in a single pass, which avoids strided access to the data cube  //
+//   for every individual spectrum.                                  //
 // ----------------------------------------------------------------- //
 
 PUBLIC void DataCube_contsub(DataCube *self, unsigned int order, size_t shift, const size_t padding, double threshold)
@@ -2121,10 +2219,10 @@ PUBLIC void DataCube_contsub(DataCube *self, unsigned int order, size_t shift, c
 	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Cannot subtract continuum from integer data.");
 	ensure(self->axis_size[2] > 5 * shift, ERR_USER_INPUT, "Continuum subtraction requires 3D data cube with > %zu channels.", 5 * shift);
 	
-	if(order > 1)
+	if(order > CONTSUB_MAX_ORDER)
 	{
-		order = 1;
-		warning("Adjusting value of polynomial order to 1.");
+		order = CONTSUB_MAX_ORDER;
+		warning("Adjusting value of polynomial order to %d.", CONTSUB_MAX_ORDER);
 	}
 	
 	if(shift < 1)
@@ -2144,166 +2242,330 @@ PUBLIC void DataCube_contsub(DataCube *self, unsigned int order, size_t shift, c
 	const size_t ny = self->axis_size[1];
 	const size_t nz = self->axis_size[2];
 	const size_t nxy = nx * ny;
-	size_t counter = 0;        // For update of progress bar
+	const size_t n_tiles = (nxy + CONTSUB_TILE_SIZE - 1) / CONTSUB_TILE_SIZE;
+	size_t progress = 0;       // For update of progress bar
+	size_t n_failed = 0;       // Number of failed polynomial fits
 	
-	#pragma omp parallel
+	// Precompute powers of the scaled channel number, t = -1 ... +1,
+	// and their sums over all channels for higher-order fits
+	const size_t n_pow = 2 * order + 1;
+	double *powers  = NULL;
+	double *moments = NULL;
+	
+	if(order > 1)
 	{
-		double *spectrum     = (double *)memory(MALLOC, nz, sizeof(double));
-		double *spectrum_tmp = (double *)memory(MALLOC, nz, sizeof(double));
+		powers  = (double *)memory(MALLOC, nz * n_pow, sizeof(double));
+		moments = (double *)memory(CALLOC, n_pow, sizeof(double));
 		
-		// Loop over all spatial pixels
-		#pragma omp for schedule(static)
-		for(size_t y = 0; y < ny; ++y)
+		for(size_t i = 0; i < nz; ++i)
+		{
+			const double t = (2.0 * i - (nz - 1.0)) / (nz - 1.0);
+			double value = 1.0;
+			
+			for(size_t k = 0; k < n_pow; ++k)
+			{
+				powers[i * n_pow + k] = value;
+				moments[k] += value;
+				value *= t;
+			}
+		}
+	}
+	
+	#pragma omp parallel
+	{
+		// Spectrum-contiguous scratch tile and work buffers
+		double *tile    = (double *)memory(MALLOC, CONTSUB_TILE_SIZE * nz, sizeof(double));
+		double *work    = (double *)memory(MALLOC, 2 * nz, sizeof(double));
+		double *scratch = (double *)memory(MALLOC, nz, sizeof(double));
+		
+		// Loop over all tiles of consecutive spatial pixels
+		#pragma omp for schedule(dynamic, 1) reduction(+: n_failed)
+		for(size_t t = 0; t < n_tiles; ++t)
 		{
 			#pragma omp critical
-			progress_bar("Progress: ", ++counter, ny);
+			progress_bar("Progress: ", ++progress, n_tiles);
 			
-			for(size_t x = 0; x < nx; ++x)
+			const size_t first = t * CONTSUB_TILE_SIZE;
+			const size_t n_pix = first + CONTSUB_TILE_SIZE < nxy ? CONTSUB_TILE_SIZE : nxy - first;
+			
+			// Transpose tile into scratch buffer, one channel at a time
+			if(self->data_type == -32)
 			{
-				// Extract spectrum
-				if(self->data_type == -32)
-				{
-					// 32-bit float
-					float *ptr = (float *)(self->data) + x + nx * y;
-					for(size_t i = 0; i < nz; ++i)
-					{
-						spectrum[i] = *ptr;
-						ptr += nxy;
-					}
-				}
-				else
-				{
-					// 64-bit float
-					double *ptr = (double *)(self->data) + x + nx * y;
-					for(size_t i = 0; i < nz; ++i)
-					{
-						spectrum[i] = *ptr;
-						ptr += nxy;
-					}
-				}
-				
-				// Shift and subtract spectrum from itself
-				for(size_t i = 0; i < nz; ++i)
-				{
-					spectrum_tmp[i] = (i < shift || i >= nz - shift) ? NAN : spectrum[i - shift] - spectrum[i + shift];
-				}
-				
-				// Robust noise measurement
-				const double rms = threshold * robust_noise_2_dbl(spectrum_tmp, nz);
-				
-				// Mask everything > rms
-				for(size_t i = 0; i < nz; ++i)
+				// 32-bit float
+				for(size_t z = 0; z < nz; ++z)
 				{
-					if(fabs(spectrum_tmp[i]) > rms)
-					{
-						const size_t j_min = (i > padding) ? i - padding : 0;
-						const size_t j_max = (i + padding < nz) ? i + padding : nz - 1;
-						for(size_t j = j_min; j <= j_max; ++j) spectrum[j] = NAN;
-					}
+					const float *ptr = (float *)(self->data) + first + nxy * z;
+					for(size_t i = 0; i < n_pix; ++i) tile[i * nz + z] = ptr[i];
 				}
-				
-				// Measure means
-				double x_mean = 0.0;
-				double y_mean = 0.0;
-				counter = 0;
-				
-				for(size_t i = 0; i < nz; ++i)
+			}
+			else
+			{
+				// 64-bit float
+				for(size_t z = 0; z < nz; ++z)
 				{
-					if(IS_NOT_NAN(spectrum[i]))
-					{
-						x_mean += i;
-						y_mean += spectrum[i];
-						++counter;
-					}
+					const double *ptr = (double *)(self->data) + first + nxy * z;
+					for(size_t i = 0; i < n_pix; ++i) tile[i * nz + z] = ptr[i];
 				}
-				
-				if(counter == 0) continue;  // Cannot fit, as nothing left after filtering
-				x_mean /= counter;
-				y_mean /= counter;
-				
-				if(order)
+			}
+			
+			// Fit and subtract polynomial from each spectrum
+			for(size_t i = 0; i < n_pix; ++i)
+			{
+				if(!DataCube_contsub_spectrum(tile + i * nz, nz, order, shift, padding, threshold, powers, moments, work, scratch)) ++n_failed;
+			}
+			
+			// Write tile back into data cube
+			if(self->data_type == -32)
+			{
+				// 32-bit float
+				for(size_t z = 0; z < nz; ++z)
 				{
-					// Fit and subtract 1st-order polynomial
-					double alpha = 0.0;
-					double beta = 0.0;
-					
-					for(size_t i = 0; i < nz; ++i)
-					{
-						if(IS_NOT_NAN(spectrum[i]))
-						{
-							alpha += (x_mean - i) * (x_mean - i);
-							beta  += (x_mean - i) * (y_mean - spectrum[i]);
-						}
-					}
-					
-					if(alpha == 0)
-					{
-						// Cannot fit for some reason
-						warning("Polynomial fit failed at position (%zu, %zu).", x, y);
-						continue;
-					}
-					
-					beta /= alpha;
-					alpha = y_mean - beta * x_mean;
-					
-					if(self->data_type == -32)
-					{
-						// 32-bit float
-						float *ptr = (float *)(self->data) + x + nx * y;
-						for(size_t i = 0; i < nz; ++i)
-						{
-							*ptr -= (alpha + beta * i);
-							ptr += nxy;
-						}
-					}
-					else
-					{
-						// 64-bit float
-						double *ptr = (double *)(self->data) + x + nx * y;
-						for(size_t i = 0; i < nz; ++i)
-						{
-							*ptr -= (alpha + beta * i);
-							ptr += nxy;
-						}
-					}
+					float *ptr = (float *)(self->data) + first + nxy * z;
+					for(size_t i = 0; i < n_pix; ++i) ptr[i] = tile[i * nz + z];
 				}
-				else
+			}
+			else
+			{
+				// 64-bit float
+				for(size_t z = 0; z < nz; ++z)
 				{
-					// Subtract mean
-					if(self->data_type == -32)
-					{
-						// 32-bit float
-						float *ptr = (float *)(self->data) + x + nx * y;
-						for(size_t i = 0; i < nz; ++i)
-						{
-							*ptr -= y_mean;
-							ptr += nxy;
-						}
-					}
-					else
-					{
-						// 64-bit float
-						double *ptr = (double *)(self->data) + x + nx * y;
-						for(size_t i = 0; i < nz; ++i)
-						{
-							*ptr -= y_mean;
-							ptr += nxy;
-						}
-					}
+					double *ptr = (double *)(self->data) + first + nxy * z;
+					for(size_t i = 0; i < n_pix; ++i) ptr[i] = tile[i * nz + z];
 				}
 			}
 		}
 		
 		// Clean-up
-		free(spectrum);
-		free(spectrum_tmp);
+		free(tile);
+		free(work);
+		free(scratch);
 	}
 	
+	// Report failed fits once rather than per spectrum
+	if(n_failed) warning("Polynomial fit failed for %zu of %zu spectra.", n_failed, nxy);
+	
+	// Clean up
+	free(powers);
+	free(moments);
+	
 	return;
 }
 
 
 
+// ----------------------------------------------------------------- //
+// Subtract residual continuum emission from a single spectrum       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) spectrum  - Spectrum to be processed (modified in place).   //
+//   (2) nz        - Number of channels.                             //
+//   (3) order     - Order of polynomial fit (0 to 5).               //
+//   (4) shift     - Amount by which to shift and subtract spectrum. //
+//   (5) padding   - Padding around flagged channels with emission.  //
+//   (6) threshold - Threshold for flagging of emission.             //
+//   (7) powers    - Powers 0 to 2 * order of the scaled channel     //
+//                   number for each channel (only for order > 1).   //
+//   (8) moments   - Sums of powers over all channels (order > 1).   //
+//   (9) work      - Work buffer of size 2 * nz.                     //
+//  (10) scratch   - Scratch buffer of size nz.                      //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Returns false if the polynomial fit failed, true otherwise.     //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method implementing the continuum subtraction of Data-  //
+//   Cube_contsub() for a single spectrum held in contiguous memory. //
+//   The caller-supplied work and scratch buffers are used for the   //
+//   masked copy of the spectrum, the shifted and subtracted spec-   //
+//   trum and the robust noise measurement, so no memory needs to be //
+//   allocated per spectrum.                                         //
+//   Polynomials of order > 1 are fitted by solving the normal       //
+//   equations through Cholesky decomposition in fixed-size local    //
+//   arrays. The sums of powers entering the normal matrix are de-   //
+//   rived from the powers and sums precomputed by the caller, such  //
+//   that only the flagged (or unflagged, whichever are fewer) chan- //
+//   nels need to be accounted for, making higher orders almost as   //
+//   cheap as order 1.                                               //
+//   The spectrum will be left unchanged if no channels remain after //
+//   flagging or the fit fails. Failures are not reported here, but  //
+//   left to the caller, so they can be summarised after the loop.   //
+// ----------------------------------------------------------------- //
+
+PRIVATE bool DataCube_contsub_spectrum(double *spectrum, const size_t nz, const unsigned int order, const size_t shift, const size_t padding, const double threshold, const double *powers, const double *moments, double *work, double *scratch)
+{
+	double *masked = work;
+	double *shifted = work + nz;
+	
+	// Shift and subtract spectrum from itself
+	for(size_t i = 0; i < nz; ++i)
+	{
+		masked[i] = spectrum[i];
+		shifted[i] = (i < shift || i >= nz - shift) ? NAN : spectrum[i - shift] - spectrum[i + shift];
+	}
+	
+	// Robust noise measurement (same as robust_noise_2_dbl)
+	size_t n_noise = 0;
+	for(size_t i = 0; i < nz; ++i)
+	{
+		if(shifted[i] < 0.0) scratch[n_noise++] = -shifted[i];
+		else if(shifted[i] >= 0.0) scratch[n_noise++] = shifted[i];
+	}
+	const double rms = threshold * (n_noise ? MAD_TO_STD * nth_element_dbl(scratch, n_noise, n_noise / 2) : NAN);
+	
+	// Mask everything > rms
+	for(size_t i = 0; i < nz; ++i)
+	{
+		if(fabs(shifted[i]) > rms)
+		{
+			const size_t j_min = (i > padding) ? i - padding : 0;
+			const size_t j_max = (i + padding < nz) ? i + padding : nz - 1;
+			for(size_t j = j_min; j <= j_max; ++j) masked[j] = NAN;
+		}
+	}
+	
+	// Measure means
+	double x_mean = 0.0;
+	double y_mean = 0.0;
+	size_t counter = 0;
+	
+	for(size_t i = 0; i < nz; ++i)
+	{
+		if(IS_NOT_NAN(masked[i]))
+		{
+			x_mean += i;
+			y_mean += masked[i];
+			++counter;
+		}
+	}
+	
+	if(counter == 0) return true;  // Cannot fit, as nothing left after filtering
+	x_mean /= counter;
+	y_mean /= counter;
+	
+	if(order > 1)
+	{
+		// Fit and subtract higher-order polynomial via normal equations
+		const size_t n_par = order + 1;
+		const size_t n_pow = 2 * order + 1;
+		double matrix[(CONTSUB_MAX_ORDER + 1) * (CONTSUB_MAX_ORDER + 1)];
+		double coeff[CONTSUB_MAX_ORDER + 1];
+		double sums[2 * CONTSUB_MAX_ORDER + 1];
+		
+		if(counter < n_par)
+		{
+			return false;
+		}
+		
+		// Sums of powers over unflagged channels; if most channels are
+		// unflagged, subtract the flagged ones from the precomputed sums
+		if(2 * counter > nz)
+		{
+			for(size_t k = 0; k < n_pow; ++k) sums[k] = moments[k];
+			for(size_t i = 0; i < nz; ++i)
+			{
+				if(IS_NAN(masked[i])) for(size_t k = 0; k < n_pow; ++k) sums[k] -= powers[i * n_pow + k];
+			}
+		}
+		else
+		{
+			for(size_t k = 0; k < n_pow; ++k) sums[k] = 0.0;
+			for(size_t i = 0; i < nz; ++i)
+			{
+				if(IS_NOT_NAN(masked[i])) for(size_t k = 0; k < n_pow; ++k) sums[k] += powers[i * n_pow + k];
+			}
+		}
+		
+		// Right-hand side of normal equations
+		for(size_t k = 0; k < n_par; ++k) coeff[k] = 0.0;
+		for(size_t i = 0; i < nz; ++i)
+		{
+			if(IS_NOT_NAN(masked[i])) for(size_t k = 0; k < n_par; ++k) coeff[k] += masked[i] * powers[i * n_pow + k];
+		}
+		
+		// Cholesky decomposition of normal matrix
+		for(size_t j = 0; j < n_par; ++j)
+		{
+			double diag = sums[2 * j];
+			for(size_t k = 0; k < j; ++k) diag -= matrix[j * n_par + k] * matrix[j * n_par + k];
+			
+			if(diag <= 0.0)
+			{
+				// Cannot fit for some reason
+				return false;
+			}
+			
+			matrix[j * n_par + j] = sqrt(diag);
+			
+			for(size_t r = j + 1; r < n_par; ++r)
+			{
+				double value = sums[r + j];
+				for(size_t k = 0; k < j; ++k) value -= matrix[r * n_par + k] * matrix[j * n_par + k];
+				matrix[r * n_par + j] = value / matrix[j * n_par + j];
+			}
+		}
+		
+		// Forward and backward substitution
+		for(size_t j = 0; j < n_par; ++j)
+		{
+			for(size_t k = 0; k < j; ++k) coeff[j] -= matrix[j * n_par + k] * coeff[k];
+			coeff[j] /= matrix[j * n_par + j];
+		}
+		
+		for(size_t j = n_par; j--;)
+		{
+			for(size_t k = j + 1; k < n_par; ++k) coeff[j] -= matrix[k * n_par + j] * coeff[k];
+			coeff[j] /= matrix[j * n_par + j];
+		}
+		
+		// Subtract polynomial, evaluated using Horner's method
+		for(size_t i = 0; i < nz; ++i)
+		{
+			const double t = powers[i * n_pow + 1];
+			double value = coeff[order];
+			for(size_t k = order; k--;) value = value * t + coeff[k];
+			spectrum[i] -= value;
+		}
+	}
+	else if(order)
+	{
+		// Fit and subtract 1st-order polynomial
+		double alpha = 0.0;
+		double beta = 0.0;
+		
+		for(size_t i = 0; i < nz; ++i)
+		{
+			if(IS_NOT_NAN(masked[i]))
+			{
+				alpha += (x_mean - i) * (x_mean - i);
+				beta  += (x_mean - i) * (y_mean - masked[i]);
+			}
+		}
+		
+		if(alpha == 0)
+		{
+			// Cannot fit for some reason
+			return false;
+		}
+		
+		beta /= alpha;
+		alpha = y_mean - beta * x_mean;
+		
+		for(size_t i = 0; i < nz; ++i) spectrum[i] -= (alpha + beta * i);
+	}
+	else
+	{
+		// Subtract mean
+		for(size_t i = 0; i < nz; ++i) spectrum[i] -= y_mean;
+	}
+	
+	return true;
+}
+
+
+
 // ----------------------------------------------------------------- //
 // Spatial filter                                                    //
 // ----------------------------------------------------------------- //
@@ -2333,30 +2595,40 @@ PUBLIC void DataCube_contsub(DataCube *self, unsigned int order, size_t shift, c
 //   cell will be spectrally smoothed with a boxcar filter of that   //
 //   radius before being subtracted from each pixel. This can help   //
 //   to reduce the noisiness of the averaged spectrum.               //
+//   Pixel values are gathered row by row directly from the data     //
+//   array and averaged in the native precision of the cube, so      //
+//   32-bit cubes are processed without conversion to double. The    //
+//   median is found by selection rather than sorting, making the    //
+//   cost per pixel independent of the window size.                  //
 // ----------------------------------------------------------------- //
 
 PUBLIC void DataCube_spatial_filter(DataCube *self, const int statistic, const size_t window_spat, const size_t radius_spec)
 {
 	// Sanity checks
 	check_null(self);
+	check_null(self->data);
+	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Cannot apply spatial filter to integer data.");
+	ensure(window_spat, ERR_USER_INPUT, "Window size of spatial filter must be > 0.");
 	
 	// Determine number of grid cells
 	const size_t nx = self->axis_size[0];
 	const size_t ny = self->axis_size[1];
 	const size_t nz = self->axis_size[2];
+	const size_t nxy = nx * ny;
 	
 	// Set up progress bar
-	size_t progress = 1;
+	size_t progress = 0;
 	const size_t n_cells_x = nx % window_spat ? nx / window_spat + 1 : nx / window_spat;
 	const size_t n_cells_y = ny % window_spat ? ny / window_spat + 1 : ny / window_spat;
 	const size_t progress_max = n_cells_x * n_cells_y;
 	
 	#pragma omp parallel
 	{
-		// Create average spectrum + temporary array
+		// Create average spectrum + temporary array of native precision
 		double *spectrum_avg = memory(MALLOC, nz, sizeof(double));
 		double *spectrum_copy = memory(MALLOC, nz + 2 * radius_spec, sizeof(double));
-		double *array_tmp = memory(MALLOC, window_spat * window_spat, sizeof(double));
+		float  *array_flt = self->data_type == -32 ? memory(MALLOC, window_spat * window_spat, sizeof(float))  : NULL;
+		double *array_dbl = self->data_type == -64 ? memory(MALLOC, window_spat * window_spat, sizeof(double)) : NULL;
 		
 		// Loop over all spatial grid cells
 		#pragma omp for collapse(2) schedule(static)
@@ -2364,35 +2636,57 @@ PUBLIC void DataCube_spatial_filter(DataCube *self, const int statistic, const s
 		{
 			for(size_t x = 0; x < nx; x += window_spat)
 			{
-				#pragma omp critical
-				progress_bar("Progress: ", progress++, progress_max);
+				size_t done;
+				#pragma omp atomic capture
+				done = ++progress;
+				
+				bool is_master = true;
+				#ifdef _OPENMP
+					is_master = (omp_get_thread_num() == 0);
+				#endif
+				if(is_master && done < progress_max) progress_bar("Progress: ", done, progress_max);
+				
+				// Extent of grid cell, truncated at image boundaries
+				const size_t width  = x + window_spat < nx ? window_spat : nx - x;
+				const size_t height = y + window_spat < ny ? window_spat : ny - y;
 				
 				// Loop over all channels
 				for(size_t z = 0; z < nz; ++z)
 				{
+					const size_t offset = x + nx * y + nxy * z;
 					size_t counter = 0;
 					
-					// Loop over spatial window
-					for(size_t dy = 0; dy < window_spat; ++dy)
+					if(self->data_type == -32)
 					{
-						for(size_t dx = 0; dx < window_spat; ++dx)
+						// 32-bit float: copy finite pixel values row by row
+						for(size_t dy = 0; dy < height; ++dy)
 						{
-							if(x + dx < nx && y + dy < ny)
-							{
-								// Copy pixel values into temporary array
-								const double value = DataCube_get_data_flt(self, x + dx, y + dy, z);
-								if(isfinite(value))
-								{
-									array_tmp[counter] = value;
-									++counter;
-								}
-							}
+							const float *ptr = (float *)(self->data) + offset + nx * dy;
+							for(size_t dx = 0; dx < width; ++dx) if(isfinite(ptr[dx])) array_flt[counter++] = ptr[dx];
+						}
+						
+						// Determine average value
+						if(counter == 0) spectrum_avg[z] = 0.0;
+						else if(statistic)
+						{
+							const double value = nth_element_flt(array_flt, counter, counter / 2);
+							spectrum_avg[z] = IS_ODD(counter) ? value : (value + max_flt(array_flt, counter / 2)) / 2.0;
 						}
+						else spectrum_avg[z] = mean_flt(array_flt, counter);
+					}
+					else
+					{
+						// 64-bit float: copy finite pixel values row by row
+						for(size_t dy = 0; dy < height; ++dy)
+						{
+							const double *ptr = (double *)(self->data) + offset + nx * dy;
+							for(size_t dx = 0; dx < width; ++dx) if(isfinite(ptr[dx])) array_dbl[counter++] = ptr[dx];
+						}
+						
+						// Determine average value
+						if(counter) spectrum_avg[z] = statistic ? median_dbl(array_dbl, counter, false) : mean_dbl(array_dbl, counter);
+						else spectrum_avg[z] = 0.0;
 					}
-					
-					// Determine average value
-					if(counter) spectrum_avg[z] = statistic ? median_dbl(array_tmp, counter, false) : mean_dbl(array_tmp, counter);
-					else spectrum_avg[z] = 0.0;
 				}
 				
 				// If requested, smooth average spectrum using boxcar filter
@@ -2401,11 +2695,26 @@ PUBLIC void DataCube_spatial_filter(DataCube *self, const int statistic, const s
 				// Subtract cell average from original data
 				for(size_t z = 0; z < nz; ++z)
 				{
-					for(size_t dy = 0; dy < window_spat; ++dy)
+					const size_t offset = x + nx * y + nxy * z;
+					
+					if(self->data_type == -32)
+					{
+						// NOTE: The average is rounded to float and added in float, exactly
+						//       as in DataCube_add_data_flt(), to retain identical results.
+						const float value = (float)(-spectrum_avg[z]);
+						for(size_t dy = 0; dy < height; ++dy)
+						{
+							float *ptr = (float *)(self->data) + offset + nx * dy;
+							for(size_t dx = 0; dx < width; ++dx) ptr[dx] += value;
+						}
+					}
+					else
 					{
-						for(size_t dx = 0; dx < window_spat; ++dx)
+						const double value = spectrum_avg[z];
+						for(size_t dy = 0; dy < height; ++dy)
 						{
-							if(x + dx < nx && y + dy < ny) DataCube_add_data_flt(self, x + dx, y + dy, z, -spectrum_avg[z]);
+							double *ptr = (double *)(self->data) + offset + nx * dy;
+							for(size_t dx = 0; dx < width; ++dx) ptr[dx] -= value;
 						}
 					}
 				}
@@ -2415,9 +2724,12 @@ PUBLIC void DataCube_spatial_filter(DataCube *self, const int statistic, const s
 		// Clean up
 		free(spectrum_avg);
 		free(spectrum_copy);
-		free(array_tmp);
+		free(array_flt);
+		free(array_dbl);
 	} // END parallel section
 	
+	progress_bar("Progress: ", progress_max, progress_max);
+	
 	return;
 }
 
@@ -2497,30 +2809,38 @@ PUBLIC void DataCube_mask(const DataCube *self, DataCube *maskCube, const double
 	return;
 }
 
-// Same, but for 8-bit mask cubes (faster)
+// Same, but for bit masks (faster)
 
-PUBLIC void DataCube_mask_8(const DataCube *self, DataCube *maskCube, const double threshold, const uint8_t value)
+PUBLIC void DataCube_mask_bits(const DataCube *self, BitMask *mask, const double threshold)
 {
 	// Sanity checks
 	check_null(self);
 	check_null(self->data);
-	check_null(maskCube);
-	check_null(maskCube->data);
+	check_null(mask);
 	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Data cube must be of floating-point type.");
-	ensure(maskCube->data_type == 8, ERR_USER_INPUT, "Mask cube must be of 8-bit integer type.");
-	ensure(self->axis_size[0] == maskCube->axis_size[0] && self->axis_size[1] == maskCube->axis_size[1] && self->axis_size[2] == maskCube->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
+	ensure(self->axis_size[0] == BitMask_get_axis_size(mask, 0) && self->axis_size[1] == BitMask_get_axis_size(mask, 1) && self->axis_size[2] == BitMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Data cube and bit mask have different sizes.");
 	ensure(threshold > 0.0, ERR_USER_INPUT, "Threshold must be positive.");
 	
-	uint8_t *ptr_mask = (uint8_t *)(maskCube->data);
+	uint64_t *ptr_mask = BitMask_get_ptr(mask);
+	const size_t n_words = BitMask_get_words(mask);
 	
+	// NOTE: Each thread assembles entire 64-bit words, so no two
+	//       threads will ever write to the same word of the mask.
+	//       The branch-free inner loop can be vectorised.
 	if(self->data_type == -32)
 	{
 		const float *ptr_data = (float *)(self->data);
 		
 		#pragma omp parallel for schedule(static)
-		for(size_t i = 0; i < self->data_size; ++i)
+		for(size_t w = 0; w < n_words; ++w)
 		{
-			if(fabs(*(ptr_data + i)) > threshold) *(ptr_mask + i) = value;
+			const size_t first = w * BITMASK_WORD_BITS;
+			const size_t n_bits = first + BITMASK_WORD_BITS > self->data_size ? self->data_size - first : BITMASK_WORD_BITS;
+			uint64_t bits = 0;
+			
+			for(size_t j = 0; j < n_bits; ++j) bits |= (uint64_t)(fabs(ptr_data[first + j]) > threshold) << j;
+			
+			ptr_mask[w] |= bits;
 		}
 	}
 	else
@@ -2528,9 +2848,15 @@ PUBLIC void DataCube_mask_8(const DataCube *self, DataCube *maskCube, const doub
 		const double *ptr_data = (double *)(self->data);
 		
 		#pragma omp parallel for schedule(static)
-		for(size_t i = 0; i < self->data_size; ++i)
+		for(size_t w = 0; w < n_words; ++w)
 		{
-			if(fabs(*(ptr_data + i)) > threshold) *(ptr_mask + i) = value;
+			const size_t first = w * BITMASK_WORD_BITS;
+			const size_t n_bits = first + BITMASK_WORD_BITS > self->data_size ? self->data_size - first : BITMASK_WORD_BITS;
+			uint64_t bits = 0;
+			
+			for(size_t j = 0; j < n_bits; ++j) bits |= (uint64_t)(fabs(ptr_data[first + j]) > threshold) << j;
+			
+			ptr_mask[w] |= bits;
 		}
 	}
 	
@@ -2599,28 +2925,35 @@ PUBLIC void DataCube_set_masked(DataCube *self, const DataCube *maskCube, const
 	return;
 }
 
-// Same, but for 8-bit mask cube (faster) //
+// Same, but for bit mask (faster) //
 
-PUBLIC void DataCube_set_masked_8(DataCube *self, const DataCube *maskCube, const double value)
+PUBLIC void DataCube_set_masked_bits(DataCube *self, const BitMask *mask, const double value)
 {
 	check_null(self);
 	check_null(self->data);
-	check_null(maskCube);
-	check_null(maskCube->data);
+	check_null(mask);
 	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Data cube must be of floating-point type.");
-	ensure(maskCube->data_type == 8, ERR_USER_INPUT, "Mask cube must be of 8-bit integer type.");
-	ensure(self->axis_size[0] == maskCube->axis_size[0] && self->axis_size[1] == maskCube->axis_size[1] && self->axis_size[2] == maskCube->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
+	ensure(self->axis_size[0] == BitMask_get_axis_size(mask, 0) && self->axis_size[1] == BitMask_get_axis_size(mask, 1) && self->axis_size[2] == BitMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Data cube and bit mask have different sizes.");
 	
-	const uint8_t *ptr_mask = (uint8_t *)(maskCube->data);
+	const uint64_t *ptr_mask = BitMask_get_ptr(mask);
+	const size_t n_words = BitMask_get_words(mask);
 	
+	// NOTE: Words without any bits set are skipped entirely, which
+	//       is the common case for sparse detection masks.
 	if(self->data_type == -32)
 	{
 		float *ptr_data = (float *)(self->data);
 		
 		#pragma omp parallel for schedule(static)
-		for(size_t i = 0; i < self->data_size; ++i)
+		for(size_t w = 0; w < n_words; ++w)
 		{
-			if(*(ptr_mask + i)) *(ptr_data + i) = copysign(value, *(ptr_data + i));
+			uint64_t bits = ptr_mask[w];
+			float *ptr = ptr_data + w * BITMASK_WORD_BITS;
+			
+			for(size_t j = 0; bits; ++j, bits >>= 1)
+			{
+				if(bits & 1) ptr[j] = copysign(value, ptr[j]);
+			}
 		}
 	}
 	else
@@ -2628,11 +2961,17 @@ PUBLIC void DataCube_set_masked_8(DataCube *self, const DataCube *maskCube, cons
 		double *ptr_data = (double *)(self->data);
 		
 		#pragma omp parallel for schedule(static)
-		for(size_t i = 0; i < self->data_size; ++i)
+		for(size_t w = 0; w < n_words; ++w)
 		{
-			if(*(ptr_mask + i)) *(ptr_data + i) = copysign(value, *(ptr_data + i));
-		}
-	}
+			uint64_t bits = ptr_mask[w];
+			double *ptr = ptr_data + w * BITMASK_WORD_BITS;
+			
+			for(size_t j = 0; bits; ++j, bits >>= 1)
+			{
+				if(bits & 1) ptr[j] = copysign(value, ptr[j]);
+			}
+		}
+	}
 	
 	return;
 }
@@ -2684,6 +3023,9 @@ PUBLIC void DataCube_reset_mask_32(DataCube *self, const int32_t value)
 //   (1) self      - Object self-reference.                          //
 //   (2) filter    - Map object with old and new label pairs of all  //
 //                   reliable sources.                               //
+//   (3) index     - Voxel index of all sources in the mask. Can be  //
+//                   NULL, in which case the entire mask will be     //
+//                   searched.                                       //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
@@ -2697,10 +3039,12 @@ PUBLIC void DataCube_reset_mask_32(DataCube *self, const int32_t value)
 //   pixel value with its new label. Pixel values not present in the //
 //   list will be discarded by setting them to 0. If an empty filter //
 //   is supplied, a warning message appears and no filtering will be //
-//   done.                                                           //
+//   done. If a voxel index is supplied, only the voxels recorded in //
+//   the index will be visited, and the index itself will be relab-  //
+//   elled in the same way.                                          //
 // ----------------------------------------------------------------- //
 
-PUBLIC void DataCube_filter_mask_32(DataCube *self, const Map *filter)
+PUBLIC void DataCube_filter_mask_32(DataCube *self, const Map *filter, VoxelIndex *index)
 {
 	// Sanity checks
 	check_null(self);
@@ -2714,6 +3058,31 @@ PUBLIC void DataCube_filter_mask_32(DataCube *self, const Map *filter)
 		return;
 	}
 	
+	if(index != NULL)
+	{
+		// Only visit voxels recorded in the index, one source at a time
+		const size_t max_label = VoxelIndex_get_max_label(index);
+		
+		#pragma omp parallel for schedule(dynamic, 16)
+		for(size_t label = 1; label <= max_label; ++label)
+		{
+			size_t first, last;
+			if(VoxelIndex_get_runs(index, label, &first, &last) == 0) continue;
+			const int32_t new_label = Map_key_exists(filter, label) ? Map_get_value(filter, label) : 0;
+			
+			for(size_t i = first; i < last; ++i)
+			{
+				size_t x, y, z, length;
+				VoxelIndex_get_run(index, i, &x, &y, &z, &length);
+				int32_t *ptr = (int32_t *)(self->data) + DataCube_get_index(self, x, y, z);
+				for(int32_t *ptr_end = ptr + length; ptr < ptr_end; ++ptr) *ptr = new_label;
+			}
+		}
+		
+		VoxelIndex_relabel(index, filter);
+		return;
+	}
+	
 	#pragma omp parallel for schedule(static)
 	for(int32_t *ptr = (int32_t *)(self->data); ptr < (int32_t *)(self->data) + self->data_size; ++ptr)
 	{
@@ -2729,6 +3098,166 @@ PUBLIC void DataCube_filter_mask_32(DataCube *self, const Map *filter)
 
 
 
+// ----------------------------------------------------------------- //
+// Add voxels in region of mask to voxel index                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) index     - Voxel index to which runs will be added.        //
+//   (3) label     - Source label to be indexed. If 0, all positive  //
+//                   labels will be indexed.                         //
+//   (4) x_min     - Lower boundary of region in x.                  //
+//   (5) x_max     - Upper boundary of region in x.                  //
+//   (6) y_min     - Lower boundary of region in y.                  //
+//   (7) y_max     - Upper boundary of region in y.                  //
+//   (8) z_min     - Lower boundary of region in z.                  //
+//   (9) z_max     - Upper boundary of region in z.                  //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for adding all runs of voxels along the x-axis   //
+//   with the specified label (or with any positive label if label   //
+//   is 0) within the specified region of the mask to the index. The //
+//   region will be traversed in the order z, y, x. Note that the    //
+//   index will need to be finalised afterwards.                     //
+// ----------------------------------------------------------------- //
+
+PRIVATE void DataCube_index_region(const DataCube *self, VoxelIndex *index, const long int label, const size_t x_min, const size_t x_max, const size_t y_min, const size_t y_max, const size_t z_min, const size_t z_max)
+{
+	for(size_t z = z_min; z <= z_max; ++z)
+	{
+		for(size_t y = y_min; y <= y_max; ++y)
+		{
+			size_t x = x_min;
+			
+			while(x <= x_max)
+			{
+				const long int value = DataCube_get_data_int(self, x, y, z);
+				
+				if(value > 0 && (label == 0 || value == label))
+				{
+					// Find end of run
+					const size_t x_start = x;
+					while(++x <= x_max && DataCube_get_data_int(self, x, y, z) == value);
+					VoxelIndex_push(index, value, x_start, y, z, x - x_start);
+				}
+				else ++x;
+			}
+		}
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Create voxel index of catalogued sources                          //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) cat       - Source catalogue.                               //
+//   (3) index     - Voxel index to be (re-)built.                   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for clearing the specified voxel index and then  //
+//   filling it with the voxels of all sources in the catalogue. The //
+//   bounding box of each source will be searched for voxels carry-  //
+//   ing the source's ID. This is used to build a temporary index    //
+//   where none was provided.                                        //
+// ----------------------------------------------------------------- //
+
+PRIVATE void DataCube_index_catalog(const DataCube *self, const Catalog *cat, VoxelIndex *index)
+{
+	VoxelIndex_clear(index);
+	if(Catalog_get_size(cat) == 0)
+	{
+		VoxelIndex_finalise(index);
+		return;
+	}
+	
+	// Resolve column handles once
+	const size_t col_id    = Catalog_get_column(cat, "id");
+	const size_t col_x_min = Catalog_get_column(cat, "x_min");
+	const size_t col_x_max = Catalog_get_column(cat, "x_max");
+	const size_t col_y_min = Catalog_get_column(cat, "y_min");
+	const size_t col_y_max = Catalog_get_column(cat, "y_max");
+	const size_t col_z_min = Catalog_get_column(cat, "z_min");
+	const size_t col_z_max = Catalog_get_column(cat, "z_max");
+	
+	for(size_t i = 0; i < Catalog_get_size(cat); ++i)
+	{
+		const long int src_id = Catalog_get_int(cat, i, col_id);
+		const size_t x_min = Catalog_get_int(cat, i, col_x_min);
+		const size_t x_max = Catalog_get_int(cat, i, col_x_max);
+		const size_t y_min = Catalog_get_int(cat, i, col_y_min);
+		const size_t y_max = Catalog_get_int(cat, i, col_y_max);
+		const size_t z_min = Catalog_get_int(cat, i, col_z_min);
+		const size_t z_max = Catalog_get_int(cat, i, col_z_max);
+		ensure(src_id > 0, ERR_USER_INPUT, "Source ID missing from catalogue; cannot create voxel index.");
+		ensure(x_min <= x_max && y_min <= y_max && z_min <= z_max, ERR_INDEX_RANGE, "Illegal source bounding box: min > max!");
+		ensure(x_max < self->axis_size[0] && y_max < self->axis_size[1] && z_max < self->axis_size[2], ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
+		
+		DataCube_index_region(self, index, src_id, x_min, x_max, y_min, y_max, z_min, z_max);
+	}
+	
+	VoxelIndex_finalise(index);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Append individual voxels to voxel index                           //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) index     - Voxel index to which voxels will be appended.   //
+//   (3) voxels    - Array of pairs of source ID and linear voxel    //
+//                   index of the voxels to be appended.             //
+//   (4) n_voxels  - Number of pairs in voxels.                      //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for appending the specified voxels of the mask   //
+//   to the voxel index, e.g. after mask dilation, and finalising    //
+//   the index again. The voxels can be in any order, as the index   //
+//   will sort and merge the runs of each source when finalised.     //
+// ----------------------------------------------------------------- //
+
+PRIVATE void DataCube_index_append(const DataCube *self, VoxelIndex *index, const size_t *voxels, const size_t n_voxels)
+{
+	for(size_t i = 0; i < n_voxels; ++i)
+	{
+		size_t x, y, z;
+		DataCube_get_xyz(self, voxels[2 * i + 1], &x, &y, &z);
+		VoxelIndex_push(index, voxels[2 * i], x, y, z, 1);
+	}
+	
+	VoxelIndex_finalise(index);
+	
+	return;
+}
+
+
+
 // ----------------------------------------------------------------- //
 // Copy masked pixels from any integer mask to 32-bit mask           //
 // ----------------------------------------------------------------- //
@@ -2765,13 +3294,12 @@ PUBLIC size_t DataCube_copy_mask_32(DataCube *self, const DataCube *source, cons
 	{
 		uint8_t *ptrSource = (uint8_t *)(source->data);
 		
-		#pragma omp parallel for schedule(static)
+		#pragma omp parallel for schedule(static) reduction(+: counter)
 		for(size_t i = 0; i < self->data_size; ++i)
 		{
 			if(*(ptrSource + i) != 0)
 			{
 				*(ptrTarget + i) = value;
-				#pragma omp atomic update
 				++counter;
 			}
 		}
@@ -2780,13 +3308,12 @@ PUBLIC size_t DataCube_copy_mask_32(DataCube *self, const DataCube *source, cons
 	{
 		int16_t *ptrSource = (int16_t *)(source->data);
 		
-		#pragma omp parallel for schedule(static)
+		#pragma omp parallel for schedule(static) reduction(+: counter)
 		for(size_t i = 0; i < self->data_size; ++i)
 		{
 			if(*(ptrSource + i) != 0)
 			{
 				*(ptrTarget + i) = value;
-				#pragma omp atomic update
 				++counter;
 			}
 		}
@@ -2795,13 +3322,12 @@ PUBLIC size_t DataCube_copy_mask_32(DataCube *self, const DataCube *source, cons
 	{
 		int32_t *ptrSource = (int32_t *)(source->data);
 		
-		#pragma omp parallel for schedule(static)
+		#pragma omp parallel for schedule(static) reduction(+: counter)
 		for(size_t i = 0; i < self->data_size; ++i)
 		{
 			if(*(ptrSource + i) != 0)
 			{
 				*(ptrTarget + i) = value;
-				#pragma omp atomic update
 				++counter;
 			}
 		}
@@ -2810,13 +3336,12 @@ PUBLIC size_t DataCube_copy_mask_32(DataCube *self, const DataCube *source, cons
 	{
 		int64_t *ptrSource = (int64_t *)(source->data);
 		
-		#pragma omp parallel for schedule(static)
+		#pragma omp parallel for schedule(static) reduction(+: counter)
 		for(size_t i = 0; i < self->data_size; ++i)
 		{
 			if(*(ptrSource + i) != 0)
 			{
 				*(ptrTarget + i) = value;
-				#pragma omp atomic update
 				++counter;
 			}
 		}
@@ -2828,339 +3353,128 @@ PUBLIC size_t DataCube_copy_mask_32(DataCube *self, const DataCube *source, cons
 
 
 // ----------------------------------------------------------------- //
-// Grow mask and update basic source parameters                      //
+// Copy masked pixels from bit mask to integer mask                  //
 // ----------------------------------------------------------------- //
 // Arguments:                                                        //
 //                                                                   //
-//   (1) self       - Data cube.                                     //
-//   (2) mask       - Mask cube.                                     //
-//   (3) src_id     - ID of source to be grown                       //
-//   (4) radius     - Radius by which to grow (in pixels).           //
-//   (5) mask_value - Value to set grown pixels to in the mask.      //
-//   (6) f_sum      - Summed flux density prior to mask growth.      //
-//   (7) f_min      - Minimum flux density prior to mask growth.     //
-//   (8) f_max      - Maximum flux density prior to mask growth.     //
-//   (9) n_pix      - Number of pixels in mask prior to mask growth. //
-//  (10) flag       - Source flag prior to mask growth.              //
-//  (11-16) x_min, x_max, y_min, y_max, z_min, z_max                 //
-//                  - Source bounding box prior to mask growth.      //
+//   (1) self      - 8-bit or 32-bit target mask.                    //
+//   (2) mask      - Source bit mask.                                //
+//   (3) value     - Mask value to set in target mask.               //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
-//   No return value.                                                //
+//   Number of masked pixels.                                        //
 //                                                                   //
 // Description:                                                      //
 //                                                                   //
-//   Private method for growing the mask of the source identified by //
-//   src_id radially outwards using a circular kernel of the speci-  //
-//   fied radius (in pixels). The algorithm will update the relevant //
-//   source parameters (which must be provided as pointers holding   //
-//   the old values prior to mask growth), including fluxes, flags   //
-//   and source bounding boxes. In addition, the user can specify a  //
-//   mask value to which all newly added pixels will be set in the   //
-//   source mask. Note that as the algorithm only grows the mask in  //
-//   x and y, the bounding box in z will not change and will need to //
-//   be provided by value rather than by reference.                  //
+//   Public method for setting all of the pixels that are set in the //
+//   bit mask to the specified value in the 8-bit or signed 32-bit   //
+//   target mask. All other pixels of the target mask will remain    //
+//   unchanged. Words of the bit mask without any bits set will be   //
+//   skipped, and the number of masked pixels is obtained from the   //
+//   population count of the bit mask.                               //
 // ----------------------------------------------------------------- //
 
-PRIVATE void DataCube_grow_mask_xy(const DataCube *self, DataCube *mask, const long int src_id, const size_t radius, const long int mask_value, double *f_sum, double *f_min, double *f_max, size_t *n_pix, long int *flag, size_t *x_min, size_t *x_max, size_t *y_min, size_t *y_max, const size_t z_min, const size_t z_max)
+PUBLIC size_t DataCube_copy_bitmask(DataCube *self, const BitMask *mask, const int32_t value)
 {
-	// Set loop boundaries from bounding box
-	const size_t x1 = *x_min;
-	const size_t x2 = *x_max;
-	const size_t y1 = *y_min;
-	const size_t y2 = *y_max;
-	
-	// Additional variables
-	const double radius2 = (double)(radius * radius);
-	size_t xx_min = 0;
-	size_t xx_max = 0;
-	size_t yy_min = 0;
-	size_t yy_max = 0;
-	
-	// Loop over source bounding box
-	for(size_t z = z_min; z <= z_max; ++z)
+	// Sanity checks
+	check_null(self);
+	check_null(self->data);
+	check_null(mask);
+	ensure(self->data_type == 8 || self->data_type == 32, ERR_USER_INPUT, "Target mask cube must be of 8-bit or 32-bit integer type.");
+	ensure(self->axis_size[0] == BitMask_get_axis_size(mask, 0) && self->axis_size[1] == BitMask_get_axis_size(mask, 1) && self->axis_size[2] == BitMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Mask cube and bit mask have different sizes.");
+	
+	const uint64_t *ptr_mask = BitMask_get_ptr(mask);
+	const size_t n_words = BitMask_get_words(mask);
+	
+	if(self->data_type == 8)
 	{
-		for(size_t y = y1; y <= y2; ++y)
+		uint8_t *ptrTarget = (uint8_t *)(self->data);
+		const uint8_t value_8 = value;
+		
+		#pragma omp parallel for schedule(static)
+		for(size_t w = 0; w < n_words; ++w)
 		{
-			for(size_t x = x1; x <= x2; ++x)
+			uint64_t bits = ptr_mask[w];
+			uint8_t *ptr = ptrTarget + w * BITMASK_WORD_BITS;
+			
+			for(size_t j = 0; bits; ++j, bits >>= 1)
 			{
-				const long int id = DataCube_get_data_int(mask, x, y, z);
-				
-				if(id == src_id)
-				{
-					// Define boundaries of box to be processed
-					if(x < radius) xx_min = 0, *flag |= 1L;
-					else xx_min = x - radius;
-					
-					if(x + radius >= self->axis_size[0]) xx_max = self->axis_size[0] - 1, *flag |= 1L;
-					else xx_max = x + radius;
-					
-					if(y < radius) yy_min = 0, *flag |= 1L;
-					else yy_min = y - radius;
-					
-					if(y + radius >= self->axis_size[1]) yy_max = self->axis_size[1] - 1, *flag |= 1L;
-					else yy_max = y + radius;
-					
-					// Loop over that box
-					for(size_t yy = yy_min; yy <= yy_max; ++yy)
-					{
-						for(size_t xx = xx_min; xx <= xx_max; ++xx)
-						{
-							const double tmp1 = (double)xx - (double)x;
-							const double tmp2 = (double)yy - (double)y;
-							if(tmp1 * tmp1 + tmp2 * tmp2 > radius2) continue;
-							
-							const long int id_new = DataCube_get_data_int(mask, xx, yy, z);
-							if(id_new == 0)
-							{
-								const double value = DataCube_get_data_flt(self, xx, yy, z);
-								
-								if(IS_NOT_NAN(value))
-								{
-									DataCube_set_data_int(mask, xx, yy, z, -1);
-									*f_sum += value;
-									if(value < *f_min) *f_min = value;
-									if(value > *f_max) *f_max = value;
-									if(xx < *x_min) *x_min = xx;
-									if(xx > *x_max) *x_max = xx;
-									if(yy < *y_min) *y_min = yy;
-									if(yy > *y_max) *y_max = yy;
-									*n_pix += 1;
-								}
-								else *flag |= 4L;
-							}
-							else if(id_new > 0 && id_new != src_id) *flag |= 8L;
-						} // END loop over xx
-					} // END loop over yy
-				}
-			} // END loop over x
-		} // END loop over y
-	} // END loop over z
-	
-	// Replace mask values as per user request
-	for(size_t z = z_min; z <= z_max; ++z)
+				if(bits & 1) ptr[j] = value_8;
+			}
+		}
+	}
+	else
 	{
-		for(size_t y = *y_min; y <= *y_max; ++y)
+		int32_t *ptrTarget = (int32_t *)(self->data);
+		
+		#pragma omp parallel for schedule(static)
+		for(size_t w = 0; w < n_words; ++w)
 		{
-			for(size_t x = *x_min; x <= *x_max; ++x)
+			uint64_t bits = ptr_mask[w];
+			int32_t *ptr = ptrTarget + w * BITMASK_WORD_BITS;
+			
+			for(size_t j = 0; bits; ++j, bits >>= 1)
 			{
-				if(DataCube_get_data_int(mask, x, y, z) == -1) DataCube_set_data_int(mask, x, y, z, mask_value);
+				if(bits & 1) ptr[j] = value;
 			}
 		}
 	}
 	
-	return;
+	return BitMask_count(mask);
 }
 
 
 
 // ----------------------------------------------------------------- //
-// Mask dilation in the spatial plane                                //
+// Convert 32-bit mask to sparse mask                                //
 // ----------------------------------------------------------------- //
 // Arguments:                                                        //
 //                                                                   //
-//   (1) self      - Data cube.                                      //
-//   (2) mask      - Mask cube.                                      //
-//   (3) cat       - Source catalogue.                               //
-//   (4) iter_max  - Maximum number of iterations.                   //
-//   (5) threshold - Threshold for relative flux increase.           //
+//   (1) self      - Object self-reference (32-bit mask cube).       //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
-//   No return value.                                                //
+//   Pointer to newly created SparseMask object.                     //
 //                                                                   //
 // Description:                                                      //
 //                                                                   //
-//   Public method for dilating the masks of all sources found in    //
-//   catalogue in the spatial plane. Dilation will occur iterative-  //
-//   ly until either the maximum number of iterations is reached or  //
-//   the relative increase in source flux drops below the specified  //
-//   threshold. If the threshold is negative, then the mask will be  //
-//   dilated by the maximum number of iterations regardless of the   //
-//   resulting flux change.                                          //
-//   Mask dilation will work correctly for sources with positive or  //
-//   negative flux; in the latter case the integrated flux is expec- //
-//   ted to decrease in each iteration. The source parameters in the //
-//   catalogue will be updated with the new, dilated values.         //
-//   Dilation will be carried out using a circular mask and itera-   //
-//   tively progress outwards by increasing the radius of the mask   //
-//   by 1 pixel in each iteration. The source mask should therefore  //
-//   approach a circle for a large number of iterations.             //
+//   Public method for run-length encoding the specified 32-bit mask //
+//   cube into a sparse mask. The data array of the mask cube will   //
+//   be released afterwards, while its header and size will be re-   //
+//   tained, such that the dense mask can later be restored with     //
+//   DataCube_from_sparse_mask(), e.g. for writing it to disc. Until //
+//   then, the mask cube must not be passed to any method that needs //
+//   to access its data array. It is the caller's responsibility to  //
+//   run the destructor on the returned sparse mask once it is no    //
+//   longer required.                                                //
 // ----------------------------------------------------------------- //
 
-PUBLIC void DataCube_dilate_mask_xy(const DataCube *self, DataCube *mask, Catalog *cat, const size_t iter_max, const double threshold)
+PUBLIC SparseMask *DataCube_to_sparse_mask(DataCube *self)
 {
 	// Sanity checks
 	check_null(self);
 	check_null(self->data);
-	check_null(mask);
-	check_null(mask->data);
-	check_null(cat);
-	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Data cube must be of floating-point type.");
-	ensure(mask->data_type > 8, ERR_USER_INPUT, "Mask must be of signed integer type.");
-	ensure(self->axis_size[0] == mask->axis_size[0] && self->axis_size[1] == mask->axis_size[1] && self->axis_size[2] == mask->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
-	ensure(iter_max < self->axis_size[0] || iter_max < self->axis_size[1], ERR_USER_INPUT, "Maximum number of iterations exceeds spatial axis size.");
+	ensure(self->data_type == 32, ERR_USER_INPUT, "Mask cube must be of 32-bit integer type.");
 	
-	// Determine catalogue size
-	const size_t cat_size = Catalog_get_size(cat);
-	if(cat_size == 0)
-	{
-		warning("No sources in catalogue; skipping mask dilation.");
-		return;
-	}
+	SparseMask *mask = SparseMask_new((int32_t *)(self->data), self->axis_size[0], self->axis_size[1], self->axis_size[2]);
 	
-	// Loop over all sources in catalogue
-	for(size_t i = 0; i < cat_size; ++i)
-	{
-		// Extract source
-		Source *src = Catalog_get_source(cat, i);
-		
-		// Get source ID
-		const long int src_id = Source_get_par_by_name_int(src, "id");
-		ensure(src_id, ERR_USER_INPUT, "Source ID missing from catalogue; mask dilation failed.");
-		
-		// Get source bounding box
-		const size_t x_min = Source_get_par_by_name_int(src, "x_min");
-		const size_t x_max = Source_get_par_by_name_int(src, "x_max");
-		const size_t y_min = Source_get_par_by_name_int(src, "y_min");
-		const size_t y_max = Source_get_par_by_name_int(src, "y_max");
-		const size_t z_min = Source_get_par_by_name_int(src, "z_min");
-		const size_t z_max = Source_get_par_by_name_int(src, "z_max");
-		ensure(x_min <= x_max && y_min <= y_max && z_min <= z_max, ERR_INDEX_RANGE, "Illegal source bounding box: min > max!");
-		ensure(x_max < self->axis_size[0] && y_max < self->axis_size[1] && z_max < self->axis_size[2], ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
-		
-		// Get fluxes and check if negative
-		const double f_sum = Source_get_par_by_name_flt(src, "f_sum");
-		const double f_min = Source_get_par_by_name_flt(src, "f_min");
-		const double f_max = Source_get_par_by_name_flt(src, "f_max");
-		const bool is_negative = (f_sum < 0.0);
-		
-		// Get other relevant source parameters
-		const size_t n_pix = Source_get_par_by_name_int(src, "n_pix");
-		const long int flag = Source_get_par_by_name_int(src, "flag");
-		
-		// If threshold negative, simply dilate and move on
-		if(threshold < 0.0)
-		{
-			double f_sum_new = f_sum;
-			double f_min_new = f_min;
-			double f_max_new = f_max;
-			long int flag_new = flag;
-			size_t n_pix_new = n_pix;
-			size_t x_min_new = x_min;
-			size_t x_max_new = x_max;
-			size_t y_min_new = y_min;
-			size_t y_max_new = y_max;
-			
-			// Dilate by iter_max
-			DataCube_grow_mask_xy(self, mask, src_id, iter_max, src_id, &f_sum_new, &f_min_new, &f_max_new, &n_pix_new, &flag_new, &x_min_new, &x_max_new, &y_min_new, &y_max_new, z_min, z_max);
-			
-			// Update source parameters with new values
-			Source_set_par_flt(src, "f_min", f_min_new, NULL, NULL);
-			Source_set_par_flt(src, "f_max", f_max_new, NULL, NULL);
-			Source_set_par_flt(src, "f_sum", f_sum_new, NULL, NULL);
-			Source_set_par_int(src, "x_min", x_min_new, NULL, NULL);
-			Source_set_par_int(src, "x_max", x_max_new, NULL, NULL);
-			Source_set_par_int(src, "y_min", y_min_new, NULL, NULL);
-			Source_set_par_int(src, "y_max", y_max_new, NULL, NULL);
-			Source_set_par_int(src, "n_pix", n_pix_new, NULL, NULL);
-			Source_set_par_int(src, "flag",  flag_new,  NULL, NULL);
-			
-			// Update progress bar
-			progress_bar("Progress: ", i + 1, cat_size);
-			
-			// Next source
-			continue;
-		}
-		else
-		{
-			// Iterative dilation required
-			message_verb(self->verbosity, "Source %zu", i);
-			
-			// Iterate
-			size_t iter = 1;
-			double f_sum_old = f_sum;
-			while(iter <= iter_max)
-			{
-				double f_sum_new = f_sum;
-				double f_min_new = f_min;
-				double f_max_new = f_max;
-				long int flag_new = flag;
-				size_t n_pix_new = n_pix;
-				size_t x_min_new = x_min;
-				size_t x_max_new = x_max;
-				size_t y_min_new = y_min;
-				size_t y_max_new = y_max;
-				
-				// Dilate mask by radius 'iter'
-				DataCube_grow_mask_xy(self, mask, src_id, iter, 0, &f_sum_new, &f_min_new, &f_max_new, &n_pix_new, &flag_new, &x_min_new, &x_max_new, &y_min_new, &y_max_new, z_min, z_max);
-				
-				// Print information
-				message_verb(self->verbosity, " - Iteration %zu: df = %.3f (%.3f%%)", iter, f_sum_new - f_sum_old, 100.0 * (f_sum_new - f_sum_old) / f_sum_old);
-				
-				// Check if flux increased within boundaries
-				if((is_negative && (f_sum_new - f_sum_old) < threshold * f_sum_old) || (!is_negative && (f_sum_new - f_sum_old) > threshold * f_sum_old))
-				{
-					// Mask should be grown further
-					f_sum_old = f_sum_new;
-					++iter;
-					continue;
-				}
-				else
-				{
-					// No significant improvement; stop iterating
-					break;
-				}
-			} // END iteration loop
-			
-			// Apply final dilation if required
-			if(iter > 1)
-			{
-				double f_sum_new = f_sum;
-				double f_min_new = f_min;
-				double f_max_new = f_max;
-				long int flag_new = flag;
-				size_t n_pix_new = n_pix;
-				size_t x_min_new = x_min;
-				size_t x_max_new = x_max;
-				size_t y_min_new = y_min;
-				size_t y_max_new = y_max;
-				
-				DataCube_grow_mask_xy(self, mask, src_id, iter - 1, src_id, &f_sum_new, &f_min_new, &f_max_new, &n_pix_new, &flag_new, &x_min_new, &x_max_new, &y_min_new, &y_max_new, z_min, z_max);
-				
-				// Update source parameters with new values
-				Source_set_par_flt(src, "f_min", f_min_new, NULL, NULL);
-				Source_set_par_flt(src, "f_max", f_max_new, NULL, NULL);
-				Source_set_par_flt(src, "f_sum", f_sum_new, NULL, NULL);
-				Source_set_par_int(src, "x_min", x_min_new, NULL, NULL);
-				Source_set_par_int(src, "x_max", x_max_new, NULL, NULL);
-				Source_set_par_int(src, "y_min", y_min_new, NULL, NULL);
-				Source_set_par_int(src, "y_max", y_max_new, NULL, NULL);
-				Source_set_par_int(src, "n_pix", n_pix_new, NULL, NULL);
-				Source_set_par_int(src, "flag",  flag_new,  NULL, NULL);
-			}
-			
-			// Update progress bar
-			if(!self->verbosity) progress_bar("Progress: ", i + 1, cat_size);
-		}
-	}  // END source loop
+	// Release dense data array
+	free(self->data);
+	self->data = NULL;
 	
-	return;
+	return mask;
 }
 
 
 
 // ----------------------------------------------------------------- //
-// Mask dilation along spectral axis                                 //
+// Restore 32-bit mask from sparse mask                              //
 // ----------------------------------------------------------------- //
 // Arguments:                                                        //
 //                                                                   //
-//   (1) self      - Data cube.                                      //
-//   (2) mask      - Mask cube.                                      //
-//   (3) cat       - Source catalogue.                               //
-//   (4) iter_max  - Maximum number of iterations.                   //
-//   (5) threshold - Threshold for relative flux increase.           //
+//   (1) self      - Object self-reference (32-bit mask cube).       //
+//   (2) mask      - Sparse mask to be decoded.                      //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
@@ -3168,201 +3482,920 @@ PUBLIC void DataCube_dilate_mask_xy(const DataCube *self, DataCube *mask, Catalo
 //                                                                   //
 // Description:                                                      //
 //                                                                   //
-//   Public method for dilating the masks of all sources found in    //
-//   catalogue along the spectral axis. Dilation will occur itera-   //
-//   tively until either the maximum number of iterations is reached //
-//   or the relative increase in source flux drops below the speci-  //
-//   field threshold.                                                //
-//   Mask dilation will work correctly for sources with positive or  //
-//   negative flux; in the latter case the integrated flux is expec- //
-//   ted to decrease in each iteration. The source parameters in the //
-//   catalogue will be updated with the new, dilated values.         //
-//   Dilation will progress by 1 channel per iteration in the di-    //
-//   rections directly adjacent to a pixel along the spectral axis.  //
+//   Public method for decoding the specified sparse mask into the   //
+//   32-bit mask cube. If the data array of the mask cube was pre-   //
+//   viously released by DataCube_to_sparse_mask(), it will be allo- //
+//   cated again. All pixels not covered by the sparse mask will be  //
+//   set to 0.                                                       //
 // ----------------------------------------------------------------- //
 
-PUBLIC void DataCube_dilate_mask_z(const DataCube *self, DataCube *mask, Catalog *cat, const size_t iter_max, const double threshold)
+PUBLIC void DataCube_from_sparse_mask(DataCube *self, const SparseMask *mask)
 {
 	// Sanity checks
 	check_null(self);
-	check_null(self->data);
 	check_null(mask);
-	check_null(mask->data);
-	check_null(cat);
-	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Data cube must be of floating-point type.");
-	ensure(mask->data_type > 8, ERR_USER_INPUT, "Mask must be of signed integer type.");
-	ensure(self->axis_size[0] == mask->axis_size[0] && self->axis_size[1] == mask->axis_size[1] && self->axis_size[2] == mask->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
-	ensure(iter_max < self->axis_size[2], ERR_USER_INPUT, "Maximum number of iterations exceeds spectral axis size.");
-		
-	// Determine catalogue size
-	const size_t cat_size = Catalog_get_size(cat);
-	if(cat_size == 0)
+	ensure(self->data_type == 32, ERR_USER_INPUT, "Mask cube must be of 32-bit integer type.");
+	ensure(self->axis_size[0] == SparseMask_get_axis_size(mask, 0) && self->axis_size[1] == SparseMask_get_axis_size(mask, 1) && self->axis_size[2] == SparseMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Mask cube and sparse mask have different sizes.");
+	
+	if(self->data == NULL) self->data = (char *)memory(MALLOC, self->data_size, self->word_size * sizeof(char));
+	SparseMask_decode(mask, (int32_t *)(self->data));
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Save sparse mask as FITS file                                     //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference (32-bit mask cube).       //
+//   (2) mask      - Sparse mask to be saved.                        //
+//   (3) filename  - Name of the output file.                        //
+//   (4) overwrite - Replace existing file (true) or not (false)?    //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for writing the specified sparse mask to a FITS   //
+//   file, using the header of the mask cube. The file will be iden- //
+//   tical to the one created by DataCube_save() for the decoded     //
+//   mask cube, but the mask is decoded one plane at a time, so the  //
+//   data array of the mask cube is not needed and may have been re- //
+//   leased by DataCube_to_sparse_mask().                            //
+// ----------------------------------------------------------------- //
+
+PUBLIC void DataCube_save_sparse_mask(const DataCube *self, const SparseMask *mask, const char *filename, const bool overwrite)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(mask);
+	check_null(filename);
+	ensure(strlen(filename), ERR_USER_INPUT, "Empty file name provided.");
+	ensure(self->data_type == 32, ERR_USER_INPUT, "Mask cube must be of 32-bit integer type.");
+	ensure(self->axis_size[0] == SparseMask_get_axis_size(mask, 0) && self->axis_size[1] == SparseMask_get_axis_size(mask, 1) && self->axis_size[2] == SparseMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Mask cube and sparse mask have different sizes.");
+	
+	// Open FITS file
+	FILE *fp;
+	if(overwrite) fp = fopen(filename, "wb");
+	else fp = fopen(filename, "wxb");
+	ensure(fp != NULL, ERR_FILE_ACCESS, "Failed to create new FITS file: %s\n       Does the destination exist and is writeable?", filename);
+	
+	message("Creating FITS file: %s", strrchr(filename, '/') == NULL ? filename : strrchr(filename, '/') + 1);
+	
+	// Write entire header
+	ensure(fwrite(Header_get(self->header), 1, Header_get_size(self->header), fp) == Header_get_size(self->header), ERR_FILE_ACCESS, "Failed to write header to FITS file.");
+	
+	// Decode and write data array plane by plane
+	const size_t size_plane = self->axis_size[0] * self->axis_size[1];
+	int32_t *plane = (int32_t *)memory(MALLOC, size_plane, sizeof(int32_t));
+	
+	for(size_t z = 0; z < self->axis_size[2]; ++z)
 	{
-		warning("No sources in catalogue; skipping mask dilation.");
-		return;
+		SparseMask_decode_plane(mask, z, plane);
+		if(is_little_endian()) for(size_t i = 0; i < size_plane; ++i) swap_byte_order((char *)(plane + i), sizeof(int32_t));
+		ensure(fwrite(plane, sizeof(int32_t), size_plane, fp) == size_plane, ERR_FILE_ACCESS, "Failed to write data to FITS file.");
 	}
 	
-	// Loop over all sources in catalogue
+	free(plane);
+	
+	// Fill file with 0x00 if necessary
+	const size_t size_footer = ((self->data_size * self->word_size) % FITS_HEADER_BLOCK_SIZE);
+	if(size_footer)
+	{
+		const char footer = '\0';
+		for(size_t counter = FITS_HEADER_BLOCK_SIZE - size_footer; counter--;) fwrite(&footer, 1, 1, fp);
+	}
+	
+	// Close file
+	fclose(fp);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Schedule sources for parallel mask dilation                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self       - Data cube.                                     //
+//   (2) cat        - Source catalogue.                              //
+//   (3) grow_xy    - Maximum growth of the sources in x and y.      //
+//   (4) grow_z     - Maximum growth of the sources in z.            //
+//   (5) order      - Array of catalogue size that will be filled    //
+//                    with the catalogue rows grouped by wave.       //
+//   (6) wave_start - Array of catalogue size + 1 that will be fil-  //
+//                    led with the start of each wave in 'order',    //
+//                    followed by the end of the last wave.          //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of waves.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for dividing the sources in the catalogue into   //
+//   waves that can be dilated in parallel. The region that each     //
+//   source's dilation can read or modify is its bounding box grown  //
+//   by the specified amounts. Two sources whose regions could meet  //
+//   are in conflict, and the later source in the catalogue must be  //
+//   dilated in a later wave than the earlier one. Processing the    //
+//   waves in order, with the sources of each wave in parallel, will //
+//   therefore produce the same mask as serial dilation in catalogue //
+//   order. Conflicts are detected conservatively on a coarse grid   //
+//   of cells of size DILATION_CELL_SIZE, with each cell recording   //
+//   the latest wave touching it. The method will also check the     //
+//   source IDs and bounding boxes for validity.                     //
+// ----------------------------------------------------------------- //
+
+PRIVATE size_t DataCube_schedule_dilation(const DataCube *self, const Catalog *cat, const size_t grow_xy, const size_t grow_z, size_t *order, size_t *wave_start)
+{
+	const size_t cat_size = Catalog_get_size(cat);
+	const size_t nx = self->axis_size[0];
+	const size_t ny = self->axis_size[1];
+	const size_t nz = self->axis_size[2];
+	
+	// Resolve column handles once
+	const size_t col_id    = Catalog_get_column(cat, "id");
+	const size_t col_x_min = Catalog_get_column(cat, "x_min");
+	const size_t col_x_max = Catalog_get_column(cat, "x_max");
+	const size_t col_y_min = Catalog_get_column(cat, "y_min");
+	const size_t col_y_max = Catalog_get_column(cat, "y_max");
+	const size_t col_z_min = Catalog_get_column(cat, "z_min");
+	const size_t col_z_max = Catalog_get_column(cat, "z_max");
+	
+	// Create grid of cells holding the latest wave + 1 (0 = unused)
+	const size_t n_cx = (nx + DILATION_CELL_SIZE - 1) / DILATION_CELL_SIZE;
+	const size_t n_cy = (ny + DILATION_CELL_SIZE - 1) / DILATION_CELL_SIZE;
+	const size_t n_cz = (nz + DILATION_CELL_SIZE - 1) / DILATION_CELL_SIZE;
+	size_t *cells = (size_t *)memory(CALLOC, n_cx * n_cy * n_cz, sizeof(size_t));
+	size_t *wave  = (size_t *)memory(MALLOC, cat_size, sizeof(size_t));
+	size_t n_waves = 0;
+	
 	for(size_t i = 0; i < cat_size; ++i)
 	{
-		// Extract source
-		Source *src = Catalog_get_source(cat, i);
-		message_verb(self->verbosity, "Source %zu", i + 1);
-		
-		// Get source ID & flag
-		const long int src_id = Source_get_par_by_name_int(src, "id");
-		ensure(src_id, ERR_USER_INPUT, "Source ID missing from catalogue; mask dilation failed.");
-		long int flag = Source_get_par_by_name_int(src, "flag");
-		
-		// Get source bounding box
-		const size_t x_min = Source_get_par_by_name_int(src, "x_min");
-		const size_t x_max = Source_get_par_by_name_int(src, "x_max");
-		const size_t y_min = Source_get_par_by_name_int(src, "y_min");
-		const size_t y_max = Source_get_par_by_name_int(src, "y_max");
-		size_t z_min = Source_get_par_by_name_int(src, "z_min");
-		size_t z_max = Source_get_par_by_name_int(src, "z_max");
+		// Check source ID and bounding box
+		ensure(Catalog_get_int(cat, i, col_id), ERR_USER_INPUT, "Source ID missing from catalogue; mask dilation failed.");
+		const size_t x_min = Catalog_get_int(cat, i, col_x_min);
+		const size_t x_max = Catalog_get_int(cat, i, col_x_max);
+		const size_t y_min = Catalog_get_int(cat, i, col_y_min);
+		const size_t y_max = Catalog_get_int(cat, i, col_y_max);
+		const size_t z_min = Catalog_get_int(cat, i, col_z_min);
+		const size_t z_max = Catalog_get_int(cat, i, col_z_max);
 		ensure(x_min <= x_max && y_min <= y_max && z_min <= z_max, ERR_INDEX_RANGE, "Illegal source bounding box: min > max!");
-		ensure(x_max < self->axis_size[0] && y_max < self->axis_size[1] && z_max < self->axis_size[2], ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
+		ensure(x_max < nx && y_max < ny && z_max < nz, ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
+		
+		// Determine cells covered by grown bounding box
+		const size_t cx_min = (x_min < grow_xy ? 0 : x_min - grow_xy) / DILATION_CELL_SIZE;
+		const size_t cy_min = (y_min < grow_xy ? 0 : y_min - grow_xy) / DILATION_CELL_SIZE;
+		const size_t cz_min = (z_min < grow_z  ? 0 : z_min - grow_z)  / DILATION_CELL_SIZE;
+		const size_t cx_max = (x_max + grow_xy < nx ? x_max + grow_xy : nx - 1) / DILATION_CELL_SIZE;
+		const size_t cy_max = (y_max + grow_xy < ny ? y_max + grow_xy : ny - 1) / DILATION_CELL_SIZE;
+		const size_t cz_max = (z_max + grow_z  < nz ? z_max + grow_z  : nz - 1) / DILATION_CELL_SIZE;
+		
+		// Source must come after all earlier sources touching the same cells
+		size_t w = 0;
+		for(size_t cz = cz_min; cz <= cz_max; ++cz)
+		{
+			for(size_t cy = cy_min; cy <= cy_max; ++cy)
+			{
+				for(size_t cx = cx_min; cx <= cx_max; ++cx)
+				{
+					const size_t cell = cells[cx + n_cx * (cy + n_cy * cz)];
+					if(cell > w) w = cell;
+				}
+			}
+		}
 		
-		// Get flux and check if source has negative flux
-		double f_sum = Source_get_par_by_name_flt(src, "f_sum");
-		double f_min = Source_get_par_by_name_flt(src, "f_min");
-		double f_max = Source_get_par_by_name_flt(src, "f_max");
-		size_t n_pix = Source_get_par_by_name_int(src, "n_pix");
-		const bool is_negative = (f_sum < 0.0);
+		for(size_t cz = cz_min; cz <= cz_max; ++cz)
+		{
+			for(size_t cy = cy_min; cy <= cy_max; ++cy)
+			{
+				for(size_t cx = cx_min; cx <= cx_max; ++cx) cells[cx + n_cx * (cy + n_cy * cz)] = w + 1;
+			}
+		}
 		
-		// Additional variables
-		double df_sum = 0.0;
-		size_t z_min_new = z_min;
-		size_t z_max_new = z_max;
+		wave[i] = w;
+		if(w + 1 > n_waves) n_waves = w + 1;
+	}
+	
+	// Group sources by wave, preserving catalogue order within each wave
+	for(size_t w = 0; w <= n_waves; ++w) wave_start[w] = 0;
+	for(size_t i = 0; i < cat_size; ++i) ++wave_start[wave[i] + 1];
+	for(size_t w = 1; w <= n_waves; ++w) wave_start[w] += wave_start[w - 1];
+	for(size_t i = 0; i < cat_size; ++i) order[wave_start[wave[i]]++] = i;
+	for(size_t w = n_waves; w > 0; --w) wave_start[w] = wave_start[w - 1];
+	wave_start[0] = 0;
+	
+	// Clean up
+	free(cells);
+	free(wave);
+	
+	return n_waves;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Mask dilation in the spatial plane                                //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Data cube.                                      //
+//   (2) mask      - Mask cube.                                      //
+//   (3) cat       - Source catalogue.                               //
+//   (4) iter_max  - Maximum number of iterations.                   //
+//   (5) threshold - Threshold for relative flux increase.           //
+//   (6) index     - Voxel index of all sources in the mask. Can be  //
+//                   NULL, in which case a temporary index will be   //
+//                   created.                                        //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for dilating the masks of all sources found in    //
+//   catalogue in the spatial plane. Dilation will occur iterative-  //
+//   ly until either the maximum number of iterations is reached or  //
+//   the relative increase in source flux drops below the specified  //
+//   threshold. If the threshold is negative, then the mask will be  //
+//   dilated by the maximum number of iterations regardless of the   //
+//   resulting flux change.                                          //
+//   Mask dilation will work correctly for sources with positive or  //
+//   negative flux; in the latter case the integrated flux is expec- //
+//   ted to decrease in each iteration. The source parameters in the //
+//   catalogue will be updated with the new, dilated values.         //
+//   Dilation will be carried out using a circular mask and itera-   //
+//   tively progress outwards by increasing the radius of the mask   //
+//   by 1 pixel in each iteration. The source mask should therefore  //
+//   approach a circle for a large number of iterations.             //
+//   Each iteration only visits the annulus between the previous     //
+//   and the new radius around the boundary pixels of the source, as //
+//   pixels enclosed by the source in the spatial plane cannot add   //
+//   anything not already covered by their neighbours. Sources are   //
+//   dilated in parallel in waves of non-conflicting sources, as de- //
+//   termined by DataCube_schedule_dilation().                       //
+//   If a voxel index is supplied, the pixels added to each source   //
+//   will be appended to it at the end, without rescanning the mask. //
+// ----------------------------------------------------------------- //
+
+PUBLIC void DataCube_dilate_mask_xy(const DataCube *self, DataCube *mask, Catalog *cat, const size_t iter_max, const double threshold, VoxelIndex *index)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(self->data);
+	check_null(mask);
+	check_null(mask->data);
+	check_null(cat);
+	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Data cube must be of floating-point type.");
+	ensure(mask->data_type > 8, ERR_USER_INPUT, "Mask must be of signed integer type.");
+	ensure(self->axis_size[0] == mask->axis_size[0] && self->axis_size[1] == mask->axis_size[1] && self->axis_size[2] == mask->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
+	ensure(iter_max < self->axis_size[0] || iter_max < self->axis_size[1], ERR_USER_INPUT, "Maximum number of iterations exceeds spatial axis size.");
+	
+	// Determine catalogue size
+	const size_t cat_size = Catalog_get_size(cat);
+	if(cat_size == 0)
+	{
+		warning("No sources in catalogue; skipping mask dilation.");
+		return;
+	}
+	
+	// Create temporary voxel index if none provided
+	VoxelIndex *index_local = NULL;
+	if(index == NULL)
+	{
+		index_local = VoxelIndex_new();
+		DataCube_index_catalog(mask, cat, index_local);
+		index = index_local;
+	}
+	
+	// Resolve column handles once
+	const size_t col_id    = Catalog_get_column(cat, "id");
+	const size_t col_x_min = Catalog_get_column(cat, "x_min");
+	const size_t col_x_max = Catalog_get_column(cat, "x_max");
+	const size_t col_y_min = Catalog_get_column(cat, "y_min");
+	const size_t col_y_max = Catalog_get_column(cat, "y_max");
+	const size_t col_f_sum = Catalog_get_column(cat, "f_sum");
+	const size_t col_f_min = Catalog_get_column(cat, "f_min");
+	const size_t col_f_max = Catalog_get_column(cat, "f_max");
+	const size_t col_n_pix = Catalog_get_column(cat, "n_pix");
+	const size_t col_flag  = Catalog_get_column(cat, "flag");
+	
+	const size_t nx = self->axis_size[0];
+	const size_t ny = self->axis_size[1];
+	
+	// Precompute pixel offsets of the annulus added in each iteration,
+	// i.e. all offsets with iter - 1 < r <= iter from the centre
+	size_t   *ring_start = (size_t *)memory(MALLOC, iter_max + 2, sizeof(size_t));
+	long int *ring = (long int *)memory(MALLOC, 2 * (2 * iter_max + 1) * (2 * iter_max + 1), sizeof(long int));
+	size_t n_ring = 0;
+	ring_start[0] = 0;
+	
+	for(size_t iter = 1; iter <= iter_max; ++iter)
+	{
+		const long int r = iter;
+		ring_start[iter] = n_ring;
 		
-		// Iterate
-		for(size_t iter = 0; iter < iter_max; ++iter)
+		for(long int dy = -r; dy <= r; ++dy)
 		{
-			df_sum = 0.0;
+			for(long int dx = -r; dx <= r; ++dx)
+			{
+				const long int r2 = dx * dx + dy * dy;
+				if(r2 <= (r - 1) * (r - 1) || r2 > r * r) continue;
+				ring[2 * n_ring]     = dx;
+				ring[2 * n_ring + 1] = dy;
+				++n_ring;
+			}
+		}
+	}
+	ring_start[iter_max + 1] = n_ring;
+	
+	// Divide sources into waves of non-conflicting sources
+	// (one extra pixel is read when locating boundary pixels)
+	size_t *order      = (size_t *)memory(MALLOC, cat_size, sizeof(size_t));
+	size_t *wave_start = (size_t *)memory(MALLOC, cat_size + 1, sizeof(size_t));
+	const size_t n_waves = DataCube_schedule_dilation(self, cat, iter_max + 1, 0, order, wave_start);
+	size_t progress = 0;
+	
+	// Source IDs and voxel indices of all pixels added to the mask,
+	// to be appended to the voxel index at the end
+	size_t *grown = NULL;
+	size_t n_grown = 0;
+	
+	// Loop over all waves
+	for(size_t w = 0; w < n_waves; ++w)
+	{
+		// Dilate sources of current wave in parallel
+		// (serially in verbose mode to keep messages together)
+		#pragma omp parallel if(!self->verbosity)
+		{
+			// Per-thread lists of boundary pixels, added pixels and
+			// accepted pixels of all sources (as pairs of ID and index)
+			size_t *boundary = NULL;
+			size_t *added = NULL;
+			size_t *accepted = NULL;
+			size_t boundary_size = 0;
+			size_t added_size = 0;
+			size_t accepted_size = 0;
+			size_t n_accepted_all = 0;
 			
-			// Loop over source bounding box
-			for(size_t z = z_min; z <= z_max; ++z)
+			#pragma omp for schedule(dynamic, 1)
+			for(size_t k = wave_start[w]; k < wave_start[w + 1]; ++k)
 			{
-				for(size_t y = y_min; y <= y_max; ++y)
+				const size_t i = order[k];
+				const long int src_id = Catalog_get_int(cat, i, col_id);
+				
+				// Get source parameters
+				size_t x_min = Catalog_get_int(cat, i, col_x_min);
+				size_t x_max = Catalog_get_int(cat, i, col_x_max);
+				size_t y_min = Catalog_get_int(cat, i, col_y_min);
+				size_t y_max = Catalog_get_int(cat, i, col_y_max);
+				double f_sum = Catalog_get_flt(cat, i, col_f_sum);
+				double f_min = Catalog_get_flt(cat, i, col_f_min);
+				double f_max = Catalog_get_flt(cat, i, col_f_max);
+				size_t n_pix = Catalog_get_int(cat, i, col_n_pix);
+				long int flag = Catalog_get_int(cat, i, col_flag);
+				const bool is_negative = (f_sum < 0.0);
+				
+				if(threshold >= 0.0) message_verb(self->verbosity, "Source %zu", i);
+				
+				// Collect boundary pixels, i.e. source pixels not enclosed
+				// by the source in all four directions of the spatial plane
+				size_t first, last;
+				size_t n_boundary = 0;
+				VoxelIndex_get_runs(index, src_id, &first, &last);
+				
+				for(size_t j = first; j < last; ++j)
 				{
-					for(size_t x = x_min; x <= x_max; ++x)
+					size_t x0, y, z, length;
+					VoxelIndex_get_run(index, j, &x0, &y, &z, &length);
+					
+					for(size_t x = x0; x < x0 + length; ++x)
 					{
-						const long int id = DataCube_get_data_int(mask, x, y, z);
+						if(x > 0 && y > 0 && x + 1 < nx && y + 1 < ny
+						&& DataCube_get_data_int(mask, x - 1, y, z) == src_id
+						&& DataCube_get_data_int(mask, x + 1, y, z) == src_id
+						&& DataCube_get_data_int(mask, x, y - 1, z) == src_id
+						&& DataCube_get_data_int(mask, x, y + 1, z) == src_id) continue;
 						
-						if(id == src_id)
+						if(n_boundary == boundary_size)
 						{
-							// Check lower z
-							if(z > 0)
+							boundary_size = 2 * boundary_size + 1024;
+							boundary = (size_t *)memory_realloc(boundary, boundary_size, sizeof(size_t));
+						}
+						boundary[n_boundary++] = DataCube_get_index(mask, x, y, z);
+					}
+				}
+				
+				// Iterate, marking new pixels with -1 until accepted
+				size_t radius = 0;
+				size_t n_added = 0;
+				
+				for(size_t iter = 1; iter <= iter_max; ++iter)
+				{
+					long int flag_new = flag;
+					double df_sum = 0.0;
+					const size_t n_accepted = n_added;
+					
+					// Loop over annulus around each boundary pixel
+					for(size_t j = 0; j < n_boundary; ++j)
+					{
+						size_t x, y, z;
+						DataCube_get_xyz(mask, boundary[j], &x, &y, &z);
+						if(x < iter || y < iter || x + iter >= nx || y + iter >= ny) flag_new |= 1L;
+						
+						for(size_t l = ring_start[iter]; l < ring_start[iter + 1]; ++l)
+						{
+							const long int xx = (long int)x + ring[2 * l];
+							const long int yy = (long int)y + ring[2 * l + 1];
+							if(xx < 0 || yy < 0 || xx >= (long int)nx || yy >= (long int)ny) continue;
+							
+							const long int id_new = DataCube_get_data_int(mask, xx, yy, z);
+							if(id_new == 0)
 							{
-								const long int id_new = DataCube_get_data_int(mask, x, y, z - 1);
-								if(id_new == 0)
+								const double value = DataCube_get_data_flt(self, xx, yy, z);
+								
+								if(IS_NOT_NAN(value))
 								{
-									if(IS_NOT_NAN(DataCube_get_data_flt(self, x, y, z - 1)))
+									DataCube_set_data_int(mask, xx, yy, z, -1);
+									df_sum += value;
+									
+									if(n_added == added_size)
 									{
-										DataCube_set_data_int(mask, x, y, z - 1, -1);
-										df_sum += DataCube_get_data_flt(self, x, y, z - 1);
-										if(z - 1 < z_min_new) z_min_new = z - 1;
+										added_size = 2 * added_size + 1024;
+										added = (size_t *)memory_realloc(added, added_size, sizeof(size_t));
 									}
-									else flag |= 4L;
+									added[n_added++] = DataCube_get_index(mask, xx, yy, z);
 								}
-								else if(id_new > 0 && id_new != src_id) flag |= 8L;
+								else flag_new |= 4L;
 							}
-							else flag |= 2L;
-							
-							// Check higher z
-							if(z < self->axis_size[2] - 1)
+							else if(id_new > 0 && id_new != src_id) flag_new |= 8L;
+						}
+					}
+					
+					// Check if flux increased within boundaries
+					if(threshold >= 0.0)
+					{
+						message_verb(self->verbosity, " - Iteration %zu: df = %.3f (%.3f%%)", iter, df_sum, 100.0 * df_sum / f_sum);
+						
+						if(!((is_negative && df_sum < threshold * f_sum) || (!is_negative && df_sum > threshold * f_sum)))
+						{
+							// No significant improvement; reset new pixels and stop iterating
+							for(size_t j = n_accepted; j < n_added; ++j)
 							{
-								const long int id_new = DataCube_get_data_int(mask, x, y, z + 1);
-								if(id_new == 0)
-								{
-									if(IS_NOT_NAN(DataCube_get_data_flt(self, x, y, z + 1)))
-									{
-										DataCube_set_data_int(mask, x, y, z + 1, -1);
-										df_sum += DataCube_get_data_flt(self, x, y, z + 1);
-										if(z + 1 > z_max_new) z_max_new = z + 1;
-									}
-									else flag |= 4L;
-								}
-								else if(id_new > 0 && id_new != src_id) flag |= 8L;
+								size_t x, y, z;
+								DataCube_get_xyz(mask, added[j], &x, &y, &z);
+								DataCube_set_data_int(mask, x, y, z, 0);
 							}
-							else flag |= 2L;
+							n_added = n_accepted;
+							break;
 						}
-					} // END loop over x
-				} // END loop over y
-			} // END loop over z
-			
-			// Check if flux increased within boundaries
-			if(threshold < 0.0 || (is_negative && df_sum < threshold * f_sum) || (!is_negative && df_sum > threshold * f_sum))
-			{
-				// Mask should be grown
-				f_sum += df_sum;
-				z_min = z_min_new;
-				z_max = z_max_new;
+					}
+					
+					// Mask should be grown
+					f_sum += df_sum;
+					flag = flag_new;
+					radius = iter;
+				}
 				
-				// Loop over new bounding box
-				for(size_t z = z_min; z <= z_max; ++z)
+				// Assign accepted pixels to source and update source parameters
+				if(threshold < 0.0 || radius > 0)
 				{
-					for(size_t y = y_min; y <= y_max; ++y)
+					for(size_t j = 0; j < n_added; ++j)
+					{
+						size_t x, y, z;
+						DataCube_get_xyz(mask, added[j], &x, &y, &z);
+						DataCube_set_data_int(mask, x, y, z, src_id);
+						
+						const double value = DataCube_get_data_flt(self, x, y, z);
+						if(value < f_min) f_min = value;
+						if(value > f_max) f_max = value;
+						if(x < x_min) x_min = x;
+						if(x > x_max) x_max = x;
+						if(y < y_min) y_min = y;
+						if(y > y_max) y_max = y;
+					}
+					n_pix += n_added;
+					
+					// Remember accepted pixels for voxel index update
+					if(index_local == NULL)
 					{
-						for(size_t x = x_min; x <= x_max; ++x)
+						if(n_accepted_all + n_added > accepted_size)
 						{
-							// If mask value is -1...
-							if(DataCube_get_data_int(mask, x, y, z) == -1)
-							{
-								// ...switch to source ID...
-								DataCube_set_data_int(mask, x, y, z, src_id);
-								
-								// ...and update n_pix, f_min and f_max if necessary
-								const double value = DataCube_get_data_flt(self, x, y, z);
-								if(value < f_min) f_min = value;
-								if(value > f_max) f_max = value;
-								++n_pix;
-							}
+							accepted_size = 2 * accepted_size + n_added + 1024;
+							accepted = (size_t *)memory_realloc(accepted, 2 * accepted_size, sizeof(size_t));
+						}
+						for(size_t j = 0; j < n_added; ++j)
+						{
+							accepted[2 * n_accepted_all]     = src_id;
+							accepted[2 * n_accepted_all + 1] = added[j];
+							++n_accepted_all;
 						}
 					}
+					
+					Catalog_set_flt(cat, i, col_f_min, f_min);
+					Catalog_set_flt(cat, i, col_f_max, f_max);
+					Catalog_set_flt(cat, i, col_f_sum, f_sum);
+					Catalog_set_int(cat, i, col_x_min, x_min);
+					Catalog_set_int(cat, i, col_x_max, x_max);
+					Catalog_set_int(cat, i, col_y_min, y_min);
+					Catalog_set_int(cat, i, col_y_max, y_max);
+					Catalog_set_int(cat, i, col_n_pix, n_pix);
+					Catalog_set_int(cat, i, col_flag,  flag);
 				}
 				
-				message_verb(self->verbosity, " - Iteration %zu: df = %.3f (%.3f%%)", iter + 1, df_sum, 100.0 * df_sum / (f_sum - df_sum));
+				// Update progress bar
+				#pragma omp critical
+				{
+					++progress;
+					if(threshold < 0.0 || !self->verbosity) progress_bar("Progress: ", progress, cat_size);
+				}
+			}  // END source loop
+			
+			// Hand over accepted pixels
+			if(n_accepted_all)
+			{
+				#pragma omp critical
+				{
+					grown = (size_t *)memory_realloc(grown, 2 * (n_grown + n_accepted_all), sizeof(size_t));
+					memcpy(grown + 2 * n_grown, accepted, 2 * n_accepted_all * sizeof(size_t));
+					n_grown += n_accepted_all;
+				}
 			}
-			else
+			
+			free(boundary);
+			free(added);
+			free(accepted);
+		}
+	}  // END wave loop
+	
+	// Update or delete voxel index
+	if(index_local != NULL) VoxelIndex_delete(index_local);
+	else DataCube_index_append(mask, index, grown, n_grown);
+	free(grown);
+	
+	// Clean up
+	free(ring_start);
+	free(ring);
+	free(order);
+	free(wave_start);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Mask dilation along spectral axis                                 //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Data cube.                                      //
+//   (2) mask      - Mask cube.                                      //
+//   (3) cat       - Source catalogue.                               //
+//   (4) iter_max  - Maximum number of iterations.                   //
+//   (5) threshold - Threshold for relative flux increase.           //
+//   (6) index     - Voxel index of all sources in the mask. Can be  //
+//                   NULL, in which case a temporary index will be   //
+//                   created.                                        //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for dilating the masks of all sources found in    //
+//   catalogue along the spectral axis. Dilation will occur itera-   //
+//   tively until either the maximum number of iterations is reached //
+//   or the relative increase in source flux drops below the speci-  //
+//   field threshold.                                                //
+//   Mask dilation will work correctly for sources with positive or  //
+//   negative flux; in the latter case the integrated flux is expec- //
+//   ted to decrease in each iteration. The source parameters in the //
+//   catalogue will be updated with the new, dilated values.         //
+//   Dilation will progress by 1 channel per iteration in the di-    //
+//   rections directly adjacent to a pixel along the spectral axis.  //
+//   Each iteration only visits the frontier of the source, i.e. the //
+//   voxels added in the previous iteration, or initially all source //
+//   voxels not enclosed by the source along the spectral axis. The  //
+//   frontier is kept in raster order so that fluxes are summed in   //
+//   the same order as in a scan of the bounding box. Sources are    //
+//   dilated in parallel in waves of non-conflicting sources, as de- //
+//   termined by DataCube_schedule_dilation(). If a voxel index is   //
+//   supplied, the voxels added to each source will be appended to   //
+//   it at the end, without rescanning the mask.                     //
+// ----------------------------------------------------------------- //
+
+PUBLIC void DataCube_dilate_mask_z(const DataCube *self, DataCube *mask, Catalog *cat, const size_t iter_max, const double threshold, VoxelIndex *index)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(self->data);
+	check_null(mask);
+	check_null(mask->data);
+	check_null(cat);
+	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Data cube must be of floating-point type.");
+	ensure(mask->data_type > 8, ERR_USER_INPUT, "Mask must be of signed integer type.");
+	ensure(self->axis_size[0] == mask->axis_size[0] && self->axis_size[1] == mask->axis_size[1] && self->axis_size[2] == mask->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
+	ensure(iter_max < self->axis_size[2], ERR_USER_INPUT, "Maximum number of iterations exceeds spectral axis size.");
+		
+	// Determine catalogue size
+	const size_t cat_size = Catalog_get_size(cat);
+	if(cat_size == 0)
+	{
+		warning("No sources in catalogue; skipping mask dilation.");
+		return;
+	}
+	
+	// Create temporary voxel index if none provided
+	VoxelIndex *index_local = NULL;
+	if(index == NULL)
+	{
+		index_local = VoxelIndex_new();
+		DataCube_index_catalog(mask, cat, index_local);
+		index = index_local;
+	}
+	
+	// Resolve column handles once
+	const size_t col_id    = Catalog_get_column(cat, "id");
+	const size_t col_z_min = Catalog_get_column(cat, "z_min");
+	const size_t col_z_max = Catalog_get_column(cat, "z_max");
+	const size_t col_f_sum = Catalog_get_column(cat, "f_sum");
+	const size_t col_f_min = Catalog_get_column(cat, "f_min");
+	const size_t col_f_max = Catalog_get_column(cat, "f_max");
+	const size_t col_n_pix = Catalog_get_column(cat, "n_pix");
+	const size_t col_flag  = Catalog_get_column(cat, "flag");
+	
+	const size_t nz = self->axis_size[2];
+	
+	// Divide sources into waves of non-conflicting sources
+	// (one extra channel is read when locating the initial frontier)
+	size_t *order      = (size_t *)memory(MALLOC, cat_size, sizeof(size_t));
+	size_t *wave_start = (size_t *)memory(MALLOC, cat_size + 1, sizeof(size_t));
+	const size_t n_waves = DataCube_schedule_dilation(self, cat, 0, iter_max + 1, order, wave_start);
+	size_t progress = 0;
+	
+	// Source IDs and voxel indices of all pixels added to the mask,
+	// to be appended to the voxel index at the end
+	size_t *grown = NULL;
+	size_t n_grown = 0;
+	
+	// Loop over all waves
+	for(size_t w = 0; w < n_waves; ++w)
+	{
+		// Dilate sources of current wave in parallel
+		// (serially in verbose mode to keep messages together)
+		#pragma omp parallel if(!self->verbosity)
+		{
+			// Per-thread lists of frontier voxels, added voxels and
+			// accepted voxels of all sources (as pairs of ID and index)
+			size_t *frontier = NULL;
+			size_t *added = NULL;
+			size_t *accepted = NULL;
+			size_t frontier_size = 0;
+			size_t added_size = 0;
+			size_t accepted_size = 0;
+			size_t n_accepted_all = 0;
+			
+			#pragma omp for schedule(dynamic, 1)
+			for(size_t k = wave_start[w]; k < wave_start[w + 1]; ++k)
 			{
-				// No significant improvement; clean up again and exit
-				for(size_t z = z_min_new; z <= z_max_new; ++z)
+				const size_t i = order[k];
+				message_verb(self->verbosity, "Source %zu", i + 1);
+				
+				// Get source parameters
+				const long int src_id = Catalog_get_int(cat, i, col_id);
+				long int flag = Catalog_get_int(cat, i, col_flag);
+				size_t z_min = Catalog_get_int(cat, i, col_z_min);
+				size_t z_max = Catalog_get_int(cat, i, col_z_max);
+				double f_sum = Catalog_get_flt(cat, i, col_f_sum);
+				double f_min = Catalog_get_flt(cat, i, col_f_min);
+				double f_max = Catalog_get_flt(cat, i, col_f_max);
+				size_t n_pix = Catalog_get_int(cat, i, col_n_pix);
+				const bool is_negative = (f_sum < 0.0);
+				
+				// Collect initial frontier, i.e. source voxels not enclosed
+				// by the source in both directions along the spectral axis
+				size_t first, last;
+				size_t n_frontier = 0;
+				VoxelIndex_get_runs(index, src_id, &first, &last);
+				
+				for(size_t j = first; j < last; ++j)
 				{
-					for(size_t y = y_min; y <= y_max; ++y)
+					size_t x0, y, z, length;
+					VoxelIndex_get_run(index, j, &x0, &y, &z, &length);
+					
+					for(size_t x = x0; x < x0 + length; ++x)
 					{
-						for(size_t x = x_min; x <= x_max; ++x)
+						if(z > 0 && z + 1 < nz
+						&& DataCube_get_data_int(mask, x, y, z - 1) == src_id
+						&& DataCube_get_data_int(mask, x, y, z + 1) == src_id) continue;
+						
+						if(n_frontier == frontier_size)
 						{
-							// Reset mask value again
-							if(DataCube_get_data_int(mask, x, y, z) == -1) DataCube_set_data_int(mask, x, y, z, 0);
+							frontier_size = 2 * frontier_size + 1024;
+							frontier = (size_t *)memory_realloc(frontier, frontier_size, sizeof(size_t));
 						}
+						frontier[n_frontier++] = DataCube_get_index(mask, x, y, z);
 					}
 				}
 				
-				// Stop iterating
-				break;
+				qsort(frontier, n_frontier, sizeof(size_t), DataCube_cmp_index);
+				
+				// Iterate
+				for(size_t iter = 0; iter < iter_max; ++iter)
+				{
+					double df_sum = 0.0;
+					size_t n_added = 0;
+					size_t z_min_new = z_min;
+					size_t z_max_new = z_max;
+					
+					// Loop over frontier
+					for(size_t j = 0; j < n_frontier; ++j)
+					{
+						size_t x, y, z;
+						DataCube_get_xyz(mask, frontier[j], &x, &y, &z);
+						
+						// Check lower and higher z
+						for(int side = -1; side <= 1; side += 2)
+						{
+							if((side < 0 && z == 0) || (side > 0 && z + 1 == nz))
+							{
+								flag |= 2L;
+								continue;
+							}
+							
+							const size_t z_new = side < 0 ? z - 1 : z + 1;
+							const long int id_new = DataCube_get_data_int(mask, x, y, z_new);
+							
+							if(id_new == 0)
+							{
+								if(IS_NOT_NAN(DataCube_get_data_flt(self, x, y, z_new)))
+								{
+									DataCube_set_data_int(mask, x, y, z_new, -1);
+									df_sum += DataCube_get_data_flt(self, x, y, z_new);
+									if(z_new < z_min_new) z_min_new = z_new;
+									if(z_new > z_max_new) z_max_new = z_new;
+									
+									if(n_added == added_size)
+									{
+										added_size = 2 * added_size + 1024;
+										added = (size_t *)memory_realloc(added, added_size, sizeof(size_t));
+									}
+									added[n_added++] = DataCube_get_index(mask, x, y, z_new);
+								}
+								else flag |= 4L;
+							}
+							else if(id_new > 0 && id_new != src_id) flag |= 8L;
+						}
+					}
+					
+					// Check if flux increased within boundaries
+					if(threshold < 0.0 || (is_negative && df_sum < threshold * f_sum) || (!is_negative && df_sum > threshold * f_sum))
+					{
+						// Mask should be grown
+						f_sum += df_sum;
+						z_min = z_min_new;
+						z_max = z_max_new;
+						
+						// Switch new voxels to source ID and update n_pix, f_min and f_max
+						for(size_t j = 0; j < n_added; ++j)
+						{
+							size_t x, y, z;
+							DataCube_get_xyz(mask, added[j], &x, &y, &z);
+							DataCube_set_data_int(mask, x, y, z, src_id);
+							
+							const double value = DataCube_get_data_flt(self, x, y, z);
+							if(value < f_min) f_min = value;
+							if(value > f_max) f_max = value;
+						}
+						n_pix += n_added;
+						
+						// Remember accepted voxels for voxel index update
+						if(index_local == NULL)
+						{
+							if(n_accepted_all + n_added > accepted_size)
+							{
+								accepted_size = 2 * accepted_size + n_added + 1024;
+								accepted = (size_t *)memory_realloc(accepted, 2 * accepted_size, sizeof(size_t));
+							}
+							for(size_t j = 0; j < n_added; ++j)
+							{
+								accepted[2 * n_accepted_all]     = src_id;
+								accepted[2 * n_accepted_all + 1] = added[j];
+								++n_accepted_all;
+							}
+						}
+						
+						// New voxels form the next frontier
+						qsort(added, n_added, sizeof(size_t), DataCube_cmp_index);
+						size_t *swap = frontier;
+						frontier = added;
+						added = swap;
+						const size_t swap_size = frontier_size;
+						frontier_size = added_size;
+						added_size = swap_size;
+						n_frontier = n_added;
+						
+						message_verb(self->verbosity, " - Iteration %zu: df = %.3f (%.3f%%)", iter + 1, df_sum, 100.0 * df_sum / (f_sum - df_sum));
+					}
+					else
+					{
+						// No significant improvement; reset new voxels and stop iterating
+						for(size_t j = 0; j < n_added; ++j)
+						{
+							size_t x, y, z;
+							DataCube_get_xyz(mask, added[j], &x, &y, &z);
+							DataCube_set_data_int(mask, x, y, z, 0);
+						}
+						break;
+					}
+				} // END iteration loop
+				
+				// Update source parameters
+				Catalog_set_flt(cat, i, col_f_min, f_min);
+				Catalog_set_flt(cat, i, col_f_max, f_max);
+				Catalog_set_flt(cat, i, col_f_sum, f_sum);
+				Catalog_set_int(cat, i, col_z_min, z_min);
+				Catalog_set_int(cat, i, col_z_max, z_max);
+				Catalog_set_int(cat, i, col_n_pix, n_pix);
+				Catalog_set_int(cat, i, col_flag,  flag);
+				
+				// Update progress bar
+				#pragma omp critical
+				progress_bar("Progress: ", ++progress, cat_size);
+			}  // END source loop
+			
+			// Hand over accepted pixels
+			if(n_accepted_all)
+			{
+				#pragma omp critical
+				{
+					grown = (size_t *)memory_realloc(grown, 2 * (n_grown + n_accepted_all), sizeof(size_t));
+					memcpy(grown + 2 * n_grown, accepted, 2 * n_accepted_all * sizeof(size_t));
+					n_grown += n_accepted_all;
+				}
 			}
-		} // END iteration loop
-		
-		// Update source parameters
-		Source_set_par_flt(src, "f_min", f_min, NULL, NULL);
-		Source_set_par_flt(src, "f_max", f_max, NULL, NULL);
-		Source_set_par_flt(src, "f_sum", f_sum, NULL, NULL);
-		Source_set_par_int(src, "z_min", z_min, NULL, NULL);
-		Source_set_par_int(src, "z_max", z_max, NULL, NULL);
-		Source_set_par_int(src, "n_pix", n_pix, NULL, NULL);
-		Source_set_par_int(src, "flag",  flag,  NULL, NULL);
-		
-		// Update progress bar
-		progress_bar("Progress: ", i + 1, cat_size);
-	}  // END source loop
+			
+			free(frontier);
+			free(added);
+			free(accepted);
+		}
+	}  // END wave loop
+	
+	// Update or delete voxel index
+	if(index_local != NULL) VoxelIndex_delete(index_local);
+	else DataCube_index_append(mask, index, grown, n_grown);
+	free(grown);
+	
+	// Clean up
+	free(order);
+	free(wave_start);
 	
 	return;
 }
 
 
 
+// ----------------------------------------------------------------- //
+// Compare two voxel indices                                         //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) a        - Pointer to first index.                          //
+//   (2) b        - Pointer to second index.                         //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Negative if a is to be sorted before b, positive if a is to be  //
+//   sorted after b.                                                 //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private comparison function for use with qsort(). Sorts linear  //
+//   voxel indices of type size_t in increasing order, i.e. in the   //
+//   order of a scan over z, y and x.                                //
+// ----------------------------------------------------------------- //
+
+PRIVATE int DataCube_cmp_index(const void *a, const void *b)
+{
+	const size_t index_a = *(const size_t *)a;
+	const size_t index_b = *(const size_t *)b;
+	
+	return index_a < index_b ? -1 : (index_a > index_b ? 1 : 0);
+}
+
+
+
 // ----------------------------------------------------------------- //
 // 2-D projection of 3-D mask                                        //
 // ----------------------------------------------------------------- //
@@ -3413,6 +4446,45 @@ PUBLIC DataCube *DataCube_2d_mask(const DataCube *self)
 	return maskImage;
 }
 
+// Same, but for sparse mask; the mask cube only provides the header //
+
+PUBLIC DataCube *DataCube_2d_sparse_mask(const DataCube *self, const SparseMask *mask)
+{
+	check_null(self);
+	check_null(mask);
+	ensure(self->data_type == 32, ERR_USER_INPUT, "Mask cube must be of 32-bit integer type.");
+	ensure(self->axis_size[0] == SparseMask_get_axis_size(mask, 0) && self->axis_size[1] == SparseMask_get_axis_size(mask, 1) && self->axis_size[2] == SparseMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Mask cube and sparse mask have different sizes.");
+	
+	DataCube *maskImage = DataCube_blank(self->axis_size[0], self->axis_size[1], 1, self->data_type, self->verbosity);
+	Header_copy_wcs(self->header, maskImage->header);
+	Header_copy_misc(self->header, maskImage->header, true, true);
+	
+	// Loop over all runs to project mask onto image
+	// NOTE: Rows are visited in order of increasing z, such that the
+	//       label of the last channel will be retained, as in the
+	//       dense case.
+	#pragma omp parallel for schedule(static)
+	for(size_t y = 0; y < self->axis_size[1]; ++y)
+	{
+		int32_t *ptr = (int32_t *)(maskImage->data) + y * self->axis_size[0];
+		
+		for(size_t z = 0; z < self->axis_size[2]; ++z)
+		{
+			const size_t *run_x;
+			const size_t *run_length;
+			const int32_t *run_label;
+			const size_t n_runs = SparseMask_get_row(mask, y, z, &run_x, &run_length, &run_label);
+			
+			for(size_t i = 0; i < n_runs; ++i)
+			{
+				for(size_t x = run_x[i]; x < run_x[i] + run_length[i]; ++x) ptr[x] = run_label[i];
+			}
+		}
+	}
+	
+	return maskImage;
+}
+
 
 
 // ----------------------------------------------------------------- //
@@ -3432,59 +4504,142 @@ PUBLIC DataCube *DataCube_2d_mask(const DataCube *self)
 //                                                                   //
 // Description:                                                      //
 //                                                                   //
-//   Public method for flagging the specified regions in the data    //
-//   cube. If the data cube is of floating-point type, then all      //
-//   pixels to be flagged will be set to NaN. For integer cubes a    //
-//   value of 0 will instead be used. The region must contain a mul- //
-//   tiple of 6 entries of the form x_min, x_max, y_min, y_max,      //
-//   z_min, z_max. Boundaries extending beyond the boundaries of the //
-//   cube will be automatically adjusted.                            //
+//   Public method for flagging the specified regions in the data    //
+//   cube. If the data cube is of floating-point type, then all      //
+//   pixels to be flagged will be set to NaN. For integer cubes a    //
+//   value of 0 will instead be used. The region must contain a mul- //
+//   tiple of 6 entries of the form x_min, x_max, y_min, y_max,      //
+//   z_min, z_max. Boundaries extending beyond the boundaries of the //
+//   cube will be automatically adjusted.                            //
+//   The regions are first normalised into a FlagIndex, such that    //
+//   overlapping regions are only blanked once. If the same regions  //
+//   are to be applied to several cubes, the index should instead be //
+//   created once and applied with DataCube_apply_flags().           //
+// ----------------------------------------------------------------- //
+
+PUBLIC void DataCube_flag_regions(DataCube *self, const Array_siz *region)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(self->data);
+	check_null(region);
+	
+	const size_t size = Array_siz_get_size(region);
+	ensure(size % 6 == 0, ERR_USER_INPUT, "Flagging regions must contain a multiple of 6 entries.");
+	
+	message("Applying flags.");
+	
+	// Create flagging index
+	FlagIndex *flags = FlagIndex_new(self->axis_size[0], self->axis_size[1], self->axis_size[2], region);
+	
+	// Print regions
+	for(size_t i = 0; i < size; i += 6)
+	{
+		size_t bounds[6];
+		for(size_t j = 0; j < 6; ++j) bounds[j] = Array_siz_get(region, i + j);
+		FlagIndex_clip_region(flags, bounds);
+		message_verb(self->verbosity, "  Region: [%zu, %zu, %zu, %zu, %zu, %zu]", bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]);
+	}
+	
+	// Apply flags
+	DataCube_fill_flags(self, flags);
+	
+	// Clean up
+	FlagIndex_delete(flags);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Apply flagging index to data cube                                 //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) flags     - Flagging index to be applied.                   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for flagging all pixels contained in the speci-   //
+//   fied flagging index. This has the same effect as calling Data-  //
+//   Cube_flag_regions() with the regions from which the index was   //
+//   created, but allows the same index to be reused for several     //
+//   cubes of the same size, e.g. the data, noise and mask cubes,    //
+//   without having to normalise the regions again. Floating-point   //
+//   pixels will be set to NaN and integer pixels to 0.              //
+// ----------------------------------------------------------------- //
+
+PUBLIC void DataCube_apply_flags(DataCube *self, const FlagIndex *flags)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(self->data);
+	check_null(flags);
+	ensure(FlagIndex_get_axis_size(flags, 0) == self->axis_size[0] && FlagIndex_get_axis_size(flags, 1) == self->axis_size[1] && FlagIndex_get_axis_size(flags, 2) == self->axis_size[2], ERR_USER_INPUT, "Flagging index and data cube have different sizes.");
+	
+	message("Applying flags.");
+	DataCube_fill_flags(self, flags);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Blank all pixels contained in flagging index                      //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) flags     - Flagging index to be applied.                   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for setting all pixels contained in the flagging //
+//   index to NaN (floating-point cubes) or 0 (integer cubes). As    //
+//   the intervals of each channel are disjoint, the channels can be //
+//   processed in parallel, with each interval being filled directly //
+//   in the data array.                                              //
 // ----------------------------------------------------------------- //
 
-PUBLIC void DataCube_flag_regions(DataCube *self, const Array_siz *region)
+PRIVATE void DataCube_fill_flags(DataCube *self, const FlagIndex *flags)
 {
-	// Sanity checks
-	check_null(self);
-	check_null(self->data);
-	check_null(region);
-	
-	const size_t size = Array_siz_get_size(region);
-	ensure(size % 6 == 0, ERR_USER_INPUT, "Flagging regions must contain a multiple of 6 entries.");
+	const size_t size_z = self->axis_size[2];
 	
-	message("Applying flags.");
-	
-	// Loop over regions
-	for(size_t i = 0; i < size; i += 6)
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(size_t z = 0; z < size_z; ++z)
 	{
-		// Establish boundaries
-		size_t x_min = Array_siz_get(region, i + 0);
-		size_t x_max = Array_siz_get(region, i + 1);
-		size_t y_min = Array_siz_get(region, i + 2);
-		size_t y_max = Array_siz_get(region, i + 3);
-		size_t z_min = Array_siz_get(region, i + 4);
-		size_t z_max = Array_siz_get(region, i + 5);
-		
-		// Adjust boundaries if necessary
-		if(x_max >= self->axis_size[0]) x_max = self->axis_size[0] - 1;
-		if(y_max >= self->axis_size[1]) y_max = self->axis_size[1] - 1;
-		if(z_max >= self->axis_size[2]) z_max = self->axis_size[2] - 1;
+		const size_t *interval;
+		const size_t n_int = FlagIndex_get_plane(flags, z, &interval);
 		
-		if(x_min > x_max) x_min = x_max;
-		if(y_min > y_max) y_min = y_max;
-		if(z_min > z_max) z_min = z_max;
-		
-		message_verb(self->verbosity, "  Region: [%zu, %zu, %zu, %zu, %zu, %zu]", x_min, x_max, y_min, y_max, z_min, z_max);
-		
-		for(size_t z = z_min; z <= z_max; ++z)
+		for(size_t i = 0; i < n_int; ++i)
 		{
-			for(size_t y = y_min; y <= y_max; ++y)
+			const size_t y     = interval[3 * i];
+			const size_t x_min = interval[3 * i + 1];
+			const size_t n_x   = interval[3 * i + 2] - x_min + 1;
+			char *ptr = self->data + DataCube_get_index(self, x_min, y, z) * self->word_size;
+			
+			if(self->data_type == -32)
 			{
-				for(size_t x = x_min; x <= x_max; ++x)
-				{
-					if(self->data_type < 0.0) DataCube_set_data_flt(self, x, y, z, NAN);
-					else DataCube_set_data_int(self, x, y, z, 0);
-				}
+				float *ptr_flt = (float *)ptr;
+				for(size_t x = 0; x < n_x; ++x) ptr_flt[x] = NAN;
 			}
+			else if(self->data_type == -64)
+			{
+				double *ptr_dbl = (double *)ptr;
+				for(size_t x = 0; x < n_x; ++x) ptr_dbl[x] = NAN;
+			}
+			else memset(ptr, 0, n_x * self->word_size);
 		}
 	}
 	
@@ -3513,7 +4668,7 @@ PUBLIC void DataCube_flag_regions(DataCube *self, const Array_siz *region)
 //   source catalogue file. The file must contain just two columns   //
 //   specifying the longitude and latitude of the positions to be    //
 //   flagged. No other content (e.g. comments) is allowed. The coor- //
-//   dinates can either be specified in pixels (coord_sys = 1) or in //
+//   dinates can either be specified in pixels (coord_sys = 0) or in //
 //   the native world coordinate system of the data cube (e.g. RA    //
 //   and declination in units of degrees). Lastly, a radius of > 0   //
 //   can be specified, in which case a circular region of that radi- //
@@ -3529,7 +4684,6 @@ PUBLIC void DataCube_continuum_flagging(DataCube *self, const char *filename, co
 	check_null(filename);
 	
 	// Set up a few variables
-	const long int radius2 = radius * radius;
 	const long int axis_size_x = (long int)(self->axis_size[0]);
 	const long int axis_size_y = (long int)(self->axis_size[1]);
 	const long int axis_size_z = (long int)(self->axis_size[2]);
@@ -3557,38 +4711,107 @@ PUBLIC void DataCube_continuum_flagging(DataCube *self, const char *filename, co
 		}
 	}
 	
-	// Process catalogue line-by-line
-	for(size_t i = 0; i < Table_rows(cont_cat); ++i)
+	// Extract positions and convert from WCS to pixels if needed
+	const size_t n_rows = Table_rows(cont_cat);
+	double *pos_x = (double *)memory(MALLOC, n_rows, sizeof(double));
+	double *pos_y = (double *)memory(MALLOC, n_rows, sizeof(double));
+	
+	for(size_t i = 0; i < n_rows; ++i)
+	{
+		pos_x[i] = Table_get(cont_cat, i, 0);
+		pos_y[i] = Table_get(cont_cat, i, 1);
+	}
+	
+	if(coord_sys == 1)
 	{
-		// Extract longitude and latitude
-		double lon = -1e+30;
-		double lat = -1e+30;
+		// Convert into separate pixel arrays, as failed rows are left
+		// untouched and must not retain their world coordinates
+		double *pix_x = (double *)memory(MALLOC, n_rows, sizeof(double));
+		double *pix_y = (double *)memory(MALLOC, n_rows, sizeof(double));
+		
+		for(size_t i = 0; i < n_rows; ++i)
+		{
+			pix_x[i] = -1e+30;
+			pix_y[i] = -1e+30;
+		}
 		
-		// Convert position from WCS to pixels if needed
-		if(coord_sys == 1) WCS_convertToPixel(wcs, Table_get(cont_cat, i, 0), Table_get(cont_cat, i, 1), 0.0, &lon, &lat, NULL);
+		WCS_convertToPixelArray(wcs, n_rows, pos_x, pos_y, NULL, pix_x, pix_y, NULL);
 		
+		free(pos_x);
+		free(pos_y);
+		pos_x = pix_x;
+		pos_y = pix_y;
+	}
+	
+	// Retain positions within cube boundaries
+	for(size_t i = 0; i < n_rows; ++i)
+	{
 		// Ensure that source is within cube boundaries
-		const long int pos_x = (long int)(lon + 0.5);
-		const long int pos_y = (long int)(lat + 0.5);
-		if(pos_x < 0 || pos_y < 0 || pos_x >= axis_size_x || pos_y >= axis_size_y) continue;
-		++counter;
+		if(!(pos_x[i] + 0.5 > -1.0 && pos_y[i] + 0.5 > -1.0 && pos_x[i] + 0.5 < axis_size_x && pos_y[i] + 0.5 < axis_size_y)) continue;
+		const long int x = (long int)(pos_x[i] + 0.5);
+		const long int y = (long int)(pos_y[i] + 0.5);
+		if(x < 0 || y < 0 || x >= axis_size_x || y >= axis_size_y) continue;
 		
-		// Establish bounding box
-		const long int x_min = pos_x > radius ? pos_x - radius : 0;
-		const long int y_min = pos_y > radius ? pos_y - radius : 0;
-		const long int x_max = pos_x + radius < axis_size_x ? pos_x + radius : axis_size_x - 1;
-		const long int y_max = pos_y + radius < axis_size_y ? pos_y + radius : axis_size_y - 1;
+		pos_x[counter] = (double)x;
+		pos_y[counter] = (double)y;
+		++counter;
+	}
+	
+	// Create spatial index of positions and determine spatial pixels to be flagged
+	PointGrid *grid = PointGrid_new(pos_x, pos_y, counter, radius > 1 ? (double)radius : 1.0);
+	bool *flag = (bool *)memory(CALLOC, axis_size_x * axis_size_y, sizeof(bool));
+	size_t n_flag = 0;
+	
+	free(pos_x);
+	free(pos_y);
+	
+	for(long int y = 0; y < axis_size_y; ++y)
+	{
+		for(long int x = 0; x < axis_size_x; ++x)
+		{
+			if(PointGrid_any_in_radius(grid, (double)x, (double)y, (double)radius))
+			{
+				flag[x + axis_size_x * y] = true;
+				++n_flag;
+			}
+		}
+	}
+	
+	// Apply flags to all channels
+	if(n_flag)
+	{
+		// Convert flagged pixels into row intervals spanning all channels
+		Array_siz *region = Array_siz_new(0);
 		
-		for(long int z = 0; z < axis_size_z; ++z)
+		for(long int y = 0; y < axis_size_y; ++y)
 		{
-			for(long int y = y_min; y <= y_max; ++y)
+			const bool *row = flag + axis_size_x * y;
+			long int x = 0;
+			
+			while(x < axis_size_x)
 			{
-				for(long int x = x_min; x <= x_max; ++x)
+				if(!row[x])
 				{
-					if((x - pos_x) * (x - pos_x) + (y - pos_y) * (y - pos_y) <= radius2) DataCube_set_data_flt(self, x, y, z, NAN);
+					++x;
+					continue;
 				}
+				
+				const long int x_min = x;
+				while(x < axis_size_x && row[x]) ++x;
+				
+				Array_siz_push(region, x_min);
+				Array_siz_push(region, x - 1);
+				Array_siz_push(region, y);
+				Array_siz_push(region, y);
+				Array_siz_push(region, 0);
+				Array_siz_push(region, axis_size_z - 1);
 			}
 		}
+		
+		FlagIndex *flags = FlagIndex_new(self->axis_size[0], self->axis_size[1], self->axis_size[2], region);
+		DataCube_fill_flags(self, flags);
+		FlagIndex_delete(flags);
+		Array_siz_delete(region);
 	}
 	
 	// Print some statistics
@@ -3597,6 +4820,8 @@ PUBLIC void DataCube_continuum_flagging(DataCube *self, const char *filename, co
 	// Clean up
 	Table_delete(cont_cat);
 	WCS_delete(wcs);
+	PointGrid_delete(grid);
+	free(flag);
 	
 	return;
 }
@@ -3632,6 +4857,11 @@ PUBLIC void DataCube_continuum_flagging(DataCube *self, const char *filename, co
 //   nels with |rms - median| > threshold * MAD will be added to the //
 //   array of regions to be flagged. The order of the region speci-  //
 //   fication is x_min, x_max, y_min, y_max, z_min, z_max.           //
+//   The noise of each channel is measured on the contiguous chan-   //
+//   nel plane. For the noise of each pixel, tiles of consecutive    //
+//   pixels are read one channel at a time and transposed into a     //
+//   spectrum-contiguous scratch buffer, which avoids strided access //
+//   to the data cube.                                               //
 // ----------------------------------------------------------------- //
 
 PUBLIC void DataCube_autoflag(const DataCube *self, const double threshold, const unsigned int mode, Array_siz *region)
@@ -3679,22 +4909,18 @@ PUBLIC void DataCube_autoflag(const DataCube *self, const double threshold, cons
 			const double rms = MAD_TO_STD * mad_val_flt(noise_array, size_z, median, 1, 0);
 			
 			// Check which channels exceed threshold
-			#pragma omp parallel for schedule(static)
 			for(size_t i = 0; i < size_z; ++i)
 			{
 				if(fabs(noise_array[i] - median) > threshold * rms)
 				{
 					// Add channel to flagging regions
-					#pragma omp critical
-					{
-						Array_siz_push(region, 0);
-						Array_siz_push(region, size_x - 1);
-						Array_siz_push(region, 0);
-						Array_siz_push(region, size_y - 1);
-						Array_siz_push(region, i);
-						Array_siz_push(region, i);
-						++counter;
-					}
+					Array_siz_push(region, 0);
+					Array_siz_push(region, size_x - 1);
+					Array_siz_push(region, 0);
+					Array_siz_push(region, size_y - 1);
+					Array_siz_push(region, i);
+					Array_siz_push(region, i);
+					++counter;
 				}
 			}
 			
@@ -3718,22 +4944,18 @@ PUBLIC void DataCube_autoflag(const DataCube *self, const double threshold, cons
 			const double rms = MAD_TO_STD * mad_val_dbl(noise_array, size_z, median, 1, 0);
 			
 			// Check which channels exceed threshold
-			#pragma omp parallel for schedule(static)
 			for(size_t i = 0; i < size_z; ++i)
 			{
 				if(fabs(noise_array[i] - median) > threshold * rms)
 				{
 					// Add channel to flagging regions
-					#pragma omp critical
-					{
-						Array_siz_push(region, 0);
-						Array_siz_push(region, size_x - 1);
-						Array_siz_push(region, 0);
-						Array_siz_push(region, size_y - 1);
-						Array_siz_push(region, i);
-						Array_siz_push(region, i);
-						++counter;
-					}
+					Array_siz_push(region, 0);
+					Array_siz_push(region, size_x - 1);
+					Array_siz_push(region, 0);
+					Array_siz_push(region, size_y - 1);
+					Array_siz_push(region, i);
+					Array_siz_push(region, i);
+					++counter;
 				}
 			}
 			
@@ -3750,66 +4972,78 @@ PUBLIC void DataCube_autoflag(const DataCube *self, const double threshold, cons
 		message("Auto-flagging of spatial pixels:");
 		size_t counter = 0;
 		
-		// 32-bit single-precision
-		DataCube *noise_array = DataCube_blank(size_x, size_y, 1, -64, self->verbosity);
+		// Noise measurement for each pixel
+		double *noise_array = (double *)memory(MALLOC, size_xy, sizeof(double));
+		const size_t n_tiles = (size_xy + AUTOFLAG_TILE_SIZE - 1) / AUTOFLAG_TILE_SIZE;
 		
-		// Loop over all pixels
 		#pragma omp parallel
 		{
-			double *spectrum = (double *)memory(MALLOC, size_z, sizeof(double));
+			// Spectrum-contiguous scratch tile of native precision
+			float  *tile_flt = self->data_type == -32 ? (float *)memory(MALLOC, AUTOFLAG_TILE_SIZE * size_z, sizeof(float))  : NULL;
+			double *tile_dbl = self->data_type == -64 ? (double *)memory(MALLOC, AUTOFLAG_TILE_SIZE * size_z, sizeof(double)) : NULL;
 			
-			#pragma omp for collapse(2) schedule(static)
-			for(size_t y = 0; y < size_y; ++y)
+			// Loop over all tiles of consecutive spatial pixels
+			#pragma omp for schedule(dynamic, 1)
+			for(size_t t = 0; t < n_tiles; ++t)
 			{
-				for(size_t x = 0; x < size_x; ++x)
+				const size_t first = t * AUTOFLAG_TILE_SIZE;
+				const size_t n_pix = first + AUTOFLAG_TILE_SIZE < size_xy ? AUTOFLAG_TILE_SIZE : size_xy - first;
+				
+				if(self->data_type == -32)
+				{
+					// 32-bit float: transpose tile, one channel at a time
+					for(size_t z = 0; z < size_z; ++z)
+					{
+						const float *ptr = (float *)(self->data) + first + size_xy * z;
+						for(size_t i = 0; i < n_pix; ++i) tile_flt[i * size_z + z] = ptr[i];
+					}
+					
+					// Measure noise across each spectrum
+					for(size_t i = 0; i < n_pix; ++i) noise_array[first + i] = MAD_TO_STD * median_abs_flt(tile_flt + i * size_z, size_z);
+				}
+				else
 				{
-					// Loop over all channels
-					for(size_t z = size_z; z--;)
+					// 64-bit float: transpose tile, one channel at a time
+					for(size_t z = 0; z < size_z; ++z)
 					{
-						// Copy values into spectrum
-						spectrum[z] = DataCube_get_data_flt(self, x, y, z);
+						const double *ptr = (double *)(self->data) + first + size_xy * z;
+						for(size_t i = 0; i < n_pix; ++i) tile_dbl[i * size_z + z] = ptr[i];
 					}
 					
-					// Measure noise across spectrum
-					DataCube_set_data_flt(noise_array, x, y, 0, robust_noise_2_dbl(spectrum, size_z));
+					// Measure noise across each spectrum
+					for(size_t i = 0; i < n_pix; ++i) noise_array[first + i] = robust_noise_2_dbl(tile_dbl + i * size_z, size_z);
 				}
 			}
 			
-			// Delete spectrum again
-			free(spectrum);
+			// Clean up
+			free(tile_flt);
+			free(tile_dbl);
 		}
 		
 		// Determine median of noise measurements
-		const double median = median_safe_dbl((double *)(noise_array->data), size_xy, false);
+		const double median = median_safe_dbl(noise_array, size_xy, false);
 		
 		// Determine RMS via MAD
-		const double rms = MAD_TO_STD * mad_val_dbl((double *)(noise_array->data), size_xy, median, 1, 0);
+		const double rms = MAD_TO_STD * mad_val_dbl(noise_array, size_xy, median, 1, 0);
 		
 		// Check which pixels exceed threshold
-		#pragma omp parallel for collapse(2) schedule(static)
-		for(size_t y = 0; y < size_y; ++y)
+		for(size_t i = 0; i < size_xy; ++i)
 		{
-			for(size_t x = 0; x < size_x; ++x)
+			if(fabs(noise_array[i] - median) > threshold * rms)
 			{
-				if(fabs(DataCube_get_data_flt(noise_array, x, y, 0) - median) > threshold * rms)
-				{
-					// Add pixel to flagging regions
-					#pragma omp critical
-					{
-						Array_siz_push(region, x);
-						Array_siz_push(region, x);
-						Array_siz_push(region, y);
-						Array_siz_push(region, y);
-						Array_siz_push(region, 0);
-						Array_siz_push(region, size_z - 1);
-					}
-					++counter;
-				}
+				// Add pixel to flagging regions
+				Array_siz_push(region, i % size_x);
+				Array_siz_push(region, i % size_x);
+				Array_siz_push(region, i / size_x);
+				Array_siz_push(region, i / size_x);
+				Array_siz_push(region, 0);
+				Array_siz_push(region, size_z - 1);
+				++counter;
 			}
 		}
 		
 		// Delete noise array
-		DataCube_delete(noise_array);
+		free(noise_array);
 		
 		message("  %zu spatial pixel%s marked for flagging.\n", counter, counter == 1 ? "" : "s");
 	}
@@ -4037,7 +5271,7 @@ PRIVATE void DataCube_get_xyz(const DataCube *self, const size_t index, size_t *
 // Arguments:                                                        //
 //                                                                   //
 //   (1) self         - Data cube to run the S+C finder on.          //
-//   (2) maskCube     - Mask cube for recording detected pixels.     //
+//   (2) mask         - Bit mask for recording detected pixels.      //
 //   (3) kernels_spat - List of spatial smoothing lengths correspon- //
 //                      ding to the FWHM of the Gaussian kernels to  //
 //                      be applied; 0 = no smoothing.                //
@@ -4103,9 +5337,9 @@ PRIVATE void DataCube_get_xyz(const DataCube *self, const size_t index, size_t *
 //   ter in the spatial domain and a boxcar filter in the spectral   //
 //   domain. It will then measure the noise level in each iteration  //
 //   and mark all pixels with absolute values greater than or equal  //
-//   to the specified threshold (relative to the noise level) as 1   //
-//   in the specified mask cube, which must be of 8-bit integer      //
-//   type, while non-detected pixels will be set to a value of 0.    //
+//   to the specified threshold (relative to the noise level) in the //
+//   specified bit mask, which must be of the same size as the data  //
+//   cube. Bits of non-detected pixels will remain unchanged.        //
 //   Pixels already detected in a previous iteration will be set to  //
 //   maskScaleXY times the original rms noise level of the data be-  //
 //   fore smoothing. If the value of maskScaleXY is negative, no re- //
@@ -4135,16 +5369,14 @@ PRIVATE void DataCube_get_xyz(const DataCube *self, const size_t index, size_t *
 //   absorption featured on the noise measurement.                   //
 // ----------------------------------------------------------------- //
 
-PUBLIC void DataCube_run_scfind(const DataCube *self, DataCube *maskCube, const Array_dbl *kernels_spat, const Array_siz *kernels_spec, const double threshold, const double maskScaleXY, const noise_stat method, const int range, const int scaleNoise, const noise_stat snStatistic, const int snRange, const size_t snWindowXY, const size_t snWindowZ, const size_t snGridXY, const size_t snGridZ, const bool snInterpol, const time_t start_time, const clock_t start_clock)
+PUBLIC void DataCube_run_scfind(const DataCube *self, BitMask *mask, const Array_dbl *kernels_spat, const Array_siz *kernels_spec, const double threshold, const double maskScaleXY, const noise_stat method, const int range, const int scaleNoise, const noise_stat snStatistic, const int snRange, const size_t snWindowXY, const size_t snWindowZ, const size_t snGridXY, const size_t snGridZ, const bool snInterpol, const time_t start_time, const clock_t start_clock)
 {
 	// Sanity checks
 	check_null(self);
 	check_null(self->data);
 	ensure(self->data_type < 0, ERR_USER_INPUT, "The S+C finder can only be applied to floating-point data.");
-	check_null(maskCube);
-	check_null(maskCube->data);
-	ensure(maskCube->data_type == 8, ERR_USER_INPUT, "Mask cube must be of 8-bit integer type.");
-	ensure(self->axis_size[0] == maskCube->axis_size[0] && self->axis_size[1] == maskCube->axis_size[1] && self->axis_size[2] == maskCube->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
+	check_null(mask);
+	ensure(self->axis_size[0] == BitMask_get_axis_size(mask, 0) && self->axis_size[1] == BitMask_get_axis_size(mask, 1) && self->axis_size[2] == BitMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Data cube and bit mask have different sizes.");
 	check_null(kernels_spat);
 	check_null(kernels_spec);
 	ensure(Array_dbl_get_size(kernels_spat) && Array_siz_get_size(kernels_spec), ERR_USER_INPUT, "Invalid spatial or spectral kernel list encountered.");
@@ -4180,7 +5412,7 @@ PUBLIC void DataCube_run_scfind(const DataCube *self, DataCube *maskCube, const
 				DataCube *smoothedCube = DataCube_copy(self);
 				
 				// Set flux of already detected pixels to maskScaleXY * rms
-				if(maskScaleXY >= 0.0) DataCube_set_masked_8(smoothedCube, maskCube, maskScaleXY * rms);
+				if(maskScaleXY >= 0.0) DataCube_set_masked_bits(smoothedCube, mask, maskScaleXY * rms);
 				
 				// Spatial and spectral smoothing
 				if(Array_dbl_get(kernels_spat, i) > 0.0) DataCube_gaussian_filter(smoothedCube, Array_dbl_get(kernels_spat, i) / FWHM_CONST);
@@ -4194,7 +5426,7 @@ PUBLIC void DataCube_run_scfind(const DataCube *self, DataCube *maskCube, const
 				if(scaleNoise == 1)
 				{
 					message("Correcting for noise variations along spectral axis.\n");
-					DataCube_scale_noise_spec(smoothedCube, snStatistic, snRange);
+					Array_dbl_delete(DataCube_scale_noise_spec(smoothedCube, snStatistic, snRange));
 				}
 				else if(scaleNoise == 2)
 				{
@@ -4220,7 +5452,7 @@ PUBLIC void DataCube_run_scfind(const DataCube *self, DataCube *maskCube, const
 				message("Noise level:       %.3e", rms_smooth);
 				
 				// Add pixels above threshold to mask
-				DataCube_mask_8(smoothedCube, maskCube, threshold * rms_smooth, 1);
+				DataCube_mask_bits(smoothedCube, mask, threshold * rms_smooth);
 				
 				// Delete smoothed cube again
 				DataCube_delete(smoothedCube);
@@ -4229,7 +5461,7 @@ PUBLIC void DataCube_run_scfind(const DataCube *self, DataCube *maskCube, const
 			{
 				// No smoothing required; apply threshold to original cube
 				message("Noise level:       %.3e", rms);
-				DataCube_mask_8(self, maskCube, threshold * rms, 1);
+				DataCube_mask_bits(self, mask, threshold * rms);
 			}
 			
 			// Print time
@@ -4248,7 +5480,7 @@ PUBLIC void DataCube_run_scfind(const DataCube *self, DataCube *maskCube, const
 // Arguments:                                                        //
 //                                                                   //
 //   (1) self         - Data cube to run the threshold finder on.    //
-//   (2) maskCube     - Mask cube for recording detected pixels.     //
+//   (2) mask         - Bit mask for recording detected pixels.      //
 //   (3) absolute     - If true, apply absolute threshold; otherwise //
 //                      multiply threshold by noise level.           //
 //   (4) threshold    - Absolute or relative flux threshold.         //
@@ -4270,7 +5502,7 @@ PUBLIC void DataCube_run_scfind(const DataCube *self, DataCube *maskCube, const
 //                                                                   //
 //   Public method for running a simple threshold finder on the data //
 //   cube specified by the user. Detected pixels will be added to    //
-//   the mask cube provided, which must be of 8-bit integer type.    //
+//   the bit mask provided, which must match the size of the cube.   //
 //   The specified flux threshold can either be absolute or relative //
 //   depending on the value of the 'absolute' parameter. In the lat- //
 //   ter case, the threshold will be multiplied by the noise level   //
@@ -4280,14 +5512,13 @@ PUBLIC void DataCube_run_scfind(const DataCube *self, DataCube *maskCube, const
 //   cube.                                                           //
 // ----------------------------------------------------------------- //
 
-PUBLIC void DataCube_run_threshold(const DataCube *self, DataCube *maskCube, const bool absolute, double threshold, const noise_stat method, const int range)
+PUBLIC void DataCube_run_threshold(const DataCube *self, BitMask *mask, const bool absolute, double threshold, const noise_stat method, const int range)
 {
 	// Sanity checks
 	check_null(self);
 	ensure(self->data_type < 0, ERR_USER_INPUT, "The S+C finder can only be applied to floating-point data.");
-	check_null(maskCube);
-	ensure(maskCube->data_type == 8, ERR_USER_INPUT, "Mask cube must be of 8-bit integer type.");
-	ensure(self->axis_size[0] == maskCube->axis_size[0] && self->axis_size[1] == maskCube->axis_size[1] && self->axis_size[2] == maskCube->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
+	check_null(mask);
+	ensure(self->axis_size[0] == BitMask_get_axis_size(mask, 0) && self->axis_size[1] == BitMask_get_axis_size(mask, 1) && self->axis_size[2] == BitMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Data cube and bit mask have different sizes.");
 	ensure(threshold >= 0.0, ERR_USER_INPUT, "Negative flux threshold encountered.");
 	ensure(method == NOISE_STAT_STD || method == NOISE_STAT_MAD || method == NOISE_STAT_GAUSS, ERR_USER_INPUT, "Invalid noise measurement method: %d.", method);
 	
@@ -4309,7 +5540,7 @@ PUBLIC void DataCube_run_threshold(const DataCube *self, DataCube *maskCube, con
 	}
 	
 	// Apply threshold
-	DataCube_mask_8(self, maskCube, threshold, 1);
+	DataCube_mask_bits(self, mask, threshold);
 	
 	return;
 }
@@ -4336,6 +5567,10 @@ PUBLIC void DataCube_run_threshold(const DataCube *self, DataCube *maskCube, con
 //  (12) positivity - If true, negative sources will be discarded.   //
 //  (13) rms        - Global rms value by which all flux values will //
 //                    be normalised. 1 = no normalisation.           //
+//  (14) voxel_index - Pointer to a VoxelIndex pointer which will be //
+//                    set to a newly created index of all voxels of  //
+//                    the linked sources. Can be NULL if no index is //
+//                    required.                                      //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
@@ -4352,10 +5587,15 @@ PUBLIC void DataCube_run_threshold(const DataCube *self, DataCube *maskCube, con
 //   Objects that fall outside of the minimum or maximum size re-    //
 //   quirements will be removed on the fly. If positivity is set to  //
 //   true, sources with negative total flux will also be removed.    //
+//   Lastly, if voxel_index is not NULL, the voxels of all sources   //
+//   will be recorded in a voxel index as they get labelled, which   //
+//   can be passed on to subsequent methods to avoid searching for   //
+//   source voxels in the bounding box of each source. The caller    //
+//   will be responsible for deleting the index again.               //
 // ----------------------------------------------------------------- //
 
 
-PUBLIC LinkerPar *DataCube_run_linker(const DataCube *self, DataCube *mask, const size_t radius_x, const size_t radius_y, const size_t radius_z, const size_t min_size_x, const size_t min_size_y, const size_t min_size_z, const size_t max_size_x, const size_t max_size_y, const size_t max_size_z, const bool positivity, const double rms)
+PUBLIC LinkerPar *DataCube_run_linker(const DataCube *self, DataCube *mask, const size_t radius_x, const size_t radius_y, const size_t radius_z, const size_t min_size_x, const size_t min_size_y, const size_t min_size_z, const size_t max_size_x, const size_t max_size_y, const size_t max_size_z, const bool positivity, const double rms, VoxelIndex **voxel_index)
 {
 	// Sanity checks
 	check_null(self);
@@ -4388,6 +5628,9 @@ PUBLIC LinkerPar *DataCube_run_linker(const DataCube *self, DataCube *mask, cons
 	int32_t *ptr_mask = (int32_t *)(mask->data);
 	const size_t cadence = (nz / 100) ? nz / 100 : 1;  // Only used for updating progress bar
 	
+	// Create voxel index to be filled during linking if requested
+	VoxelIndex *index_runs = (voxel_index != NULL) ? VoxelIndex_new() : NULL;
+	
 	// Link pixels into sources
 	for(size_t z = nz; z--;)
 	{
@@ -4421,11 +5664,12 @@ PUBLIC LinkerPar *DataCube_run_linker(const DataCube *self, DataCube *mask, cons
 					
 					// Create a new linker parameter entry
 					LinkerPar_push(lpar, label, x, y, z, flux * rms_inv, flag);
+					if(index_runs != NULL) VoxelIndex_push(index_runs, label, x, y, z, 1);
 					
 					// Recursively process neighbouring pixels
 					Stack *stack = Stack_new();
 					Stack_push(stack, index);
-					DataCube_process_stack(self, mask, stack, radius_x, radius_y, radius_z, label, lpar, rms_inv);
+					DataCube_process_stack(self, mask, stack, radius_x, radius_y, radius_z, label, lpar, rms_inv, index_runs);
 					Stack_delete(stack);
 					
 					// Check if new source outside size (and other) requirements
@@ -4458,6 +5702,7 @@ PUBLIC LinkerPar *DataCube_run_linker(const DataCube *self, DataCube *mask, cons
 						
 						// Discard source entry
 						LinkerPar_pop(lpar);
+						if(index_runs != NULL) VoxelIndex_discard(index_runs, label);
 					}
 					else
 					{
@@ -4479,6 +5724,13 @@ PUBLIC LinkerPar *DataCube_run_linker(const DataCube *self, DataCube *mask, cons
 	// Print information
 	LinkerPar_print_info(lpar);
 	
+	// Hand over voxel index of linked sources if requested
+	if(index_runs != NULL)
+	{
+		VoxelIndex_finalise(index_runs);
+		*voxel_index = index_runs;
+	}
+	
 	// Return LinkerPar object
 	return lpar;
 }
@@ -4505,6 +5757,8 @@ PUBLIC LinkerPar *DataCube_run_linker(const DataCube *self, DataCube *mask, cons
 //   (9) rms_inv   - Inverse of the global rms value by which all    //
 //                   flux values will multiplied. If set to 1, no    //
 //                   normalisation will occur.                       //
+//  (10) index_runs - Voxel index to which newly labelled pixels     //
+//                    will be added. Can be NULL.                    //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
@@ -4525,7 +5779,7 @@ PUBLIC LinkerPar *DataCube_run_linker(const DataCube *self, DataCube *mask, cons
 //   needed.                                                         //
 // ----------------------------------------------------------------- //
 
-PRIVATE void DataCube_process_stack(const DataCube *self, DataCube *mask, Stack *stack, const size_t radius_x, const size_t radius_y, const size_t radius_z, const int32_t label, LinkerPar *lpar, const double rms_inv)
+PRIVATE void DataCube_process_stack(const DataCube *self, DataCube *mask, Stack *stack, const size_t radius_x, const size_t radius_y, const size_t radius_z, const int32_t label, LinkerPar *lpar, const double rms_inv, VoxelIndex *index_runs)
 {
 	// Set up a few parameters
 	size_t x, y, z;
@@ -4592,6 +5846,7 @@ PRIVATE void DataCube_process_stack(const DataCube *self, DataCube *mask, Stack
 						*ptr = label;                                              // label pixel
 						LinkerPar_update(lpar, xx, yy, zz, flux * rms_inv, flag);  // update linker parameter object
 						Stack_push(stack, index);                                  // push pixel onto stack
+						if(index_runs != NULL) VoxelIndex_push(index_runs, label, xx, yy, zz, 1);  // record pixel in voxel index
 					}
 				}
 			}
@@ -4609,13 +5864,21 @@ PRIVATE void DataCube_process_stack(const DataCube *self, DataCube *mask, Stack
 // Arguments:                                                        //
 //                                                                   //
 //   (1)  self      - Object self-reference.                         //
-//   (2)  mask      - 32-bit mask cube.                              //
+//   (2)  mask      - 32-bit mask cube. Its data array will only be  //
+//                    accessed if index or sparse is NULL.           //
 //   (3)  cat       - Catalogue of sources to be parameterised.      //
 //   (4)  use_wcs   - If true, attempt to convert the position of    //
 //                    the source to WCS.                             //
 //   (5)  physical  - If true, convert relevant parameters to phy-   //
 //                    sical units using information from the header. //
 //                    If false, native pixel units will be used.     //
+//   (6)  prefix    - Prefix to be used in source names.             //
+//   (7)  index     - Voxel index of all sources in the mask. Can be //
+//                    NULL, in which case a temporary index will be  //
+//                    created.                                       //
+//   (8)  sparse    - Sparse form of the mask, used in place of the  //
+//                    mask cube to find non-source pixels. Can be    //
+//                    NULL.                                          //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
@@ -4633,15 +5896,22 @@ PRIVATE void DataCube_process_stack(const DataCube *self, DataCube *mask, Stack
 //   If use_wcs is set to true, the method will attempt to convert   //
 //   certain parameters to WCS and append those to the catalogue in  //
 //   addition to their pixel-based equivalents.                      //
+//   Sources are measured in parallel, starting with the largest     //
+//   bounding boxes, while the catalogue itself is updated serially  //
+//   in catalogue order afterwards. The pixels of each source are    //
+//   looked up in the voxel index, so that only the local noise mea- //
+//   surement needs to search the entire bounding box. If a sparse   //
+//   mask is supplied, non-source pixels will be identified from its //
+//   runs, and the dense mask cube will not be accessed at all.      //
 // ----------------------------------------------------------------- //
 
-PUBLIC void DataCube_parameterise(const DataCube *self, const DataCube *mask, Catalog *cat, bool use_wcs, bool physical, const char *prefix)
+PUBLIC void DataCube_parameterise(const DataCube *self, const DataCube *mask, Catalog *cat, bool use_wcs, bool physical, const char *prefix, const VoxelIndex *index, const SparseMask *sparse)
 {
 	// Sanity checks
 	check_null(self);
 	check_null(self->data);
 	check_null(mask);
-	check_null(mask->data);
+	ensure((index != NULL && sparse != NULL) || mask->data != NULL, ERR_NULL_PTR, "Mask data or voxel index and sparse mask required for parameterisation.");
 	check_null(cat);
 	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Parameterisation only possible with floating-point data.");
 	ensure(mask->data_type > 0, ERR_USER_INPUT, "Mask must be of integer type.");
@@ -4678,220 +5948,192 @@ PUBLIC void DataCube_parameterise(const DataCube *self, const DataCube *mask, Ca
 	// (only supported if BUNIT is Jy/beam)
 	if((physical = physical ? String_compare(unit_flux_dens, "Jy/beam") : physical)) message("Attempting to measure parameters in physical units.");
 	
-	// Create string holding source name
-	String *source_name = String_new("");
+	// Extract source IDs and bounding boxes from catalogue
+	SourcePar *par = (SourcePar *)memory(MALLOC, cat_size, sizeof(SourcePar));
+	size_t *order = (size_t *)memory(MALLOC, 2 * cat_size, sizeof(size_t));
+	
+	const size_t col_id    = Catalog_get_column(cat, "id");
+	const size_t col_n_pix = Catalog_get_column(cat, "n_pix");
+	const size_t col_x_min = Catalog_get_column(cat, "x_min");
+	const size_t col_x_max = Catalog_get_column(cat, "x_max");
+	const size_t col_y_min = Catalog_get_column(cat, "y_min");
+	const size_t col_y_max = Catalog_get_column(cat, "y_max");
+	const size_t col_z_min = Catalog_get_column(cat, "z_min");
+	const size_t col_z_max = Catalog_get_column(cat, "z_max");
+	const size_t col_f_sum = Catalog_get_column(cat, "f_sum");
 	
-	// Loop over all sources in catalogue
 	for(size_t i = 0; i < cat_size; ++i)
 	{
-		// Extract source
-		Source *src = Catalog_get_source(cat, i);
-		
 		// Extract source ID
-		const size_t src_id = Source_get_par_by_name_int(src, "id");
-		ensure(src_id, ERR_USER_INPUT, "Source ID missing from catalogue; cannot parameterise.");
-		progress_bar("Progress: ", i + 1, cat_size);
+		par[i].src_id = Catalog_get_int(cat, i, col_id);
+		ensure(par[i].src_id, ERR_USER_INPUT, "Source ID missing from catalogue; cannot parameterise.");
 		
 		// Extract number of detected pixels
-		const size_t n_pix = Source_get_par_by_name_int(src, "n_pix");
+		par[i].n_pix = Catalog_get_int(cat, i, col_n_pix);
 		
 		// Extract source bounding box
-		const size_t x_min = Source_get_par_by_name_int(src, "x_min");
-		const size_t x_max = Source_get_par_by_name_int(src, "x_max");
-		const size_t y_min = Source_get_par_by_name_int(src, "y_min");
-		const size_t y_max = Source_get_par_by_name_int(src, "y_max");
-		const size_t z_min = Source_get_par_by_name_int(src, "z_min");
-		const size_t z_max = Source_get_par_by_name_int(src, "z_max");
-		ensure(x_min <= x_max && y_min <= y_max && z_min <= z_max, ERR_INDEX_RANGE, "Illegal source bounding box: min > max!");
-		ensure(x_max < self->axis_size[0] && y_max < self->axis_size[1] && z_max < self->axis_size[2], ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
-		
-		const size_t nx = x_max - x_min + 1;
-		const size_t ny = y_max - y_min + 1;
-		const size_t nz = z_max - z_min + 1;
+		par[i].x_min = Catalog_get_int(cat, i, col_x_min);
+		par[i].x_max = Catalog_get_int(cat, i, col_x_max);
+		par[i].y_min = Catalog_get_int(cat, i, col_y_min);
+		par[i].y_max = Catalog_get_int(cat, i, col_y_max);
+		par[i].z_min = Catalog_get_int(cat, i, col_z_min);
+		par[i].z_max = Catalog_get_int(cat, i, col_z_max);
+		ensure(par[i].x_min <= par[i].x_max && par[i].y_min <= par[i].y_max && par[i].z_min <= par[i].z_max, ERR_INDEX_RANGE, "Illegal source bounding box: min > max!");
+		ensure(par[i].x_max < self->axis_size[0] && par[i].y_max < self->axis_size[1] && par[i].z_max < self->axis_size[2], ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
 		
 		// Check if source has negative flux
-		const bool is_negative = (Source_get_par_by_name_flt(src, "f_sum") < 0.0);
-		
-		// Initialise source parameters
-		double rms = 0.0;
-		double pos_x = 0.0;
-		double pos_y = 0.0;
-		double pos_z = 0.0;
-		double f_sum = 0.0;
-		double f_min = INFINITY;
-		double f_max = -INFINITY;
-		double w50 = 0.0;
-		double w20 = 0.0;
-		double err_x = 0.0;
-		double err_y = 0.0;
-		double err_z = 0.0;
-		double err_f_sum = 0.0;
-		double longitude = 0.0;
-		double latitude = 0.0;
-		double spectral = 0.0;
-		double ell_maj = 0.0;
-		double ell_min = 0.0;
-		double ell_pa = 0.0;
-		double ell3s_maj = 0.0;
-		double ell3s_min = 0.0;
-		double ell3s_pa = 0.0;
-		double kin_pa = 0.0;
-		
-		// Auxiliary parameters and storage
-		double *kpa_cenX = (double *)memory(MALLOC, nz, sizeof(double));
-		double *kpa_cenY = (double *)memory(MALLOC, nz, sizeof(double));
-		double *kpa_sum  = (double *)memory(MALLOC, nz, sizeof(double));
-		size_t kpa_first = z_max - z_min;
-		size_t kpa_last  = 0;
-		size_t kpa_counter = 0;
-		
-		Array_dbl *array_rms = Array_dbl_new(0);
-		double *spectrum   = (double *)memory(CALLOC, nz, sizeof(double));
-		double *moment_map = (double *)memory(CALLOC, nx * ny,   sizeof(double));
-		size_t *count_map  = (size_t *)memory(CALLOC, nx * ny,   sizeof(size_t));
-		
-		double sum_pos = 0.0;
-		
-		// First pass
-		for(size_t z = z_min; z <= z_max; ++z)
-		{
-			for(size_t y = y_min; y <= y_max; ++y)
-			{
-				for(size_t x = x_min; x <= x_max; ++x)
-				{
-					const size_t id    = DataCube_get_data_int(mask, x, y, z);
-					const double value = is_negative ? -DataCube_get_data_flt(self, x, y, z) : DataCube_get_data_flt(self, x, y, z);
-					
-					if(id == src_id)
-					{
-						// ALL PIXELS
-						// Flux
-						f_sum += value;
-						if(f_min > value) f_min = value;
-						if(f_max < value) f_max = value;
-						
-						// Moment map for ellipse fitting
-						moment_map[x - x_min + nx * (y - y_min)] += value;
-						count_map [x - x_min + nx * (y - y_min)] += 1;
-						
-						// Spectrum for line width
-						spectrum[z - z_min] += value;
-						
-						// POSITIVE PIXELS ONLY
-						if(value > 0.0)
-						{
-							// Centroid position
-							pos_x += value * x;
-							pos_y += value * y;
-							pos_z += value * z;
-							sum_pos += value;
-						}
-					}
-					else if(id == 0)
-					{
-						// Retain non-source pixels for RMS measurement
-						Array_dbl_push(array_rms, value);
-					}
-				}
-			}
-		}
+		par[i].is_negative = (Catalog_get_flt(cat, i, col_f_sum) < 0.0);
 		
-		// Finalise centroid
-		pos_x /= sum_pos;
-		pos_y /= sum_pos;
-		pos_z /= sum_pos;
-		
-		// Measure local RMS
-		if(Array_dbl_get_size(array_rms)) rms = MAD_TO_STD * mad_val_dbl(Array_dbl_get_ptr(array_rms), Array_dbl_get_size(array_rms), 0.0, 1, 0);
-		else warning_verb(self->verbosity, "Failed to measure local noise level for source %zu.", src_id);
-		
-		// Second pass
-		// (for parameters dependent on first-pass output)
-		for(size_t z = z_min; z <= z_max; ++z)
+		// Record bounding box volume for scheduling
+		order[2 * i]     = (par[i].x_max - par[i].x_min + 1) * (par[i].y_max - par[i].y_min + 1) * (par[i].z_max - par[i].z_min + 1);
+		order[2 * i + 1] = i;
+	}
+	
+	// Process sources with the largest bounding boxes first
+	// NOTE: This is to prevent a few very large sources from being
+	//       picked up by the last thread and stalling the entire loop.
+	qsort(order, cat_size, 2 * sizeof(size_t), DataCube_cmp_volume);
+	
+	// Create temporary voxel index if none provided
+	VoxelIndex *index_local = NULL;
+	if(index == NULL)
+	{
+		index_local = VoxelIndex_new();
+		DataCube_index_catalog(mask, cat, index_local);
+		index = index_local;
+	}
+	
+	// Measure source parameters in parallel
+	// NOTE: Each source is measured independently using thread-local
+	//       scratch buffers that are reused across sources. Results are
+	//       written into the par array and only transferred to the
+	//       catalogue afterwards, so the output does not depend on the
+	//       order in which sources are processed.
+	size_t progress = 0;
+	
+	#pragma omp parallel
+	{
+		double *buffer = NULL;
+		size_t *count_map = NULL;
+		double *noise = NULL;
+		size_t buffer_size = 0;
+		size_t count_map_size = 0;
+		size_t noise_size = 0;
+		
+		#pragma omp for schedule(dynamic, 1)
+		for(size_t i = 0; i < cat_size; ++i)
 		{
-			kpa_cenX[z - z_min] = 0.0;
-			kpa_cenY[z - z_min] = 0.0;
-			kpa_sum[z - z_min] = 0.0;
+			DataCube_measure_source(self, mask, index, sparse, par + order[2 * i + 1], &buffer, &buffer_size, &count_map, &count_map_size, &noise, &noise_size);
 			
-			for(size_t y = y_min; y <= y_max; ++y)
-			{
-				for(size_t x = x_min; x <= x_max; ++x)
-				{
-					const size_t id    = DataCube_get_data_int(mask, x, y, z);
-					const double value = is_negative ? -DataCube_get_data_flt(self, x, y, z) : DataCube_get_data_flt(self, x, y, z);
-					
-					if(id == src_id)
-					{
-						// POSITIVE PIXELS
-						if(value > 0.0)
-						{
-							err_x += ((double)x - pos_x) * ((double)x - pos_x);
-							err_y += ((double)y - pos_y) * ((double)y - pos_y);
-							err_z += ((double)z - pos_z) * ((double)z - pos_z);
-						}
-						
-						// PIXELS > 3 SIGMA
-						if(value > 3.0 * rms)
-						{
-							// Centroids for kinematic major axis
-							kpa_cenX[z - z_min] += value * (double)x;
-							kpa_cenY[z - z_min] += value * (double)y;
-							kpa_sum [z - z_min] += value;
-						}
-					}
-				}
-			}
+			size_t done;
+			#pragma omp atomic capture
+			done = ++progress;
 			
-			// Determine centroid in each channel
-			if(kpa_sum[z - z_min] > 0.0)
-			{
-				kpa_cenX[z - z_min] /= kpa_sum[z - z_min];
-				kpa_cenY[z - z_min] /= kpa_sum[z - z_min];
-				++kpa_counter;
-				
-				if(kpa_first > z - z_min) kpa_first = z - z_min;
-				if(kpa_last  < z - z_min) kpa_last  = z - z_min;
-			}
+			bool is_master = true;
+			#ifdef _OPENMP
+				is_master = (omp_get_thread_num() == 0);
+			#endif
+			if(is_master && done < cat_size) progress_bar("Progress: ", done, cat_size);
 		}
 		
-		// Measure kinematic major axis
-		if(kpa_counter < 2)
-		{
-			warning_verb(self->verbosity, "Failed to determine kinematic major axis for source %zu.\n         Emission is too faint.", i);
-			kin_pa = -1.0;
-		}
-		else
+		free(buffer);
+		free(count_map);
+		free(noise);
+	}
+	
+	progress_bar("Progress: ", cat_size, cat_size);
+	
+	VoxelIndex_delete(index_local);
+	
+	// Create string holding source name
+	String *source_name = String_new("");
+	
+	// Define output columns once, in their final order
+	const char *unit_f_sum = String_get(physical ? unit_flux : unit_flux_dens);
+	const char *unit_width = physical ? String_get(unit_spec) : "pix";
+	
+	const size_t col_x         = Catalog_add_column(cat, "x",         SOURCE_TYPE_FLT, "pix",                      "pos.cartesian.x");
+	const size_t col_y         = Catalog_add_column(cat, "y",         SOURCE_TYPE_FLT, "pix",                      "pos.cartesian.y");
+	const size_t col_z         = Catalog_add_column(cat, "z",         SOURCE_TYPE_FLT, "pix",                      "pos.cartesian.z");
+	const size_t col_rms       = Catalog_add_column(cat, "rms",       SOURCE_TYPE_FLT, String_get(unit_flux_dens), "instr.det.noise");
+	const size_t col_f_min     = Catalog_add_column(cat, "f_min",     SOURCE_TYPE_FLT, String_get(unit_flux_dens), "phot.flux.density;stat.min");
+	const size_t col_f_max     = Catalog_add_column(cat, "f_max",     SOURCE_TYPE_FLT, String_get(unit_flux_dens), "phot.flux.density;stat.max");
+	Catalog_add_column(cat, "f_sum", SOURCE_TYPE_FLT, unit_f_sum, "phot.flux");  // already resolved as col_f_sum; updates unit only
+	const size_t col_w20       = Catalog_add_column(cat, "w20",       SOURCE_TYPE_FLT, unit_width,                 "spect.line.width");
+	const size_t col_w50       = Catalog_add_column(cat, "w50",       SOURCE_TYPE_FLT, unit_width,                 "spect.line.width");
+	const size_t col_ell_maj   = Catalog_add_column(cat, "ell_maj",   SOURCE_TYPE_FLT, "pix",                      "phys.angSize");
+	const size_t col_ell_min   = Catalog_add_column(cat, "ell_min",   SOURCE_TYPE_FLT, "pix",                      "phys.angSize");
+	const size_t col_ell_pa    = Catalog_add_column(cat, "ell_pa",    SOURCE_TYPE_FLT, "deg",                      "pos.posAng");
+	const size_t col_ell3s_maj = Catalog_add_column(cat, "ell3s_maj", SOURCE_TYPE_FLT, "pix",                      "phys.angSize");
+	const size_t col_ell3s_min = Catalog_add_column(cat, "ell3s_min", SOURCE_TYPE_FLT, "pix",                      "phys.angSize");
+	const size_t col_ell3s_pa  = Catalog_add_column(cat, "ell3s_pa",  SOURCE_TYPE_FLT, "deg",                      "pos.posAng");
+	const size_t col_kin_pa    = Catalog_add_column(cat, "kin_pa",    SOURCE_TYPE_FLT, "deg",                      "pos.posAng");
+	const size_t col_err_x     = Catalog_add_column(cat, "err_x",     SOURCE_TYPE_FLT, "pix",                      "stat.error;pos.cartesian.x");
+	const size_t col_err_y     = Catalog_add_column(cat, "err_y",     SOURCE_TYPE_FLT, "pix",                      "stat.error;pos.cartesian.y");
+	const size_t col_err_z     = Catalog_add_column(cat, "err_z",     SOURCE_TYPE_FLT, "pix",                      "stat.error;pos.cartesian.z");
+	const size_t col_err_f_sum = Catalog_add_column(cat, "err_f_sum", SOURCE_TYPE_FLT, unit_f_sum,                 "stat.error;phot.flux");
+	size_t col_lon  = 0;
+	size_t col_lat  = 0;
+	size_t col_spec = 0;
+	
+	if(use_wcs)
+	{
+		col_lon  = Catalog_add_column(cat, String_get(label_lon),  SOURCE_TYPE_FLT, String_get(unit_lon),  String_get(ucd_lon));
+		col_lat  = Catalog_add_column(cat, String_get(label_lat),  SOURCE_TYPE_FLT, String_get(unit_lat),  String_get(ucd_lat));
+		col_spec = Catalog_add_column(cat, String_get(label_spec), SOURCE_TYPE_FLT, String_get(unit_spec), String_get(ucd_spec));
+	}
+	
+	// Convert all source positions to WCS in one go if requested
+	double *world = NULL;
+	
+	if(use_wcs)
+	{
+		world = (double *)memory(CALLOC, 6 * cat_size, sizeof(double));
+		double *pixel = world + 3 * cat_size;
+		
+		for(size_t i = 0; i < cat_size; ++i)
 		{
-			if(kpa_counter == 2) warning_verb(self->verbosity, "Kinematic major axis for source %zu based on just 2 data points.", i);
-			kin_pa = kin_maj_axis_dbl(kpa_cenX, kpa_cenY, kpa_sum, nz, kpa_first, kpa_last);
+			pixel[i]                = par[i].pos_x;
+			pixel[i + cat_size]     = par[i].pos_y;
+			pixel[i + 2 * cat_size] = par[i].pos_z;
 		}
 		
-		// Ellipse fit to moment-0 map
-		moment_ellipse_fit_dbl(moment_map, count_map, nx, ny, pos_x - x_min, pos_y - y_min, rms, &ell_maj, &ell_min, &ell_pa, &ell3s_maj, &ell3s_min, &ell3s_pa);
+		WCS_convertToWorldArray(wcs, cat_size, pixel, pixel + cat_size, pixel + 2 * cat_size, world, world + cat_size, world + 2 * cat_size);
+	}
+	
+	// Loop over all sources in catalogue
+	for(size_t i = 0; i < cat_size; ++i)
+	{
+		const SourcePar *sp = par + i;
+		
+		// Initialise WCS parameters
+		const double longitude = use_wcs ? world[i] : 0.0;
+		const double latitude  = use_wcs ? world[i + cat_size] : 0.0;
+		const double spectral  = use_wcs ? world[i + 2 * cat_size] : 0.0;
+		double f_sum = sp->f_sum;
+		double f_min = sp->f_min;
+		double f_max = sp->f_max;
 		
-		// Determine w20 and w50 from spectrum (moving inwards)
-		spectral_line_width_dbl(spectrum, nz, &w20, &w50);
+		if(!sp->rms_valid) warning_verb(self->verbosity, "Failed to measure local noise level for source %zu.", sp->src_id);
+		if(sp->kpa_counter < 2) warning_verb(self->verbosity, "Failed to determine kinematic major axis for source %zu.\n         Emission is too faint.", i);
+		else if(sp->kpa_counter == 2) warning_verb(self->verbosity, "Kinematic major axis for source %zu based on just 2 data points.", i);
 		
-		// Determine uncertainties
-		err_x = sqrt(err_x) * rms / sum_pos;
-		err_y = sqrt(err_y) * rms / sum_pos;
-		err_z = sqrt(err_z) * rms / sum_pos;
-		err_f_sum = rms * sqrt(n_pix);
+		// Determine flux uncertainty
+		const double err_f_sum = sp->rms * sqrt(sp->n_pix);
 		
 		// Carry out WCS conversion if requested
 		if(use_wcs)
 		{
-			WCS_convertToWorld(wcs, pos_x, pos_y, pos_z, &longitude, &latitude, &spectral);
 			DataCube_create_src_name(self, &source_name, prefix, longitude, latitude, label_lon);
 		}
 		else
 		{
 			String_set(source_name, prefix ? prefix : "SoFiA");
-			String_append_int(source_name, "-%04zu", src_id);
+			String_append_int(source_name, "-%04zu", sp->src_id);
 		}
 		
 		// Invert flux-related parameters of negative sources
-		if(is_negative)
+		if(sp->is_negative)
 		{
 			swap(&f_min, &f_max);
 			f_min = -f_min;
@@ -4900,88 +6142,414 @@ PUBLIC void DataCube_parameterise(const DataCube *self, const DataCube *mask, Ca
 		}
 		
 		// Update catalogue entries
-		Source_set_identifier(src, String_get(source_name));
-		Source_set_par_flt(src, "x",     pos_x, "pix",                      "pos.cartesian.x");
-		Source_set_par_flt(src, "y",     pos_y, "pix",                      "pos.cartesian.y");
-		Source_set_par_flt(src, "z",     pos_z, "pix",                      "pos.cartesian.z");
-		Source_set_par_flt(src, "rms",   rms,   String_get(unit_flux_dens), "instr.det.noise");
-		Source_set_par_flt(src, "f_min", f_min, String_get(unit_flux_dens), "phot.flux.density;stat.min");
-		Source_set_par_flt(src, "f_max", f_max, String_get(unit_flux_dens), "phot.flux.density;stat.max");
+		Catalog_set_identifier(cat, i, String_get(source_name));
+		Catalog_set_flt(cat, i, col_x,     sp->pos_x);
+		Catalog_set_flt(cat, i, col_y,     sp->pos_y);
+		Catalog_set_flt(cat, i, col_z,     sp->pos_z);
+		Catalog_set_flt(cat, i, col_rms,   sp->rms);
+		Catalog_set_flt(cat, i, col_f_min, f_min);
+		Catalog_set_flt(cat, i, col_f_max, f_max);
+		
+		if(physical)
+		{
+			Catalog_set_flt(cat, i, col_f_sum, f_sum * chan_size / beam_area);
+			Catalog_set_flt(cat, i, col_w20,   sp->w20 * chan_size);
+			Catalog_set_flt(cat, i, col_w50,   sp->w50 * chan_size);
+		}
+		else
+		{
+			Catalog_set_flt(cat, i, col_f_sum, f_sum);
+			Catalog_set_flt(cat, i, col_w20,   sp->w20);
+			Catalog_set_flt(cat, i, col_w50,   sp->w50);
+		}
+		
+		Catalog_set_flt(cat, i, col_ell_maj,   sp->ell_maj);
+		Catalog_set_flt(cat, i, col_ell_min,   sp->ell_min);
+		Catalog_set_flt(cat, i, col_ell_pa,    sp->ell_pa);
+		Catalog_set_flt(cat, i, col_ell3s_maj, sp->ell3s_maj);
+		Catalog_set_flt(cat, i, col_ell3s_min, sp->ell3s_min);
+		Catalog_set_flt(cat, i, col_ell3s_pa,  sp->ell3s_pa);
+		Catalog_set_flt(cat, i, col_kin_pa,    sp->kin_pa);
+		
+		if(physical)
+		{
+			Catalog_set_flt(cat, i, col_err_x,     sp->err_x * sqrt(beam_area));
+			Catalog_set_flt(cat, i, col_err_y,     sp->err_y * sqrt(beam_area));
+			Catalog_set_flt(cat, i, col_err_z,     sp->err_z * sqrt(beam_area));
+			Catalog_set_flt(cat, i, col_err_f_sum, err_f_sum * chan_size / sqrt(beam_area));
+		}
+		else
+		{
+			Catalog_set_flt(cat, i, col_err_x,     sp->err_x);
+			Catalog_set_flt(cat, i, col_err_y,     sp->err_y);
+			Catalog_set_flt(cat, i, col_err_z,     sp->err_z);
+			Catalog_set_flt(cat, i, col_err_f_sum, err_f_sum);
+		}
+		
+		if(use_wcs)
+		{
+			Catalog_set_flt(cat, i, col_lon,  longitude);
+			Catalog_set_flt(cat, i, col_lat,  latitude);
+			Catalog_set_flt(cat, i, col_spec, spectral);
+		}
+	}
+	
+	// Clean up (globally)
+	free(par);
+	free(order);
+	free(world);
+	WCS_delete(wcs);
+	String_delete(unit_flux_dens);
+	String_delete(unit_flux);
+	String_delete(unit_lon);
+	String_delete(unit_lat);
+	String_delete(unit_spec);
+	String_delete(label_lon);
+	String_delete(label_lat);
+	String_delete(label_spec);
+	String_delete(ucd_lon);
+	String_delete(ucd_lat);
+	String_delete(ucd_spec);
+	String_delete(source_name);
+	
+	return;
+}
+
+
+// ----------------------------------------------------------------- //
+// Measure parameters of a single source                             //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self           - Object self-reference.                     //
+//   (2) mask           - 32-bit mask cube.                          //
+//   (3) index          - Voxel index of source mask.                //
+//   (4) sparse         - Sparse form of the mask. If not NULL, it   //
+//                        will be used instead of the mask cube.     //
+//   (5) par            - Source parameters. Source ID, bounding box //
+//                        and sign of the flux must have been set.   //
+//   (6) buffer         - Pointer to scratch buffer for spectrum,    //
+//                        moment map and kinematic centroids.        //
+//   (7) buffer_size    - Current size of scratch buffer.            //
+//   (8) count_map      - Pointer to scratch buffer for count map.   //
+//   (9) count_map_size - Current size of count map buffer.          //
+//  (10) noise          - Pointer to scratch buffer for noise data.  //
+//  (11) noise_size     - Current size of noise buffer.              //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for measuring the parameters of a single source  //
+//   within its bounding box. The results will be written to par.    //
+//   The bounding box is only traversed once to collect the non-     //
+//   source pixels for the local noise measurement. Source pixels    //
+//   are instead looked up in the voxel index, first to measure all  //
+//   flux-related parameters and positional moments and then again   //
+//   to measure the kinematic major axis once the local noise level  //
+//   is known. If fewer than 2 noise pixels are available, the local //
+//   noise level and all uncertainties will be set to NaN.           //
+//   Flux-related parameters of negative sources will be measured on //
+//   the inverted data and must be inverted again by the caller. The //
+//   scratch buffers will be enlarged as needed and can be reused    //
+//   across multiple calls; they must be released by the caller. The //
+//   method does not modify any shared data and can hence be called  //
+//   concurrently on different sources from multiple threads.        //
+// ----------------------------------------------------------------- //
+
+PRIVATE void DataCube_measure_source(const DataCube *self, const DataCube *mask, const VoxelIndex *index, const SparseMask *sparse, SourcePar *par, double **buffer, size_t *buffer_size, size_t **count_map, size_t *count_map_size, double **noise, size_t *noise_size)
+{
+	const size_t src_id = par->src_id;
+	const size_t x_min = par->x_min;
+	const size_t x_max = par->x_max;
+	const size_t y_min = par->y_min;
+	const size_t y_max = par->y_max;
+	const size_t z_min = par->z_min;
+	const size_t z_max = par->z_max;
+	const bool is_negative = par->is_negative;
+	
+	const size_t nx = x_max - x_min + 1;
+	const size_t ny = y_max - y_min + 1;
+	const size_t nz = z_max - z_min + 1;
+	
+	// Initialise source parameters
+	double rms = 0.0;
+	double pos_x = 0.0;
+	double pos_y = 0.0;
+	double pos_z = 0.0;
+	double f_sum = 0.0;
+	double f_min = INFINITY;
+	double f_max = -INFINITY;
+	double err_x = 0.0;
+	double err_y = 0.0;
+	double err_z = 0.0;
+	
+	// Set up scratch buffers
+	if(*buffer_size < 4 * nz + nx * ny)
+	{
+		*buffer_size = 4 * nz + nx * ny;
+		*buffer = (double *)memory_realloc(*buffer, *buffer_size, sizeof(double));
+	}
+	if(*count_map_size < nx * ny)
+	{
+		*count_map_size = nx * ny;
+		*count_map = (size_t *)memory_realloc(*count_map, *count_map_size, sizeof(size_t));
+	}
+	
+	double *spectrum   = *buffer;
+	double *kpa_cenX   = *buffer + nz;
+	double *kpa_cenY   = *buffer + 2 * nz;
+	double *kpa_sum    = *buffer + 3 * nz;
+	double *moment_map = *buffer + 4 * nz;
+	size_t *counts     = *count_map;
+	size_t kpa_first = z_max - z_min;
+	size_t kpa_last  = 0;
+	size_t kpa_counter = 0;
+	size_t n_noise = 0;
+	
+	for(size_t i = 0; i < nz; ++i) spectrum[i] = 0.0;
+	for(size_t i = 0; i < nx * ny; ++i)
+	{
+		moment_map[i] = 0.0;
+		counts[i] = 0;
+	}
+	
+	double sum_pos = 0.0;
+	
+	// Raw moments of positive pixels relative to bounding box origin
+	size_t n_pos = 0;
+	double sum_x  = 0.0;
+	double sum_y  = 0.0;
+	double sum_z  = 0.0;
+	double sum_xx = 0.0;
+	double sum_yy = 0.0;
+	double sum_zz = 0.0;
+	
+	// Look up source pixels in index
+	size_t first, last;
+	VoxelIndex_get_runs(index, src_id, &first, &last);
+	
+	// Loop over source pixels
+	for(size_t i = first; i < last; ++i)
+	{
+		size_t x0, y, z, length;
+		VoxelIndex_get_run(index, i, &x0, &y, &z, &length);
 		
-		if(physical)
+		for(size_t x = x0; x < x0 + length; ++x)
 		{
-			Source_set_par_flt(src, "f_sum", f_sum * chan_size / beam_area, String_get(unit_flux), "phot.flux");
-			Source_set_par_flt(src, "w20",   w20 * chan_size,               String_get(unit_spec), "spect.line.width");
-			Source_set_par_flt(src, "w50",   w50 * chan_size,               String_get(unit_spec), "spect.line.width");
+			const double value = is_negative ? -DataCube_get_data_flt(self, x, y, z) : DataCube_get_data_flt(self, x, y, z);
+			
+			// ALL PIXELS
+			// Flux
+			f_sum += value;
+			if(f_min > value) f_min = value;
+			if(f_max < value) f_max = value;
+			
+			// Moment map for ellipse fitting
+			moment_map[x - x_min + nx * (y - y_min)] += value;
+			counts    [x - x_min + nx * (y - y_min)] += 1;
+			
+			// Spectrum for line width
+			spectrum[z - z_min] += value;
+			
+			// POSITIVE PIXELS ONLY
+			if(value > 0.0)
+			{
+				// Centroid position
+				pos_x += value * x;
+				pos_y += value * y;
+				pos_z += value * z;
+				sum_pos += value;
+				
+				// Raw moments for positional uncertainties
+				const double dx = (double)(x - x_min);
+				const double dy = (double)(y - y_min);
+				const double dz = (double)(z - z_min);
+				sum_x  += dx;
+				sum_y  += dy;
+				sum_z  += dz;
+				sum_xx += dx * dx;
+				sum_yy += dy * dy;
+				sum_zz += dz * dz;
+				++n_pos;
+			}
 		}
-		else
+	}
+	
+	// Retain non-source pixels in bounding box for RMS measurement
+	for(size_t z = z_min; z <= z_max; ++z)
+	{
+		for(size_t y = y_min; y <= y_max; ++y)
 		{
-			Source_set_par_flt(src, "f_sum", f_sum, String_get(unit_flux_dens), "phot.flux");
-			Source_set_par_flt(src, "w20",   w20,   "pix",                      "spect.line.width");
-			Source_set_par_flt(src, "w50",   w50,   "pix",                      "spect.line.width");
+			// Get runs of row from sparse mask if available
+			const size_t *run_x = NULL;
+			const size_t *run_length = NULL;
+			const int32_t *run_label = NULL;
+			const size_t n_runs = sparse != NULL ? SparseMask_get_row(sparse, y, z, &run_x, &run_length, &run_label) : 0;
+			size_t run = 0;
+			
+			for(size_t x = x_min; x <= x_max; ++x)
+			{
+				if(sparse != NULL)
+				{
+					// Skip pixels covered by runs
+					while(run < n_runs && run_x[run] + run_length[run] <= x) ++run;
+					if(run < n_runs && run_x[run] <= x)
+					{
+						x = run_x[run] + run_length[run] - 1;
+						continue;
+					}
+				}
+				else if(DataCube_get_data_int(mask, x, y, z)) continue;
+				
+				if(n_noise == *noise_size)
+				{
+					*noise_size = *noise_size ? 2 * *noise_size : 1024;
+					*noise = (double *)memory_realloc(*noise, *noise_size, sizeof(double));
+				}
+				(*noise)[n_noise++] = is_negative ? -DataCube_get_data_flt(self, x, y, z) : DataCube_get_data_flt(self, x, y, z);
+			}
 		}
+	}
+	
+	// Finalise centroid
+	pos_x /= sum_pos;
+	pos_y /= sum_pos;
+	pos_z /= sum_pos;
+	
+	// Measure local RMS
+	// NOTE: At least 2 noise pixels are required for a meaningful MAD;
+	//       otherwise rms remains 0 here and is reported as NaN below.
+	const bool rms_valid = n_noise > 1;
+	if(rms_valid) rms = MAD_TO_STD * mad_val_dbl(*noise, n_noise, 0.0, 1, 0);
+	
+	// Derive sum of squared offsets from centroid from raw moments
+	// NOTE: sum((x - c)^2) = sum((x - m)^2) + n (m - c)^2, where m is the
+	//       mean position; the first term is clipped at zero to guard
+	//       against rounding errors.
+	if(n_pos)
+	{
+		const double mean_x = sum_x / n_pos;
+		const double mean_y = sum_y / n_pos;
+		const double mean_z = sum_z / n_pos;
+		const double dev_x = pos_x - x_min - mean_x;
+		const double dev_y = pos_y - y_min - mean_y;
+		const double dev_z = pos_z - z_min - mean_z;
+		err_x = (sum_xx > sum_x * mean_x ? sum_xx - sum_x * mean_x : 0.0) + n_pos * dev_x * dev_x;
+		err_y = (sum_yy > sum_y * mean_y ? sum_yy - sum_y * mean_y : 0.0) + n_pos * dev_y * dev_y;
+		err_z = (sum_zz > sum_z * mean_z ? sum_zz - sum_z * mean_z : 0.0) + n_pos * dev_z * dev_z;
+	}
+	
+	// Determine centroid in each channel from source pixels > 3 sigma
+	for(size_t i = 0; i < nz; ++i)
+	{
+		kpa_cenX[i] = 0.0;
+		kpa_cenY[i] = 0.0;
+		kpa_sum[i] = 0.0;
+	}
+	
+	for(size_t i = first; i < last; ++i)
+	{
+		size_t x0, y, z, length;
+		VoxelIndex_get_run(index, i, &x0, &y, &z, &length);
 		
-		Source_set_par_flt(src, "ell_maj",   ell_maj,   "pix", "phys.angSize");
-		Source_set_par_flt(src, "ell_min",   ell_min,   "pix", "phys.angSize");
-		Source_set_par_flt(src, "ell_pa",    ell_pa,    "deg", "pos.posAng");
-		Source_set_par_flt(src, "ell3s_maj", ell3s_maj, "pix", "phys.angSize");
-		Source_set_par_flt(src, "ell3s_min", ell3s_min, "pix", "phys.angSize");
-		Source_set_par_flt(src, "ell3s_pa",  ell3s_pa,  "deg", "pos.posAng");
-		Source_set_par_flt(src, "kin_pa",    kin_pa,    "deg", "pos.posAng");
-		
-		if(physical)
+		for(size_t x = x0; x < x0 + length; ++x)
 		{
-			Source_set_par_flt(src, "err_x",     err_x * sqrt(beam_area),                 "pix",                 "stat.error;pos.cartesian.x");
-			Source_set_par_flt(src, "err_y",     err_y * sqrt(beam_area),                 "pix",                 "stat.error;pos.cartesian.y");
-			Source_set_par_flt(src, "err_z",     err_z * sqrt(beam_area),                 "pix",                 "stat.error;pos.cartesian.z");
-			Source_set_par_flt(src, "err_f_sum", err_f_sum * chan_size / sqrt(beam_area), String_get(unit_flux), "stat.error;phot.flux");
-		}
-		else
-		{
-			Source_set_par_flt(src, "err_x",     err_x,     "pix",                      "stat.error;pos.cartesian.x");
-			Source_set_par_flt(src, "err_y",     err_y,     "pix",                      "stat.error;pos.cartesian.y");
-			Source_set_par_flt(src, "err_z",     err_z,     "pix",                      "stat.error;pos.cartesian.z");
-			Source_set_par_flt(src, "err_f_sum", err_f_sum, String_get(unit_flux_dens), "stat.error;phot.flux");
+			const double value = is_negative ? -DataCube_get_data_flt(self, x, y, z) : DataCube_get_data_flt(self, x, y, z);
+			
+			if(value > 0.0 && value > 3.0 * rms)
+			{
+				kpa_cenX[z - z_min] += value * x;
+				kpa_cenY[z - z_min] += value * y;
+				kpa_sum [z - z_min] += value;
+			}
 		}
-		
-		if(use_wcs)
+	}
+	
+	for(size_t i = 0; i < nz; ++i)
+	{
+		if(kpa_sum[i] > 0.0)
 		{
-			Source_set_par_flt(src, String_get(label_lon),  longitude, String_get(unit_lon),  String_get(ucd_lon));
-			Source_set_par_flt(src, String_get(label_lat),  latitude,  String_get(unit_lat),  String_get(ucd_lat));
-			Source_set_par_flt(src, String_get(label_spec), spectral,  String_get(unit_spec), String_get(ucd_spec));
+			kpa_cenX[i] /= kpa_sum[i];
+			kpa_cenY[i] /= kpa_sum[i];
+			++kpa_counter;
+			
+			if(kpa_first > i) kpa_first = i;
+			if(kpa_last  < i) kpa_last  = i;
 		}
-		
-		// Clean up (per source)
-		Array_dbl_delete(array_rms);
-		free(spectrum);
-		free(moment_map);
-		free(count_map);
-		
-		free(kpa_cenX);
-		free(kpa_cenY);
-		free(kpa_sum);
 	}
 	
-	// Clean up (globally)
-	WCS_delete(wcs);
-	String_delete(unit_flux_dens);
-	String_delete(unit_flux);
-	String_delete(unit_lon);
-	String_delete(unit_lat);
-	String_delete(unit_spec);
-	String_delete(label_lon);
-	String_delete(label_lat);
-	String_delete(label_spec);
-	String_delete(ucd_lon);
-	String_delete(ucd_lat);
-	String_delete(ucd_spec);
-	String_delete(source_name);
+	// Measure kinematic major axis
+	par->kin_pa = kpa_counter < 2 ? -1.0 : kin_maj_axis_dbl(kpa_cenX, kpa_cenY, kpa_sum, nz, kpa_first, kpa_last);
+	
+	// Ellipse fit to moment-0 map
+	// NOTE: Parameters will remain 0 if the fit cannot be carried out.
+	par->ell_maj   = 0.0;
+	par->ell_min   = 0.0;
+	par->ell_pa    = 0.0;
+	par->ell3s_maj = 0.0;
+	par->ell3s_min = 0.0;
+	par->ell3s_pa  = 0.0;
+	moment_ellipse_fit_dbl(moment_map, counts, nx, ny, pos_x - x_min, pos_y - y_min, rms, &par->ell_maj, &par->ell_min, &par->ell_pa, &par->ell3s_maj, &par->ell3s_min, &par->ell3s_pa);
+	
+	// Determine w20 and w50 from spectrum (moving inwards)
+	spectral_line_width_dbl(spectrum, nz, &par->w20, &par->w50);
+	
+	// Store results
+	par->rms_valid   = rms_valid;
+	par->kpa_counter = kpa_counter;
+	par->rms   = rms_valid ? rms : NAN;
+	par->pos_x = pos_x;
+	par->pos_y = pos_y;
+	par->pos_z = pos_z;
+	par->f_sum = f_sum;
+	par->f_min = f_min;
+	par->f_max = f_max;
+	
+	// Determine positional uncertainties
+	par->err_x = sqrt(err_x) * par->rms / sum_pos;
+	par->err_y = sqrt(err_y) * par->rms / sum_pos;
+	par->err_z = sqrt(err_z) * par->rms / sum_pos;
 	
 	return;
 }
 
 
 
+// ----------------------------------------------------------------- //
+// Compare bounding box volumes of two sources                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) a        - Pointer to first (volume, index) pair.           //
+//   (2) b        - Pointer to second (volume, index) pair.          //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Negative if a is to be sorted before b, positive if a is to be  //
+//   sorted after b.                                                 //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private comparison function for use with qsort(). Sorts pairs   //
+//   of size_t values, consisting of a bounding box volume and a     //
+//   source index, by decreasing volume. Sources of equal volume are //
+//   sorted by increasing index to ensure a well-defined order.      //
+// ----------------------------------------------------------------- //
+
+PRIVATE int DataCube_cmp_volume(const void *a, const void *b)
+{
+	const size_t *pair_a = (const size_t *)a;
+	const size_t *pair_b = (const size_t *)b;
+	
+	if(pair_a[0] != pair_b[0]) return pair_a[0] > pair_b[0] ? -1 : 1;
+	return pair_a[1] < pair_b[1] ? -1 : (pair_a[1] > pair_b[1] ? 1 : 0);
+}
+
+
+
 // ----------------------------------------------------------------- //
 // Extract WCS-related keywords from header                          //
 // ----------------------------------------------------------------- //
@@ -5272,6 +6840,12 @@ PRIVATE void DataCube_create_src_name(const DataCube *self, String **source_name
 //   will contribute to the calculation of the first and second mo-  //
 //   ment maps. This can be useful to prevent large negative signals //
 //   from affecting the moment calculation.                          //
+//   The moment maps are created in a single pass over the data      //
+//   cube, with the xy-plane divided into tiles of MOMENT_TILE_SIZE  //
+//   pixels that are processed in parallel. Moments 1 and 2 are      //
+//   derived from sums of flux and spectral coordinate relative to   //
+//   the central channel, with the spectral coordinate of each       //
+//   channel calculated only once.                                   //
 // ----------------------------------------------------------------- //
 
 PUBLIC void DataCube_create_moments(const DataCube *self, const DataCube *mask, DataCube **mom0, DataCube **mom1, DataCube **mom2, DataCube **chan, const char *obj_name, bool use_wcs, const bool positive)
@@ -5285,6 +6859,236 @@ PUBLIC void DataCube_create_moments(const DataCube *self, const DataCube *mask,
 	ensure(mask->data_type > 0, ERR_USER_INPUT, "Mask must be of integer type.");
 	ensure(self->axis_size[0] == mask->axis_size[0] && self->axis_size[1] == mask->axis_size[1] && self->axis_size[2] == mask->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
 	
+	// Set up moment maps and spectral axis
+	double chan_width, spectral_ref;
+	double *spectral = DataCube_moments_init(self, mom0, mom1, mom2, chan, obj_name, use_wcs, &chan_width, &spectral_ref);
+	
+	const size_t nx = self->axis_size[0];
+	const size_t ny = self->axis_size[1];
+	const size_t nz = self->axis_size[2];
+	
+	// Divide xy-plane into tiles to be processed in parallel
+	const size_t tile_x = nx < MOMENT_TILE_SIZE ? nx : MOMENT_TILE_SIZE;
+	const size_t tile_y = ny < MOMENT_TILE_SIZE ? ny : MOMENT_TILE_SIZE;
+	const size_t n_tiles_x = (nx + tile_x - 1) / tile_x;
+	const size_t n_tiles_y = (ny + tile_y - 1) / tile_y;
+	
+	#pragma omp parallel
+	{
+		// Create per-thread accumulators for one tile
+		double *sum_flux = (double *)memory(MALLOC, tile_x * tile_y, sizeof(double));
+		double *sum_pos  = (double *)memory(MALLOC, tile_x * tile_y, sizeof(double));
+		double *sum_mom1 = (double *)memory(MALLOC, tile_x * tile_y, sizeof(double));
+		double *sum_mom2 = (double *)memory(MALLOC, tile_x * tile_y, sizeof(double));
+		size_t *counter  = (size_t *)memory(MALLOC, tile_x * tile_y, sizeof(size_t));
+		
+		#pragma omp for schedule(dynamic, 1)
+		for(size_t tile = 0; tile < n_tiles_x * n_tiles_y; ++tile)
+		{
+			const size_t x_min = (tile % n_tiles_x) * tile_x;
+			const size_t y_min = (tile / n_tiles_x) * tile_y;
+			const size_t x_max = x_min + tile_x < nx ? x_min + tile_x : nx;
+			const size_t y_max = y_min + tile_y < ny ? y_min + tile_y : ny;
+			const size_t width = x_max - x_min;
+			const size_t n_pix = width * (y_max - y_min);
+			
+			for(size_t i = 0; i < n_pix; ++i)
+			{
+				sum_flux[i] = 0.0;
+				sum_pos[i]  = 0.0;
+				sum_mom1[i] = 0.0;
+				sum_mom2[i] = 0.0;
+				counter[i]  = 0;
+			}
+			
+			// Accumulate all moment sums in a single pass over the tile
+			for(size_t z = 0; z < nz; ++z)
+			{
+				const double offset = spectral[z] - spectral_ref;
+				const bool valid = !isnan(offset);
+				
+				for(size_t y = y_min; y < y_max; ++y)
+				{
+					for(size_t x = x_min; x < x_max; ++x)
+					{
+						if(DataCube_get_data_int(mask, x, y, z))
+						{
+							const double flux = DataCube_get_data_flt(self, x, y, z);
+							const size_t i = (y - y_min) * width + x - x_min;
+							
+							sum_flux[i] += flux;
+							++counter[i];
+							
+							if(valid && (!positive || flux > 0.0))
+							{
+								sum_pos[i]  += flux;
+								sum_mom1[i] += flux * offset;
+								sum_mom2[i] += flux * offset * offset;
+							}
+						}
+					}
+				}
+			}
+			
+			// Write moments of tile into output maps
+			for(size_t y = y_min; y < y_max; ++y)
+			{
+				for(size_t x = x_min; x < x_max; ++x)
+				{
+					const size_t i = (y - y_min) * width + x - x_min;
+					DataCube_moments_set_pixel(*mom0, *mom1, *mom2, *chan, x, y, sum_flux[i], sum_pos[i], sum_mom1[i], sum_mom2[i], counter[i], chan_width, spectral_ref);
+				}
+			}
+		}
+		
+		free(sum_flux);
+		free(sum_pos);
+		free(sum_mom1);
+		free(sum_mom2);
+		free(counter);
+	}
+	
+	// Clean up
+	free(spectral);
+	
+	return;
+}
+
+
+// Same, but for sparse mask //
+
+PUBLIC void DataCube_create_moments_sparse(const DataCube *self, const SparseMask *mask, DataCube **mom0, DataCube **mom1, DataCube **mom2, DataCube **chan, const char *obj_name, bool use_wcs, const bool positive)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(self->data);
+	check_null(mask);
+	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Moment maps only possible with floating-point data.");
+	ensure(self->axis_size[0] == SparseMask_get_axis_size(mask, 0) && self->axis_size[1] == SparseMask_get_axis_size(mask, 1) && self->axis_size[2] == SparseMask_get_axis_size(mask, 2), ERR_USER_INPUT, "Data cube and sparse mask have different sizes.");
+	
+	// Set up moment maps and spectral axis
+	double chan_width, spectral_ref;
+	double *spectral = DataCube_moments_init(self, mom0, mom1, mom2, chan, obj_name, use_wcs, &chan_width, &spectral_ref);
+	
+	const size_t nx = self->axis_size[0];
+	const size_t ny = self->axis_size[1];
+	const size_t nz = self->axis_size[2];
+	
+	// Process rows of the xy-plane in parallel
+	// NOTE: Only the runs of labelled voxels in the sparse mask are
+	//       visited, and the sums of each pixel are accumulated in the
+	//       same order of increasing z as in the dense case.
+	#pragma omp parallel
+	{
+		// Create per-thread accumulators for one row
+		double *sum_flux = (double *)memory(MALLOC, nx, sizeof(double));
+		double *sum_pos  = (double *)memory(MALLOC, nx, sizeof(double));
+		double *sum_mom1 = (double *)memory(MALLOC, nx, sizeof(double));
+		double *sum_mom2 = (double *)memory(MALLOC, nx, sizeof(double));
+		size_t *counter  = (size_t *)memory(MALLOC, nx, sizeof(size_t));
+		
+		#pragma omp for schedule(dynamic, 16)
+		for(size_t y = 0; y < ny; ++y)
+		{
+			for(size_t x = 0; x < nx; ++x)
+			{
+				sum_flux[x] = 0.0;
+				sum_pos[x]  = 0.0;
+				sum_mom1[x] = 0.0;
+				sum_mom2[x] = 0.0;
+				counter[x]  = 0;
+			}
+			
+			// Accumulate all moment sums over the runs of the row
+			for(size_t z = 0; z < nz; ++z)
+			{
+				const size_t *run_x;
+				const size_t *run_length;
+				const int32_t *run_label;
+				const size_t n_runs = SparseMask_get_row(mask, y, z, &run_x, &run_length, &run_label);
+				const double offset = spectral[z] - spectral_ref;
+				const bool valid = !isnan(offset);
+				
+				// Typed pointers to the start of the row in the data cube
+				const float  *row_flt = (const float  *)(self->data) + nx * (y + ny * z);
+				const double *row_dbl = (const double *)(self->data) + nx * (y + ny * z);
+				
+				for(size_t i = 0; i < n_runs; ++i)
+				{
+					for(size_t x = run_x[i]; x < run_x[i] + run_length[i]; ++x)
+					{
+						const double flux = (self->data_type == -32) ? row_flt[x] : row_dbl[x];
+						
+						sum_flux[x] += flux;
+						++counter[x];
+						
+						if(valid && (!positive || flux > 0.0))
+						{
+							sum_pos[x]  += flux;
+							sum_mom1[x] += flux * offset;
+							sum_mom2[x] += flux * offset * offset;
+						}
+					}
+				}
+			}
+			
+			// Write moments of row into output maps
+			for(size_t x = 0; x < nx; ++x) DataCube_moments_set_pixel(*mom0, *mom1, *mom2, *chan, x, y, sum_flux[x], sum_pos[x], sum_mom1[x], sum_mom2[x], counter[x], chan_width, spectral_ref);
+		}
+		
+		free(sum_flux);
+		free(sum_pos);
+		free(sum_mom1);
+		free(sum_mom2);
+		free(counter);
+	}
+	
+	// Clean up
+	free(spectral);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Set up moment maps                                                //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1)  self         - Object self-reference.                      //
+//   (2)  mom0         - Pointer to moment 0 map to be created.      //
+//   (3)  mom1         - Pointer to moment 1 map to be created.      //
+//   (4)  mom2         - Pointer to moment 2 map to be created.      //
+//   (5)  chan         - Pointer to channel map to be created.       //
+//   (6)  obj_name     - Name of the object for OBJECT header entry. //
+//                       If NULL, no OBJECT entry will be created.   //
+//   (7)  use_wcs      - If true, convert channel numbers to WCS.    //
+//   (8)  chan_width   - Will be set to the factor by which moment 0 //
+//                       is to be multiplied.                        //
+//   (9)  spectral_ref - Will be set to the spectral coordinate that //
+//                       the moment sums are taken relative to.      //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Spectral coordinate of each channel.                            //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for creating empty moment and channel maps with  //
+//   the appropriate header entries for the specified data cube, as  //
+//   used by DataCube_create_moments() and its sparse counterpart.   //
+//   Moments 1 and 2 and the channel map will be set to NULL if the  //
+//   cube is not 3-D. The spectral coordinate of each channel is re- //
+//   turned in a newly allocated array which must be freed by the    //
+//   caller. Channels whose WCS conversion failed are set to NaN and //
+//   will not contribute to moments 1 and 2. The reference coordina- //
+//   te is that of the valid channel closest to the central channel, //
+//   or NaN if there is no valid channel.                            //
+// ----------------------------------------------------------------- //
+
+PRIVATE double *DataCube_moments_init(const DataCube *self, DataCube **mom0, DataCube **mom1, DataCube **mom2, DataCube **chan, const char *obj_name, bool use_wcs, double *chan_width, double *spectral_ref)
+{
 	// Is data cube a 2-D image?
 	const bool is_3d = DataCube_get_axis_size(self, 2) > 1;
 	if(!is_3d) warning("Image is not 3D; moments 1 and 2 will not be created.");
@@ -5322,9 +7126,6 @@ PUBLIC void DataCube_create_moments(const DataCube *self, const DataCube *mask,
 	// Create empty moment 0 map
 	*mom0 = DataCube_blank(self->axis_size[0], self->axis_size[1], 1, -32, self->verbosity);
 	
-	// Create additional map containing summed flux for moment 1 and 2 calculations
-	DataCube *sum_pos = NULL;
-	
 	// Copy WCS and other header elements from data cube to moment map
 	Header_copy_wcs(self->header, (*mom0)->header);
 	Header_copy_misc(self->header, (*mom0)->header, true, true);
@@ -5337,9 +7138,6 @@ PUBLIC void DataCube_create_moments(const DataCube *self, const DataCube *mask,
 		*mom1 = DataCube_copy(*mom0);
 		*mom2 = DataCube_copy(*mom0);
 		
-		// Create empty sum map (by copying empty moment 0 map)
-		sum_pos = DataCube_copy(*mom0);
-		
 		// Create empty channel map of 32-bit integer type
 		*chan = DataCube_blank(self->axis_size[0], self->axis_size[1], 1, 32, self->verbosity);
 		Header_copy_wcs(self->header, (*chan)->header);
@@ -5359,99 +7157,92 @@ PUBLIC void DataCube_create_moments(const DataCube *self, const DataCube *mask,
 		*chan = NULL;
 	}
 	
-	// Determine moments 0 and 1
-	for(size_t z = self->axis_size[2]; z--;)
-	{
-		double spectral = z;
-		if(use_wcs) WCS_convertToWorld(wcs, 0, 0, z, NULL, NULL, &spectral);
-		
-		for(size_t y = self->axis_size[1]; y--;)
-		{
-			for(size_t x = self->axis_size[0]; x--;)
-			{
-				if(DataCube_get_data_int(mask, x, y, z))
-				{
-					const double flux = DataCube_get_data_flt(self, x, y, z);
-					DataCube_add_data_flt(*mom0, x, y, 0, flux);
-					
-					if(is_3d)
-					{
-						DataCube_add_data_int(*chan, x, y, 0, 1);
-						
-						if(!positive || flux > 0.0)
-						{
-							DataCube_add_data_flt(*mom1, x, y, 0, flux * spectral);
-							DataCube_add_data_flt(sum_pos, x, y, 0, flux);
-						}
-					}
-				}
-			}
-		}
-	}
-	
-	// If image is 2-D then return, as nothing left to do
-	if(!is_3d) return;
+	// Precompute spectral coordinate of each channel
+	const size_t nz = self->axis_size[2];
+	double *spectral = (double *)memory(MALLOC, nz, sizeof(double));
 	
-	// Otherwise continue with creation of moments 1 and 2
-	// Divide moment 1 by moment 0
-	#pragma omp parallel for collapse(2) schedule(static)
-	for(size_t y = 0; y < self->axis_size[1]; ++y)
-	{
-		for(size_t x = 0; x < self->axis_size[0]; ++x)
-		{
-			const double flux = DataCube_get_data_flt(sum_pos, x, y, 0);
-			if(flux > 0.0) DataCube_set_data_flt(*mom1, x, y, 0, DataCube_get_data_flt(*mom1, x, y, 0) / flux);
-			else DataCube_set_data_flt(*mom1, x, y, 0, NAN);
-		}
-	}
+	if(use_wcs) memcpy(spectral, WCS_get_spectral_axis(wcs, nz), nz * sizeof(double));
+	else for(size_t z = 0; z < nz; ++z) spectral[z] = z;
 	
-	// Determine moment 2
-	for(size_t z = self->axis_size[2]; z--;)
-	{
-		double spectral = z;
-		if(use_wcs) WCS_convertToWorld(wcs, 0, 0, z, NULL, NULL, &spectral);
-		
-		for(size_t y = self->axis_size[1]; y--;)
-		{
-			for(size_t x = self->axis_size[0]; x--;)
-			{
-				if(DataCube_get_data_int(mask, x, y, z))
-				{
-					const double flux = DataCube_get_data_flt(self, x, y, z);
-					
-					if(!positive || flux > 0.0)
-					{
-						const double velo = DataCube_get_data_flt(*mom1, x, y, 0) - spectral;
-						DataCube_add_data_flt(*mom2, x, y, 0, velo * velo * flux);
-					}
-				}
-			}
-		}
-	}
+	// Moment 0 will be multiplied by CDELT3 if requested
+	*chan_width = use_wcs ? fabs(Header_get_flt(self->header, "CDELT3")) : 1.0;
 	
-	// Divide moment 2 by summed flux density and take square root.
-	#pragma omp parallel for collapse(2) schedule(static)
-	for(size_t y = 0; y < self->axis_size[1]; ++y)
+	// Moment sums are taken relative to the valid channel closest to
+	// the central channel to limit rounding errors in moment 2
+	*spectral_ref = NAN;
+	for(size_t i = 0; i < nz && isnan(*spectral_ref); ++i)
 	{
-		for(size_t x = 0; x < self->axis_size[0]; ++x)
-		{
-			// Moment 2
-			const double flux = DataCube_get_data_flt(sum_pos, x, y, 0);
-			const double sigma = DataCube_get_data_flt(*mom2, x, y, 0);
-			if(flux > 0.0 && sigma > 0.0) DataCube_set_data_flt(*mom2, x, y, 0, sqrt(sigma / flux));
-			else DataCube_set_data_flt(*mom2, x, y, 0, NAN);
-		}
+		const size_t z = (i % 2) ? nz / 2 - (i + 1) / 2 : nz / 2 + i / 2;
+		if(z < nz) *spectral_ref = spectral[z];
 	}
 	
-	// Multiply moment 0 by CDELT3 if requested.
-	if(use_wcs) DataCube_multiply_const(*mom0, fabs(Header_get_flt(self->header, "CDELT3")));
-	
 	// Clean up
-	DataCube_delete(sum_pos);
 	WCS_delete(wcs);
 	String_delete(unit_flux_dens);
 	String_delete(unit_spec);
 	
+	return spectral;
+}
+	
+
+
+
+// ----------------------------------------------------------------- //
+// Write moments of a single pixel                                   //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1)  mom0         - Moment 0 map.                               //
+//   (2)  mom1         - Moment 1 map; NULL if cube is not 3-D.      //
+//   (3)  mom2         - Moment 2 map; NULL if cube is not 3-D.      //
+//   (4)  chan         - Channel map; NULL if cube is not 3-D.       //
+//   (5)  x            - x coordinate of the pixel.                  //
+//   (6)  y            - y coordinate of the pixel.                  //
+//   (7)  sum_flux     - Sum of flux of all masked voxels.           //
+//   (8)  sum_pos      - Sum of flux used for moments 1 and 2.       //
+//   (9)  sum_mom1     - Flux-weighted sum of spectral offsets.      //
+//  (10)  sum_mom2     - Flux-weighted sum of squared offsets.       //
+//  (11)  counter      - Number of masked voxels.                    //
+//  (12)  chan_width   - Factor to multiply moment 0 by.             //
+//  (13)  spectral_ref - Spectral coordinate the offsets refer to.   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for deriving the moments of a single pixel from  //
+//   the sums accumulated along the spectral axis and writing them   //
+//   into the moment and channel maps. As the variance is derived as //
+//   the difference of two sums, it is subject to rounding noise     //
+//   even if the true dispersion is zero, e.g. for a single channel. //
+//   Hence, any variance not exceeding MOMENT_SIGMA_TOL times the    //
+//   mean squared offset is treated as zero, and moment 2 is set to  //
+//   NaN, as for a non-positive variance.                            //
+// ----------------------------------------------------------------- //
+
+PRIVATE void DataCube_moments_set_pixel(DataCube *mom0, DataCube *mom1, DataCube *mom2, DataCube *chan, const size_t x, const size_t y, const double sum_flux, const double sum_pos, const double sum_mom1, const double sum_mom2, const size_t counter, const double chan_width, const double spectral_ref)
+{
+	DataCube_set_data_flt(mom0, x, y, 0, sum_flux * chan_width);
+	if(mom1 == NULL) return;
+	
+	DataCube_set_data_int(chan, x, y, 0, counter);
+	
+	if(sum_pos > 0.0)
+	{
+		const double mean   = sum_mom1 / sum_pos;
+		const double second = sum_mom2 / sum_pos;
+		const double sigma  = second - mean * mean;
+		DataCube_set_data_flt(mom1, x, y, 0, spectral_ref + mean);
+		DataCube_set_data_flt(mom2, x, y, 0, sigma > MOMENT_SIGMA_TOL * second ? sqrt(sigma) : NAN);
+	}
+	else
+	{
+		DataCube_set_data_flt(mom1, x, y, 0, NAN);
+		DataCube_set_data_flt(mom2, x, y, 0, NAN);
+	}
+	
 	return;
 }
 
@@ -5471,6 +7262,9 @@ PUBLIC void DataCube_create_moments(const DataCube *self, const DataCube *mask,
 //   (7)  physical  - If true, correct flux for beam solid angle.    //
 //   (8)  margin    - Margin in pixels to be added around each       //
 //                    source. If 0, sources will be cut out exactly. //
+//   (9)  index     - Voxel index of all sources in the mask. Can be //
+//                    NULL, in which case a temporary index will be  //
+//                    created.                                       //
 //                                                                   //
 // Return value:                                                     //
 //                                                                   //
@@ -5483,26 +7277,34 @@ PUBLIC void DataCube_create_moments(const DataCube *self, const DataCube *mask,
 //   will generate cut-outs of the data cube and mask cube around    //
 //   each source and also generate moment maps (0-2) and integrate   //
 //   spectra. All data products will be saved to disc and then de-   //
-//   leted again.                                                    //
-// ----------------------------------------------------------------- //
-
-PUBLIC void DataCube_create_cubelets(const DataCube *self, const DataCube *mask, const Catalog *cat, const char *basename, const bool overwrite, bool use_wcs, bool physical, const size_t margin)
+//   leted again. Masklets and spectra are created from the source   //
+//   pixels recorded in the voxel index.                             //
+//   Sources are passed through a bounded queue of up to CUBELET_-   //
+//   BATCH_SIZE product sets whose total estimated memory footprint  //
+//   does not exceed CUBELET_BATCH_MEMORY, with any source larger    //
+//   than that being admitted only once the queue is empty. Each     //
+//   thread repeatedly either writes the oldest extracted set to     //
+//   disc, as long as fewer than CUBELET_WRITERS threads are writ-   //
+//   ing, or else extracts the products of the next source, so that  //
+//   extraction and output overlap. Each slot carries a lock that is //
+//   held by the thread processing it. A thread with nothing to do   //
+//   blocks on the lock of a slot in progress instead of polling the //
+//   queue, and idle threads are spread across different slots.      //
+// ----------------------------------------------------------------- //
+
+PUBLIC void DataCube_create_cubelets(const DataCube *self, const DataCube *mask, const Catalog *cat, const char *basename, const bool overwrite, bool use_wcs, bool physical, const size_t margin, const VoxelIndex *index)
 {
 	// Sanity checks
 	check_null(self);
 	check_null(self->data);
 	check_null(mask);
-	check_null(mask->data);
+	ensure(index != NULL || mask->data != NULL, ERR_NULL_PTR, "Mask data or voxel index required to create cubelets.");
 	check_null(cat);
 	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Cubelets only possible with floating-point data.");
 	ensure(mask->data_type > 0, ERR_USER_INPUT, "Mask must be of integer type.");
 	ensure(self->axis_size[0] == mask->axis_size[0] && self->axis_size[1] == mask->axis_size[1] && self->axis_size[2] == mask->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
 	ensure(Catalog_get_size(cat), ERR_USER_INPUT, "Empty source catalogue provided.");
 	
-	// Create string for file names
-	String *filename_template = String_append(String_new(basename), "_");
-	String *filename = String_new("");
-	
 	// Extract flux unit from header
 	String *unit_flux_dens = Header_get_string(self->header, "BUNIT");
 	if(String_size(unit_flux_dens) == 0)
@@ -5560,229 +7362,620 @@ PUBLIC void DataCube_create_cubelets(const DataCube *self, const DataCube *mask,
 		else String_set(unit_flux, "Jy");
 	}
 	
-	// Loop over all sources in the catalogue
-	for(size_t i = 0; i < Catalog_get_size(cat); ++i)
+	// Create temporary voxel index if none provided
+	VoxelIndex *index_local = NULL;
+	if(index == NULL)
 	{
-		const Source *src = Catalog_get_source(cat, i);
-		
-		// Get source ID
-		const size_t src_id = Source_get_par_by_name_int(src, "id");
-		ensure(src_id, ERR_USER_INPUT, "Source ID missing from catalogue; cannot create cubelets.");
-		
-		// Get source bounding box
-		size_t x_min = Source_get_par_by_name_int(src, "x_min");
-		size_t x_max = Source_get_par_by_name_int(src, "x_max");
-		size_t y_min = Source_get_par_by_name_int(src, "y_min");
-		size_t y_max = Source_get_par_by_name_int(src, "y_max");
-		size_t z_min = Source_get_par_by_name_int(src, "z_min");
-		size_t z_max = Source_get_par_by_name_int(src, "z_max");
-		ensure(x_min <= x_max && y_min <= y_max && z_min <= z_max, ERR_INDEX_RANGE, "Illegal source bounding box: min > max!");
-		ensure(x_max < self->axis_size[0] && y_max < self->axis_size[1] && z_max < self->axis_size[2], ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
-		
-		// Add margin if requested
-		if(margin)
-		{
-			x_min = margin > x_min ? 0 : x_min - margin;
-			y_min = margin > y_min ? 0 : y_min - margin;
-			z_min = margin > z_min ? 0 : z_min - margin;
-			x_max = x_max + margin < self->axis_size[0] ? x_max + margin : self->axis_size[0] - 1;
-			y_max = y_max + margin < self->axis_size[1] ? y_max + margin : self->axis_size[1] - 1;
-			z_max = z_max + margin < self->axis_size[2] ? z_max + margin : self->axis_size[2] - 1;
-		}
-		
-		const size_t nx = x_max - x_min + 1;
-		const size_t ny = y_max - y_min + 1;
-		const size_t nz = z_max - z_min + 1;
-		
-		// Create empty cubelet
-		DataCube *cubelet = DataCube_blank(nx, ny, nz, self->data_type, self->verbosity);
-		
-		// Copy and adjust header information
-		Header_copy_wcs(self->header, cubelet->header);
-		Header_adjust_wcs_to_subregion(cubelet->header, x_min, x_max, y_min, y_max, z_min, z_max);
-		Header_copy_misc(self->header, cubelet->header, true, true);
-		Header_set_str(cubelet->header, "OBJECT", Source_get_identifier(src));
-		
-		// Create empty masklet
-		DataCube *masklet = DataCube_blank(nx, ny, nz, 8, self->verbosity);
-		
-		// Copy and adjust header information
-		Header_copy_wcs(self->header, masklet->header);
-		Header_adjust_wcs_to_subregion(masklet->header, x_min, x_max, y_min, y_max, z_min, z_max);
-		Header_set_str(masklet->header, "BUNIT", " ");
-		Header_set_str(masklet->header, "OBJECT", Source_get_identifier(src));
-		
-		// Create data array for spectrum
-		double *spectrum = (double *)memory(CALLOC, nz, sizeof(double));
-		size_t *pixcount = (size_t *)memory(CALLOC, nz, sizeof(size_t));
+		index_local = VoxelIndex_new();
+		DataCube_index_catalog(mask, cat, index_local);
+		index = index_local;
+	}
+	
+	// Convert channel numbers to spectral coordinates once for all spectra
+	const double *spectral = use_wcs ? WCS_get_spectral_axis(wcs, self->axis_size[2]) : NULL;
+	
+	// Resolve column handles once
+	const size_t col_id    = Catalog_get_column(cat, "id");
+	const size_t col_x_min = Catalog_get_column(cat, "x_min");
+	const size_t col_x_max = Catalog_get_column(cat, "x_max");
+	const size_t col_y_min = Catalog_get_column(cat, "y_min");
+	const size_t col_y_max = Catalog_get_column(cat, "y_max");
+	const size_t col_z_min = Catalog_get_column(cat, "z_min");
+	const size_t col_z_max = Catalog_get_column(cat, "z_max");
+	
+	// Create slots for the products of the sources in the queue
+	// (spectrum buffers will be reused by subsequent sources)
+	const size_t cat_size = Catalog_get_size(cat);
+	CubeletSet *sets = (CubeletSet *)memory(CALLOC, CUBELET_BATCH_SIZE, sizeof(CubeletSet));
+	
+	// Set up queue state, consisting of a stack of free slots and a
+	// ring buffer of slots with extracted products awaiting output
+	size_t *free_slots = (size_t *)memory(MALLOC, CUBELET_BATCH_SIZE, sizeof(size_t));
+	size_t *ready      = (size_t *)memory(MALLOC, CUBELET_BATCH_SIZE, sizeof(size_t));
+	for(size_t i = 0; i < CUBELET_BATCH_SIZE; ++i) free_slots[i] = CUBELET_BATCH_SIZE - 1 - i;
+	size_t n_free = CUBELET_BATCH_SIZE;
+	size_t ready_first = 0;
+	size_t n_ready = 0;
+	size_t n_writers = 0;       // Number of threads currently writing
+	size_t n_written = 0;       // Number of sources written so far
+	size_t next_row = 0;        // Next catalogue row to be extracted
+	size_t queue_memory = 0;    // Memory held by sets in the queue
+	size_t wait_next = 0;       // Slot from which to search for a set to wait for
+	
+	// Create one lock per slot, held by the thread processing the slot
+	#ifdef _OPENMP
+		for(size_t i = 0; i < CUBELET_BATCH_SIZE; ++i) omp_init_lock(&sets[i].lock);
+	#endif
+	
+	#pragma omp parallel
+	{
+		bool done = false;
 		
-		// Copy data into cubelet, masklet and spectrum
-		for(size_t z = z_min; z <= z_max; ++z)
+		while(!done)
 		{
-			for(size_t y = y_min; y <= y_max; ++y)
+			CubeletSet *set = NULL;
+			CubeletSet *wait = NULL;
+			bool write = false;
+			
+			#pragma omp critical(cubelet_queue)
 			{
-				for(size_t x = x_min; x <= x_max; ++x)
+				if(n_ready && n_writers < CUBELET_WRITERS)
+				{
+					// Take oldest extracted set for output
+					set = sets + ready[ready_first];
+					ready_first = (ready_first + 1) % CUBELET_BATCH_SIZE;
+					--n_ready;
+					++n_writers;
+					write = true;
+				}
+				else if(next_row < cat_size && n_free)
 				{
-					// Cubelet
-					DataCube_set_data_flt(cubelet, x - x_min, y - y_min, z - z_min, DataCube_get_data_flt(self, x, y, z));
+					// Get source ID
+					const size_t src_id = Catalog_get_int(cat, next_row, col_id);
+					ensure(src_id, ERR_USER_INPUT, "Source ID missing from catalogue; cannot create cubelets.");
 					
-					// Masklet
-					const size_t id = DataCube_get_data_int(mask, x, y, z);
-					if(id == src_id)
+					// Get source bounding box
+					size_t x_min = Catalog_get_int(cat, next_row, col_x_min);
+					size_t x_max = Catalog_get_int(cat, next_row, col_x_max);
+					size_t y_min = Catalog_get_int(cat, next_row, col_y_min);
+					size_t y_max = Catalog_get_int(cat, next_row, col_y_max);
+					size_t z_min = Catalog_get_int(cat, next_row, col_z_min);
+					size_t z_max = Catalog_get_int(cat, next_row, col_z_max);
+					ensure(x_min <= x_max && y_min <= y_max && z_min <= z_max, ERR_INDEX_RANGE, "Illegal source bounding box: min > max!");
+					ensure(x_max < self->axis_size[0] && y_max < self->axis_size[1] && z_max < self->axis_size[2], ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
+					
+					// Add margin if requested
+					if(margin)
+					{
+						x_min = margin > x_min ? 0 : x_min - margin;
+						y_min = margin > y_min ? 0 : y_min - margin;
+						z_min = margin > z_min ? 0 : z_min - margin;
+						x_max = x_max + margin < self->axis_size[0] ? x_max + margin : self->axis_size[0] - 1;
+						y_max = y_max + margin < self->axis_size[1] ? y_max + margin : self->axis_size[1] - 1;
+						z_max = z_max + margin < self->axis_size[2] ? z_max + margin : self->axis_size[2] - 1;
+					}
+					
+					// Estimate memory needed for cubelet, masklet, moment maps and spectrum
+					const size_t nx = x_max - x_min + 1;
+					const size_t ny = y_max - y_min + 1;
+					const size_t nz = z_max - z_min + 1;
+					const size_t set_memory = nx * ny * (nz * (self->word_size + 1) + 5 * sizeof(float)) + nz * (sizeof(double) + sizeof(size_t));
+					
+					// Admit source only if within memory limit
+					// (a source exceeding the limit on its own needs an empty queue)
+					if(queue_memory == 0 || queue_memory + set_memory <= CUBELET_BATCH_MEMORY)
+					{
+						set = sets + free_slots[--n_free];
+						set->row    = next_row;
+						set->src_id = src_id;
+						set->x_min  = x_min;
+						set->x_max  = x_max;
+						set->y_min  = y_min;
+						set->y_max  = y_max;
+						set->z_min  = z_min;
+						set->z_max  = z_max;
+						set->memory = set_memory;
+						queue_memory += set_memory;
+						++next_row;
+					}
+				}
+				
+				if(set != NULL)
+				{
+					// Claim slot until processing is finished
+					set->busy = true;
+					#ifdef _OPENMP
+						omp_set_lock(&set->lock);
+					#endif
+				}
+				else
+				{
+					// Nothing to do for now; pick a slot in progress to wait for,
+					// spreading idle threads across different slots
+					for(size_t i = 0; i < CUBELET_BATCH_SIZE && wait == NULL; ++i)
 					{
-						DataCube_set_data_int(masklet, x - x_min, y - y_min, z - z_min, 1);
-						spectrum[z - z_min] += DataCube_get_data_flt(self, x, y, z);
-						pixcount[z - z_min] += 1;
+						const size_t slot = (wait_next + i) % CUBELET_BATCH_SIZE;
+						if(sets[slot].busy)
+						{
+							wait = sets + slot;
+							wait_next = slot + 1;
+						}
 					}
-					else DataCube_set_data_int(masklet, x - x_min, y - y_min, z - z_min, 0);
 				}
+				
+				done = (n_written == cat_size);
 			}
+			
+			if(set == NULL)
+			{
+				// Block until the slot has been processed, then try again
+				#ifdef _OPENMP
+					if(wait != NULL)
+					{
+						omp_set_lock(&wait->lock);
+						omp_unset_lock(&wait->lock);
+					}
+				#endif
+				continue;
+			}
+			
+			if(write)
+			{
+				// Save and release products, then free slot
+				DataCube_save_cubelet(set, basename, overwrite, spectral, String_get(label_spec), String_get(unit_spec), String_get(unit_flux), beam_area);
+				
+				#pragma omp critical(cubelet_queue)
+				{
+					free_slots[n_free++] = set - sets;
+					queue_memory -= set->memory;
+					set->busy = false;
+					--n_writers;
+					++n_written;
+				}
+			}
+			else
+			{
+				// Extract cubelet and create moment maps, then queue for output
+				DataCube_extract_cubelet(self, cat, index, set, use_wcs);
+				
+				#pragma omp critical(cubelet_queue)
+				{
+					ready[(ready_first + n_ready) % CUBELET_BATCH_SIZE] = set - sets;
+					set->busy = false;
+					++n_ready;
+				}
+			}
+			
+			// Release slot and wake up any threads waiting for it
+			#ifdef _OPENMP
+				omp_unset_lock(&set->lock);
+			#endif
 		}
-		
-		// Create moment maps
-		DataCube *mom0;
-		DataCube *mom1;
-		DataCube *mom2;
-		DataCube *chan;
-		DataCube_create_moments(cubelet, masklet, &mom0, &mom1, &mom2, &chan, Source_get_identifier(src), use_wcs, false);
-		
-		// Save output products...
-		// ...cubelet
-		String_set(filename, String_get(filename_template));
-		String_append_int(filename, "%ld", src_id);
-		String_append(filename, "_cube.fits");
-		DataCube_save(cubelet, String_get(filename), overwrite, DESTROY);
-		
-		// ...masklet
-		String_set(filename, String_get(filename_template));
-		String_append_int(filename, "%ld", src_id);
-		String_append(filename, "_mask.fits");
-		DataCube_save(masklet, String_get(filename), overwrite, DESTROY);
-		
-		// ...moment maps
-		if(mom0 != NULL)
-		{
-			String_set(filename, String_get(filename_template));
-			String_append_int(filename, "%ld", src_id);
-			String_append(filename, "_mom0.fits");
-			DataCube_save(mom0, String_get(filename), overwrite, DESTROY);
-		}
-		
-		if(mom1 != NULL)
-		{
-			String_set(filename, String_get(filename_template));
-			String_append_int(filename, "%ld", src_id);
-			String_append(filename, "_mom1.fits");
-			DataCube_save(mom1, String_get(filename), overwrite, DESTROY);
-		}
-		
-		if(mom2 != NULL)
+	}
+	
+	#ifdef _OPENMP
+		for(size_t i = 0; i < CUBELET_BATCH_SIZE; ++i) omp_destroy_lock(&sets[i].lock);
+	#endif
+	
+	// Clean up
+	for(size_t i = 0; i < CUBELET_BATCH_SIZE; ++i)
+	{
+		free(sets[i].spectrum);
+		free(sets[i].pixcount);
+	}
+	free(sets);
+	free(free_slots);
+	free(ready);
+	VoxelIndex_delete(index_local);
+	String_delete(unit_flux_dens);
+	String_delete(unit_flux);
+	String_delete(unit_spec);
+	String_delete(label_spec);
+	WCS_delete(wcs);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Extract cubelet, masklet, spectrum and moments of a single source //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference (data cube).              //
+//   (2) cat       - Source catalogue.                               //
+//   (3) index     - Voxel index of all sources in the mask.         //
+//   (4) set       - Product set holding the source ID and bounding  //
+//                   box on input and the data products on output.   //
+//   (5) use_wcs   - Try to convert channel numbers to WCS?          //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for cutting out the cubelet of a single source   //
+//   and generating its masklet, integrated spectrum and moment maps //
+//   as part of DataCube_create_cubelets(). The method only reads    //
+//   from the data cube and voxel index and writes to the specified  //
+//   product set, so it can be called for different sources in pa-   //
+//   rallel. The spectrum buffers of the set will be enlarged if ne- //
+//   cessary and otherwise reused.                                   //
+// ----------------------------------------------------------------- //
+
+PRIVATE void DataCube_extract_cubelet(const DataCube *self, const Catalog *cat, const VoxelIndex *index, CubeletSet *set, const bool use_wcs)
+{
+	const size_t nx = set->x_max - set->x_min + 1;
+	const size_t ny = set->y_max - set->y_min + 1;
+	const size_t nz = set->z_max - set->z_min + 1;
+	const char *identifier = Catalog_get_identifier(cat, set->row);
+	
+	// Create empty cubelet
+	set->cubelet = DataCube_blank(nx, ny, nz, self->data_type, self->verbosity);
+	
+	// Copy and adjust header information
+	Header_copy_wcs(self->header, set->cubelet->header);
+	Header_adjust_wcs_to_subregion(set->cubelet->header, set->x_min, set->x_max, set->y_min, set->y_max, set->z_min, set->z_max);
+	Header_copy_misc(self->header, set->cubelet->header, true, true);
+	Header_set_str(set->cubelet->header, "OBJECT", identifier);
+	
+	// Create empty masklet
+	set->masklet = DataCube_blank(nx, ny, nz, 8, self->verbosity);
+	
+	// Copy and adjust header information
+	Header_copy_wcs(self->header, set->masklet->header);
+	Header_adjust_wcs_to_subregion(set->masklet->header, set->x_min, set->x_max, set->y_min, set->y_max, set->z_min, set->z_max);
+	Header_set_str(set->masklet->header, "BUNIT", " ");
+	Header_set_str(set->masklet->header, "OBJECT", identifier);
+	
+	// Reset spectrum buffers
+	if(nz > set->capacity)
+	{
+		set->spectrum = (double *)memory_realloc(set->spectrum, nz, sizeof(double));
+		set->pixcount = (size_t *)memory_realloc(set->pixcount, nz, sizeof(size_t));
+		set->capacity = nz;
+	}
+	for(size_t z = 0; z < nz; ++z)
+	{
+		set->spectrum[z] = 0.0;
+		set->pixcount[z] = 0;
+	}
+	
+	// Copy data into cubelet row by row
+	const size_t bytes_per_row = nx * self->word_size;
+	
+	for(size_t z = set->z_min; z <= set->z_max; ++z)
+	{
+		for(size_t y = set->y_min; y <= set->y_max; ++y)
 		{
-			String_set(filename, String_get(filename_template));
-			String_append_int(filename, "%ld", src_id);
-			String_append(filename, "_mom2.fits");
-			DataCube_save(mom2, String_get(filename), overwrite, DESTROY);
+			memcpy(set->cubelet->data + set->cubelet->word_size * DataCube_get_index(set->cubelet, 0, y - set->y_min, z - set->z_min), self->data + self->word_size * DataCube_get_index(self, set->x_min, y, z), bytes_per_row);
 		}
+	}
+	
+	// Fill masklet and spectrum from source pixels
+	size_t first, last;
+	VoxelIndex_get_runs(index, set->src_id, &first, &last);
+	
+	for(size_t j = first; j < last; ++j)
+	{
+		size_t x0, y, z, length;
+		VoxelIndex_get_run(index, j, &x0, &y, &z, &length);
 		
-		if(chan != NULL)
+		for(size_t x = x0; x < x0 + length; ++x)
 		{
-			String_set(filename, String_get(filename_template));
-			String_append_int(filename, "%ld", src_id);
-			String_append(filename, "_chan.fits");
-			DataCube_save(chan, String_get(filename), overwrite, DESTROY);
+			DataCube_set_data_int(set->masklet, x - set->x_min, y - set->y_min, z - set->z_min, 1);
+			set->spectrum[z - set->z_min] += DataCube_get_data_flt(self, x, y, z);
+			set->pixcount[z - set->z_min] += 1;
 		}
-		
-		// ...spectrum
+	}
+	
+	// Create moment maps
+	DataCube_create_moments(set->cubelet, set->masklet, &set->mom0, &set->mom1, &set->mom2, &set->chan, identifier, use_wcs, false);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Save and delete the data products of a single source              //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) set        - Product set to be saved.                       //
+//   (2) basename   - Base name to be used for output files.         //
+//   (3) overwrite  - Replace existing files (true) or not (false)?  //
+//   (4) spectral   - Spectral coordinate of each channel of the     //
+//                    full data cube. If NULL, no spectral column    //
+//                    will be written to the spectrum file. Channels //
+//                    with failed WCS conversion must be NaN.        //
+//   (5) label_spec - Name of the spectral axis.                     //
+//   (6) unit_spec  - Unit of the spectral axis.                     //
+//   (7) unit_flux  - Unit of the integrated flux.                   //
+//   (8) beam_area  - Beam solid angle by which to divide spectrum.  //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for writing the cubelet, masklet, moment maps    //
+//   and integrated spectrum held in the specified product set to    //
+//   disc as part of DataCube_create_cubelets(). All data cubes will //
+//   be deleted again afterwards, while the spectrum buffers will be //
+//   retained for reuse. Different sets can be saved in parallel.    //
+// ----------------------------------------------------------------- //
+
+PRIVATE void DataCube_save_cubelet(CubeletSet *set, const char *basename, const bool overwrite, const double *spectral, const char *label_spec, const char *unit_spec, const char *unit_flux, const double beam_area)
+{
+	// Create base name for all output files of this source
+	String *filename_template = String_append(String_new(basename), "_");
+	String_append_int(filename_template, "%ld", set->src_id);
+	String *filename = String_new("");
+	
+	// Save output products...
+	// ...cubelet
+	String_set(filename, String_get(filename_template));
+	String_append(filename, "_cube.fits");
+	DataCube_save(set->cubelet, String_get(filename), overwrite, DESTROY);
+	
+	// ...masklet
+	String_set(filename, String_get(filename_template));
+	String_append(filename, "_mask.fits");
+	DataCube_save(set->masklet, String_get(filename), overwrite, DESTROY);
+	
+	// ...moment maps
+	if(set->mom0 != NULL)
+	{
+		String_set(filename, String_get(filename_template));
+		String_append(filename, "_mom0.fits");
+		DataCube_save(set->mom0, String_get(filename), overwrite, DESTROY);
+	}
+	
+	if(set->mom1 != NULL)
+	{
+		String_set(filename, String_get(filename_template));
+		String_append(filename, "_mom1.fits");
+		DataCube_save(set->mom1, String_get(filename), overwrite, DESTROY);
+	}
+	
+	if(set->mom2 != NULL)
+	{
+		String_set(filename, String_get(filename_template));
+		String_append(filename, "_mom2.fits");
+		DataCube_save(set->mom2, String_get(filename), overwrite, DESTROY);
+	}
+	
+	if(set->chan != NULL)
+	{
 		String_set(filename, String_get(filename_template));
-		String_append_int(filename, "%ld", src_id);
-		String_append(filename, "_spec.txt");
-		message("Creating text file: %s", strrchr(String_get(filename), '/') == NULL ? String_get(filename) : strrchr(String_get(filename), '/') + 1);
+		String_append(filename, "_chan.fits");
+		DataCube_save(set->chan, String_get(filename), overwrite, DESTROY);
+	}
+	
+	// ...spectrum
+	String_set(filename, String_get(filename_template));
+	String_append(filename, "_spec.txt");
+	message("Creating text file: %s", strrchr(String_get(filename), '/') == NULL ? String_get(filename) : strrchr(String_get(filename), '/') + 1);
+	
+	FILE *fp;
+	if(overwrite) fp = fopen(String_get(filename), "wb");
+	else fp = fopen(String_get(filename), "wxb");
+	ensure(fp != NULL, ERR_FILE_ACCESS, "Failed to open output file: %s", String_get(filename));
+	
+	fprintf(fp, "# Integrated source spectrum\n");
+	fprintf(fp, "# Creator: %s\n", SOFIA_VERSION_FULL);
+	fprintf(fp, "#\n");
+	fprintf(fp, "# Description of columns:\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "# - Channel       Spectral channel number.\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "# - Velocity      Radial velocity corresponding to the channel number as\n");
+	fprintf(fp, "#                 described by the WCS information in the header.\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "# - Frequency     Frequency corresponding to the channel number as described\n");
+	fprintf(fp, "#                 by the WCS information in the header.\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "# - Flux density  Sum of flux density values of all spatial pixels covered\n");
+	fprintf(fp, "#                 by the source in that channel. If the unit is Jy, then\n");
+	fprintf(fp, "#                 the flux density has already been corrected for the solid\n");
+	fprintf(fp, "#                 angle of the beam. If instead the unit is Jy/beam, you\n");
+	fprintf(fp, "#                 will need to manually divide by the beam area which, for\n");
+	fprintf(fp, "#                 Gaussian beams, will be\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "#                   pi * a * b / (4 * ln(2))\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "#                 where a and b are the major and minor axis of the beam in\n");
+	fprintf(fp, "#                 units of pixels.\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "# - Pixels        Number of spatial pixels covered by the source in that\n");
+	fprintf(fp, "#                 channel. This can be used to determine the statistical\n");
+	fprintf(fp, "#                 uncertainty of the summed flux value. Again, this has\n");
+	fprintf(fp, "#                 not yet been corrected for any potential spatial correla-\n");
+	fprintf(fp, "#                 tion of pixels due to the beam solid angle!\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "# Note that a WCS-related column will only be present if WCS conversion was\n");
+	fprintf(fp, "# explicitly requested when running the pipeline.\n");
+	fprintf(fp, "#\n");
+	fprintf(fp, "#\n");
+	if(spectral != NULL)
+	{
+		fprintf(fp, "#%*s%*s%*s%*s\n", 9, "Channel", 18, label_spec, 18, "Flux density", 10, "Pixels");
+		fprintf(fp, "#%*s%*s%*s%*s\n", 9,       "-", 18, unit_spec,  18,      unit_flux, 10,      "-");
+	}
+	else
+	{
+		fprintf(fp, "#%*s%*s%*s\n", 9, "Channel", 18, "Flux density", 10, "Pixels");
+		fprintf(fp, "#%*s%*s%*s\n", 9,       "-", 18,      unit_flux, 10,      "-");
+	}
+	fprintf(fp, "#\n");
+	
+	const size_t nz = set->z_max - set->z_min + 1;
+	
+	for(size_t j = 0; j < nz; ++j)
+	{
+		// Add spectral coordinate if requested and possible
+		if(spectral != NULL) fprintf(fp, "%*zu%*.7e%*.7e%*zu\n", 10, j + set->z_min, 18, spectral[j + set->z_min], 18, set->spectrum[j] / beam_area, 10, set->pixcount[j]);
+		else fprintf(fp, "%*zu%*.7e%*zu\n", 10, j + set->z_min, 18, set->spectrum[j] / beam_area, 10, set->pixcount[j]);
+	}
+	
+	fclose(fp);
+	
+	// Delete output products again
+	DataCube_delete(set->cubelet);
+	DataCube_delete(set->masklet);
+	DataCube_delete(set->mom0);
+	DataCube_delete(set->mom1);
+	DataCube_delete(set->mom2);
+	DataCube_delete(set->chan);
+	set->cubelet = set->masklet = set->mom0 = set->mom1 = set->mom2 = set->chan = NULL;
+	
+	// Clean up
+	String_delete(filename_template);
+	String_delete(filename);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Extract integrated spectra and voxel lists of all sources         //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference (data cube).              //
+//   (2) mask      - Mask cube. Only accessed if index is NULL, so   //
+//                   its data array may have been released.          //
+//   (3) cat       - Source catalogue.                               //
+//   (4) physical  - If true, correct flux for beam solid angle.     //
+//   (5) index     - Voxel index of all sources in the mask. Can be  //
+//                   NULL, in which case a temporary index will be   //
+//                   created.                                        //
+//   (6) spectra   - Pointer to an array of Array_dbl pointers that  //
+//                   will be allocated and filled with one spectrum  //
+//                   per source.                                     //
+//   (7) voxels    - Pointer to an array of Array_siz pointers that  //
+//                   will be allocated and filled with one list of   //
+//                   voxel indices per source.                       //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for extracting the integrated spectrum and the    //
+//   list of voxels of each source in the catalogue, e.g. for stor-  //
+//   age in a database alongside the catalogue. The spectrum covers  //
+//   channels z_min to z_max of the source and is the sum over all   //
+//   source pixels in each channel, divided by the beam solid angle  //
+//   if physical is true, as in the spectra created along with cube- //
+//   lets. The voxels of each source are given as linear indices     //
+//   relative to its bounding box, i.e. (z - z_min) * nx * ny +      //
+//   (y - y_min) * nx + (x - x_min), in ascending order. Both arrays //
+//   will have one entry per catalogue row, and the user will be     //
+//   responsible for deleting the individual arrays and freeing the  //
+//   memory of the two pointer arrays once no longer required.       //
+// ----------------------------------------------------------------- //
+
+PUBLIC void DataCube_get_source_data(const DataCube *self, const DataCube *mask, const Catalog *cat, bool physical, const VoxelIndex *index, Array_dbl ***spectra, Array_siz ***voxels)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(self->data);
+	check_null(mask);
+	check_null(cat);
+	check_null(spectra);
+	check_null(voxels);
+	ensure(index != NULL || mask->data != NULL, ERR_NULL_PTR, "Mask data or voxel index required to extract source data.");
+	ensure(self->data_type == -32 || self->data_type == -64, ERR_USER_INPUT, "Spectra only possible with floating-point data.");
+	ensure(mask->data_type > 0, ERR_USER_INPUT, "Mask must be of integer type.");
+	ensure(self->axis_size[0] == mask->axis_size[0] && self->axis_size[1] == mask->axis_size[1] && self->axis_size[2] == mask->axis_size[2], ERR_USER_INPUT, "Data cube and mask cube have different sizes.");
+	
+	const size_t cat_size = Catalog_get_size(cat);
+	ensure(cat_size, ERR_USER_INPUT, "Empty source catalogue provided.");
+	
+	// Extract beam solid angle in pixels from header
+	double beam_area = 1.0;
+	if(physical)
+	{
+		beam_area = DataCube_get_beam_area(self);
+		if(IS_NAN(beam_area)) beam_area = 1.0;
+	}
+	
+	// Create temporary voxel index if none provided
+	VoxelIndex *index_local = NULL;
+	if(index == NULL)
+	{
+		index_local = VoxelIndex_new();
+		DataCube_index_catalog(mask, cat, index_local);
+		index = index_local;
+	}
+	
+	// Resolve column handles once
+	const size_t col_id    = Catalog_get_column(cat, "id");
+	const size_t col_x_min = Catalog_get_column(cat, "x_min");
+	const size_t col_x_max = Catalog_get_column(cat, "x_max");
+	const size_t col_y_min = Catalog_get_column(cat, "y_min");
+	const size_t col_y_max = Catalog_get_column(cat, "y_max");
+	const size_t col_z_min = Catalog_get_column(cat, "z_min");
+	const size_t col_z_max = Catalog_get_column(cat, "z_max");
+	
+	*spectra = (Array_dbl **)memory(CALLOC, cat_size, sizeof(Array_dbl *));
+	*voxels  = (Array_siz **)memory(CALLOC, cat_size, sizeof(Array_siz *));
+	
+	// Loop over all sources in the catalogue
+	#pragma omp parallel for schedule(dynamic, 16)
+	for(size_t i = 0; i < cat_size; ++i)
+	{
+		// Get source ID and bounding box
+		const size_t src_id = Catalog_get_int(cat, i, col_id);
+		const size_t x_min = Catalog_get_int(cat, i, col_x_min);
+		const size_t x_max = Catalog_get_int(cat, i, col_x_max);
+		const size_t y_min = Catalog_get_int(cat, i, col_y_min);
+		const size_t y_max = Catalog_get_int(cat, i, col_y_max);
+		const size_t z_min = Catalog_get_int(cat, i, col_z_min);
+		const size_t z_max = Catalog_get_int(cat, i, col_z_max);
+		ensure(src_id, ERR_USER_INPUT, "Source ID missing from catalogue; cannot extract spectra.");
+		ensure(x_min <= x_max && y_min <= y_max && z_min <= z_max, ERR_INDEX_RANGE, "Illegal source bounding box: min > max!");
+		ensure(x_max < self->axis_size[0] && y_max < self->axis_size[1] && z_max < self->axis_size[2], ERR_INDEX_RANGE, "Source bounding box outside data cube boundaries.");
 		
-		FILE *fp;
-		if(overwrite) fp = fopen(String_get(filename), "wb");
-		else fp = fopen(String_get(filename), "wxb");
-		ensure(fp != NULL, ERR_FILE_ACCESS, "Failed to open output file: %s", String_get(filename));
+		const size_t nx = x_max - x_min + 1;
+		const size_t ny = y_max - y_min + 1;
+		const size_t nz = z_max - z_min + 1;
 		
-		fprintf(fp, "# Integrated source spectrum\n");
-		fprintf(fp, "# Creator: %s\n", SOFIA_VERSION_FULL);
-		fprintf(fp, "#\n");
-		fprintf(fp, "# Description of columns:\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "# - Channel       Spectral channel number.\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "# - Velocity      Radial velocity corresponding to the channel number as\n");
-		fprintf(fp, "#                 described by the WCS information in the header.\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "# - Frequency     Frequency corresponding to the channel number as described\n");
-		fprintf(fp, "#                 by the WCS information in the header.\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "# - Flux density  Sum of flux density values of all spatial pixels covered\n");
-		fprintf(fp, "#                 by the source in that channel. If the unit is Jy, then\n");
-		fprintf(fp, "#                 the flux density has already been corrected for the solid\n");
-		fprintf(fp, "#                 angle of the beam. If instead the unit is Jy/beam, you\n");
-		fprintf(fp, "#                 will need to manually divide by the beam area which, for\n");
-		fprintf(fp, "#                 Gaussian beams, will be\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "#                   pi * a * b / (4 * ln(2))\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "#                 where a and b are the major and minor axis of the beam in\n");
-		fprintf(fp, "#                 units of pixels.\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "# - Pixels        Number of spatial pixels covered by the source in that\n");
-		fprintf(fp, "#                 channel. This can be used to determine the statistical\n");
-		fprintf(fp, "#                 uncertainty of the summed flux value. Again, this has\n");
-		fprintf(fp, "#                 not yet been corrected for any potential spatial correla-\n");
-		fprintf(fp, "#                 tion of pixels due to the beam solid angle!\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "# Note that a WCS-related column will only be present if WCS conversion was\n");
-		fprintf(fp, "# explicitly requested when running the pipeline.\n");
-		fprintf(fp, "#\n");
-		fprintf(fp, "#\n");
-		if(use_wcs)
-		{
-			fprintf(fp, "#%*s%*s%*s%*s\n", 9, "Channel", 18, String_get(label_spec), 18,        "Flux density", 10, "Pixels");
-			fprintf(fp, "#%*s%*s%*s%*s\n", 9,       "-", 18, String_get(unit_spec),  18, String_get(unit_flux), 10,      "-");
-		}
-		else
-		{
-			fprintf(fp, "#%*s%*s%*s\n", 9, "Channel", 18,        "Flux density", 10, "Pixels");
-			fprintf(fp, "#%*s%*s%*s\n", 9,       "-", 18, String_get(unit_flux), 10,      "-");
-		}
-		fprintf(fp, "#\n");
+		Array_dbl *spectrum = Array_dbl_new(nz);
+		Array_siz *list = Array_siz_new(VoxelIndex_get_npix(index, src_id));
+		size_t counter = 0;
 		
-		for(size_t j = 0; j < nz; ++j)
+		// Sum up source pixels from voxel index
+		size_t first, last;
+		VoxelIndex_get_runs(index, src_id, &first, &last);
+		
+		for(size_t j = first; j < last; ++j)
 		{
-			// Convert z to WCS if requested and possible
-			if(use_wcs)
+			size_t x0, y, z, length;
+			VoxelIndex_get_run(index, j, &x0, &y, &z, &length);
+			
+			for(size_t x = x0; x < x0 + length; ++x)
 			{
-				double spectral = 0.0;
-				WCS_convertToWorld(wcs, 0, 0, j + z_min, NULL, NULL, &spectral);
-				fprintf(fp, "%*zu%*.7e%*.7e%*zu\n", 10, j + z_min, 18, spectral, 18, spectrum[j] / beam_area, 10, pixcount[j]);
+				Array_dbl_add(spectrum, z - z_min, DataCube_get_data_flt(self, x, y, z));
+				Array_siz_set(list, counter++, (z - z_min) * nx * ny + (y - y_min) * nx + (x - x_min));
 			}
-			else fprintf(fp, "%*zu%*.7e%*zu\n", 10, j + z_min, 18, spectrum[j] / beam_area, 10, pixcount[j]);
 		}
 		
-		fclose(fp);
+		// Correct for beam solid angle
+		if(physical) for(size_t j = 0; j < nz; ++j) Array_dbl_set(spectrum, j, Array_dbl_get(spectrum, j) / beam_area);
 		
-		// Delete output products again
-		DataCube_delete(cubelet);
-		DataCube_delete(masklet);
-		DataCube_delete(mom0);
-		DataCube_delete(mom1);
-		DataCube_delete(mom2);
-		DataCube_delete(chan);
-		free(spectrum);
-		free(pixcount);
+		(*spectra)[i] = spectrum;
+		(*voxels)[i]  = Array_siz_sort(list);
 	}
 	
-	// Clean up
-	String_delete(filename_template);
-	String_delete(filename);
-	String_delete(unit_flux_dens);
-	String_delete(unit_flux);
-	String_delete(unit_spec);
-	String_delete(label_spec);
-	WCS_delete(wcs);
+	VoxelIndex_delete(index_local);
 	
 	return;
 }
@@ -45,9 +45,22 @@
 #include "LinkerPar.h"
 #include "Header.h"
 #include "WCS.h"
+#include "VoxelIndex.h"
+#include "FlagIndex.h"
+#include "BitMask.h"
+#include "SparseMask.h"
 
 #define DESTROY  false
 #define PRESERVE true
+#define CUBELET_BATCH_MEMORY 1073741824
+#define CUBELET_BATCH_SIZE   256
+#define CUBELET_WRITERS      4
+#define MOMENT_TILE_SIZE     64
+#define MOMENT_SIGMA_TOL     1.0e-12
+#define DILATION_CELL_SIZE   32
+#define CONTSUB_TILE_SIZE    64
+#define CONTSUB_MAX_ORDER    5
+#define AUTOFLAG_TILE_SIZE   64
 typedef enum {NOISE_STAT_STD, NOISE_STAT_MAD, NOISE_STAT_GAUSS} noise_stat;
 
 
@@ -62,6 +75,8 @@ typedef enum {NOISE_STAT_STD, NOISE_STAT_MAD, NOISE_STAT_GAUSS} noise_stat;
 // ----------------------------------------------------------------- //
 
 typedef CLASS DataCube DataCube;
+typedef struct SourcePar SourcePar;
+typedef struct CubeletSet CubeletSet;
 
 // Constructor and destructor
 PUBLIC DataCube  *DataCube_new              (const bool verbosity);
@@ -116,7 +131,7 @@ PUBLIC double     DataCube_stat_mad         (const DataCube *self, const double
 PUBLIC double     DataCube_stat_gauss       (const DataCube *self, const size_t cadence, const int range);
 
 // Noise scaling
-PUBLIC void       DataCube_scale_noise_spec (const DataCube *self, const noise_stat statistic, const int range);
+PUBLIC Array_dbl *DataCube_scale_noise_spec (const DataCube *self, const noise_stat statistic, const int range);
 PUBLIC DataCube  *DataCube_scale_noise_local(DataCube *self, const noise_stat statistic, const int range, size_t window_spat, size_t window_spec, size_t grid_spat, size_t grid_spec, const bool interpolate);
 
 // Spatial and spectral smoothing
@@ -129,35 +144,43 @@ PUBLIC void       DataCube_spatial_filter   (DataCube *self, const int statistic
 
 // Masking
 PUBLIC void       DataCube_mask             (const DataCube *self, DataCube *maskCube, const double threshold);
-PUBLIC void       DataCube_mask_8           (const DataCube *self, DataCube *maskCube, const double threshold, const uint8_t value);
+PUBLIC void       DataCube_mask_bits        (const DataCube *self, BitMask *mask, const double threshold);
 PUBLIC void       DataCube_set_masked       (DataCube *self, const DataCube *maskCube, const double value);
-PUBLIC void       DataCube_set_masked_8     (DataCube *self, const DataCube *maskCube, const double value);
+PUBLIC void       DataCube_set_masked_bits  (DataCube *self, const BitMask *mask, const double value);
 PUBLIC void       DataCube_reset_mask_32    (DataCube *self, const int32_t value);
-PUBLIC void       DataCube_filter_mask_32   (DataCube *self, const Map *filter);
+PUBLIC void       DataCube_filter_mask_32   (DataCube *self, const Map *filter, VoxelIndex *index);
 PUBLIC size_t     DataCube_copy_mask_32     (DataCube *self, const DataCube *source, const int32_t value);
-PUBLIC void       DataCube_dilate_mask_xy   (const DataCube *self, DataCube *mask, Catalog *cat, const size_t iter_max, const double threshold);
-PUBLIC void       DataCube_dilate_mask_z    (const DataCube *self, DataCube *mask, Catalog *cat, const size_t iter_max, const double threshold);
+PUBLIC size_t     DataCube_copy_bitmask     (DataCube *self, const BitMask *mask, const int32_t value);
+PUBLIC SparseMask *DataCube_to_sparse_mask  (DataCube *self);
+PUBLIC void       DataCube_from_sparse_mask (DataCube *self, const SparseMask *mask);
+PUBLIC void       DataCube_save_sparse_mask (const DataCube *self, const SparseMask *mask, const char *filename, const bool overwrite);
+PUBLIC void       DataCube_dilate_mask_xy   (const DataCube *self, DataCube *mask, Catalog *cat, const size_t iter_max, const double threshold, VoxelIndex *index);
+PUBLIC void       DataCube_dilate_mask_z    (const DataCube *self, DataCube *mask, Catalog *cat, const size_t iter_max, const double threshold, VoxelIndex *index);
 PUBLIC DataCube  *DataCube_2d_mask          (const DataCube *self);
+PUBLIC DataCube  *DataCube_2d_sparse_mask   (const DataCube *self, const SparseMask *mask);
 
 // Flagging
 PUBLIC void       DataCube_flag_regions     (DataCube *self, const Array_siz *region);
+PUBLIC void       DataCube_apply_flags      (DataCube *self, const FlagIndex *flags);
 PUBLIC void       DataCube_copy_blanked     (DataCube *self, const DataCube *source);
 PUBLIC void       DataCube_autoflag         (const DataCube *self, const double threshold, const unsigned int mode, Array_siz *region);
 PUBLIC size_t     DataCube_flag_infinity    (const DataCube *self, Array_siz *region);
 
 // Source finding
-PUBLIC void       DataCube_run_scfind       (const DataCube *self, DataCube *maskCube, const Array_dbl *kernels_spat, const Array_siz *kernels_spec, const double threshold, const double maskScaleXY, const noise_stat method, const int range, const int scaleNoise, const noise_stat snStatistic, const int snRange, const size_t snWindowXY, const size_t snWindowZ, const size_t snGridXY, const size_t snGridZ, const bool snInterpol, const time_t start_time, const clock_t start_clock);
-PUBLIC void       DataCube_run_threshold    (const DataCube *self, DataCube *maskCube, const bool absolute, double threshold, const noise_stat method, const int range);
+PUBLIC void       DataCube_run_scfind       (const DataCube *self, BitMask *mask, const Array_dbl *kernels_spat, const Array_siz *kernels_spec, const double threshold, const double maskScaleXY, const noise_stat method, const int range, const int scaleNoise, const noise_stat snStatistic, const int snRange, const size_t snWindowXY, const size_t snWindowZ, const size_t snGridXY, const size_t snGridZ, const bool snInterpol, const time_t start_time, const clock_t start_clock);
+PUBLIC void       DataCube_run_threshold    (const DataCube *self, BitMask *mask, const bool absolute, double threshold, const noise_stat method, const int range);
 
 // Linking
-PUBLIC LinkerPar *DataCube_run_linker       (const DataCube *self, DataCube *mask, const size_t radius_x, const size_t radius_y, const size_t radius_z, const size_t min_size_x, const size_t min_size_y, const size_t min_size_z, const size_t max_size_x, const size_t max_size_y, const size_t max_size_z, const bool positivity, const double rms);
+PUBLIC LinkerPar *DataCube_run_linker       (const DataCube *self, DataCube *mask, const size_t radius_x, const size_t radius_y, const size_t radius_z, const size_t min_size_x, const size_t min_size_y, const size_t min_size_z, const size_t max_size_x, const size_t max_size_y, const size_t max_size_z, const bool positivity, const double rms, VoxelIndex **index);
 
 // Parameterisation
-PUBLIC void       DataCube_parameterise     (const DataCube *self, const DataCube *mask, Catalog *cat, bool use_wcs, bool physical, const char *prefix);
+PUBLIC void       DataCube_parameterise     (const DataCube *self, const DataCube *mask, Catalog *cat, bool use_wcs, bool physical, const char *prefix, const VoxelIndex *index, const SparseMask *sparse);
 
 // Create moment maps and cubelets
 PUBLIC void       DataCube_create_moments   (const DataCube *self, const DataCube *mask, DataCube **mom0, DataCube **mom1, DataCube **mom2, DataCube **chan, const char *obj_name, bool use_wcs, const bool positive);
-PUBLIC void       DataCube_create_cubelets  (const DataCube *self, const DataCube *mask, const Catalog *cat, const char *basename, const bool overwrite, bool use_wcs, bool physical, const size_t margin);
+PUBLIC void       DataCube_create_moments_sparse(const DataCube *self, const SparseMask *mask, DataCube **mom0, DataCube **mom1, DataCube **mom2, DataCube **chan, const char *obj_name, bool use_wcs, const bool positive);
+PUBLIC void       DataCube_create_cubelets  (const DataCube *self, const DataCube *mask, const Catalog *cat, const char *basename, const bool overwrite, bool use_wcs, bool physical, const size_t margin, const VoxelIndex *index);
+PUBLIC void       DataCube_get_source_data  (const DataCube *self, const DataCube *mask, const Catalog *cat, bool physical, const VoxelIndex *index, Array_dbl ***spectra, Array_siz ***voxels);
 
 // WCS
 PUBLIC WCS       *DataCube_extract_wcs      (const DataCube *self);
@@ -165,11 +188,23 @@ PUBLIC WCS       *DataCube_extract_wcs      (const DataCube *self);
 // Private methods
 PRIVATE inline size_t DataCube_get_index       (const DataCube *self, const size_t x, const size_t y, const size_t z);
 PRIVATE        void   DataCube_get_xyz         (const DataCube *self, const size_t index, size_t *x, size_t *y, size_t *z);
-PRIVATE        void   DataCube_process_stack   (const DataCube *self, DataCube *mask, Stack *stack, const size_t radius_x, const size_t radius_y, const size_t radius_z, const int32_t label, LinkerPar *lpar, const double rms);
-PRIVATE        void   DataCube_grow_mask_xy    (const DataCube *self, DataCube *mask, const long int src_id, const size_t radius, const long int mask_value, double *f_sum, double *f_min, double *f_max, size_t *n_pix, long int *flag, size_t *x_min, size_t *x_max, size_t *y_min, size_t *y_max, const size_t z_min, const size_t z_max);
+PRIVATE        bool   DataCube_contsub_spectrum(double *spectrum, const size_t nz, const unsigned int order, const size_t shift, const size_t padding, const double threshold, const double *powers, const double *moments, double *work, double *scratch);
+PRIVATE        void   DataCube_process_stack   (const DataCube *self, DataCube *mask, Stack *stack, const size_t radius_x, const size_t radius_y, const size_t radius_z, const int32_t label, LinkerPar *lpar, const double rms, VoxelIndex *index_runs);
+PRIVATE        void   DataCube_index_region    (const DataCube *self, VoxelIndex *index, const long int label, const size_t x_min, const size_t x_max, const size_t y_min, const size_t y_max, const size_t z_min, const size_t z_max);
+PRIVATE        void   DataCube_index_catalog   (const DataCube *self, const Catalog *cat, VoxelIndex *index);
+PRIVATE        void   DataCube_index_append    (const DataCube *self, VoxelIndex *index, const size_t *voxels, const size_t n_voxels);
+PRIVATE        size_t DataCube_schedule_dilation(const DataCube *self, const Catalog *cat, const size_t grow_xy, const size_t grow_z, size_t *order, size_t *wave_start);
+PRIVATE        int    DataCube_cmp_index       (const void *a, const void *b);
+PRIVATE        void   DataCube_fill_flags      (DataCube *self, const FlagIndex *flags);
+PRIVATE        void   DataCube_measure_source  (const DataCube *self, const DataCube *mask, const VoxelIndex *index, const SparseMask *sparse, SourcePar *par, double **buffer, size_t *buffer_size, size_t **count_map, size_t *count_map_size, double **noise, size_t *noise_size);
+PRIVATE        void   DataCube_extract_cubelet (const DataCube *self, const Catalog *cat, const VoxelIndex *index, CubeletSet *set, const bool use_wcs);
+PRIVATE        void   DataCube_save_cubelet    (CubeletSet *set, const char *basename, const bool overwrite, const double *spectral, const char *label_spec, const char *unit_spec, const char *unit_flux, const double beam_area);
+PRIVATE        int    DataCube_cmp_volume      (const void *a, const void *b);
 PRIVATE        double DataCube_get_beam_area   (const DataCube *self);
 PRIVATE        void   DataCube_get_wcs_info    (const DataCube *self, String **unit_flux_dens, String **unit_flux, String **label_lon, String **label_lat, String **label_spec, String **ucd_lon, String **ucd_lat, String **ucd_spec, String **unit_lon, String **unit_lat, String **unit_spec, double *beam_area, double *chan_size);
 PRIVATE        void   DataCube_create_src_name (const DataCube *self, String **source_name, const char *prefix, const double longitude, const double latitude, const String *label_lon);
+PRIVATE        double *DataCube_moments_init   (const DataCube *self, DataCube **mom0, DataCube **mom1, DataCube **mom2, DataCube **chan, const char *obj_name, bool use_wcs, double *chan_width, double *spectral_ref);
+PRIVATE        void   DataCube_moments_set_pixel(DataCube *mom0, DataCube *mom1, DataCube *mom2, DataCube *chan, const size_t x, const size_t y, const double sum_flux, const double sum_pos, const double sum_mom1, const double sum_mom2, const size_t counter, const double chan_width, const double spectral_ref);
 PRIVATE        void   DataCube_swap_byte_order (const DataCube *self);
 
 // TEST
@@ -0,0 +1,398 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (FlagIndex.c) - Source Finding Application               ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "FlagIndex.h"
+
+
+
+// ----------------------------------------------------------------- //
+// Declaration of properties of class FlagIndex                      //
+// ----------------------------------------------------------------- //
+
+CLASS FlagIndex
+{
+	size_t  size[3];
+	size_t *plane;
+	size_t  n_lists;
+	size_t *offset;
+	size_t *interval;
+};
+
+
+
+// ----------------------------------------------------------------- //
+// Standard constructor                                              //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) size_x   - Size of the cube in x.                           //
+//   (2) size_y   - Size of the cube in y.                           //
+//   (3) size_z   - Size of the cube in z.                           //
+//   (4) region   - Array containing the regions to be flagged. Must //
+//                  be of the form x_min, x_max, y_min, y_max,       //
+//                  z_min, z_max, ... where the boundaries are in-   //
+//                  clusive.                                         //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Pointer to newly created FlagIndex object.                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Standard constructor. Will create a new FlagIndex object from   //
+//   the specified flagging regions. Regions extending beyond the    //
+//   boundaries of the cube will first be adjusted as described for  //
+//   FlagIndex_clip_region(). The spectral axis is then divided into //
+//   slabs within which the set of regions is constant. In each      //
+//   slab, the flagged pixels of each row are merged into a sorted   //
+//   list of disjoint intervals. Slabs with identical lists share    //
+//   the same list. Note that the destructor will need to be called  //
+//   explicitly once the object is no longer required to release any //
+//   memory allocated during the lifetime of the object.             //
+// ----------------------------------------------------------------- //
+
+PUBLIC FlagIndex *FlagIndex_new(const size_t size_x, const size_t size_y, const size_t size_z, const Array_siz *region)
+{
+	// Sanity checks
+	check_null(region);
+	ensure(size_x && size_y && size_z, ERR_USER_INPUT, "Cannot create flagging index for empty cube.");
+	const size_t size = Array_siz_get_size(region);
+	ensure(size % 6 == 0, ERR_USER_INPUT, "Flagging regions must contain a multiple of 6 entries.");
+	
+	FlagIndex *self = (FlagIndex *)memory(MALLOC, 1, sizeof(FlagIndex));
+	
+	self->size[0]  = size_x;
+	self->size[1]  = size_y;
+	self->size[2]  = size_z;
+	self->plane    = (size_t *)memory(MALLOC, size_z, sizeof(size_t));
+	self->n_lists  = 0;
+	self->offset   = (size_t *)memory(MALLOC, 1, sizeof(size_t));
+	self->interval = NULL;
+	
+	self->offset[0] = 0;
+	for(size_t z = 0; z < size_z; ++z) self->plane[z] = SIZE_MAX;
+	
+	const size_t n_reg = size / 6;
+	if(n_reg == 0) return self;
+	
+	// Adjust boundaries of all regions
+	size_t *bounds = (size_t *)memory(MALLOC, size, sizeof(size_t));
+	for(size_t i = 0; i < size; ++i) bounds[i] = Array_siz_get(region, i);
+	for(size_t i = 0; i < n_reg; ++i) FlagIndex_clip_region(self, bounds + 6 * i);
+	
+	// Sort regions by z_min (pairs of z_min and region index)
+	size_t *by_z = (size_t *)memory(MALLOC, 2 * n_reg, sizeof(size_t));
+	for(size_t i = 0; i < n_reg; ++i)
+	{
+		by_z[2 * i]     = bounds[6 * i + 4];
+		by_z[2 * i + 1] = i;
+	}
+	qsort(by_z, n_reg, 2 * sizeof(size_t), FlagIndex_cmp_interval);
+	
+	// Slab boundaries where the set of regions changes
+	size_t *breaks = (size_t *)memory(MALLOC, 4 * n_reg, sizeof(size_t));
+	for(size_t i = 0; i < n_reg; ++i)
+	{
+		breaks[4 * i]     = bounds[6 * i + 4];
+		breaks[4 * i + 1] = 0;
+		breaks[4 * i + 2] = bounds[6 * i + 5] + 1;
+		breaks[4 * i + 3] = 0;
+	}
+	qsort(breaks, 2 * n_reg, 2 * sizeof(size_t), FlagIndex_cmp_interval);
+	
+	size_t n_breaks = 1;
+	for(size_t i = 1; i < 2 * n_reg; ++i) if(breaks[2 * i] != breaks[2 * (n_breaks - 1)]) breaks[2 * n_breaks++] = breaks[2 * i];
+	
+	// Active regions and row intervals (y, x_min, x_max) of current slab
+	size_t *active = (size_t *)memory(MALLOC, n_reg, sizeof(size_t));
+	size_t n_active = 0;
+	size_t next = 0;
+	size_t *rows = NULL;
+	size_t rows_size = 0;
+	size_t capacity = 0;
+	
+	// Loop over slabs
+	for(size_t k = 0; k + 1 < n_breaks; ++k)
+	{
+		const size_t z_min = breaks[2 * k];
+		const size_t z_max = breaks[2 * k + 2] - 1;
+		
+		// Update active regions
+		size_t n_keep = 0;
+		for(size_t i = 0; i < n_active; ++i) if(bounds[6 * active[i] + 5] >= z_min) active[n_keep++] = active[i];
+		n_active = n_keep;
+		while(next < n_reg && by_z[2 * next] <= z_min) active[n_active++] = by_z[2 * next++ + 1];
+		if(n_active == 0) continue;
+		
+		// Collect row intervals of active regions
+		size_t n_rows = 0;
+		for(size_t i = 0; i < n_active; ++i) n_rows += bounds[6 * active[i] + 3] - bounds[6 * active[i] + 2] + 1;
+		
+		if(n_rows > rows_size)
+		{
+			rows_size = n_rows;
+			rows = (size_t *)memory_realloc(rows, 3 * rows_size, sizeof(size_t));
+		}
+		
+		n_rows = 0;
+		for(size_t i = 0; i < n_active; ++i)
+		{
+			const size_t *box = bounds + 6 * active[i];
+			for(size_t y = box[2]; y <= box[3]; ++y)
+			{
+				rows[3 * n_rows]     = y;
+				rows[3 * n_rows + 1] = box[0];
+				rows[3 * n_rows + 2] = box[1];
+				++n_rows;
+			}
+		}
+		
+		// Sort by y and x_min, then merge overlapping or adjacent intervals
+		qsort(rows, n_rows, 3 * sizeof(size_t), FlagIndex_cmp_interval);
+		
+		size_t n_merged = 0;
+		for(size_t i = 0; i < n_rows; ++i)
+		{
+			if(n_merged && rows[3 * n_merged - 3] == rows[3 * i] && rows[3 * i + 1] <= rows[3 * n_merged - 1] + 1)
+			{
+				if(rows[3 * i + 2] > rows[3 * n_merged - 1]) rows[3 * n_merged - 1] = rows[3 * i + 2];
+			}
+			else
+			{
+				memmove(rows + 3 * n_merged, rows + 3 * i, 3 * sizeof(size_t));
+				++n_merged;
+			}
+		}
+		
+		// Reuse existing list if identical
+		size_t list = 0;
+		while(list < self->n_lists && (self->offset[list + 1] - self->offset[list] != n_merged || memcmp(self->interval + 3 * self->offset[list], rows, 3 * n_merged * sizeof(size_t)) != 0)) ++list;
+		
+		if(list == self->n_lists)
+		{
+			// Append new list
+			const size_t n_total = self->offset[list] + n_merged;
+			if(n_total > capacity)
+			{
+				capacity = n_total > 2 * capacity ? n_total : 2 * capacity;
+				self->interval = (size_t *)memory_realloc(self->interval, 3 * capacity, sizeof(size_t));
+			}
+			memcpy(self->interval + 3 * self->offset[list], rows, 3 * n_merged * sizeof(size_t));
+			
+			self->offset = (size_t *)memory_realloc(self->offset, list + 2, sizeof(size_t));
+			self->offset[list + 1] = n_total;
+			++self->n_lists;
+		}
+		
+		for(size_t z = z_min; z <= z_max; ++z) self->plane[z] = list;
+	}
+	
+	// Clean up
+	free(bounds);
+	free(by_z);
+	free(breaks);
+	free(active);
+	free(rows);
+	
+	return self;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Destructor                                                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Destructor. Note that the destructor must be called explicitly  //
+//   if the object is no longer required. This will release the me-  //
+//   mory occupied by the object.                                    //
+// ----------------------------------------------------------------- //
+
+PUBLIC void FlagIndex_delete(FlagIndex *self)
+{
+	if(self != NULL)
+	{
+		free(self->plane);
+		free(self->offset);
+		free(self->interval);
+	}
+	free(self);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return size of cube along specified axis                          //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) axis     - Axis (0, 1 or 2) for which to return the size.   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Size of the cube along the specified axis.                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the size of the cube for which the  //
+//   flagging index was created along the specified axis.            //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t FlagIndex_get_axis_size(const FlagIndex *self, const size_t axis)
+{
+	check_null(self);
+	ensure(axis < 3, ERR_INDEX_RANGE, "Axis must be 0, 1 or 2.");
+	return self->size[axis];
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return flagged intervals of a spectral channel                    //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) z        - Spectral channel.                                //
+//   (3) interval - Pointer to be set to the first interval.         //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of flagged intervals in the specified channel.           //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for retrieving the flagged pixels of the speci-   //
+//   fied channel. The intervals are stored as consecutive triplets  //
+//   of y, x_min and x_max (inclusive), sorted by y and x_min, and   //
+//   do not overlap. If the channel contains no flags, 0 will be     //
+//   returned and the interval pointer set to NULL.                  //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t FlagIndex_get_plane(const FlagIndex *self, const size_t z, const size_t **interval)
+{
+	check_null(self);
+	ensure(z < self->size[2], ERR_INDEX_RANGE, "Channel index out of range.");
+	
+	const size_t list = self->plane[z];
+	
+	if(list == SIZE_MAX)
+	{
+		*interval = NULL;
+		return 0;
+	}
+	
+	*interval = self->interval + 3 * self->offset[list];
+	return self->offset[list + 1] - self->offset[list];
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Adjust flagging region to boundaries of cube                      //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) bounds   - Region of the form x_min, x_max, y_min, y_max,   //
+//                  z_min, z_max to be adjusted in place.            //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for adjusting the boundaries of a flagging region //
+//   extending beyond the boundaries of the cube. Upper bounds are   //
+//   limited to the cube size, while lower bounds exceeding the up-  //
+//   per bound are set to the upper bound.                           //
+// ----------------------------------------------------------------- //
+
+PUBLIC void FlagIndex_clip_region(const FlagIndex *self, size_t *bounds)
+{
+	check_null(self);
+	check_null(bounds);
+	
+	for(size_t i = 0; i < 3; ++i)
+	{
+		if(bounds[2 * i + 1] >= self->size[i]) bounds[2 * i + 1] = self->size[i] - 1;
+		if(bounds[2 * i] > bounds[2 * i + 1]) bounds[2 * i] = bounds[2 * i + 1];
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Compare two records by their first and second element             //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) a        - Pointer to first record of size_t values.        //
+//   (2) b        - Pointer to second record of size_t values.       //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   -1, 0 or 1 if a is less than, equal to or greater than b.       //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private comparison function for qsort() to sort records of two  //
+//   or more size_t values lexicographically by their first and sec- //
+//   ond element.                                                    //
+// ----------------------------------------------------------------- //
+
+PRIVATE int FlagIndex_cmp_interval(const void *a, const void *b)
+{
+	const size_t *rec_a = (const size_t *)a;
+	const size_t *rec_b = (const size_t *)b;
+	
+	if(rec_a[0] != rec_b[0]) return rec_a[0] < rec_b[0] ? -1 : 1;
+	return rec_a[1] < rec_b[1] ? -1 : (rec_a[1] > rec_b[1] ? 1 : 0);
+}
@@ -0,0 +1,66 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (FlagIndex.h) - Source Finding Application               ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#ifndef FLAGINDEX_H
+#define FLAGINDEX_H
+
+#include "common.h"
+#include "Array_siz.h"
+
+
+// ----------------------------------------------------------------- //
+// Class 'FlagIndex'                                                 //
+// ----------------------------------------------------------------- //
+// The purpose of this class is to provide a normalised representa-  //
+// tion of a list of (possibly overlapping) flagging regions. For    //
+// each spectral channel, the flagged pixels are stored as a sorted  //
+// list of disjoint intervals (y, x_min, x_max) along the x-axis.    //
+// Channels with identical flags share the same list, such that the  //
+// index remains compact for typical combinations of flagged chan-   //
+// nels and pixels. Once created, the index can be applied to any    //
+// data, noise or mask cube of the same size.                        //
+// ----------------------------------------------------------------- //
+
+typedef CLASS FlagIndex FlagIndex;
+
+// Constructor and destructor
+PUBLIC FlagIndex   *FlagIndex_new           (const size_t size_x, const size_t size_y, const size_t size_z, const Array_siz *region);
+PUBLIC void         FlagIndex_delete        (FlagIndex *self);
+
+// Public methods
+PUBLIC size_t       FlagIndex_get_axis_size (const FlagIndex *self, const size_t axis);
+PUBLIC size_t       FlagIndex_get_plane     (const FlagIndex *self, const size_t z, const size_t **interval);
+PUBLIC void         FlagIndex_clip_region   (const FlagIndex *self, size_t *bounds);
+
+// Private methods
+PRIVATE int         FlagIndex_cmp_interval  (const void *a, const void *b);
+
+#endif
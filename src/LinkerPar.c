@@ -40,11 +40,15 @@
 #endif
 
 #include "LinkerPar.h"
+#include "PointGrid.h"
 #include "String.h"
 
 // Set to 1 if measurement of flux-weighted centroid required
 #define MEASURE_CENTROID_POSITION 0
 
+// Number of sources processed per block in kernel density estimation
+#define KERNEL_BLOCK_SIZE 256
+
 
 
 // ----------------------------------------------------------------- //
@@ -585,8 +589,24 @@ PUBLIC Catalog *LinkerPar_make_catalog(const LinkerPar *self, const Map *filter,
 	// Check if reliability filtering requested
 	const bool remove_unreliable = filter != NULL && Map_get_size(filter);
 	
-	// Create an empty source catalogue
+	// Create an empty source catalogue and define its columns
 	Catalog *cat = Catalog_new();
+	const size_t col_id    = Catalog_add_column(cat, "id",    SOURCE_TYPE_INT, "",        "meta.id");
+	const size_t col_x     = Catalog_add_column(cat, "x",     SOURCE_TYPE_FLT, "pix",     "pos.cartesian.x");
+	const size_t col_y     = Catalog_add_column(cat, "y",     SOURCE_TYPE_FLT, "pix",     "pos.cartesian.y");
+	const size_t col_z     = Catalog_add_column(cat, "z",     SOURCE_TYPE_FLT, "pix",     "pos.cartesian.z");
+	const size_t col_x_min = Catalog_add_column(cat, "x_min", SOURCE_TYPE_INT, "pix",     "pos.cartesian.x;stat.min");
+	const size_t col_x_max = Catalog_add_column(cat, "x_max", SOURCE_TYPE_INT, "pix",     "pos.cartesian.x;stat.max");
+	const size_t col_y_min = Catalog_add_column(cat, "y_min", SOURCE_TYPE_INT, "pix",     "pos.cartesian.y;stat.min");
+	const size_t col_y_max = Catalog_add_column(cat, "y_max", SOURCE_TYPE_INT, "pix",     "pos.cartesian.y;stat.max");
+	const size_t col_z_min = Catalog_add_column(cat, "z_min", SOURCE_TYPE_INT, "pix",     "pos.cartesian.z;stat.min");
+	const size_t col_z_max = Catalog_add_column(cat, "z_max", SOURCE_TYPE_INT, "pix",     "pos.cartesian.z;stat.max");
+	const size_t col_n_pix = Catalog_add_column(cat, "n_pix", SOURCE_TYPE_INT, "",        "meta.number;instr.pixel");
+	const size_t col_f_min = Catalog_add_column(cat, "f_min", SOURCE_TYPE_FLT, flux_unit, "phot.flux.density;stat.min");
+	const size_t col_f_max = Catalog_add_column(cat, "f_max", SOURCE_TYPE_FLT, flux_unit, "phot.flux.density;stat.max");
+	const size_t col_f_sum = Catalog_add_column(cat, "f_sum", SOURCE_TYPE_FLT, flux_unit, "phot.flux");
+	const size_t col_rel   = Catalog_add_column(cat, "rel",   SOURCE_TYPE_FLT, "",        "stat.probability");
+	const size_t col_flag  = Catalog_add_column(cat, "flag",  SOURCE_TYPE_INT, "",        "meta.code.qual");
 	
 	// Create string for holding identifier
 	String *identifier = String_new("");
@@ -598,40 +618,34 @@ PUBLIC Catalog *LinkerPar_make_catalog(const LinkerPar *self, const Map *filter,
 		
 		if(!remove_unreliable || Map_key_exists(filter, self->label[i]))
 		{
-			// Create a new source
-			Source *src = Source_new(self->verbosity);
-			
-			// Set the identifier to the current label
+			// Add a new row with the identifier set to the current label
 			String_set_int(identifier, "%zu", self->label[i]);
-			Source_set_identifier(src, String_get(identifier));
+			const size_t row = Catalog_add_row(cat, String_get(identifier));
 			
-			// Set other parameters
-			Source_add_par_int(src, "id",    new_label,                       "",        "meta.id");
+			// Set parameters
+			Catalog_set_int(cat, row, col_id,    new_label);
 			#if MEASURE_CENTROID_POSITION
-			Source_add_par_flt(src, "x",     self->x_ctr[i] / self->f_sum[i], "pix",     "pos.cartesian.x");
-			Source_add_par_flt(src, "y",     self->y_ctr[i] / self->f_sum[i], "pix",     "pos.cartesian.y");
-			Source_add_par_flt(src, "z",     self->z_ctr[i] / self->f_sum[i], "pix",     "pos.cartesian.z");
+			Catalog_set_flt(cat, row, col_x,     self->x_ctr[i] / self->f_sum[i]);
+			Catalog_set_flt(cat, row, col_y,     self->y_ctr[i] / self->f_sum[i]);
+			Catalog_set_flt(cat, row, col_z,     self->z_ctr[i] / self->f_sum[i]);
 			#else
 			// Insert placeholder if no centroid requested
-			Source_add_par_flt(src, "x",     0.0,                             "pix",     "pos.cartesian.x");
-			Source_add_par_flt(src, "y",     0.0,                             "pix",     "pos.cartesian.y");
-			Source_add_par_flt(src, "z",     0.0,                             "pix",     "pos.cartesian.z");
+			Catalog_set_flt(cat, row, col_x,     0.0);
+			Catalog_set_flt(cat, row, col_y,     0.0);
+			Catalog_set_flt(cat, row, col_z,     0.0);
 			#endif
-			Source_add_par_int(src, "x_min", self->x_min[i],                  "pix",     "pos.cartesian.x;stat.min");
-			Source_add_par_int(src, "x_max", self->x_max[i],                  "pix",     "pos.cartesian.x;stat.max");
-			Source_add_par_int(src, "y_min", self->y_min[i],                  "pix",     "pos.cartesian.y;stat.min");
-			Source_add_par_int(src, "y_max", self->y_max[i],                  "pix",     "pos.cartesian.y;stat.max");
-			Source_add_par_int(src, "z_min", self->z_min[i],                  "pix",     "pos.cartesian.z;stat.min");
-			Source_add_par_int(src, "z_max", self->z_max[i],                  "pix",     "pos.cartesian.z;stat.max");
-			Source_add_par_int(src, "n_pix", self->n_pix[i],                  "",        "meta.number;instr.pixel");
-			Source_add_par_flt(src, "f_min", self->f_min[i],                  flux_unit, "phot.flux.density;stat.min");
-			Source_add_par_flt(src, "f_max", self->f_max[i],                  flux_unit, "phot.flux.density;stat.max");
-			Source_add_par_flt(src, "f_sum", self->f_sum[i],                  flux_unit, "phot.flux");
-			Source_add_par_flt(src, "rel",   self->rel  [i],                  "",        "stat.probability");
-			Source_add_par_int(src, "flag",  self->flags[i],                  "",        "meta.code.qual");
-			
-			// Add source to catalogue
-			Catalog_add_source(cat, src);
+			Catalog_set_int(cat, row, col_x_min, self->x_min[i]);
+			Catalog_set_int(cat, row, col_x_max, self->x_max[i]);
+			Catalog_set_int(cat, row, col_y_min, self->y_min[i]);
+			Catalog_set_int(cat, row, col_y_max, self->y_max[i]);
+			Catalog_set_int(cat, row, col_z_min, self->z_min[i]);
+			Catalog_set_int(cat, row, col_z_max, self->z_max[i]);
+			Catalog_set_int(cat, row, col_n_pix, self->n_pix[i]);
+			Catalog_set_flt(cat, row, col_f_min, self->f_min[i]);
+			Catalog_set_flt(cat, row, col_f_max, self->f_max[i]);
+			Catalog_set_flt(cat, row, col_f_sum, self->f_sum[i]);
+			Catalog_set_flt(cat, row, col_rel,   self->rel  [i]);
+			Catalog_set_int(cat, row, col_flag,  self->flags[i]);
 		}
 	}
 	
@@ -817,7 +831,13 @@ PRIVATE void LinkerPar_reallocate_memory(LinkerPar *self)
 //                      distribution of negative sources is used.    //
 //   (3) fmin         - Value of the fmin parameter, where fmin =    //
 //                      sum / sqrt(N).                               //
-//   (4) rel_cat      - Table of pixel coordinates on the sky. All   //
+//   (4) cutoff       - Kernel cut-off radius in units of the kernel //
+//                      standard deviation. Only sources within this //
+//                      radius will contribute to the density esti-  //
+//                      mate. If set to 0, the exact kernel density  //
+//                      will be calculated by summing over all sour- //
+//                      ces.                                         //
+//   (5) rel_cat      - Table of pixel coordinates on the sky. All   //
 //                      negative detections with bounding boxes in-  //
 //                      cluding those positions will be removed be-  //
 //                      fore reliability calculation. NULL can be    //
@@ -860,13 +880,94 @@ PRIVATE void LinkerPar_reallocate_memory(LinkerPar *self)
 //   the reliability calculation. rel_cat must contain exactly two   //
 //   columns (x and y in pixels). If set to NULL, this feature will  //
 //   be disabled altogether.                                         //
+//   If cutoff is greater than 0, all sources will be sorted into a  //
+//   regular grid in parameter space, the cell size of which along   //
+//   each axis corresponds to the projected extent of the kernel at  //
+//   the cut-off radius. The kernel density at each positive source  //
+//   then only needs to be summed over the 27 surrounding cells, and //
+//   only sources within the cut-off radius will be included. As     //
+//   each kernel term left out is below exp(-cutoff^2 / 2), an upper //
+//   limit on the error in the reliability of each source due to the //
+//   cut-off can be derived from the number of positive and negative //
+//   sources left out and the densities P and N. The largest of      //
+//   these per-source limits will be reported.                       //
+// ----------------------------------------------------------------- //
+
+PUBLIC Matrix *LinkerPar_reliability(LinkerPar *self, const double scale_kernel, const double fmin, const double cutoff, const Table *rel_cat)
+{
+	// Sanity checks
+	check_null(self);
+	ensure(self->size, ERR_NO_SRC_FOUND, "No sources left after linking. Cannot proceed.");
+	
+	// Calculate kernel densities
+	double *dens_pos = (double *)memory(MALLOC, self->size, sizeof(double));
+	double *dens_neg = (double *)memory(MALLOC, self->size, sizeof(double));
+	Matrix *covar = LinkerPar_rel_density(self, scale_kernel, fmin, cutoff, rel_cat, dens_pos, dens_neg);
+	
+	// Determine reliability
+	for(size_t i = 0; i < self->size; ++i)
+	{
+		if(dens_pos[i] > 0.0) self->rel[i] = dens_pos[i] > dens_neg[i] ? (dens_pos[i] - dens_neg[i]) / dens_pos[i] : 0.0;
+	}
+	
+	// Release memory again
+	free(dens_pos);
+	free(dens_neg);
+	
+	return covar;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Kernel density of positive and negative detections                //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self         - Object self-reference.                       //
+//   (2) scale_kernel - Scale factor of the kernel size relative to  //
+//                      the covariance of the negative detections.   //
+//   (3) fmin         - Densities will only be calculated for posi-  //
+//                      tive sources with sum / sqrt(N) > fmin.      //
+//   (4) cutoff       - Kernel cut-off radius in units of the kernel //
+//                      standard deviation; 0 = exact calculation.   //
+//   (5) rel_cat      - Table of pixel coordinates of negative arte- //
+//                      facts to be excluded, or NULL.               //
+//   (6) dens_pos     - Array of size self->size to be filled with   //
+//                      the density of positive detections at the    //
+//                      location of each source.                     //
+//   (7) dens_neg     - Array of size self->size to be filled with   //
+//                      the density of negative detections at the    //
+//                      location of each source.                     //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Covariance matrix from the negative detections.                 //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method carrying out the expensive part of the reliabi-  //
+//   lity calculation, i.e. the kernel density estimation described  //
+//   in LinkerPar_reliability(). The densities of positive and nega- //
+//   tive detections are stored in dens_pos and dens_neg for every   //
+//   positive source above fmin, while all other elements are set to //
+//   0. As every positive source contributes to its own density, a   //
+//   positive value of dens_pos indicates that the densities were    //
+//   calculated for that source. The reliability values stored in    //
+//   the LinkerPar object will not be modified.                      //
 // ----------------------------------------------------------------- //
 
-PUBLIC Matrix *LinkerPar_reliability(LinkerPar *self, const double scale_kernel, const double fmin, const Table *rel_cat)
+PRIVATE Matrix *LinkerPar_rel_density(const LinkerPar *self, const double scale_kernel, const double fmin, const double cutoff, const Table *rel_cat, double *dens_pos, double *dens_neg)
 {
 	// Sanity checks
 	check_null(self);
+	check_null(dens_pos);
+	check_null(dens_neg);
 	ensure(self->size, ERR_NO_SRC_FOUND, "No sources left after linking. Cannot proceed.");
+	ensure(cutoff >= 0.0, ERR_USER_INPUT, "Negative kernel cut-off radius encountered.");
+	
+	// Initialise density arrays
+	for(size_t i = 0; i < self->size; ++i) dens_pos[i] = dens_neg[i] = 0.0;
 	
 	// Dimensionality of parameter space
 	const int dim = 3;
@@ -892,38 +993,46 @@ PUBLIC Matrix *LinkerPar_reliability(LinkerPar *self, const double scale_kernel,
 	if(n_neg < threshold_warning) warning("Only %zu negative detections found.\n         Reliability calculation may not be accurate.", n_neg);
 	
 	// Extract relevant parameters
+	// NOTE: Parameters are stored as a structure of arrays, i.e. parameter k
+	//       of source j is found at par_pos[k * n_pos + j], to allow the kernel
+	//       density estimation below to be vectorised.
 	double *par_pos = (double *)memory(MALLOC, dim * n_pos, sizeof(double));
 	size_t *idx_pos = (size_t *)memory(MALLOC, n_pos, sizeof(size_t));
 	double *par_neg = (double *)memory(MALLOC, dim * n_neg, sizeof(double));
 	size_t *idx_neg = (size_t *)memory(MALLOC, n_neg, sizeof(size_t));
 	
+	// Build spatial index of catalogue positions to be excluded
+	PointGrid *exclusion = NULL;
+	
+	if(rel_cat != NULL)
+	{
+		const size_t n_cat = Table_rows(rel_cat);
+		double *cat_x = (double *)memory(MALLOC, n_cat ? n_cat : 1, sizeof(double));
+		double *cat_y = (double *)memory(MALLOC, n_cat ? n_cat : 1, sizeof(double));
+		
+		for(size_t row = 0; row < n_cat; ++row)
+		{
+			cat_x[row] = Table_get(rel_cat, row, 0);
+			cat_y[row] = Table_get(rel_cat, row, 1);
+		}
+		
+		exclusion = PointGrid_new(cat_x, cat_y, n_cat, 0.0);
+		free(cat_x);
+		free(cat_y);
+	}
+	
 	for(size_t i = self->size; i--;)
 	{
 		if(self->f_sum[i] < 0.0)
 		{
-			bool include_source = true;
-			
-			if(rel_cat != NULL)
-			{
-				for(size_t row = 0; row < Table_rows(rel_cat); ++row)
-				{
-					const double cat_x = Table_get(rel_cat, row, 0);
-					const double cat_y = Table_get(rel_cat, row, 1);
-					
-					if(cat_x >= (double)(self->x_min[i]) && cat_x <= (double)(self->x_max[i]) && cat_y >= (double)(self->y_min[i]) && cat_y <= (double)(self->y_max[i]))
-					{
-						include_source = false;
-						break;
-					}
-				}
-			}
+			const bool include_source = exclusion == NULL || !PointGrid_any_in_box(exclusion, (double)(self->x_min[i]), (double)(self->x_max[i]), (double)(self->y_min[i]), (double)(self->y_max[i]));
 			
 			if(include_source)
 			{
 				ensure(self->f_min[i] < 0.0, ERR_FAILURE, "Non-negative minimum assigned to source with negative flux!");
-				par_neg[dim * counter_neg + 0] = log10(-self->f_min[i]);
-				par_neg[dim * counter_neg + 1] = log10(-self->f_sum[i]);
-				par_neg[dim * counter_neg + 2] = log10(-self->f_sum[i] / self->n_pix[i]);
+				par_neg[0 * n_neg + counter_neg] = log10(-self->f_min[i]);
+				par_neg[1 * n_neg + counter_neg] = log10(-self->f_sum[i]);
+				par_neg[2 * n_neg + counter_neg] = log10(-self->f_sum[i] / self->n_pix[i]);
 				idx_neg[counter_neg] = i;
 				++counter_neg;
 			}
@@ -931,21 +1040,24 @@ PUBLIC Matrix *LinkerPar_reliability(LinkerPar *self, const double scale_kernel,
 		else if(self->f_sum[i] > 0.0)
 		{
 			ensure(self->f_max[i] > 0.0, ERR_FAILURE, "Non-positive maximum assigned to source with positive flux!");
-			par_pos[dim * counter_pos + 0] = log10(self->f_max[i]);
-			par_pos[dim * counter_pos + 1] = log10(self->f_sum[i]);
-			par_pos[dim * counter_pos + 2] = log10(self->f_sum[i] / self->n_pix[i]);
+			par_pos[0 * n_pos + counter_pos] = log10(self->f_max[i]);
+			par_pos[1 * n_pos + counter_pos] = log10(self->f_sum[i]);
+			par_pos[2 * n_pos + counter_pos] = log10(self->f_sum[i] / self->n_pix[i]);
 			idx_pos[counter_pos] = i;
 			++counter_pos;
 		}
 	}
 	
+	PointGrid_delete(exclusion);
+	
 	// Adjust array sizes if necessary (some negative sources may have been removed)
 	if(counter_neg < n_neg)
 	{
 		message("Excluding %zu out of %zu negative sources from reliability analysis.", n_neg - counter_neg, n_neg);
+		ensure(counter_neg, ERR_FAILURE, "No negative sources found. Cannot proceed.");
+		if(counter_neg < threshold_warning) warning("Only %zu negative detections found.\n         Reliability calculation may not be accurate.", counter_neg);
+		for(size_t k = 1; k < dim; ++k) memmove(par_neg + k * counter_neg, par_neg + k * n_neg, counter_neg * sizeof(double));
 		n_neg = counter_neg;
-		ensure(n_neg, ERR_FAILURE, "No negative sources found. Cannot proceed.");
-		if(n_neg < threshold_warning) warning("Only %zu negative detections found.\n         Reliability calculation may not be accurate.", n_neg);
 		par_neg = (double *)memory_realloc(par_neg, dim * n_neg, sizeof(double));
 		idx_neg = (size_t *)memory_realloc(idx_neg, n_neg, sizeof(size_t));
 	}
@@ -959,7 +1071,7 @@ PUBLIC Matrix *LinkerPar_reliability(LinkerPar *self, const double scale_kernel,
 	for(size_t i = dim; i--;)
 	{
 		mean[i] = 0.0;
-		for(size_t j = 0; j < n_neg; ++j) mean[i] += par_neg[dim * j + i];
+		for(size_t j = 0; j < n_neg; ++j) mean[i] += par_neg[i * n_neg + j];
 		mean[i] /= n_neg;
 	}
 	
@@ -968,9 +1080,9 @@ PUBLIC Matrix *LinkerPar_reliability(LinkerPar *self, const double scale_kernel,
 	{
 		for(size_t j = dim; j--;)
 		{
-			for(size_t k = 0; k < dim * n_neg; k += dim)
+			for(size_t k = 0; k < n_neg; ++k)
 			{
-				Matrix_add_value(covar, i, j, (par_neg[k + i] - mean[i]) * (par_neg[k + j] - mean[j]));
+				Matrix_add_value(covar, i, j, (par_neg[i * n_neg + k] - mean[i]) * (par_neg[j * n_neg + k] - mean[j]));
 			}
 			Matrix_mul_value(covar, i, j, scale_kernel * scale_kernel / n_neg);  // NOTE: Variance = sigma^2, hence scale_kernel^2 here.
 		}
@@ -989,6 +1101,16 @@ PUBLIC Matrix *LinkerPar_reliability(LinkerPar *self, const double scale_kernel,
 	//       the amplitude rather than the integral. The normalisation factor 
 	//       does matter for the Skellam plot generation further down, though.
 	
+	// Expand exponent of kernel, -0.5 v^T C^-1 v, into its six independent coefficients
+	double kernel[6];
+	kernel[0] = -0.5 *  Matrix_get_value(covar_inv, 0, 0);
+	kernel[1] = -0.5 *  Matrix_get_value(covar_inv, 1, 1);
+	kernel[2] = -0.5 *  Matrix_get_value(covar_inv, 2, 2);
+	kernel[3] = -0.5 * (Matrix_get_value(covar_inv, 0, 1) + Matrix_get_value(covar_inv, 1, 0));
+	kernel[4] = -0.5 * (Matrix_get_value(covar_inv, 0, 2) + Matrix_get_value(covar_inv, 2, 0));
+	kernel[5] = -0.5 * (Matrix_get_value(covar_inv, 1, 2) + Matrix_get_value(covar_inv, 2, 1));
+	Matrix_delete(covar_inv);
+	
 	
 	// Create Skellam array
 	/*Array_dbl *skellam = Array_dbl_new(n_neg);
@@ -1045,75 +1167,324 @@ PUBLIC Matrix *LinkerPar_reliability(LinkerPar *self, const double scale_kernel,
 	Array_dbl_delete(skellam);*/
 	
 	
-	// Loop over all positive detections to measure their reliability
+	// Set up grid in parameter space if kernel cut-off requested
+	const double arg_min = cutoff > 0.0 ? -0.5 * cutoff * cutoff : -INFINITY;
+	double grid_origin[dim];
+	double grid_width[dim];
+	long int grid_size[dim];
+	size_t *cell_pos = NULL;
+	size_t *cell_neg = NULL;
+	
+	if(cutoff > 0.0)
+	{
+		// Limit number of grid cells to a sensible multiple of the number of sources
+		const double max_cells = 4.0 * (double)(n_pos + n_neg) + 64.0;
+		
+		// Determine extent of parameter space
+		for(size_t i = 0; i < dim; ++i)
+		{
+			double par_min = par_pos[i * n_pos];
+			double par_max = par_pos[i * n_pos];
+			for(size_t j = 0; j < n_pos; ++j)
+			{
+				if(par_pos[i * n_pos + j] < par_min) par_min = par_pos[i * n_pos + j];
+				if(par_pos[i * n_pos + j] > par_max) par_max = par_pos[i * n_pos + j];
+			}
+			for(size_t j = 0; j < n_neg; ++j)
+			{
+				if(par_neg[i * n_neg + j] < par_min) par_min = par_neg[i * n_neg + j];
+				if(par_neg[i * n_neg + j] > par_max) par_max = par_neg[i * n_neg + j];
+			}
+			
+			// Cell size = extent of kernel ellipsoid at cut-off radius along axis i
+			grid_origin[i] = par_min;
+			grid_width[i]  = cutoff * sqrt(Matrix_get_value(covar, i, i));
+			ensure(grid_width[i] > 0.0, ERR_USER_INPUT, "Kernel width along axis %zu is not positive; cannot set up grid.", i);
+			
+			// Clamp number of cells along axis before conversion to integer
+			// NOTE: If the kernel is very narrow, the cells are widened instead,
+			//       such that the cut-off radius still fits within one cell.
+			double size = floor((par_max - par_min) / grid_width[i]) + 1.0;
+			if(size > max_cells)
+			{
+				size = max_cells;
+				grid_width[i] = (par_max - par_min) / (max_cells - 1.0);
+			}
+			grid_size[i] = (long int)size;
+		}
+		
+		double n_cells = (double)(grid_size[0]) * (double)(grid_size[1]) * (double)(grid_size[2]);
+		
+		if(n_cells > max_cells)
+		{
+			const double factor = cbrt(n_cells / max_cells);
+			for(size_t i = 0; i < dim; ++i)
+			{
+				grid_width[i] *= factor;
+				grid_size[i] = (long int)(grid_size[i] / factor) + 1;
+			}
+			n_cells = (double)(grid_size[0]) * (double)(grid_size[1]) * (double)(grid_size[2]);
+		}
+		
+		// Sort sources into grid cells
+		cell_pos = (size_t *)memory(CALLOC, (size_t)(n_cells) + 1, sizeof(size_t));
+		cell_neg = (size_t *)memory(CALLOC, (size_t)(n_cells) + 1, sizeof(size_t));
+		LinkerPar_grid_sort(par_pos, idx_pos, n_pos, grid_origin, grid_width, grid_size, cell_pos);
+		LinkerPar_grid_sort(par_neg, idx_neg, n_neg, grid_origin, grid_width, grid_size, cell_neg);
+		
+		message("Kernel cut-off radius:  %.1f sigma (%zu grid cells)", cutoff, (size_t)(n_cells));
+	}
+	else message("Calculating exact kernel density without cut-off.");
+	
+	// Loop over all positive detections to measure kernel densities
 	const size_t cadence = (n_pos / 100) ? n_pos / 100 : 1;  // Only needed for progress bar
+	const double kernel_min = exp(arg_min);                 // Upper limit of any kernel term left out
 	size_t progress = 0;
+	size_t progress_next = cadence;                          // Only accessed by master thread
+	size_t n_pairs = 0;
+	double max_error = 0.0;
+	#ifdef _OPENMP
+		const double time_start = omp_get_wtime();
+	#else
+		const clock_t time_start = clock();
+	#endif
 	message("");
 	
-	#pragma omp parallel
+	#pragma omp parallel for schedule(static) reduction(+: n_pairs) reduction(max: max_error)
+	for(size_t i = 0; i < n_pos; ++i)
 	{
-		Matrix *vector = Matrix_new(dim, 1);
+		size_t done;
+		#pragma omp atomic capture
+		done = ++progress;
 		
-		#pragma omp for schedule(static)
-		for(size_t i = 0; i < n_pos; ++i)
+		bool is_master = true;
+		#ifdef _OPENMP
+			is_master = (omp_get_thread_num() == 0);
+		#endif
+		if(is_master && done >= progress_next && done < n_pos)
 		{
-			#pragma omp critical
-			if(++progress % cadence == 0 || progress == n_pos) progress_bar("Progress: ", progress, n_pos);
-			
-			const double p2 = par_pos[dim * i + 1];
-			const double p3 = par_pos[dim * i + 2];
+			progress_bar("Progress: ", done, n_pos);
+			progress_next = done + cadence;
+		}
+		
+		const double p[3] = {par_pos[i], par_pos[n_pos + i], par_pos[2 * n_pos + i]};
+		
+		// Only process sources above fmin
+		if(p[1] + p[2] > log_fmin_squared)
+		{
+			double pdf_neg_sum;
+			double pdf_pos_sum;
+			size_t used_neg = 0;
+			size_t used_pos = 0;
 			
-			// Only process sources above fmin
-			if(p2 + p3 > log_fmin_squared)
+			if(cutoff > 0.0)
 			{
-				const double p1 = par_pos[dim * i];
-				
-				// Multivariate kernel density estimation for negative detections
-				double pdf_neg_sum = 0.0;
+				// Multivariate kernel density estimation within cut-off radius
+				pdf_neg_sum = LinkerPar_grid_kde(par_neg, n_neg, cell_neg, grid_origin, grid_width, grid_size, p, kernel, arg_min, &n_pairs, &used_neg);
+				pdf_pos_sum = LinkerPar_grid_kde(par_pos, n_pos, cell_pos, grid_origin, grid_width, grid_size, p, kernel, arg_min, &n_pairs, &used_pos);
 				
-				for(double *ptr = par_neg + n_neg * dim; ptr > par_neg;)
-				{
-					// Set up relative position vector
-					Matrix_set_value_nocheck(vector, 2, 0, *(--ptr) - p3);
-					Matrix_set_value_nocheck(vector, 1, 0, *(--ptr) - p2);
-					Matrix_set_value_nocheck(vector, 0, 0, *(--ptr) - p1);
-					
-					pdf_neg_sum += Matrix_prob_dens_nocheck(covar_inv, vector, scal_fact);
-				}
-				
-				// Multivariate kernel density estimation for positive detections
-				double pdf_pos_sum = 0.0;
-				
-				for(double *ptr = par_pos + n_pos * dim; ptr > par_pos;)
-				{
-					// Set up relative position vector
-					Matrix_set_value_nocheck(vector, 2, 0, *(--ptr) - p3);
-					Matrix_set_value_nocheck(vector, 1, 0, *(--ptr) - p2);
-					Matrix_set_value_nocheck(vector, 0, 0, *(--ptr) - p1);
-					
-					pdf_pos_sum += Matrix_prob_dens_nocheck(covar_inv, vector, scal_fact);
-				}
-				
-				// Determine reliability
-				self->rel[idx_pos[i]] = pdf_pos_sum > pdf_neg_sum ? (pdf_pos_sum - pdf_neg_sum) / pdf_pos_sum : 0.0;
+				// Upper limit of reliability error due to the kernel terms left out
+				// NOTE: With R = 1 - N / P, leaving out up to lost_neg of N and
+				//       up to lost_pos of P changes R by at most the larger
+				//       of lost_neg / P and N lost_pos / (P (P + lost_pos)).
+				const double lost_neg = (double)(n_neg - used_neg) * kernel_min;
+				const double lost_pos = (double)(n_pos - used_pos) * kernel_min;
+				const double error_neg = lost_neg / pdf_pos_sum;
+				const double error_pos = pdf_neg_sum * lost_pos / (pdf_pos_sum * (pdf_pos_sum + lost_pos));
+				if(error_neg > max_error) max_error = error_neg;
+				if(error_pos > max_error) max_error = error_pos;
+			}
+			else
+			{
+				// Multivariate kernel density estimation over all detections
+				pdf_neg_sum = LinkerPar_kernel_sum(par_neg, n_neg, 0, n_neg, p, kernel, arg_min, &used_neg);
+				pdf_pos_sum = LinkerPar_kernel_sum(par_pos, n_pos, 0, n_pos, p, kernel, arg_min, &used_pos);
+				n_pairs += n_neg + n_pos;
 			}
+			
+			// Store densities
+			dens_pos[idx_pos[i]] = scal_fact * pdf_pos_sum;
+			dens_neg[idx_pos[i]] = scal_fact * pdf_neg_sum;
 		}
-		
-		Matrix_delete(vector);
 	}
 	
+	progress_bar("Progress: ", n_pos, n_pos);
+	if(cutoff > 0.0) message("Maximum error in reliability due to cut-off:  %.1e", max_error);
+	
+	// Report kernel throughput
+	#ifdef _OPENMP
+		const double time_elapsed = omp_get_wtime() - time_start;
+	#else
+		const double time_elapsed = (double)(clock() - time_start) / CLOCKS_PER_SEC;
+	#endif
+	if(time_elapsed > 0.0) message("Kernel evaluations:  %zu pairs in %.3f s (%.2e pairs/s)", n_pairs, time_elapsed, (double)(n_pairs) / time_elapsed);
+	
 	// Release memory again
-	Matrix_delete(covar_inv);
 	free(par_pos);
 	free(par_neg);
 	free(idx_pos);
 	free(idx_neg);
+	free(cell_pos);
+	free(cell_neg);
 	
 	return covar;
 }
 
 
 
+// ----------------------------------------------------------------- //
+// Sweep reliability filter parameters                               //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self          - Object self-reference.                      //
+//   (2) scale_kernel  - List of kernel scale factors to be tested.  //
+//   (3) threshold     - List of reliability thresholds to be tes-   //
+//                       ted.                                        //
+//   (4) fmin          - List of fmin values to be tested.           //
+//   (5) cutoff        - Kernel cut-off radius in units of the ker-  //
+//                       nel standard deviation; 0 = exact.          //
+//   (6) rel_cat       - Table of pixel coordinates of negative ar-  //
+//                       tefacts to be excluded, or NULL.            //
+//   (7) filename      - Name of the output table.                   //
+//   (8) filename_dens - Name of the output file for the kernel den- //
+//                       sities. NULL can be used to disable.        //
+//   (9) overwrite     - If true, overwrite output files, otherwise  //
+//                       do not overwrite.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for evaluating the outcome of the reliability     //
+//   filter for a grid of parameter values in a single run. As the   //
+//   kernel densities only depend on the kernel scale factor, they   //
+//   will be calculated just once for each value of scale_kernel     //
+//   (using the smallest value of fmin), after which all             //
+//   combinations of threshold and fmin are evaluated from the same  //
+//   densities. For each combination, the number of sources passing  //
+//   the filter, their mean reliability and the expected number of   //
+//   false detections, sum(1 - R), will be written to a text file.   //
+//   If filename_dens is not NULL, the densities and reliability of  //
+//   every positive source will also be written to disk, such that   //
+//   further thresholds can be evaluated without having to repeat    //
+//   the kernel density estimation. The reliability values stored in //
+//   the LinkerPar object will not be modified.                      //
+// ----------------------------------------------------------------- //
+
+PUBLIC void LinkerPar_rel_sweep(const LinkerPar *self, const Array_dbl *scale_kernel, const Array_dbl *threshold, const Array_dbl *fmin, const double cutoff, const Table *rel_cat, const char *filename, const char *filename_dens, const bool overwrite)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(scale_kernel);
+	check_null(threshold);
+	check_null(fmin);
+	check_null(filename);
+	ensure(self->size, ERR_NO_SRC_FOUND, "No sources left after linking. Cannot proceed.");
+	ensure(Array_dbl_get_size(scale_kernel) && Array_dbl_get_size(threshold) && Array_dbl_get_size(fmin), ERR_USER_INPUT, "Empty parameter list encountered in reliability sweep.");
+	
+	// Determine smallest fmin value
+	double fmin_min = Array_dbl_get(fmin, 0);
+	for(size_t j = 1; j < Array_dbl_get_size(fmin); ++j)
+	{
+		if(Array_dbl_get(fmin, j) < fmin_min) fmin_min = Array_dbl_get(fmin, j);
+	}
+	
+	// Get current date and time
+	char current_time_string[64];
+	time_t current_time = time(NULL);
+	strftime(current_time_string, 64, "%a, %d %b %Y, %H:%M:%S", localtime(&current_time));
+	
+	// Open output file(s)
+	FILE *fp;
+	if(overwrite) fp = fopen(filename, "wb");
+	else fp = fopen(filename, "wxb");
+	ensure(fp != NULL, ERR_FILE_ACCESS, "Failed to open output file: %s", filename);
+	
+	fprintf(fp, "# SoFiA reliability sweep\n# Creator: %s\n# Time:    %s\n#\n", SOFIA_VERSION_FULL, current_time_string);
+	fprintf(fp, "# Columns:\n#   scale_kernel = kernel scale factor\n#   fmin         = minimum SNR, sum / sqrt(N)\n#   threshold    = reliability threshold\n");
+	fprintf(fp, "#   n_src        = number of sources passing the filter\n#   rel_mean     = mean reliability of those sources\n#   n_false      = expected number of false detections, sum(1 - R)\n#\n");
+	fprintf(fp, "#%13s%14s%14s%14s%14s%14s\n\n", "scale_kernel", "fmin", "threshold", "n_src", "rel_mean", "n_false");
+	
+	FILE *fp_dens = NULL;
+	if(filename_dens != NULL)
+	{
+		if(overwrite) fp_dens = fopen(filename_dens, "wb");
+		else fp_dens = fopen(filename_dens, "wxb");
+		ensure(fp_dens != NULL, ERR_FILE_ACCESS, "Failed to open output file: %s", filename_dens);
+		
+		fprintf(fp_dens, "# SoFiA reliability kernel densities\n# Creator: %s\n# Time:    %s\n#\n", SOFIA_VERSION_FULL, current_time_string);
+		fprintf(fp_dens, "# Columns:\n#   scale_kernel = kernel scale factor\n#   id           = linker label of source\n#   snr          = sum / sqrt(N)\n");
+		fprintf(fp_dens, "#   dens_pos     = density of positive detections\n#   dens_neg     = density of negative detections\n#   rel          = reliability\n#\n");
+		fprintf(fp_dens, "#%13s%14s%14s%14s%14s%14s\n\n", "scale_kernel", "id", "snr", "dens_pos", "dens_neg", "rel");
+	}
+	
+	// Allocate memory for densities and reliability
+	double *dens_pos = (double *)memory(MALLOC, self->size, sizeof(double));
+	double *dens_neg = (double *)memory(MALLOC, self->size, sizeof(double));
+	double *rel      = (double *)memory(MALLOC, self->size, sizeof(double));
+	
+	// Loop over kernel scale factors
+	for(size_t k = 0; k < Array_dbl_get_size(scale_kernel); ++k)
+	{
+		const double sk = Array_dbl_get(scale_kernel, k);
+		message("Kernel scale factor:  %.3f", sk);
+		
+		// Calculate kernel densities and reliability
+		Matrix *covar = LinkerPar_rel_density(self, sk, fmin_min, cutoff, rel_cat, dens_pos, dens_neg);
+		Matrix_delete(covar);
+		
+		for(size_t i = 0; i < self->size; ++i) rel[i] = dens_pos[i] > dens_neg[i] ? (dens_pos[i] - dens_neg[i]) / dens_pos[i] : 0.0;
+		
+		// Write densities if requested
+		if(fp_dens != NULL)
+		{
+			for(size_t i = 0; i < self->size; ++i)
+			{
+				if(dens_pos[i] > 0.0) fprintf(fp_dens, " %13.4f%14zu%14.6e%14.6e%14.6e%14.6f\n", sk, self->label[i], self->f_sum[i] / sqrt(self->n_pix[i]), dens_pos[i], dens_neg[i], rel[i]);
+			}
+		}
+		
+		// Evaluate filter for all combinations of fmin and threshold
+		for(size_t f = 0; f < Array_dbl_get_size(fmin); ++f)
+		{
+			for(size_t t = 0; t < Array_dbl_get_size(threshold); ++t)
+			{
+				const double fmin_value = Array_dbl_get(fmin, f);
+				const double rel_value  = Array_dbl_get(threshold, t);
+				size_t n_src = 0;
+				double rel_sum = 0.0;
+				
+				for(size_t i = 0; i < self->size; ++i)
+				{
+					if(rel[i] >= rel_value && self->f_sum[i] / sqrt(self->n_pix[i]) > fmin_value)
+					{
+						++n_src;
+						rel_sum += rel[i];
+					}
+				}
+				
+				fprintf(fp, " %13.4f%14.4f%14.4f%14zu%14.6f%14.4f\n", sk, fmin_value, rel_value, n_src, n_src ? rel_sum / n_src : 0.0, n_src - rel_sum);
+			}
+		}
+		
+		message("");
+	}
+	
+	// Clean up
+	fclose(fp);
+	if(fp_dens != NULL) fclose(fp_dens);
+	free(dens_pos);
+	free(dens_neg);
+	free(rel);
+	
+	return;
+}
+
+
+
 // ----------------------------------------------------------------- //
 // Create reliability diagnostic plots                               //
 // ----------------------------------------------------------------- //
@@ -1426,6 +1797,268 @@ PUBLIC void LinkerPar_rel_plots(const LinkerPar *self, const double threshold, c
 }
 
 
+// ----------------------------------------------------------------- //
+// Sort sources into a regular grid in parameter space               //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) par        - Array of source parameters, stored as a struc- //
+//                    ture of arrays with 3 parameters per source.   //
+//   (2) idx        - Array of source indices to be sorted along     //
+//                    with the parameters.                           //
+//   (3) n_src      - Number of sources.                             //
+//   (4) origin     - Lower edge of the grid along each axis.        //
+//   (5) width      - Width of the grid cells along each axis.       //
+//   (6) size       - Number of grid cells along each axis.          //
+//   (7) cell_start - Array of size n_cells + 1 to be filled with    //
+//                    the index of the first source in each cell.    //
+//                    Must be initialised with 0.                    //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private function for sorting the specified sources into a regu- //
+//   lar 3-D grid by means of a counting sort. The parameter and in- //
+//   dex arrays will be reordered in place such that the sources in  //
+//   cell c will occupy positions cell_start[c] <= j <               //
+//   cell_start[c + 1]. Within each cell, the original order of the  //
+//   sources is preserved.                                           //
+// ----------------------------------------------------------------- //
+
+PRIVATE void LinkerPar_grid_sort(double *par, size_t *idx, const size_t n_src, const double *origin, const double *width, const long int *size, size_t *cell_start)
+{
+	const size_t n_cells = (size_t)(size[0] * size[1] * size[2]);
+	size_t *cell = (size_t *)memory(MALLOC, n_src, sizeof(size_t));
+	
+	// Count number of sources per cell
+	for(size_t j = 0; j < n_src; ++j)
+	{
+		const double p[3] = {par[j], par[n_src + j], par[2 * n_src + j]};
+		cell[j] = LinkerPar_grid_cell(p, origin, width, size);
+		++cell_start[cell[j] + 1];
+	}
+	
+	// Convert counts into start indices
+	for(size_t c = 0; c < n_cells; ++c) cell_start[c + 1] += cell_start[c];
+	
+	// Reorder sources, using the start indices as temporary counters
+	double *par_copy = (double *)memory(MALLOC, 3 * n_src, sizeof(double));
+	size_t *idx_copy = (size_t *)memory(MALLOC, n_src, sizeof(size_t));
+	memcpy(par_copy, par, 3 * n_src * sizeof(double));
+	memcpy(idx_copy, idx, n_src * sizeof(size_t));
+	
+	for(size_t j = 0; j < n_src; ++j)
+	{
+		const size_t k = cell_start[cell[j]]++;
+		par[k]             = par_copy[j];
+		par[n_src + k]     = par_copy[n_src + j];
+		par[2 * n_src + k] = par_copy[2 * n_src + j];
+		idx[k] = idx_copy[j];
+	}
+	
+	// Shift start indices back into place
+	for(size_t c = n_cells; c > 0; --c) cell_start[c] = cell_start[c - 1];
+	cell_start[0] = 0;
+	
+	free(cell);
+	free(par_copy);
+	free(idx_copy);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return grid cell containing a position in parameter space         //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) p          - Position in parameter space (3 values).        //
+//   (2) origin     - Lower edge of the grid along each axis.        //
+//   (3) width      - Width of the grid cells along each axis.       //
+//   (4) size       - Number of grid cells along each axis.          //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Index of the grid cell containing the specified position.       //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private function for returning the index of the grid cell that  //
+//   contains the specified position. Positions outside of the grid  //
+//   will be assigned to the nearest cell on the edge.               //
+// ----------------------------------------------------------------- //
+
+PRIVATE size_t LinkerPar_grid_cell(const double *p, const double *origin, const double *width, const long int *size)
+{
+	long int c[3];
+	
+	for(size_t i = 0; i < 3; ++i)
+	{
+		c[i] = (long int)floor((p[i] - origin[i]) / width[i]);
+		if(c[i] < 0) c[i] = 0;
+		else if(c[i] >= size[i]) c[i] = size[i] - 1;
+	}
+	
+	return (size_t)(c[0] + size[0] * (c[1] + size[1] * c[2]));
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Kernel density within cut-off radius using grid look-up           //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) par        - Array of source parameters, sorted by grid     //
+//                    cell and stored as a structure of arrays.      //
+//   (2) n_src      - Number of sources.                             //
+//   (3) cell_start - Index of the first source in each grid cell.   //
+//   (4) origin     - Lower edge of the grid along each axis.        //
+//   (5) width      - Width of the grid cells along each axis.       //
+//   (6) size       - Number of grid cells along each axis.          //
+//   (7) p          - Position at which to evaluate the density.     //
+//   (8) kernel     - The six coefficients of the kernel exponent.   //
+//   (9) arg_min    - Minimum kernel exponent, -cutoff^2 / 2.        //
+//  (10) n_pairs    - Counter to be incremented by the number of     //
+//                    kernel evaluations carried out.                //
+//  (11) n_used     - Counter to be incremented by the number of     //
+//                    sources within the cut-off radius.             //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Sum of the unnormalised kernel contributions of all sources     //
+//   within the cut-off radius.                                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private function for evaluating the Gaussian kernel density at  //
+//   the specified position p by summing over all sources within the //
+//   cut-off radius. As the cell size of the grid is no smaller than //
+//   the extent of the cut-off ellipsoid along each axis, only the   //
+//   cell containing p and its immediate neighbours need to be       //
+//   searched. Neighbouring cells along the x-axis are contiguous in //
+//   memory, so each row of three cells is handed to the kernel as a //
+//   single block.                                                   //
+// ----------------------------------------------------------------- //
+
+PRIVATE double LinkerPar_grid_kde(const double *par, const size_t n_src, const size_t *cell_start, const double *origin, const double *width, const long int *size, const double *p, const double *kernel, const double arg_min, size_t *n_pairs, size_t *n_used)
+{
+	long int c[3];
+	for(size_t i = 0; i < 3; ++i) c[i] = (long int)floor((p[i] - origin[i]) / width[i]);
+	
+	const long int cx1 = c[0] > 0 ? c[0] - 1 : 0;
+	const long int cx2 = c[0] + 1 < size[0] ? c[0] + 1 : size[0] - 1;
+	if(cx1 > cx2) return 0.0;
+	
+	double sum = 0.0;
+	
+	for(long int cz = c[2] - 1; cz <= c[2] + 1; ++cz)
+	{
+		if(cz < 0 || cz >= size[2]) continue;
+		
+		for(long int cy = c[1] - 1; cy <= c[1] + 1; ++cy)
+		{
+			if(cy < 0 || cy >= size[1]) continue;
+			
+			const size_t first = cell_start[(size_t)(cx1 + size[0] * (cy + size[1] * cz))];
+			const size_t last  = cell_start[(size_t)(cx2 + size[0] * (cy + size[1] * cz)) + 1];
+			
+			sum += LinkerPar_kernel_sum(par, n_src, first, last, p, kernel, arg_min, n_used);
+			*n_pairs += last - first;
+		}
+	}
+	
+	return sum;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Sum of Gaussian kernel over a block of sources                    //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) par        - Array of source parameters, stored as a struc- //
+//                    ture of arrays with 3 parameters per source.   //
+//   (2) n_src      - Total number of sources in par.                //
+//   (3) first      - Index of first source to be included.          //
+//   (4) last       - Index of last source to be included + 1.       //
+//   (5) p          - Position at which to evaluate the kernel.      //
+//   (6) kernel     - The six coefficients of the kernel exponent,   //
+//                    i.e. -0.5 times the diagonal elements of the   //
+//                    inverse covariance matrix followed by -0.5     //
+//                    times the sums of the off-diagonal pairs (01), //
+//                    (02) and (12).                                 //
+//   (7) arg_min    - Sources for which the kernel exponent is below //
+//                    this value will be ignored. Set to -INFINITY   //
+//                    to include all sources.                        //
+//   (8) n_used     - Counter to be incremented by the number of     //
+//                    sources not ignored.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Sum of exp(-0.5 v^T C^-1 v) over all sources in the range.      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private function for summing the unnormalised 3-D Gaussian ker- //
+//   nel centred on p over the specified range of sources. This is   //
+//   the innermost loop of the reliability calculation. The quadra-  //
+//   tic form is fully unrolled and evaluated in blocks of           //
+//   KERNEL_BLOCK_SIZE sources over the structure-of-arrays layout,  //
+//   which allows the compiler to vectorise it. The exponential is   //
+//   evaluated in a separate loop which will be vectorised as well   //
+//   if a vector math library is available to the compiler (e.g.     //
+//   glibc's libmvec with -ffast-math); otherwise the standard exp() //
+//   is used.                                                        //
+// ----------------------------------------------------------------- //
+
+PRIVATE double LinkerPar_kernel_sum(const double *par, const size_t n_src, const size_t first, const size_t last, const double *p, const double *kernel, const double arg_min, size_t *n_used)
+{
+	const double *par1 = par;
+	const double *par2 = par + n_src;
+	const double *par3 = par + 2 * n_src;
+	const double k11 = kernel[0];
+	const double k22 = kernel[1];
+	const double k33 = kernel[2];
+	const double k12 = kernel[3];
+	const double k13 = kernel[4];
+	const double k23 = kernel[5];
+	double arg[KERNEL_BLOCK_SIZE];
+	double sum = 0.0;
+	size_t used = 0;
+	
+	for(size_t block = first; block < last; block += KERNEL_BLOCK_SIZE)
+	{
+		const size_t n = (last - block < KERNEL_BLOCK_SIZE) ? last - block : KERNEL_BLOCK_SIZE;
+		
+		#pragma omp simd
+		for(size_t j = 0; j < n; ++j)
+		{
+			const double d1 = par1[block + j] - p[0];
+			const double d2 = par2[block + j] - p[1];
+			const double d3 = par3[block + j] - p[2];
+			arg[j] = d1 * (k11 * d1 + k12 * d2 + k13 * d3) + d2 * (k22 * d2 + k23 * d3) + k33 * d3 * d3;
+		}
+		
+		#pragma omp simd reduction(+: sum, used)
+		for(size_t j = 0; j < n; ++j)
+		{
+			sum  += arg[j] >= arg_min ? exp(arg[j]) : 0.0;
+			used += arg[j] >= arg_min;
+		}
+	}
+	
+	*n_used += used;
+	return sum;
+}
+
+
 
 // ----------------------------------------------------------------- //
 // Create Skellam diagnostic plot                                    //
@@ -71,14 +71,20 @@ PUBLIC  Catalog   *LinkerPar_make_catalog (const LinkerPar *self, const Map *fil
 PUBLIC  void       LinkerPar_print_info   (const LinkerPar *self);
 
 // Reliability filtering
-PUBLIC  Matrix    *LinkerPar_reliability  (LinkerPar *self, const double scale_kernel, const double fmin, const Table *rel_cat);
+PUBLIC  Matrix    *LinkerPar_reliability  (LinkerPar *self, const double scale_kernel, const double fmin, const double cutoff, const Table *rel_cat);
 PUBLIC  void       LinkerPar_rel_plots    (const LinkerPar *self, const double threshold, const double fmin, const Matrix *covar, const char *filename, const bool overwrite);
+PUBLIC  void       LinkerPar_rel_sweep    (const LinkerPar *self, const Array_dbl *scale_kernel, const Array_dbl *threshold, const Array_dbl *fmin, const double cutoff, const Table *rel_cat, const char *filename, const char *filename_dens, const bool overwrite);
 
 // Private methods
 PRIVATE size_t     LinkerPar_get_index    (const LinkerPar *self, const size_t label);
 PRIVATE void       LinkerPar_reallocate_memory(LinkerPar *self);
+PRIVATE Matrix    *LinkerPar_rel_density  (const LinkerPar *self, const double scale_kernel, const double fmin, const double cutoff, const Table *rel_cat, double *dens_pos, double *dens_neg);
 
 // Private functions
 PRIVATE void       LinkerPar_skellam_plot (Array_dbl *skellam, const char *filename, const bool overwrite);
+PRIVATE void       LinkerPar_grid_sort    (double *par, size_t *idx, const size_t n_src, const double *origin, const double *width, const long int *size, size_t *cell_start);
+PRIVATE size_t     LinkerPar_grid_cell    (const double *p, const double *origin, const double *width, const long int *size);
+PRIVATE double     LinkerPar_grid_kde     (const double *par, const size_t n_src, const size_t *cell_start, const double *origin, const double *width, const long int *size, const double *p, const double *kernel, const double arg_min, size_t *n_pairs, size_t *n_used);
+PRIVATE double     LinkerPar_kernel_sum   (const double *par, const size_t n_src, const size_t first, const size_t last, const double *p, const double *kernel, const double arg_min, size_t *n_used);
 
 #endif
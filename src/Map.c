@@ -30,6 +30,7 @@
 ///                                                                      ///
 
 #include <stdlib.h>
+#include <stdint.h>
 #include "Map.h"
 
 
@@ -41,8 +42,11 @@
 CLASS Map
 {
 	size_t  size;
+	size_t  n_keys;
+	size_t  capacity;
 	size_t *keys;
 	size_t *values;
+	bool   *used;
 };
 
 
@@ -71,9 +75,12 @@ PUBLIC Map *Map_new(void)
 {
 	Map *self = (Map *)memory(MALLOC, 1, sizeof(Map));
 	
-	self->size = 0;
-	self->keys = NULL;
-	self->values = NULL;
+	self->size     = 0;
+	self->n_keys   = 0;
+	self->capacity = MAP_MIN_CAPACITY;
+	self->keys     = (size_t *)memory(MALLOC, self->capacity, sizeof(size_t));
+	self->values   = (size_t *)memory(MALLOC, self->capacity, sizeof(size_t));
+	self->used     = (bool *)memory(CALLOC, self->capacity, sizeof(bool));
 	
 	return self;
 }
@@ -104,6 +111,7 @@ PUBLIC void Map_delete(Map *self)
 	{
 		free(self->keys);
 		free(self->values);
+		free(self->used);
 		free(self);
 	}
 	
@@ -128,9 +136,11 @@ PUBLIC void Map_delete(Map *self)
 // Description:                                                      //
 //                                                                   //
 //   Public method for pushing a new key-value pair onto the speci-  //
-//   fied map. Note that there will be no check as to whether the    //
-//   key already exists, and it is therefore possible to create more //
-//   than one entry with the same key.                               //
+//   fied map. If the key already exists, its value will be replaced //
+//   by the new value, but the entry will still be counted again in  //
+//   the size of the map. The hash table will be doubled in size     //
+//   whenever it becomes more than half full, such that the cost of  //
+//   pushing a new entry is constant on average.                     //
 // ----------------------------------------------------------------- //
 
 PUBLIC void Map_push(Map *self, const size_t key, const size_t value)
@@ -138,13 +148,20 @@ PUBLIC void Map_push(Map *self, const size_t key, const size_t value)
 	// Sanity checks
 	check_null(self);
 	
-	++self->size;
+	// Grow hash table if necessary
+	if(2 * (self->n_keys + 1) > self->capacity) Map_grow(self);
 	
-	self->keys   = (size_t *)memory_realloc(self->keys, self->size, sizeof(size_t));
-	self->values = (size_t *)memory_realloc(self->values, self->size, sizeof(size_t));
+	const size_t slot = Map_find(self, key);
 	
-	self->keys[self->size - 1] = key;
-	self->values[self->size - 1] = value;
+	if(!self->used[slot])
+	{
+		self->used[slot] = true;
+		self->keys[slot] = key;
+		++self->n_keys;
+	}
+	
+	self->values[slot] = value;
+	++self->size;
 	
 	return;
 }
@@ -166,9 +183,9 @@ PUBLIC void Map_push(Map *self, const size_t key, const size_t value)
 // Description:                                                      //
 //                                                                   //
 //   Public method for retrieving the value associated with the spe- //
-//   cified key. If the same key exists more than once, the last oc- //
-//   currence will be retrieved. The process will be terminated of   //
-//   the specified map is empty or the key is not found.             //
+//   cified key. If the same key was pushed more than once, the last //
+//   value pushed will be retrieved. The process will be terminated  //
+//   if the specified map is empty or the key is not found.          //
 // ----------------------------------------------------------------- //
 
 PUBLIC size_t Map_get_value(const Map *self, const size_t key)
@@ -177,13 +194,10 @@ PUBLIC size_t Map_get_value(const Map *self, const size_t key)
 	check_null(self);
 	
 	// Search for key and return value
-	for(size_t i = self->size; i--;) if(self->keys[i] == key) return self->values[i];
-	
-	// Key not found
-	ensure(false, ERR_USER_INPUT, "Key \'%zu\' not found in map.", key);
+	const size_t slot = Map_find(self, key);
+	ensure(self->used[slot], ERR_USER_INPUT, "Key \'%zu\' not found in map.", key);
 	
-	// While this return statement is never executed, it is required by the compiler:
-	return 0;
+	return self->values[slot];
 }
 
 
@@ -240,6 +254,87 @@ PUBLIC bool Map_key_exists(const Map *self, const size_t key)
 	check_null(self);
 	
 	// Search for key
-	for(size_t i = 0; i < self->size; ++i) if(self->keys[i] == key) return true;
-	return false;
+	return self->used[Map_find(self, key)];
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Find slot of key in hash table                                    //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) key      - Key to be searched for.                          //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Slot containing the key or, if the key does not exist, the      //
+//   empty slot at which it would be inserted.                       //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for locating the specified key in the hash table //
+//   using open addressing with linear probing. The initial slot is  //
+//   derived from the key by Fibonacci hashing, which spreads conse- //
+//   cutive source labels evenly across the table. As the table is   //
+//   never more than half full, an empty slot will always be found   //
+//   after a small number of probes on average.                      //
+// ----------------------------------------------------------------- //
+
+PRIVATE size_t Map_find(const Map *self, const size_t key)
+{
+	const size_t mask = self->capacity - 1;
+	size_t slot = (size_t)(((uint64_t)key * UINT64_C(11400714819323198485)) >> 32) & mask;
+	
+	while(self->used[slot] && self->keys[slot] != key) slot = (slot + 1) & mask;
+	
+	return slot;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Double size of hash table                                         //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for doubling the capacity of the hash table and  //
+//   re-inserting all existing entries into the enlarged table.      //
+// ----------------------------------------------------------------- //
+
+PRIVATE void Map_grow(Map *self)
+{
+	const size_t  old_capacity = self->capacity;
+	size_t *old_keys   = self->keys;
+	size_t *old_values = self->values;
+	bool   *old_used   = self->used;
+	
+	self->capacity *= 2;
+	self->keys   = (size_t *)memory(MALLOC, self->capacity, sizeof(size_t));
+	self->values = (size_t *)memory(MALLOC, self->capacity, sizeof(size_t));
+	self->used   = (bool *)memory(CALLOC, self->capacity, sizeof(bool));
+	
+	for(size_t i = 0; i < old_capacity; ++i)
+	{
+		if(!old_used[i]) continue;
+		const size_t slot = Map_find(self, old_keys[i]);
+		self->used[slot]   = true;
+		self->keys[slot]   = old_keys[i];
+		self->values[slot] = old_values[i];
+	}
+	
+	free(old_keys);
+	free(old_values);
+	free(old_used);
+	
+	return;
 }
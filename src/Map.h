@@ -34,6 +34,8 @@
 
 #include "common.h"
 
+#define MAP_MIN_CAPACITY 64
+
 
 // ----------------------------------------------------------------- //
 // Class 'Map'                                                       //
@@ -41,7 +43,9 @@
 // The purpose of this class is to provide a simple map structure    //
 // that allows key-value pairs to be handled. Both key and value are //
 // of type size_t (to facilitate handling of source mask labels).    //
-// Multiple entries with the same key are allowed.                   //
+// Entries are stored in a hash table with open addressing, such     //
+// that keys can be looked up in constant time on average. Pushing   //
+// an existing key again will replace its value.                     //
 // ----------------------------------------------------------------- //
 
 typedef CLASS Map Map;
@@ -56,4 +60,8 @@ PUBLIC size_t        Map_get_value  (const Map *self, const size_t key);
 PUBLIC size_t        Map_get_size   (const Map *self);
 PUBLIC bool          Map_key_exists (const Map *self, const size_t key);
 
+// Private methods
+PRIVATE size_t       Map_find       (const Map *self, const size_t key);
+PRIVATE void         Map_grow       (Map *self);
+
 #endif
@@ -599,8 +599,14 @@ PUBLIC void Parameter_default(Parameter *self)
 	Parameter_set(self, "reliability.threshold"    , "0.9");
 	Parameter_set(self, "reliability.scaleKernel"  , "0.4");
 	Parameter_set(self, "reliability.fmin"         , "15.0");
+	Parameter_set(self, "reliability.kernelCutoff" , "0");
 	Parameter_set(self, "reliability.plot"         , "true");
 	Parameter_set(self, "reliability.catalog"      , "");
+	Parameter_set(self, "reliability.sweep"        , "false");
+	Parameter_set(self, "reliability.sweepKernel"  , "0.3, 0.4, 0.5");
+	Parameter_set(self, "reliability.sweepThreshold", "0.8, 0.9, 0.95, 0.99");
+	Parameter_set(self, "reliability.sweepFmin"    , "5.0, 10.0, 15.0, 20.0");
+	Parameter_set(self, "reliability.sweepDensity" , "false");
 	
 	// Mask dilation
 	Parameter_set(self, "dilation.enable"          , "false");
@@ -621,6 +627,10 @@ PUBLIC void Parameter_default(Parameter *self)
 	Parameter_set(self, "output.writeCatASCII"     , "true");
 	Parameter_set(self, "output.writeCatXML"       , "true");
 	Parameter_set(self, "output.writeCatSQL"       , "false");
+	Parameter_set(self, "output.writeCatFITS"      , "false");
+	Parameter_set(self, "output.binaryCatXML"      , "false");
+	Parameter_set(self, "output.writeCatSQLite"    , "false");
+	Parameter_set(self, "output.sqliteSourceData"  , "false");
 	Parameter_set(self, "output.writeNoise"        , "false");
 	Parameter_set(self, "output.writeFiltered"     , "false");
 	Parameter_set(self, "output.writeMask"         , "false");
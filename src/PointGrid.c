@@ -0,0 +1,354 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (PointGrid.c) - Source Finding Application               ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "PointGrid.h"
+
+
+
+// ----------------------------------------------------------------- //
+// Declaration of properties of class PointGrid                      //
+// ----------------------------------------------------------------- //
+
+CLASS PointGrid
+{
+	size_t  size;
+	double *x;
+	double *y;
+	double  origin_x;
+	double  origin_y;
+	double  cell_size;
+	size_t  n_cells_x;
+	size_t  n_cells_y;
+	size_t *cell_start;
+};
+
+
+
+// ----------------------------------------------------------------- //
+// Standard constructor                                              //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) x         - Array of x coordinates.                         //
+//   (2) y         - Array of y coordinates.                         //
+//   (3) size      - Number of positions.                            //
+//   (4) cell_size - Size of the grid cells. If set to 0, a cell     //
+//                   size will be chosen automatically such that     //
+//                   there is about one position per cell.           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Pointer to newly created PointGrid object.                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Standard constructor. Will create a new PointGrid object from   //
+//   the specified positions, which will be copied into the object   //
+//   and sorted by grid cell. Non-finite positions are skipped. The  //
+//   number of grid cells is limited to a few times the number of    //
+//   positions, and the cell size will be increased if necessary.    //
+//   Note that the destructor will need to be called explicitly once //
+//   the object is no longer required to release its memory again.   //
+// ----------------------------------------------------------------- //
+
+PUBLIC PointGrid *PointGrid_new(const double *x, const double *y, const size_t size, const double cell_size)
+{
+	// Sanity checks
+	ensure(size == 0 || (x != NULL && y != NULL), ERR_NULL_PTR, "NULL pointer to coordinates passed to PointGrid constructor.");
+	ensure(cell_size >= 0.0, ERR_USER_INPUT, "Negative cell size passed to PointGrid constructor.");
+	
+	PointGrid *self = (PointGrid *)memory(MALLOC, 1, sizeof(PointGrid));
+	
+	// Determine extent of positions, skipping non-finite ones
+	double x_min = 0.0, x_max = 0.0, y_min = 0.0, y_max = 0.0;
+	size_t n_pos = 0;
+	
+	for(size_t i = 0; i < size; ++i)
+	{
+		if(!isfinite(x[i]) || !isfinite(y[i])) continue;
+		if(n_pos == 0 || x[i] < x_min) x_min = x[i];
+		if(n_pos == 0 || x[i] > x_max) x_max = x[i];
+		if(n_pos == 0 || y[i] < y_min) y_min = y[i];
+		if(n_pos == 0 || y[i] > y_max) y_max = y[i];
+		++n_pos;
+	}
+	
+	// Determine cell size
+	const double extent_x = x_max - x_min > 1.0 ? x_max - x_min : 1.0;
+	const double extent_y = y_max - y_min > 1.0 ? y_max - y_min : 1.0;
+	const double max_cells = 4.0 * n_pos + 16.0;
+	
+	self->cell_size = cell_size > 0.0 ? cell_size : sqrt(extent_x * extent_y / (n_pos ? n_pos : 1));
+	if((extent_x / self->cell_size + 1.0) * (extent_y / self->cell_size + 1.0) > max_cells) self->cell_size = sqrt(extent_x * extent_y / max_cells) + 1.0;
+	
+	self->size      = n_pos;
+	self->origin_x  = x_min;
+	self->origin_y  = y_min;
+	self->n_cells_x = (size_t)((x_max - x_min) / self->cell_size) + 1;
+	self->n_cells_y = (size_t)((y_max - y_min) / self->cell_size) + 1;
+	
+	// Sort positions into cells (counting sort)
+	const size_t n_cells = self->n_cells_x * self->n_cells_y;
+	size_t *cell = (size_t *)memory(MALLOC, size ? size : 1, sizeof(size_t));
+	self->cell_start = (size_t *)memory(CALLOC, n_cells + 1, sizeof(size_t));
+	self->x = (double *)memory(MALLOC, n_pos ? n_pos : 1, sizeof(double));
+	self->y = (double *)memory(MALLOC, n_pos ? n_pos : 1, sizeof(double));
+	
+	for(size_t i = 0; i < size; ++i)
+	{
+		if(!isfinite(x[i]) || !isfinite(y[i])) continue;
+		size_t cx_min, cx_max, cy_min, cy_max;
+		PointGrid_get_cells(self, x[i], x[i], y[i], y[i], &cx_min, &cx_max, &cy_min, &cy_max);
+		cell[i] = cx_min + self->n_cells_x * cy_min;
+		++self->cell_start[cell[i] + 1];
+	}
+	
+	for(size_t c = 0; c < n_cells; ++c) self->cell_start[c + 1] += self->cell_start[c];
+	
+	for(size_t i = 0; i < size; ++i)
+	{
+		if(!isfinite(x[i]) || !isfinite(y[i])) continue;
+		const size_t k = self->cell_start[cell[i]]++;
+		self->x[k] = x[i];
+		self->y[k] = y[i];
+	}
+	
+	for(size_t c = n_cells; c > 0; --c) self->cell_start[c] = self->cell_start[c - 1];
+	self->cell_start[0] = 0;
+	
+	free(cell);
+	
+	return self;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Destructor                                                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Destructor. Note that the destructor must be called explicitly  //
+//   if the object is no longer required. This will release the me-  //
+//   mory occupied by the object.                                    //
+// ----------------------------------------------------------------- //
+
+PUBLIC void PointGrid_delete(PointGrid *self)
+{
+	if(self != NULL)
+	{
+		free(self->x);
+		free(self->y);
+		free(self->cell_start);
+	}
+	free(self);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return number of positions                                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of positions stored in the grid.                         //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the number of positions stored in   //
+//   the grid.                                                       //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t PointGrid_get_size(const PointGrid *self)
+{
+	check_null(self);
+	return self->size;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Check for positions within a box                                  //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) x_min    - Lower boundary of box in x.                      //
+//   (3) x_max    - Upper boundary of box in x.                      //
+//   (4) y_min    - Lower boundary of box in y.                      //
+//   (5) y_max    - Upper boundary of box in y.                      //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   true if at least one position lies within the box, false        //
+//   otherwise.                                                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for checking whether any of the positions stored  //
+//   in the grid fall within the specified box, including its        //
+//   boundaries. Only grid cells overlapping with the box will be    //
+//   searched.                                                       //
+// ----------------------------------------------------------------- //
+
+PUBLIC bool PointGrid_any_in_box(const PointGrid *self, const double x_min, const double x_max, const double y_min, const double y_max)
+{
+	// Sanity checks
+	check_null(self);
+	if(self->size == 0 || x_max < self->origin_x || y_max < self->origin_y) return false;
+	
+	size_t cx_min, cx_max, cy_min, cy_max;
+	PointGrid_get_cells(self, x_min, x_max, y_min, y_max, &cx_min, &cx_max, &cy_min, &cy_max);
+	
+	for(size_t cy = cy_min; cy <= cy_max; ++cy)
+	{
+		// Cells adjacent in x are contiguous in memory
+		const size_t first = self->cell_start[cx_min + self->n_cells_x * cy];
+		const size_t last  = self->cell_start[cx_max + self->n_cells_x * cy + 1];
+		
+		for(size_t k = first; k < last; ++k)
+		{
+			if(self->x[k] >= x_min && self->x[k] <= x_max && self->y[k] >= y_min && self->y[k] <= y_max) return true;
+		}
+	}
+	
+	return false;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Check for positions within a radius                               //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) x        - x coordinate of centre.                          //
+//   (3) y        - y coordinate of centre.                          //
+//   (4) radius   - Search radius.                                   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   true if at least one position lies within the radius, false     //
+//   otherwise.                                                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for checking whether any of the positions stored  //
+//   in the grid are within the specified radius of (x, y). Posi-    //
+//   tions exactly on the circle are considered to be inside. Only   //
+//   grid cells overlapping with the circle's bounding box will be   //
+//   searched.                                                       //
+// ----------------------------------------------------------------- //
+
+PUBLIC bool PointGrid_any_in_radius(const PointGrid *self, const double x, const double y, const double radius)
+{
+	// Sanity checks
+	check_null(self);
+	if(self->size == 0 || radius < 0.0 || x + radius < self->origin_x || y + radius < self->origin_y) return false;
+	
+	const double radius_squ = radius * radius;
+	size_t cx_min, cx_max, cy_min, cy_max;
+	PointGrid_get_cells(self, x - radius, x + radius, y - radius, y + radius, &cx_min, &cx_max, &cy_min, &cy_max);
+	
+	for(size_t cy = cy_min; cy <= cy_max; ++cy)
+	{
+		const size_t first = self->cell_start[cx_min + self->n_cells_x * cy];
+		const size_t last  = self->cell_start[cx_max + self->n_cells_x * cy + 1];
+		
+		for(size_t k = first; k < last; ++k)
+		{
+			if((self->x[k] - x) * (self->x[k] - x) + (self->y[k] - y) * (self->y[k] - y) <= radius_squ) return true;
+		}
+	}
+	
+	return false;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Determine range of grid cells overlapping with a box              //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) x_min    - Lower boundary of box in x.                      //
+//   (3) x_max    - Upper boundary of box in x.                      //
+//   (4) y_min    - Lower boundary of box in y.                      //
+//   (5) y_max    - Upper boundary of box in y.                      //
+//   (6) cx_min   - Pointer to first cell in x to be returned.       //
+//   (7) cx_max   - Pointer to last cell in x to be returned.        //
+//   (8) cy_min   - Pointer to first cell in y to be returned.       //
+//   (9) cy_max   - Pointer to last cell in y to be returned.        //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private method for determining the range of grid cells that     //
+//   overlap with the specified box. Cell indices will be clipped to //
+//   the valid range of the grid.                                    //
+// ----------------------------------------------------------------- //
+
+PRIVATE void PointGrid_get_cells(const PointGrid *self, const double x_min, const double x_max, const double y_min, const double y_max, size_t *cx_min, size_t *cx_max, size_t *cy_min, size_t *cy_max)
+{
+	const double cx1 = floor((x_min - self->origin_x) / self->cell_size);
+	const double cx2 = floor((x_max - self->origin_x) / self->cell_size);
+	const double cy1 = floor((y_min - self->origin_y) / self->cell_size);
+	const double cy2 = floor((y_max - self->origin_y) / self->cell_size);
+	
+	*cx_min = cx1 < 0.0 ? 0 : (cx1 >= self->n_cells_x ? self->n_cells_x - 1 : (size_t)cx1);
+	*cx_max = cx2 < 0.0 ? 0 : (cx2 >= self->n_cells_x ? self->n_cells_x - 1 : (size_t)cx2);
+	*cy_min = cy1 < 0.0 ? 0 : (cy1 >= self->n_cells_y ? self->n_cells_y - 1 : (size_t)cy1);
+	*cy_max = cy2 < 0.0 ? 0 : (cy2 >= self->n_cells_y ? self->n_cells_y - 1 : (size_t)cy2);
+	
+	return;
+}
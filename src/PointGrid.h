@@ -0,0 +1,62 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (PointGrid.h) - Source Finding Application               ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#ifndef POINTGRID_H
+#define POINTGRID_H
+
+#include "common.h"
+
+
+// ----------------------------------------------------------------- //
+// Class 'PointGrid'                                                 //
+// ----------------------------------------------------------------- //
+// The purpose of this class is to provide a spatial index for a set //
+// of 2-D positions, e.g. pixel positions read from a catalogue. The //
+// positions are sorted into a regular grid of square cells, so that //
+// all positions near a given location or within a given box can be  //
+// found without having to search through the entire list.           //
+// ----------------------------------------------------------------- //
+
+typedef CLASS PointGrid PointGrid;
+
+// Constructor and destructor
+PUBLIC PointGrid    *PointGrid_new          (const double *x, const double *y, const size_t size, const double cell_size);
+PUBLIC void          PointGrid_delete       (PointGrid *self);
+
+// Public methods
+PUBLIC size_t        PointGrid_get_size     (const PointGrid *self);
+PUBLIC bool          PointGrid_any_in_box   (const PointGrid *self, const double x_min, const double x_max, const double y_min, const double y_max);
+PUBLIC bool          PointGrid_any_in_radius(const PointGrid *self, const double x, const double y, const double radius);
+
+// Private methods
+PRIVATE void         PointGrid_get_cells    (const PointGrid *self, const double x_min, const double x_max, const double y_min, const double y_max, size_t *cx_min, size_t *cx_max, size_t *cy_min, size_t *cy_max);
+
+#endif
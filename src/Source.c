@@ -36,6 +36,7 @@
 #include <time.h>
 
 #include "Source.h"
+#include "Catalog.h"
 #include "String.h"
 
 
@@ -61,6 +62,8 @@ CLASS Source
 	String        **names;
 	String        **units;
 	String        **ucds;
+	Catalog        *catalog;
+	size_t          row;
 	int             verbosity;
 };
 
@@ -100,6 +103,8 @@ PUBLIC Source *Source_new(const bool verbosity)
 	self->names      = NULL;
 	self->units      = NULL;
 	self->ucds       = NULL;
+	self->catalog    = NULL;
+	self->row        = 0;
 	
 	self->verbosity  = verbosity;
 	
@@ -177,7 +182,8 @@ PUBLIC void Source_delete(Source *self)
 PUBLIC void Source_set_identifier(Source *self, const char *name)
 {
 	check_null(self);
-	String_set(self->identifier, name);
+	if(self->catalog != NULL) Catalog_set_identifier(self->catalog, self->row, name);
+	else String_set(self->identifier, name);
 	return;
 }
 
@@ -216,6 +222,13 @@ PUBLIC void Source_add_par_flt(Source *self, const char *name, const double valu
 	check_null(unit);
 	check_null(ucd);
 	
+	// Sources in a catalogue are stored in the catalogue's columns
+	if(self->catalog != NULL)
+	{
+		Catalog_set_flt(self->catalog, self->row, Catalog_add_column(self->catalog, name, SOURCE_TYPE_FLT, unit, ucd), value);
+		return;
+	}
+	
 	// Reserve memory for one additional parameter
 	Source_append_memory(self);
 	
@@ -263,6 +276,13 @@ PUBLIC void Source_add_par_int(Source *self, const char *name, const long int va
 	check_null(unit);
 	check_null(ucd);
 	
+	// Sources in a catalogue are stored in the catalogue's columns
+	if(self->catalog != NULL)
+	{
+		Catalog_set_int(self->catalog, self->row, Catalog_add_column(self->catalog, name, SOURCE_TYPE_INT, unit, ucd), value);
+		return;
+	}
+	
 	// Reserve memory for one additional parameter
 	Source_append_memory(self);
 	
@@ -311,6 +331,13 @@ PUBLIC void Source_set_par_flt(Source *self, const char *name, const double valu
 	check_null(self);
 	check_null(name);
 	
+	// Sources in a catalogue are stored in the catalogue's columns
+	if(self->catalog != NULL)
+	{
+		Catalog_set_flt(self->catalog, self->row, Catalog_add_column(self->catalog, name, SOURCE_TYPE_FLT, unit, ucd), value);
+		return;
+	}
+	
 	// Check if parameter of same name already exists
 	size_t index = 0;
 	
@@ -368,6 +395,13 @@ PUBLIC void Source_set_par_int(Source *self, const char *name, const long int va
 	check_null(self);
 	check_null(name);
 	
+	// Sources in a catalogue are stored in the catalogue's columns
+	if(self->catalog != NULL)
+	{
+		Catalog_set_int(self->catalog, self->row, Catalog_add_column(self->catalog, name, SOURCE_TYPE_INT, unit, ucd), value);
+		return;
+	}
+	
 	// Check if parameter already exists
 	size_t index = 0;
 	
@@ -415,6 +449,7 @@ PUBLIC void Source_set_par_int(Source *self, const char *name, const long int va
 PUBLIC double Source_get_par_flt(const Source *self, const size_t index)
 {
 	check_null(self);
+	if(self->catalog != NULL) return Catalog_get_flt(self->catalog, self->row, index);
 	ensure(index < self->n_par, ERR_INDEX_RANGE, "Source parameter index out of range.");
 	return self->values[index].value_flt;
 }
@@ -442,6 +477,7 @@ PUBLIC double Source_get_par_flt(const Source *self, const size_t index)
 PUBLIC long int Source_get_par_int(const Source *self, const size_t index)
 {
 	check_null(self);
+	if(self->catalog != NULL) return Catalog_get_int(self->catalog, self->row, index);
 	ensure(index < self->n_par, ERR_INDEX_RANGE, "Source parameter index out of range.");
 	return self->values[index].value_int;
 }
@@ -472,6 +508,8 @@ PUBLIC double Source_get_par_by_name_flt(const Source *self, const char *name)
 {
 	check_null(self);
 	check_null(name);
+	size_t index = 0;
+	if(self->catalog != NULL && Catalog_column_exists(self->catalog, name, &index)) return Catalog_get_flt(self->catalog, self->row, index);
 	for(size_t i = self->n_par; i--;) if(String_compare(self->names[i], name)) return self->values[i].value_flt;
 	warning_verb(self->verbosity, "Parameter \'%s\' not found.", name);
 	return NAN;
@@ -503,6 +541,8 @@ PUBLIC long int Source_get_par_by_name_int(const Source *self, const char *name)
 {
 	check_null(self);
 	check_null(name);
+	size_t index = 0;
+	if(self->catalog != NULL && Catalog_column_exists(self->catalog, name, &index)) return Catalog_get_int(self->catalog, self->row, index);
 	for(size_t i = self->n_par; i--;) if(String_compare(self->names[i], name)) return self->values[i].value_int;
 	warning_verb(self->verbosity, "Parameter \'%s\' not found.", name);
 	return 0;
@@ -539,6 +579,22 @@ PUBLIC void Source_offset_xyz(Source *self, const size_t dx, const size_t dy, co
 	
 	size_t index = 0;
 	
+	if(self->catalog != NULL)
+	{
+		if(Catalog_column_exists(self->catalog, "x", &index)) Catalog_set_flt(self->catalog, self->row, index, Catalog_get_flt(self->catalog, self->row, index) + (double)dx);
+		if(Catalog_column_exists(self->catalog, "y", &index)) Catalog_set_flt(self->catalog, self->row, index, Catalog_get_flt(self->catalog, self->row, index) + (double)dy);
+		if(Catalog_column_exists(self->catalog, "z", &index)) Catalog_set_flt(self->catalog, self->row, index, Catalog_get_flt(self->catalog, self->row, index) + (double)dz);
+		
+		if(Catalog_column_exists(self->catalog, "x_min", &index)) Catalog_set_int(self->catalog, self->row, index, Catalog_get_int(self->catalog, self->row, index) + dx);
+		if(Catalog_column_exists(self->catalog, "x_max", &index)) Catalog_set_int(self->catalog, self->row, index, Catalog_get_int(self->catalog, self->row, index) + dx);
+		if(Catalog_column_exists(self->catalog, "y_min", &index)) Catalog_set_int(self->catalog, self->row, index, Catalog_get_int(self->catalog, self->row, index) + dy);
+		if(Catalog_column_exists(self->catalog, "y_max", &index)) Catalog_set_int(self->catalog, self->row, index, Catalog_get_int(self->catalog, self->row, index) + dy);
+		if(Catalog_column_exists(self->catalog, "z_min", &index)) Catalog_set_int(self->catalog, self->row, index, Catalog_get_int(self->catalog, self->row, index) + dz);
+		if(Catalog_column_exists(self->catalog, "z_max", &index)) Catalog_set_int(self->catalog, self->row, index, Catalog_get_int(self->catalog, self->row, index) + dz);
+		
+		return;
+	}
+	
 	if(Source_par_exists(self, "x", &index)) self->values[index].value_flt += (double)dx;
 	if(Source_par_exists(self, "y", &index)) self->values[index].value_flt += (double)dy;
 	if(Source_par_exists(self, "z", &index)) self->values[index].value_flt += (double)dz;
@@ -586,6 +642,8 @@ PUBLIC bool Source_par_exists(const Source *self, const char *name, size_t *inde
 	check_null(self);
 	check_null(name);
 	
+	if(self->catalog != NULL) return Catalog_column_exists(self->catalog, name, index);
+	
 	for(size_t i = self->n_par; --i;)
 	{
 		if(String_compare(self->names[i], name))
@@ -622,6 +680,7 @@ PUBLIC bool Source_par_exists(const Source *self, const char *name, size_t *inde
 PUBLIC const char *Source_get_name(const Source *self, const size_t index)
 {
 	check_null(self);
+	if(self->catalog != NULL) return Catalog_get_name(self->catalog, index);
 	ensure(index < self->n_par, ERR_INDEX_RANGE, "Source parameter index out of range.");
 	return String_get(self->names[index]);
 }
@@ -650,6 +709,7 @@ PUBLIC const char *Source_get_name(const Source *self, const size_t index)
 PUBLIC const char *Source_get_unit(const Source *self, const size_t index)
 {
 	check_null(self);
+	if(self->catalog != NULL) return Catalog_get_unit(self->catalog, index);
 	ensure(index < self->n_par, ERR_INDEX_RANGE, "Source parameter index out of range.");
 	return String_get(self->units[index]);
 }
@@ -678,6 +738,7 @@ PUBLIC const char *Source_get_unit(const Source *self, const size_t index)
 PUBLIC unsigned char Source_get_type(const Source *self, const size_t index)
 {
 	check_null(self);
+	if(self->catalog != NULL) return Catalog_get_type(self->catalog, index);
 	ensure(index < self->n_par, ERR_INDEX_RANGE, "Source parameter index out of range.");
 	return self->types[index];
 }
@@ -706,6 +767,7 @@ PUBLIC unsigned char Source_get_type(const Source *self, const size_t index)
 PUBLIC const char *Source_get_ucd(const Source *self, const size_t index)
 {
 	check_null(self);
+	if(self->catalog != NULL) return Catalog_get_ucd(self->catalog, index);
 	ensure(index < self->n_par, ERR_INDEX_RANGE, "Source parameter index out of range.");
 	return String_get(self->ucds[index]);
 }
@@ -733,6 +795,7 @@ PUBLIC const char *Source_get_ucd(const Source *self, const size_t index)
 PUBLIC const char *Source_get_identifier(const Source *self)
 {
 	check_null(self);
+	if(self->catalog != NULL) return Catalog_get_identifier(self->catalog, self->row);
 	return String_get(self->identifier);
 }
 
@@ -758,11 +821,98 @@ PUBLIC const char *Source_get_identifier(const Source *self)
 PUBLIC size_t Source_get_num_par(const Source *self)
 {
 	check_null(self);
+	if(self->catalog != NULL) return Catalog_get_num_col(self->catalog);
 	return self->n_par;
 }
 
 
 
+// ----------------------------------------------------------------- //
+// Turn source into view of catalogue row                            //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) catalog  - Catalogue the source belongs to.                 //
+//   (3) row      - Row of the source in the catalogue.              //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for turning the specified source into a view of   //
+//   the specified catalogue row. Any parameters and the identifier  //
+//   currently stored in the source itself will be discarded, and    //
+//   all subsequent access will instead be redirected to the cata-   //
+//   logue. This method is meant to be called only by the Catalog    //
+//   class when a source is added to a catalogue, after its parame-  //
+//   ters have been copied into the catalogue's columns.             //
+// ----------------------------------------------------------------- //
+
+PUBLIC void Source_attach(Source *self, Catalog *catalog, const size_t row)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(catalog);
+	ensure(self->catalog == NULL, ERR_USER_INPUT, "Source is already part of a catalogue.");
+	
+	// Release parameters stored in source
+	for(size_t i = self->n_par; i--;)
+	{
+		String_delete(self->names[i]);
+		String_delete(self->units[i]);
+		String_delete(self->ucds[i]);
+	}
+	
+	String_delete(self->identifier);
+	free(self->values);
+	free(self->types);
+	free(self->names);
+	free(self->units);
+	free(self->ucds);
+	
+	self->identifier = NULL;
+	self->n_par      = 0;
+	self->values     = NULL;
+	self->types      = NULL;
+	self->names      = NULL;
+	self->units      = NULL;
+	self->ucds       = NULL;
+	self->catalog    = catalog;
+	self->row        = row;
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Check if source is part of a catalogue                            //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   True if the source is part of a catalogue, false otherwise.     //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for checking if the specified source has been     //
+//   added to a catalogue and hence is a view of a catalogue row.    //
+// ----------------------------------------------------------------- //
+
+PUBLIC bool Source_is_attached(const Source *self)
+{
+	check_null(self);
+	return self->catalog != NULL;
+}
+
+
+
 // ----------------------------------------------------------------- //
 // Reallocate memory for one additional parameter                    //
 // ----------------------------------------------------------------- //
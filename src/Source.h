@@ -47,10 +47,16 @@
 // double-precision floating-point values are supported. In addi-    //
 // tion, a source can be assigned an identifier in the form of a     //
 // string, e.g. a source name.                                       //
+// Once a source has been added to a catalogue, its parameters will  //
+// be stored in the columns of the catalogue, and the source object  //
+// will merely act as a view of the corresponding catalogue row.     //
 // ----------------------------------------------------------------- //
 
 typedef CLASS Source Source;
 
+// Forward declaration of class 'Catalog' (see Catalog.h)
+CLASS Catalog;
+
 // Constructor and destructor
 PUBLIC  Source       *Source_new                 (const bool verbosity);
 PUBLIC  void          Source_delete              (Source *self);
@@ -79,6 +85,9 @@ PUBLIC  const char   *Source_get_unit            (const Source *self, const size
 PUBLIC  unsigned char Source_get_type            (const Source *self, const size_t index);
 PUBLIC  const char   *Source_get_ucd             (const Source *self, const size_t index);
 
+PUBLIC  void          Source_attach              (Source *self, CLASS Catalog *catalog, const size_t row);
+PUBLIC  bool          Source_is_attached         (const Source *self);
+
 // Private methods
 PRIVATE void          Source_append_memory       (Source *self);
 
@@ -0,0 +1,436 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (SparseMask.c) - Source Finding Application              ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SparseMask.h"
+
+
+
+// ----------------------------------------------------------------- //
+// Declaration of properties of class SparseMask                     //
+// ----------------------------------------------------------------- //
+
+CLASS SparseMask
+{
+	size_t   size[3];
+	size_t   n_runs;
+	size_t  *row;
+	size_t  *x;
+	size_t  *length;
+	int32_t *label;
+};
+
+
+
+// ----------------------------------------------------------------- //
+// Standard constructor                                              //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) data     - Pointer to dense 32-bit mask to be encoded.      //
+//   (2) size_x   - Size of the mask in x.                           //
+//   (3) size_y   - Size of the mask in y.                           //
+//   (4) size_z   - Size of the mask in z.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Pointer to newly created SparseMask object.                     //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Standard constructor. Will create a new SparseMask object by    //
+//   run-length encoding the specified dense mask, which must be     //
+//   stored in the same order as a data cube, i.e. with x varying    //
+//   fastest. Every sequence of consecutive non-zero pixels of the   //
+//   same value along the x-axis will be stored as a single run. The //
+//   encoding is done in two passes over all rows, the first one to  //
+//   count the runs in each row and the second one to record them,   //
+//   such that both can be carried out in parallel. Note that the    //
+//   destructor will need to be called explicitly once the object is //
+//   no longer required to release any memory allocated during the   //
+//   lifetime of the object.                                         //
+// ----------------------------------------------------------------- //
+
+PUBLIC SparseMask *SparseMask_new(const int32_t *data, const size_t size_x, const size_t size_y, const size_t size_z)
+{
+	// Sanity checks
+	check_null(data);
+	ensure(size_x && size_y && size_z, ERR_USER_INPUT, "Cannot create sparse mask for empty cube.");
+	
+	SparseMask *self = (SparseMask *)memory(MALLOC, 1, sizeof(SparseMask));
+	
+	self->size[0] = size_x;
+	self->size[1] = size_y;
+	self->size[2] = size_z;
+	
+	const size_t n_rows = size_y * size_z;
+	self->row = (size_t *)memory(CALLOC, n_rows + 1, sizeof(size_t));
+	
+	// Count runs per row
+	#pragma omp parallel for schedule(static)
+	for(size_t r = 0; r < n_rows; ++r)
+	{
+		const int32_t *ptr = data + r * size_x;
+		size_t counter = 0;
+		int32_t previous = 0;
+		
+		for(size_t x = 0; x < size_x; ++x)
+		{
+			counter += (ptr[x] != 0 && ptr[x] != previous);
+			previous = ptr[x];
+		}
+		
+		self->row[r + 1] = counter;
+	}
+	
+	// Convert counts into offsets
+	for(size_t r = 0; r < n_rows; ++r) self->row[r + 1] += self->row[r];
+	self->n_runs = self->row[n_rows];
+	
+	self->x      = (size_t  *)memory(MALLOC, self->n_runs ? self->n_runs : 1, sizeof(size_t));
+	self->length = (size_t  *)memory(MALLOC, self->n_runs ? self->n_runs : 1, sizeof(size_t));
+	self->label  = (int32_t *)memory(MALLOC, self->n_runs ? self->n_runs : 1, sizeof(int32_t));
+	
+	// Record runs
+	#pragma omp parallel for schedule(static)
+	for(size_t r = 0; r < n_rows; ++r)
+	{
+		if(self->row[r + 1] == self->row[r]) continue;
+		
+		const int32_t *ptr = data + r * size_x;
+		size_t i = self->row[r];
+		size_t x = 0;
+		
+		while(x < size_x)
+		{
+			const int32_t value = ptr[x];
+			const size_t x_start = x;
+			while(++x < size_x && ptr[x] == value);
+			
+			if(value)
+			{
+				self->x[i]      = x_start;
+				self->length[i] = x - x_start;
+				self->label[i]  = value;
+				++i;
+			}
+		}
+	}
+	
+	return self;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Destructor                                                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Destructor. Note that the destructor must be called explicitly  //
+//   if the object is no longer required. This will release the me-  //
+//   mory occupied by the object.                                    //
+// ----------------------------------------------------------------- //
+
+PUBLIC void SparseMask_delete(SparseMask *self)
+{
+	if(self != NULL)
+	{
+		free(self->row);
+		free(self->x);
+		free(self->length);
+		free(self->label);
+	}
+	free(self);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return size of mask along specified axis                          //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) axis     - Axis (0, 1 or 2) for which to return the size.   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Size of the mask along the specified axis.                      //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the size of the dense mask from     //
+//   which the sparse mask was created along the specified axis.     //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t SparseMask_get_axis_size(const SparseMask *self, const size_t axis)
+{
+	check_null(self);
+	ensure(axis < 3, ERR_INDEX_RANGE, "Axis must be 0, 1 or 2.");
+	return self->size[axis];
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return total number of runs                                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Total number of runs stored in the sparse mask.                 //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the total number of runs of label-  //
+//   led pixels stored in the sparse mask.                           //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t SparseMask_get_size(const SparseMask *self)
+{
+	check_null(self);
+	return self->n_runs;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return runs of a single row                                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) y        - y coordinate of the row.                         //
+//   (3) z        - z coordinate of the row.                         //
+//   (4) x        - Will point to the x coordinates of the first     //
+//                  pixel of each run.                               //
+//   (5) length   - Will point to the number of pixels of each run.  //
+//   (6) label    - Will point to the label of each run.             //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of runs in the specified row.                            //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for retrieving all runs in the specified (y, z)   //
+//   row of the mask. The runs are sorted by increasing x coordinate //
+//   and do not overlap. The pointers returned are only valid for as //
+//   long as the object exists and must not be freed by the caller.  //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t SparseMask_get_row(const SparseMask *self, const size_t y, const size_t z, const size_t **x, const size_t **length, const int32_t **label)
+{
+	check_null(self);
+	ensure(y < self->size[1] && z < self->size[2], ERR_INDEX_RANGE, "Row index out of range.");
+	
+	const size_t r = y + self->size[1] * z;
+	*x      = self->x      + self->row[r];
+	*length = self->length + self->row[r];
+	*label  = self->label  + self->row[r];
+	
+	return self->row[r + 1] - self->row[r];
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Decode sparse mask into dense mask                                //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) data     - Pointer to dense 32-bit mask to be filled.       //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for writing the sparse mask into the specified    //
+//   dense 32-bit mask, which must be large enough to hold all pix-  //
+//   els of the cube from which the sparse mask was created. Pixels  //
+//   not covered by any run will be set to 0. Rows are processed in  //
+//   parallel, with each thread writing an entire row at a time.     //
+// ----------------------------------------------------------------- //
+
+PUBLIC void SparseMask_decode(const SparseMask *self, int32_t *data)
+{
+	check_null(self);
+	check_null(data);
+	
+	const size_t size_x = self->size[0];
+	const size_t n_rows = self->size[1] * self->size[2];
+	
+	#pragma omp parallel for schedule(static)
+	for(size_t r = 0; r < n_rows; ++r)
+	{
+		int32_t *ptr = data + r * size_x;
+		memset(ptr, 0, size_x * sizeof(int32_t));
+		
+		for(size_t i = self->row[r]; i < self->row[r + 1]; ++i)
+		{
+			for(size_t x = self->x[i]; x < self->x[i] + self->length[i]; ++x) ptr[x] = self->label[i];
+		}
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Decode single plane of sparse mask                                //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) z        - z coordinate of the plane to be decoded.         //
+//   (3) data     - Pointer to dense 32-bit image to be filled.      //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for writing a single xy plane of the sparse mask  //
+//   into the specified dense 32-bit image, which must be large      //
+//   enough to hold size_x * size_y pixels. Pixels not covered by    //
+//   any run will be set to 0. This allows the dense mask to be      //
+//   written to disc plane by plane without ever holding the entire  //
+//   dense mask in memory.                                           //
+// ----------------------------------------------------------------- //
+
+PUBLIC void SparseMask_decode_plane(const SparseMask *self, const size_t z, int32_t *data)
+{
+	check_null(self);
+	check_null(data);
+	ensure(z < self->size[2], ERR_INDEX_RANGE, "Plane index out of range.");
+	
+	const size_t size_x = self->size[0];
+	const size_t size_y = self->size[1];
+	memset(data, 0, size_x * size_y * sizeof(int32_t));
+	
+	for(size_t y = 0; y < size_y; ++y)
+	{
+		const size_t r = y + size_y * z;
+		int32_t *ptr = data + y * size_x;
+		
+		for(size_t i = self->row[r]; i < self->row[r + 1]; ++i)
+		{
+			for(size_t x = self->x[i]; x < self->x[i] + self->length[i]; ++x) ptr[x] = self->label[i];
+		}
+	}
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Relabel sources                                                   //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) filter   - Map object with old and new label pairs of all   //
+//                  sources to be retained.                          //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for relabelling all runs of the sparse mask in    //
+//   the same way as DataCube_filter_mask_32() relabels a dense mask //
+//   cube. Runs with a positive label contained in the filter will   //
+//   be assigned their new label, while all other runs with a posi-  //
+//   tive label will be removed. Runs with a negative label will be  //
+//   retained unchanged. The remaining runs are compacted in place,  //
+//   so the number of runs can only decrease.                        //
+// ----------------------------------------------------------------- //
+
+PUBLIC void SparseMask_relabel(SparseMask *self, const Map *filter)
+{
+	check_null(self);
+	check_null(filter);
+	
+	const size_t n_rows = self->size[1] * self->size[2];
+	size_t counter = 0;
+	
+	for(size_t r = 0; r < n_rows; ++r)
+	{
+		const size_t first = self->row[r];
+		const size_t last  = self->row[r + 1];
+		self->row[r] = counter;
+		
+		for(size_t i = first; i < last; ++i)
+		{
+			int32_t label = self->label[i];
+			
+			if(label > 0)
+			{
+				label = Map_key_exists(filter, label) ? Map_get_value(filter, label) : 0;
+				if(label == 0) continue;
+			}
+			
+			self->x[counter]      = self->x[i];
+			self->length[counter] = self->length[i];
+			self->label[counter]  = label;
+			++counter;
+		}
+	}
+	
+	self->row[n_rows] = counter;
+	self->n_runs = counter;
+	
+	return;
+}
@@ -0,0 +1,68 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (SparseMask.h) - Source Finding Application              ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#ifndef SPARSEMASK_H
+#define SPARSEMASK_H
+
+#include <stdint.h>
+
+#include "common.h"
+#include "Map.h"
+
+
+// ----------------------------------------------------------------- //
+// Class 'SparseMask'                                                //
+// ----------------------------------------------------------------- //
+// The purpose of this class is to provide a sparse representation   //
+// of a labelled 32-bit source mask. Voxels are stored as runs of    //
+// consecutive pixels along the x-axis that share the same label,    //
+// with the runs of each (y, z) row stored contiguously in order of  //
+// increasing x and the rows themselves stored in the same order as  //
+// in the data cube. As source masks are typically very sparse, this //
+// is much more compact than the dense mask, and operations that     //
+// only need to visit labelled voxels can run directly on the runs.  //
+// ----------------------------------------------------------------- //
+
+typedef CLASS SparseMask SparseMask;
+
+// Constructor and destructor
+PUBLIC SparseMask *SparseMask_new          (const int32_t *data, const size_t size_x, const size_t size_y, const size_t size_z);
+PUBLIC void        SparseMask_delete       (SparseMask *self);
+
+// Public methods
+PUBLIC size_t      SparseMask_get_axis_size(const SparseMask *self, const size_t axis);
+PUBLIC size_t      SparseMask_get_size     (const SparseMask *self);
+PUBLIC size_t      SparseMask_get_row      (const SparseMask *self, const size_t y, const size_t z, const size_t **x, const size_t **length, const int32_t **label);
+PUBLIC void        SparseMask_decode       (const SparseMask *self, int32_t *data);
+PUBLIC void        SparseMask_decode_plane (const SparseMask *self, const size_t z, int32_t *data);
+PUBLIC void        SparseMask_relabel      (SparseMask *self, const Map *filter);
+
+#endif
@@ -0,0 +1,632 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (VoxelIndex.c) - Source Finding Application              ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#include <stdlib.h>
+
+#include "VoxelIndex.h"
+
+
+
+// ----------------------------------------------------------------- //
+// Declaration of properties of class VoxelIndex                     //
+// ----------------------------------------------------------------- //
+
+CLASS VoxelIndex
+{
+	size_t    n_runs;
+	size_t    capacity;
+	uint32_t *label;
+	VoxelRun *run;
+	size_t    max_label;
+	size_t   *offset;
+	bool      finalised;
+};
+
+
+
+// ----------------------------------------------------------------- //
+// Declaration of a single run of voxels along the x-axis            //
+// ----------------------------------------------------------------- //
+
+struct VoxelRun
+{
+	uint64_t yz;      // y in lower and z in upper 32 bits
+	uint32_t x;
+	uint32_t length;
+};
+
+
+
+// ----------------------------------------------------------------- //
+// Standard constructor                                              //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   No arguments.                                                   //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Pointer to newly created VoxelIndex object.                     //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Standard constructor. Will create a new and empty VoxelIndex    //
+//   object. Note that the destructor will need to be called expli-  //
+//   citly once the object is no longer required to release any me-  //
+//   mory allocated during the lifetime of the object.               //
+// ----------------------------------------------------------------- //
+
+PUBLIC VoxelIndex *VoxelIndex_new(void)
+{
+	VoxelIndex *self = (VoxelIndex *)memory(MALLOC, 1, sizeof(VoxelIndex));
+	
+	self->n_runs    = 0;
+	self->capacity  = 0;
+	self->label     = NULL;
+	self->run       = NULL;
+	self->max_label = 0;
+	self->offset    = (size_t *)memory(CALLOC, 2, sizeof(size_t));
+	self->finalised = true;
+	
+	return self;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Destructor                                                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Destructor. Note that the destructor must be called explicitly  //
+//   if the object is no longer required. This will release the me-  //
+//   mory occupied by the object.                                    //
+// ----------------------------------------------------------------- //
+
+PUBLIC void VoxelIndex_delete(VoxelIndex *self)
+{
+	if(self != NULL)
+	{
+		free(self->label);
+		free(self->run);
+		free(self->offset);
+	}
+	free(self);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Remove all runs                                                   //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for removing all runs from the index. Allocated   //
+//   memory will be retained so that the index can be refilled with- //
+//   out reallocation.                                               //
+// ----------------------------------------------------------------- //
+
+PUBLIC void VoxelIndex_clear(VoxelIndex *self)
+{
+	check_null(self);
+	
+	self->n_runs = 0;
+	self->max_label = 0;
+	self->offset = (size_t *)memory_realloc(self->offset, 2, sizeof(size_t));
+	self->offset[0] = self->offset[1] = 0;
+	self->finalised = true;
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Add run of voxels                                                 //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) label    - Source label of the run; must be > 0.            //
+//   (3) x        - x coordinate of first voxel of the run.          //
+//   (4) y        - y coordinate of the run.                         //
+//   (5) z        - z coordinate of the run.                         //
+//   (6) length   - Number of consecutive voxels along x.            //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for adding a run of consecutive voxels along the  //
+//   x-axis to the index. Runs can be added in any order, but the    //
+//   index will need to be finalised by calling VoxelIndex_final-    //
+//   ise() before any runs can be retrieved. If the new run directly //
+//   adjoins the previously added run of the same label along x, the //
+//   previous run will be extended instead, so that voxels added one //
+//   at a time in roughly sequential order remain compact.           //
+// ----------------------------------------------------------------- //
+
+PUBLIC void VoxelIndex_push(VoxelIndex *self, const size_t label, const size_t x, const size_t y, const size_t z, const size_t length)
+{
+	// Sanity checks
+	check_null(self);
+	ensure(label, ERR_USER_INPUT, "Source label of 0 passed to voxel index.");
+	ensure(label <= UINT32_MAX && x + length <= UINT32_MAX && y <= UINT32_MAX && z <= UINT32_MAX, ERR_INDEX_RANGE, "Voxel position or label too large for voxel index.");
+	
+	const uint64_t yz = (uint64_t)y | ((uint64_t)z << 32);
+	
+	// Extend previous run if adjoining
+	if(self->n_runs && self->label[self->n_runs - 1] == label && self->run[self->n_runs - 1].yz == yz)
+	{
+		VoxelRun *prev = self->run + self->n_runs - 1;
+		
+		if(prev->x + prev->length == x)
+		{
+			prev->length += length;
+			self->finalised = false;
+			return;
+		}
+		
+		if(x + length == prev->x)
+		{
+			prev->x = x;
+			prev->length += length;
+			self->finalised = false;
+			return;
+		}
+	}
+	
+	// Increase memory if necessary
+	if(self->n_runs == self->capacity)
+	{
+		self->capacity = self->capacity ? 2 * self->capacity : 1024;
+		self->label = (uint32_t *)memory_realloc(self->label, self->capacity, sizeof(uint32_t));
+		self->run   = (VoxelRun *)memory_realloc(self->run,   self->capacity, sizeof(VoxelRun));
+	}
+	
+	// Append run
+	self->label[self->n_runs]        = label;
+	self->run[self->n_runs].yz       = yz;
+	self->run[self->n_runs].x        = x;
+	self->run[self->n_runs].length   = length;
+	++self->n_runs;
+	
+	if(label > self->max_label) self->max_label = label;
+	self->finalised = false;
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Discard runs of most recently added source                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) label    - Source label of the runs to be discarded.        //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for removing all runs with the specified label    //
+//   from the end of the index. This is meant for discarding a       //
+//   source that was added last, e.g. by the linker when the source  //
+//   turns out to violate the size requirements. Runs of the same    //
+//   label added before any run of another label will be retained.   //
+// ----------------------------------------------------------------- //
+
+PUBLIC void VoxelIndex_discard(VoxelIndex *self, const size_t label)
+{
+	check_null(self);
+	
+	while(self->n_runs && self->label[self->n_runs - 1] == label) --self->n_runs;
+	self->finalised = false;
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Group runs by source label                                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for grouping all runs by their source label using //
+//   a stable counting sort, and for setting up the offset array via //
+//   which the runs of each label can be accessed. The runs of each  //
+//   label are then sorted in the order z, y, x (unless they already //
+//   are), and runs adjoining each other along x are merged. This    //
+//   method must be called after adding new runs and before retrie-  //
+//   ving any runs.                                                  //
+// ----------------------------------------------------------------- //
+
+PUBLIC void VoxelIndex_finalise(VoxelIndex *self)
+{
+	check_null(self);
+	if(self->finalised) return;
+	
+	// Count runs per label
+	self->offset = (size_t *)memory_realloc(self->offset, self->max_label + 2, sizeof(size_t));
+	for(size_t i = 0; i < self->max_label + 2; ++i) self->offset[i] = 0;
+	for(size_t i = 0; i < self->n_runs; ++i) ++self->offset[self->label[i] + 1];
+	for(size_t i = 0; i <= self->max_label; ++i) self->offset[i + 1] += self->offset[i];
+	
+	// Move runs to their new position
+	size_t   *position = (size_t *)memory(MALLOC, self->max_label + 1, sizeof(size_t));
+	uint32_t *label    = (uint32_t *)memory(MALLOC, self->capacity ? self->capacity : 1, sizeof(uint32_t));
+	VoxelRun *run      = (VoxelRun *)memory(MALLOC, self->capacity ? self->capacity : 1, sizeof(VoxelRun));
+	for(size_t i = 0; i <= self->max_label; ++i) position[i] = self->offset[i];
+	
+	for(size_t i = 0; i < self->n_runs; ++i)
+	{
+		const size_t target = position[self->label[i]]++;
+		label[target] = self->label[i];
+		run[target]   = self->run[i];
+	}
+	
+	free(position);
+	free(self->label);
+	free(self->run);
+	self->label = label;
+	self->run   = run;
+	
+	// Sort runs of each label in the order z, y, x
+	#pragma omp parallel for schedule(dynamic, 64)
+	for(size_t i = 1; i <= self->max_label; ++i)
+	{
+		for(size_t j = self->offset[i] + 1; j < self->offset[i + 1]; ++j)
+		{
+			if(VoxelIndex_cmp_run(run + j - 1, run + j) > 0)
+			{
+				qsort(run + self->offset[i], self->offset[i + 1] - self->offset[i], sizeof(VoxelRun), VoxelIndex_cmp_run);
+				break;
+			}
+		}
+	}
+	
+	// Merge adjoining runs of the same label
+	size_t counter = 0;
+	
+	for(size_t i = 1; i <= self->max_label; ++i)
+	{
+		const size_t first = self->offset[i];
+		const size_t last  = self->offset[i + 1];
+		self->offset[i] = counter;
+		
+		for(size_t j = first; j < last; ++j)
+		{
+			if(counter > self->offset[i] && run[counter - 1].yz == run[j].yz && run[counter - 1].x + run[counter - 1].length == run[j].x)
+			{
+				run[counter - 1].length += run[j].length;
+			}
+			else
+			{
+				label[counter] = i;
+				run[counter] = run[j];
+				++counter;
+			}
+		}
+	}
+	
+	self->offset[self->max_label + 1] = counter;
+	self->n_runs = counter;
+	self->finalised = true;
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return number of sources                                          //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of source labels with at least one run.                  //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the number of distinct source la-   //
+//   bels contained in the index.                                    //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t VoxelIndex_get_size(const VoxelIndex *self)
+{
+	check_null(self);
+	ensure(self->finalised, ERR_FAILURE, "Voxel index must be finalised before use.");
+	
+	size_t counter = 0;
+	for(size_t i = 1; i <= self->max_label; ++i) counter += (self->offset[i + 1] > self->offset[i]);
+	
+	return counter;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return largest source label                                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Largest source label contained in the index.                    //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the largest source label contained  //
+//   in the index. All labels from 1 to the value returned can be    //
+//   passed to VoxelIndex_get_runs(), although some of them may not  //
+//   have any runs associated with them.                             //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t VoxelIndex_get_max_label(const VoxelIndex *self)
+{
+	check_null(self);
+	return self->max_label;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return range of runs belonging to a source                        //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) label    - Source label.                                    //
+//   (3) first    - Pointer to index of first run to be returned.    //
+//   (4) last     - Pointer to index of last run + 1 to be returned. //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of runs belonging to the specified source.               //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for determining the range of run indices, first   //
+//   to last - 1, belonging to the specified source label. The runs  //
+//   can then be retrieved with VoxelIndex_get_run(). If the label   //
+//   does not exist, first and last will be equal and 0 returned.    //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t VoxelIndex_get_runs(const VoxelIndex *self, const size_t label, size_t *first, size_t *last)
+{
+	check_null(self);
+	ensure(self->finalised, ERR_FAILURE, "Voxel index must be finalised before use.");
+	
+	if(label > self->max_label)
+	{
+		*first = *last = self->n_runs;
+		return 0;
+	}
+	
+	*first = self->offset[label];
+	*last  = self->offset[label + 1];
+	
+	return *last - *first;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return number of voxels belonging to a source                     //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) label    - Source label.                                    //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Number of voxels belonging to the specified source.             //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the total number of voxels in all   //
+//   runs belonging to the specified source label.                   //
+// ----------------------------------------------------------------- //
+
+PUBLIC size_t VoxelIndex_get_npix(const VoxelIndex *self, const size_t label)
+{
+	size_t first, last, n_pix = 0;
+	VoxelIndex_get_runs(self, label, &first, &last);
+	for(size_t i = first; i < last; ++i) n_pix += self->run[i].length;
+	
+	return n_pix;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Retrieve run                                                      //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) index    - Index of the run.                                //
+//   (3) x        - Pointer for x coordinate of first voxel of run.  //
+//   (4) y        - Pointer for y coordinate of run.                 //
+//   (5) z        - Pointer for z coordinate of run.                 //
+//   (6) length   - Pointer for number of voxels in run.             //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for retrieving the position and length of the     //
+//   run with the specified index. Valid indices for a given source  //
+//   label can be obtained from VoxelIndex_get_runs().               //
+// ----------------------------------------------------------------- //
+
+PUBLIC void VoxelIndex_get_run(const VoxelIndex *self, const size_t index, size_t *x, size_t *y, size_t *z, size_t *length)
+{
+	check_null(self);
+	ensure(index < self->n_runs, ERR_INDEX_RANGE, "Run index out of range.");
+	
+	*x      = self->run[index].x;
+	*y      = self->run[index].yz & UINT32_MAX;
+	*z      = self->run[index].yz >> 32;
+	*length = self->run[index].length;
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Relabel sources                                                   //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self     - Object self-reference.                           //
+//   (2) filter   - Map object with old and new label pairs of all   //
+//                  sources to be retained.                          //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for relabelling all sources in the index in the   //
+//   same way as DataCube_filter_mask_32() relabels the mask. Runs   //
+//   of labels contained in the filter will be assigned their new    //
+//   label, while all other runs will be removed. The index will be  //
+//   finalised again afterwards.                                     //
+// ----------------------------------------------------------------- //
+
+PUBLIC void VoxelIndex_relabel(VoxelIndex *self, const Map *filter)
+{
+	// Sanity checks
+	check_null(self);
+	check_null(filter);
+	ensure(self->finalised, ERR_FAILURE, "Voxel index must be finalised before use.");
+	
+	size_t counter = 0;
+	size_t max_label = 0;
+	
+	// Look up each label only once, as runs are grouped by label
+	for(size_t label = 1; label <= self->max_label; ++label)
+	{
+		if(self->offset[label + 1] == self->offset[label] || !Map_key_exists(filter, label)) continue;
+		const size_t new_label = Map_get_value(filter, label);
+		if(new_label == 0) continue;
+		if(new_label > max_label) max_label = new_label;
+		
+		for(size_t i = self->offset[label]; i < self->offset[label + 1]; ++i)
+		{
+			self->label[counter] = new_label;
+			self->run[counter]   = self->run[i];
+			++counter;
+		}
+	}
+	
+	self->n_runs = counter;
+	self->max_label = max_label;
+	self->finalised = false;
+	VoxelIndex_finalise(self);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Compare two runs                                                  //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) a        - Pointer to first run.                            //
+//   (2) b        - Pointer to second run.                           //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   -1, 0 or 1 if a is less than, equal to or greater than b.       //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Private comparison function for qsort() to sort runs in the     //
+//   order z, y, x. As z is stored in the upper and y in the lower   //
+//   32 bits of the packed position, comparing the packed values is  //
+//   sufficient to establish the order in z and y.                   //
+// ----------------------------------------------------------------- //
+
+PRIVATE int VoxelIndex_cmp_run(const void *a, const void *b)
+{
+	const VoxelRun *run_a = (const VoxelRun *)a;
+	const VoxelRun *run_b = (const VoxelRun *)b;
+	
+	if(run_a->yz != run_b->yz) return run_a->yz < run_b->yz ? -1 : 1;
+	return run_a->x < run_b->x ? -1 : (run_a->x > run_b->x ? 1 : 0);
+}
@@ -0,0 +1,78 @@
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// SoFiA 2.2.1 (VoxelIndex.h) - Source Finding Application              ///
+/// Copyright (C) 2020 Tobias Westmeier                                  ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// Address:  Tobias Westmeier                                           ///
+///           ICRAR M468                                                 ///
+///           The University of Western Australia                        ///
+///           35 Stirling Highway                                        ///
+///           Crawley WA 6009                                            ///
+///           Australia                                                  ///
+///                                                                      ///
+/// E-mail:   tobias.westmeier [at] uwa.edu.au                           ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+/// This program is free software: you can redistribute it and/or modify ///
+/// it under the terms of the GNU General Public License as published by ///
+/// the Free Software Foundation, either version 3 of the License, or    ///
+/// (at your option) any later version.                                  ///
+///                                                                      ///
+/// This program is distributed in the hope that it will be useful,      ///
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of       ///
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         ///
+/// GNU General Public License for more details.                         ///
+///                                                                      ///
+/// You should have received a copy of the GNU General Public License    ///
+/// along with this program. If not, see http://www.gnu.org/licenses/.   ///
+/// ____________________________________________________________________ ///
+///                                                                      ///
+
+#ifndef VOXELINDEX_H
+#define VOXELINDEX_H
+
+#include <stdint.h>
+
+#include "common.h"
+#include "Map.h"
+
+
+// ----------------------------------------------------------------- //
+// Class 'VoxelIndex'                                                //
+// ----------------------------------------------------------------- //
+// The purpose of this class is to provide a compact index of the    //
+// voxels belonging to each source in a labelled mask. Voxels are    //
+// stored as runs of consecutive pixels along the x-axis, and runs   //
+// are grouped by source label in compressed sparse row (CSR) form,  //
+// such that all runs of a source can be accessed directly without   //
+// having to search through the source's bounding box. Each run only //
+// stores its starting x position and length as 32-bit integers plus //
+// its y and z position packed into a single 64-bit integer. Within  //
+// each source, runs are sorted in the order z, y, x, and adjacent   //
+// runs are merged, such that they can be added in any order.        //
+// ----------------------------------------------------------------- //
+
+typedef CLASS VoxelIndex VoxelIndex;
+typedef struct VoxelRun VoxelRun;
+
+// Constructor and destructor
+PUBLIC VoxelIndex  *VoxelIndex_new          (void);
+PUBLIC void         VoxelIndex_delete       (VoxelIndex *self);
+
+// Public methods
+PUBLIC void         VoxelIndex_clear        (VoxelIndex *self);
+PUBLIC void         VoxelIndex_push         (VoxelIndex *self, const size_t label, const size_t x, const size_t y, const size_t z, const size_t length);
+PUBLIC void         VoxelIndex_discard      (VoxelIndex *self, const size_t label);
+PUBLIC void         VoxelIndex_finalise     (VoxelIndex *self);
+PUBLIC size_t       VoxelIndex_get_size     (const VoxelIndex *self);
+PUBLIC size_t       VoxelIndex_get_max_label(const VoxelIndex *self);
+PUBLIC size_t       VoxelIndex_get_runs     (const VoxelIndex *self, const size_t label, size_t *first, size_t *last);
+PUBLIC size_t       VoxelIndex_get_npix     (const VoxelIndex *self, const size_t label);
+PUBLIC void         VoxelIndex_get_run      (const VoxelIndex *self, const size_t index, size_t *x, size_t *y, size_t *z, size_t *length);
+PUBLIC void         VoxelIndex_relabel      (VoxelIndex *self, const Map *filter);
+
+// Private methods
+PRIVATE int         VoxelIndex_cmp_run      (const void *a, const void *b);
+
+#endif
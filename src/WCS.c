@@ -30,6 +30,7 @@
 ///                                                                      ///
 
 #include <stdlib.h>
+#include <math.h>
 
 #include <wcslib/wcs.h>
 #include <wcslib/wcshdr.h>
@@ -48,6 +49,8 @@ CLASS WCS
 	bool valid;
 	struct wcsprm *wcs_pars;
 	int  n_wcs_rep;
+	double *spectral;
+	size_t  n_spectral;
 };
 
 
@@ -96,6 +99,8 @@ PUBLIC WCS *WCS_new(const char *header, const int n_keys, const int n_axes, cons
 	self->valid = false;
 	self->wcs_pars = NULL;
 	self->n_wcs_rep = 0;
+	self->spectral = NULL;
+	self->n_spectral = 0;
 	
 	// Set up WCS object from header information
 	WCS_setup(self, header, n_keys, n_axes, dim_axes);
@@ -133,6 +138,7 @@ PUBLIC void WCS_delete(WCS *self)
 		free(self->wcs_pars);
 	}
 	
+	if(self != NULL) free(self->spectral);
 	free(self);
 	
 	return;
@@ -208,9 +214,13 @@ PRIVATE void WCS_setup(WCS *self, const char *header, const int n_keys, const in
 	int status = wcsini(true, n_axes, self->wcs_pars);
 	
 	// Parse the FITS header to fill in the wcsprm structure
-	if(!status) status = wcspih((char *)header, n_keys, WCSHDR_all, 0, &n_rejected, &self->n_wcs_rep, &self->wcs_pars);
-	// NOTE: The (char *) cast is necessary as wcspih would actually
-	//       manipulate the header if the 4th argument was negative!
+	// (serialised, as the header parser of older wcslib versions is not re-entrant)
+	#pragma omp critical(WCS_header_parser)
+	{
+		if(!status) status = wcspih((char *)header, n_keys, WCSHDR_all, 0, &n_rejected, &self->n_wcs_rep, &self->wcs_pars);
+		// NOTE: The (char *) cast is necessary as wcspih would actually
+		//       manipulate the header if the 4th argument was negative!
+	}
 	
 	// Apply all necessary corrections to wcsprm structure
 	// (missing cards, non-standard units or spectral types, etc.)
@@ -395,3 +405,259 @@ PUBLIC void WCS_convertToPixel(const WCS *self, const double longitude, const do
 	
 	return;
 }
+
+
+
+// ----------------------------------------------------------------- //
+// Convert array of pixel coordinates to world coordinates           //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) size      - Number of coordinates to be converted.          //
+//   (3) x         - Array of x coordinates (0-based).               //
+//   (4) y         - Array of y coordinates (0-based).               //
+//   (5) z         - Array of z coordinates (0-based).               //
+//   (6) longitude - Array for holding longitude coordinates.        //
+//   (7) latitude  - Array for holding latitude coordinates.         //
+//   (8) spectral  - Array for holding spectral coordinates.         //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for converting an entire array of pixel coordi-   //
+//   nates (x, y, z) to world coordinates (longitude, latitude, spe- //
+//   ctral). This is equivalent to calling WCS_convertToWorld() for  //
+//   each element, but passes the coordinates to wcslib in blocks of //
+//   WCS_BATCH_SIZE, thereby avoiding the overhead of one memory al- //
+//   location and one library call per coordinate. Any of the input  //
+//   arrays can be NULL, in which case the corresponding pixel coor- //
+//   dinate is assumed to be 0. Any of the output arrays can be NULL //
+//   in which case it is not updated. Input and output arrays are    //
+//   allowed to be identical. If an individual coordinate is invalid //
+//   then a warning message will be printed and its output values    //
+//   will be left unchanged.                                         //
+// ----------------------------------------------------------------- //
+
+PUBLIC void WCS_convertToWorldArray(const WCS *self, const size_t size, const double *x, const double *y, const double *z, double *longitude, double *latitude, double *spectral)
+{
+	// Sanity checks
+	ensure(WCS_is_valid(self), ERR_USER_INPUT, "Failed to convert coordinates; no valid WCS definition found.");
+	
+	// Determine number of WCS axes
+	const size_t n_axes = self->wcs_pars->naxis;
+	ensure(n_axes, ERR_USER_INPUT, "Failed to convert coordinates; no valid WCS axes found.");
+	
+	if(size == 0) return;
+	const size_t n_block = size < WCS_BATCH_SIZE ? size : WCS_BATCH_SIZE;
+	
+	// Allocate memory for coordinate arrays
+	double *coord_pixel = (double *)memory(MALLOC, n_block * n_axes, sizeof(double));
+	double *coord_world = (double *)memory(MALLOC, n_block * n_axes, sizeof(double));
+	double *tmp_world   = (double *)memory(MALLOC, n_block * n_axes, sizeof(double));
+	double *phi         = (double *)memory(MALLOC, n_block, sizeof(double));
+	double *theta       = (double *)memory(MALLOC, n_block, sizeof(double));
+	int    *stat        = (int *)   memory(MALLOC, n_block, sizeof(int));
+	
+	for(size_t first = 0; first < size; first += n_block)
+	{
+		const size_t n_coord = size - first < n_block ? size - first : n_block;
+		
+		// Initialise pixel coordinates
+		// NOTE: WCS pixel arrays are 1-based!!!
+		for(size_t i = 0; i < n_coord; ++i)
+		{
+			double *ptr = coord_pixel + i * n_axes;
+			for(size_t j = 0; j < n_axes; ++j) ptr[j] = 1.0;
+			if(x != NULL)               ptr[0] += x[first + i];
+			if(y != NULL && n_axes > 1) ptr[1] += y[first + i];
+			if(z != NULL && n_axes > 2) ptr[2] += z[first + i];
+		}
+		
+		// Call WCS conversion module
+		// NOTE: A status of WCSERR_BAD_PIX means that only some of the coordinates
+		//       were invalid, in which case 'stat' flags the affected elements.
+		const int status = wcsp2s(self->wcs_pars, n_coord, n_axes, coord_pixel, tmp_world, phi, theta, coord_world, stat);
+		
+		for(size_t i = 0; i < n_coord; ++i)
+		{
+			if(status && (status != WCSERR_BAD_PIX || stat[i]))
+			{
+				warning("wcslib error %d: %s", status, wcs_errmsg[status]);
+				continue;
+			}
+			
+			// Pass back world coordinates
+			const double *ptr = coord_world + i * n_axes;
+			if(longitude != NULL)               longitude[first + i] = ptr[0];
+			if(latitude  != NULL && n_axes > 1) latitude [first + i] = ptr[1];
+			if(spectral  != NULL && n_axes > 2) spectral [first + i] = ptr[2];
+		}
+	}
+	
+	// Clean up
+	free(coord_pixel);
+	free(coord_world);
+	free(tmp_world);
+	free(phi);
+	free(theta);
+	free(stat);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Convert array of world coordinates to pixel coordinates           //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) size      - Number of coordinates to be converted.          //
+//   (3) longitude - Array of longitude coordinates.                 //
+//   (4) latitude  - Array of latitude coordinates.                  //
+//   (5) spectral  - Array of spectral coordinates.                  //
+//   (6) x         - Array for holding x coordinates (0-based).      //
+//   (7) y         - Array for holding y coordinates (0-based).      //
+//   (8) z         - Array for holding z coordinates (0-based).      //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   No return value.                                                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for converting an entire array of world coordi-   //
+//   nates (longitude, latitude, spectral) to pixel coordinates (x,  //
+//   y, z). This is the array equivalent of WCS_convertToPixel(). As //
+//   with WCS_convertToWorldArray(), NULL input arrays are taken to  //
+//   be 0, NULL output arrays are not updated, input and output ar-  //
+//   rays may be identical, and the output values of invalid coordi- //
+//   nates will be left unchanged after printing a warning message.  //
+// ----------------------------------------------------------------- //
+
+PUBLIC void WCS_convertToPixelArray(const WCS *self, const size_t size, const double *longitude, const double *latitude, const double *spectral, double *x, double *y, double *z)
+{
+	// Sanity checks
+	ensure(WCS_is_valid(self), ERR_USER_INPUT, "Failed to convert coordinates; no valid WCS definition found.");
+	
+	// Determine number of WCS axes
+	const size_t n_axes = self->wcs_pars->naxis;
+	ensure(n_axes, ERR_USER_INPUT, "Failed to convert coordinates; no valid WCS axes found.");
+	
+	if(size == 0) return;
+	const size_t n_block = size < WCS_BATCH_SIZE ? size : WCS_BATCH_SIZE;
+	
+	// Allocate memory for coordinate arrays
+	double *coord_pixel = (double *)memory(MALLOC, n_block * n_axes, sizeof(double));
+	double *coord_world = (double *)memory(MALLOC, n_block * n_axes, sizeof(double));
+	double *tmp_world   = (double *)memory(MALLOC, n_block * n_axes, sizeof(double));
+	double *phi         = (double *)memory(MALLOC, n_block, sizeof(double));
+	double *theta       = (double *)memory(MALLOC, n_block, sizeof(double));
+	int    *stat        = (int *)   memory(MALLOC, n_block, sizeof(int));
+	
+	for(size_t first = 0; first < size; first += n_block)
+	{
+		const size_t n_coord = size - first < n_block ? size - first : n_block;
+		
+		// Initialise world coordinates
+		for(size_t i = 0; i < n_coord; ++i)
+		{
+			double *ptr = coord_world + i * n_axes;
+			for(size_t j = 0; j < n_axes; ++j) ptr[j] = 0.0;
+			if(longitude != NULL)               ptr[0] = longitude[first + i];
+			if(latitude  != NULL && n_axes > 1) ptr[1] = latitude [first + i];
+			if(spectral  != NULL && n_axes > 2) ptr[2] = spectral [first + i];
+		}
+		
+		// Call WCS conversion module
+		// NOTE: A status of WCSERR_BAD_WORLD means that only some of the coordinates
+		//       were invalid, in which case 'stat' flags the affected elements.
+		const int status = wcss2p(self->wcs_pars, n_coord, n_axes, coord_world, phi, theta, tmp_world, coord_pixel, stat);
+		
+		for(size_t i = 0; i < n_coord; ++i)
+		{
+			if(status && (status != WCSERR_BAD_WORLD || stat[i]))
+			{
+				warning("wcslib error %d: %s", status, wcs_errmsg[status]);
+				continue;
+			}
+			
+			// Pass back pixel coordinates
+			// NOTE: WCS pixel arrays are 1-based!!!
+			const double *ptr = coord_pixel + i * n_axes;
+			if(x != NULL)               x[first + i] = ptr[0] - 1.0;
+			if(y != NULL && n_axes > 1) y[first + i] = ptr[1] - 1.0;
+			if(z != NULL && n_axes > 2) z[first + i] = ptr[2] - 1.0;
+		}
+	}
+	
+	// Clean up
+	free(coord_pixel);
+	free(coord_world);
+	free(tmp_world);
+	free(phi);
+	free(theta);
+	free(stat);
+	
+	return;
+}
+
+
+
+// ----------------------------------------------------------------- //
+// Return spectral coordinates of all channels                       //
+// ----------------------------------------------------------------- //
+// Arguments:                                                        //
+//                                                                   //
+//   (1) self      - Object self-reference.                          //
+//   (2) size_z    - Number of channels along the spectral axis.     //
+//                                                                   //
+// Return value:                                                     //
+//                                                                   //
+//   Pointer to array of size_z spectral coordinates.                //
+//                                                                   //
+// Description:                                                      //
+//                                                                   //
+//   Public method for returning the spectral coordinate of each of  //
+//   the first size_z channels of the cube, evaluated at the spatial //
+//   pixel position (0, 0). The coordinates are calculated only once //
+//   with a single call to WCS_convertToWorldArray() and then cached //
+//   in the WCS object, such that repeated requests for the spectral //
+//   axis will not involve wcslib again. The returned array is owned //
+//   by the WCS object and must not be freed or modified by the user //
+//   and will become invalid once the WCS object is deleted. Chan-   //
+//   nels for which the conversion fails will be set to NaN and must //
+//   be skipped by the caller.                                       //
+// ----------------------------------------------------------------- //
+
+PUBLIC const double *WCS_get_spectral_axis(WCS *self, const size_t size_z)
+{
+	// Sanity checks
+	ensure(WCS_is_valid(self), ERR_USER_INPUT, "Failed to convert coordinates; no valid WCS definition found.");
+	ensure(size_z, ERR_USER_INPUT, "Failed to convert coordinates; spectral axis is empty.");
+	
+	// Fill cache on first request
+	if(self->spectral == NULL || self->n_spectral != size_z)
+	{
+		self->spectral = (double *)memory_realloc(self->spectral, size_z, sizeof(double));
+		self->n_spectral = size_z;
+		
+		double *channel = (double *)memory(MALLOC, size_z, sizeof(double));
+		
+		for(size_t i = 0; i < size_z; ++i)
+		{
+			channel[i] = (double)i;
+			self->spectral[i] = NAN;
+		}
+		
+		WCS_convertToWorldArray(self, size_z, NULL, NULL, channel, NULL, NULL, self->spectral);
+		free(channel);
+	}
+	
+	return self->spectral;
+}
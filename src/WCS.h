@@ -34,6 +34,8 @@
 
 #include "common.h"
 
+#define WCS_BATCH_SIZE 4096
+
 
 // ----------------------------------------------------------------- //
 // Class 'WCS'                                                       //
@@ -49,15 +51,18 @@
 typedef CLASS WCS WCS;
 
 // Constructor and destructor
-PUBLIC  WCS  *WCS_new            (const char *header, const int n_keys, const int n_axes, const int *dim_axes);
-PUBLIC  void  WCS_delete         (WCS *self);
+PUBLIC  WCS          *WCS_new                 (const char *header, const int n_keys, const int n_axes, const int *dim_axes);
+PUBLIC  void          WCS_delete              (WCS *self);
 
 // Public methods
-PUBLIC  bool  WCS_is_valid       (const WCS *self);
-PUBLIC  void  WCS_convertToWorld (const WCS *self, const double x, const double y, const double z, double *longitude, double *latitude, double *spectral);
-PUBLIC  void  WCS_convertToPixel (const WCS *self, const double longitude, const double latitude, const double spectral, double *x, double *y, double *z);
+PUBLIC  bool          WCS_is_valid            (const WCS *self);
+PUBLIC  void          WCS_convertToWorld      (const WCS *self, const double x, const double y, const double z, double *longitude, double *latitude, double *spectral);
+PUBLIC  void          WCS_convertToPixel      (const WCS *self, const double longitude, const double latitude, const double spectral, double *x, double *y, double *z);
+PUBLIC  void          WCS_convertToWorldArray (const WCS *self, const size_t size, const double *x, const double *y, const double *z, double *longitude, double *latitude, double *spectral);
+PUBLIC  void          WCS_convertToPixelArray (const WCS *self, const size_t size, const double *longitude, const double *latitude, const double *spectral, double *x, double *y, double *z);
+PUBLIC  const double *WCS_get_spectral_axis   (WCS *self, const size_t size_z);
 
 // Private methods
-PRIVATE void  WCS_setup          (WCS *self, const char *header, const int n_keys, const int n_axes, const int *dim_axes);
+PRIVATE void          WCS_setup               (WCS *self, const char *header, const int n_keys, const int n_axes, const int *dim_axes);
 
 #endif
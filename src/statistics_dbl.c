@@ -671,6 +671,18 @@ double median_safe_dbl(const double *data, const size_t size, const bool fast)
 
 
 
+// Histogram bin of absolute value for mad_val() and median_abs()
+
+static inline size_t noise_bin_dbl(const double value)
+{
+	const float abs_value = fabs(value);
+	uint32_t bits;
+	memcpy(&bits, &abs_value, sizeof(bits));
+	return bits >> 20;
+}
+
+
+
 // --------------------------------------------------------- //
 // Median absolute deviation from value                      //
 // --------------------------------------------------------- //
@@ -699,13 +711,19 @@ double median_safe_dbl(const double *data, const size_t size, const bool fast)
 //                                                           //
 //   where x denotes the data values from the input array.   //
 //   NOTE that this function is NaN-safe and will not modify //
-//   the original data array.                                //
+//   the original data array. For large arrays the median is //
+//   located with the help of a histogram by mad_val_hist(). //
 // --------------------------------------------------------- //
 
 double mad_val_dbl(const double *data, const size_t size, const double value, const size_t cadence, const int range)
 {
-	// Create copy of data array with specified range and cadence
+	// Maximum number of values to be considered
 	const size_t data_copy_size = (range == 0) ? (size / cadence) : (size / (2 * cadence));
+	
+	// Use histogram of absolute deviations for large arrays
+	if(data_copy_size >= NOISE_HIST_MIN_SIZE) return mad_val_hist_dbl(data, size, value, cadence, range, data_copy_size);
+	
+	// Create copy of data array with specified range and cadence
 	double *data_copy = (double *)memory(MALLOC, data_copy_size, sizeof(double));
 	
 	// Some settings
@@ -734,6 +752,88 @@ double mad_val_dbl(const double *data, const size_t size, const double value, co
 
 
 
+// Same as mad_val(), but using a histogram of the absolute deviations
+// to locate the median, such that only the values in the bin contain-
+// ing the median need to be copied; the result is identical. The elements
+// are selected in exactly the same way as in mad_val(), including the
+// limit of max_count values.
+
+double mad_val_hist_dbl(const double *data, const size_t size, const double value, const size_t cadence, const int range, const size_t max_count)
+{
+	// Histogram of absolute deviations of all selected elements
+	size_t histogram[NOISE_HIST_BINS] = {0};
+	const double *ptr = data + size;
+	size_t counter = 0;
+	
+	// NOTE: Selection is done without branching, as the sign of the
+	//       data values is essentially random in the case of noise.
+	while((ptr -= cadence) > data && counter < max_count)
+	{
+		const bool selected = (range < 0) ? (*ptr < 0.0) : ((range > 0) ? (*ptr > 0.0) : IS_NOT_NAN(*ptr));
+		histogram[noise_bin_dbl(*ptr - value)] += selected;
+		counter += selected;
+	}
+	
+	if(counter == 0) return NAN;
+	
+	// Locate bin containing the element of rank counter / 2
+	size_t rank = counter / 2;
+	size_t bin = 0;
+	while(rank >= histogram[bin]) rank -= histogram[bin++];
+	
+	// Copy values of all elements in that bin
+	// NOTE: One extra element is allocated, as every value is written
+	//       to the copy before deciding whether to keep it.
+	const size_t size_copy = histogram[bin];
+	double *data_copy = (double *)memory(MALLOC, size_copy + 1, sizeof(double));
+	double *ptr_copy = data_copy;
+	
+	ptr = data + size;
+	counter = 0;
+	
+	while((ptr -= cadence) > data && counter < max_count)
+	{
+		const bool selected = (range < 0) ? (*ptr < 0.0) : ((range > 0) ? (*ptr > 0.0) : IS_NOT_NAN(*ptr));
+		const double deviation = fabs(*ptr - value);
+		*ptr_copy = deviation;
+		ptr_copy += selected & (noise_bin_dbl(deviation) == bin);
+		counter += selected;
+	}
+	
+	// Determine median
+	const double result = nth_element_dbl(data_copy, size_copy, rank);
+	double lower = result;
+	
+	if(IS_EVEN(counter))
+	{
+		if(rank) lower = max_dbl(data_copy, rank);
+		else
+		{
+			// Rare case of lower middle element falling into a lower bin
+			ptr = data + size;
+			counter = 0;
+			lower = 0.0;
+			
+			while((ptr -= cadence) > data && counter < max_count)
+			{
+				if((range < 0 && *ptr < 0.0) || (range == 0 && IS_NOT_NAN(*ptr)) || (range > 0 && *ptr > 0.0))
+				{
+					const double deviation = fabs(*ptr - value);
+					if(noise_bin_dbl(deviation) < bin && deviation > lower) lower = deviation;
+					++counter;
+				}
+			}
+		}
+	}
+	
+	// Clean up
+	free(data_copy);
+	
+	return IS_ODD(counter) ? result : (result + lower) / 2.0;
+}
+
+
+
 // --------------------------------------------------------- //
 // Median absolute deviation                                 //
 // --------------------------------------------------------- //
@@ -821,24 +921,90 @@ double robust_noise_dbl(const double *data, const size_t size)
 
 
 
-// Same, but using positive and negative values
-
-double robust_noise_2_dbl(const double *data, const size_t size)
+// --------------------------------------------------------- //
+// Pseudo-median of absolute values                          //
+// --------------------------------------------------------- //
+//                                                           //
+// Arguments:                                                //
+//                                                           //
+//   (1) data - Pointer to the data array.                   //
+//   (2) size - Size of the array.                           //
+//                                                           //
+// Returns:                                                  //
+//                                                           //
+//   Pseudo-median of the absolute values of the data.       //
+//                                                           //
+// Description:                                              //
+//                                                           //
+//   Returns the element of rank size / 2 of the absolute    //
+//   values of all non-NaN elements in the data array, or    //
+//   NaN if no valid data are found. The data array will     //
+//   not be altered. For small arrays, all absolute values   //
+//   are copied and passed to nth_element(). For larger      //
+//   arrays, the absolute values are first binned by the     //
+//   leading 12 bits of their single-precision               //
+//   representation, which is monotonic in the value. Only   //
+//   the values falling into the bin that contains the       //
+//   pseudo-median are then copied and passed to             //
+//   nth_element(), which yields the same exact result at    //
+//   a fraction of the cost.                                 //
+// --------------------------------------------------------- //
+
+double median_abs_dbl(const double *data, const size_t size)
 {
-	// Allocate memory for 1D data copy
-	double *data_copy = (double *)memory(MALLOC, size, sizeof(double));
+	if(size < NOISE_HIST_MIN_SIZE)
+	{
+		// Allocate memory for 1D data copy
+		double *data_copy = (double *)memory(MALLOC, size, sizeof(double));
+		double *ptr_copy = data_copy;
+		
+		// Copy values of all non-NaN elements
+		for(const double *ptr = data + size; ptr --> data;)
+		{
+			if(*ptr < 0.0) *ptr_copy++ = -(*ptr);
+			else if(*ptr >= 0.0) *ptr_copy++ = *ptr;
+		}
+		
+		// Calculate pseudo-median
+		const size_t size_copy = ptr_copy - data_copy;
+		const double result = size_copy ? nth_element_dbl(data_copy, size_copy, size_copy / 2) : NAN;
+		
+		// Clean up and return result
+		free(data_copy);
+		return result;
+	}
+	
+	// Histogram of absolute values of all non-NaN elements
+	size_t histogram[NOISE_HIST_BINS] = {0};
+	size_t counter = 0;
+	
+	for(const double *ptr = data + size; ptr --> data;)
+	{
+		if(IS_NOT_NAN(*ptr))
+		{
+			++histogram[noise_bin_dbl(*ptr)];
+			++counter;
+		}
+	}
+	
+	if(counter == 0) return NAN;
+	
+	// Locate bin containing the pseudo-median
+	size_t rank = counter / 2;
+	size_t bin = 0;
+	while(rank >= histogram[bin]) rank -= histogram[bin++];
+	
+	// Copy values of all elements in that bin
+	double *data_copy = (double *)memory(MALLOC, histogram[bin], sizeof(double));
 	double *ptr_copy = data_copy;
 	
-	// Copy values of all non-NaN elements
 	for(const double *ptr = data + size; ptr --> data;)
 	{
-		if(*ptr < 0.0) *ptr_copy++ = -(*ptr);
-		else if(*ptr >= 0.0) *ptr_copy++ = *ptr;
+		if(IS_NOT_NAN(*ptr) && noise_bin_dbl(*ptr) == bin) *ptr_copy++ = *ptr < 0.0 ? -(*ptr) : *ptr;
 	}
 	
 	// Calculate pseudo-median
-	const size_t size_copy = ptr_copy - data_copy;
-	const double result = size_copy ? MAD_TO_STD * nth_element_dbl(data_copy, size_copy, size_copy / 2) : NAN;
+	const double result = nth_element_dbl(data_copy, histogram[bin], rank);
 	
 	// Clean up and return result
 	free(data_copy);
@@ -847,6 +1013,15 @@ double robust_noise_2_dbl(const double *data, const size_t size)
 
 
 
+// Same as robust_noise(), but using positive and negative values
+
+double robust_noise_2_dbl(const double *data, const size_t size)
+{
+	return MAD_TO_STD * median_abs_dbl(data, size);
+}
+
+
+
 // --------------------------------------------------------- //
 // Robust noise measurement in region of 3D array            //
 // --------------------------------------------------------- //
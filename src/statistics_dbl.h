@@ -46,6 +46,12 @@
 #define BOXCAR_MIN_ITER 3
 #define BOXCAR_MAX_ITER 6
 
+// ------------------------------------ //
+// Settings for histogram-based noise   //
+// ------------------------------------ //
+#define NOISE_HIST_BINS 2048
+#define NOISE_HIST_MIN_SIZE 256
+
 
 
 // -------------------- //
@@ -82,10 +88,12 @@ double median_dbl(double *data, const size_t size, const bool fast);
 double median_safe_dbl(const double *data, const size_t size, const bool fast);
 double mad_dbl(double *data, const size_t size);
 double mad_val_dbl(const double *data, const size_t size, const double value, const size_t cadence, const int range);
+double mad_val_hist_dbl(const double *data, const size_t size, const double value, const size_t cadence, const int range, const size_t max_count);
 
 // Robust and fast noise measurement
 double robust_noise_dbl(const double *data, const size_t size);
 double robust_noise_2_dbl(const double *data, const size_t size);
+double median_abs_dbl(const double *data, const size_t size);
 double robust_noise_in_region_dbl(const double *data, const size_t nx, const size_t ny, const size_t x1, const size_t x2, const size_t y1, const size_t y2, const size_t z1, const size_t z2);
 
 // Gaussian fit to histogram
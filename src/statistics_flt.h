@@ -46,6 +46,12 @@
 #define BOXCAR_MIN_ITER 3
 #define BOXCAR_MAX_ITER 6
 
+// ------------------------------------ //
+// Settings for histogram-based noise   //
+// ------------------------------------ //
+#define NOISE_HIST_BINS 2048
+#define NOISE_HIST_MIN_SIZE 256
+
 
 
 // -------------------- //
@@ -82,10 +88,12 @@ float median_flt(float *data, const size_t size, const bool fast);
 float median_safe_flt(const float *data, const size_t size, const bool fast);
 float mad_flt(float *data, const size_t size);
 float mad_val_flt(const float *data, const size_t size, const float value, const size_t cadence, const int range);
+float mad_val_hist_flt(const float *data, const size_t size, const float value, const size_t cadence, const int range, const size_t max_count);
 
 // Robust and fast noise measurement
 float robust_noise_flt(const float *data, const size_t size);
 float robust_noise_2_flt(const float *data, const size_t size);
+float median_abs_flt(const float *data, const size_t size);
 float robust_noise_in_region_flt(const float *data, const size_t nx, const size_t ny, const size_t x1, const size_t x2, const size_t y1, const size_t y2, const size_t z1, const size_t z2);
 
 // Gaussian fit to histogram
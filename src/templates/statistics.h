@@ -46,6 +46,12 @@
 #define BOXCAR_MIN_ITER 3
 #define BOXCAR_MAX_ITER 6
 
+// ------------------------------------ //
+// Settings for histogram-based noise   //
+// ------------------------------------ //
+#define NOISE_HIST_BINS 2048
+#define NOISE_HIST_MIN_SIZE 256
+
 
 
 // -------------------- //
@@ -82,10 +88,12 @@ DATA_T median_SFX(DATA_T *data, const size_t size, const bool fast);
 DATA_T median_safe_SFX(const DATA_T *data, const size_t size, const bool fast);
 DATA_T mad_SFX(DATA_T *data, const size_t size);
 DATA_T mad_val_SFX(const DATA_T *data, const size_t size, const DATA_T value, const size_t cadence, const int range);
+DATA_T mad_val_hist_SFX(const DATA_T *data, const size_t size, const DATA_T value, const size_t cadence, const int range, const size_t max_count);
 
 // Robust and fast noise measurement
 DATA_T robust_noise_SFX(const DATA_T *data, const size_t size);
 DATA_T robust_noise_2_SFX(const DATA_T *data, const size_t size);
+DATA_T median_abs_SFX(const DATA_T *data, const size_t size);
 DATA_T robust_noise_in_region_SFX(const DATA_T *data, const size_t nx, const size_t ny, const size_t x1, const size_t x2, const size_t y1, const size_t y2, const size_t z1, const size_t z2);
 
 // Gaussian fit to histogram